@@ -0,0 +1,472 @@
+// macposts_bench: times the hot paths of the library on synthetic networks.
+//
+// Every case writes one JSON object per line to the output file (the library
+// itself prints to stdout, so the results are kept apart from that); a short
+// summary goes to stderr. Run with --help for the options.
+
+#include "synthetic.h"
+
+#include "dta.h"
+#include "dta_gradient_utls.h"
+#include "due.h"
+#include "multiclass.h"
+#include "path.h"
+#include "shortest_path.h"
+#include "ults.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+struct Options
+{
+  std::string m_output = "macposts_bench.jsonl";
+  std::string m_workdir = "macposts_bench_data";
+  // side of the grid, the ring-radial network has a comparable size
+  int m_scale = 10;
+  int m_repeats = 3;
+  int m_max_interval = 10;
+  int m_due_iters = 3;
+  // folder of a single class network to replicate, e.g. Sioux Falls
+  std::string m_replicate;
+  int m_copies = 4;
+  // only the cases whose name contains this
+  std::string m_filter;
+};
+
+class Recorder
+{
+public:
+  explicit Recorder (const std::string &file_name) : m_file (file_name)
+  {
+    if (!m_file.is_open ())
+      {
+        throw std::runtime_error ("failed to open file: " + file_name);
+      }
+  }
+
+  // seconds of each repeat of bench on network
+  void write (const std::string &network, const std::string &bench,
+              const MNM_Dta *dta, std::vector<double> seconds)
+  {
+    std::sort (seconds.begin (), seconds.end ());
+    double _mean = std::accumulate (seconds.begin (), seconds.end (), 0.)
+                   / seconds.size ();
+    double _median = seconds[seconds.size () / 2];
+    m_file << "{\"network\": \"" << network << "\", \"bench\": \"" << bench
+           << "\", \"nodes\": " << dta->m_node_factory->m_node_map.size ()
+           << ", \"links\": " << dta->m_link_factory->m_link_map.size ()
+           << ", \"repeats\": " << seconds.size ()
+           << ", \"min_s\": " << seconds.front ()
+           << ", \"median_s\": " << _median << ", \"mean_s\": " << _mean
+           << "}\n";
+    m_file.flush ();
+    std::fprintf (stderr, "%-28s %-16s %12.6f s\n", network.c_str (),
+                  bench.c_str (), _median);
+  }
+
+private:
+  std::ofstream m_file;
+};
+
+double
+time_once (const std::function<void ()> &job)
+{
+  auto _start = std::chrono::steady_clock::now ();
+  job ();
+  std::chrono::duration<double> _elapsed
+    = std::chrono::steady_clock::now () - _start;
+  return _elapsed.count ();
+}
+
+MNM_Dta *
+build_dta (const std::string &folder)
+{
+  MNM_Dta *_dta = new MNM_Dta (folder);
+  _dta->build_from_files ();
+  _dta->hook_up_node_and_link ();
+  _dta->is_ok ();
+  return _dta;
+}
+
+// link travel times (intervals) after loading, for every loading interval
+std::unordered_map<TInt, TFlt *>
+link_tt_map (MNM_Dta *dta)
+{
+  std::unordered_map<TInt, TFlt *> _tt;
+  int _num = dta->m_current_loading_interval;
+  for (auto _it : dta->m_link_factory->m_link_map)
+    {
+      _tt[_it.first] = new TFlt[_num];
+      for (int i = 0; i < _num; ++i)
+        {
+          _tt[_it.first][i]
+            = MNM_DTA_GRADIENT::get_travel_time (_it.second, TFlt (i + 1),
+                                                 dta->m_unit_time, _num);
+        }
+    }
+  return _tt;
+}
+
+void
+free_map (std::unordered_map<TInt, TFlt *> &map)
+{
+  for (auto _it : map)
+    {
+      delete[] _it.second;
+    }
+  map.clear ();
+}
+
+// build, loading, cumulative curve queries, link travel times, shortest path
+// trees and DAR records of a single class network
+void
+bench_single_class (const Options &options, const std::string &network,
+                    const std::string &folder, Recorder &recorder)
+{
+  std::vector<double> _build, _loading;
+  MNM_Dta *_dta = nullptr;
+  for (int r = 0; r < options.m_repeats; ++r)
+    {
+      delete _dta;
+      MNM_Ults::set_random_state (0);
+      _build.push_back (time_once ([&] () { _dta = build_dta (folder); }));
+      for (auto _it : _dta->m_link_factory->m_link_map)
+        {
+          _it.second->install_cumulative_curve ();
+        }
+      _loading.push_back (time_once ([&] () {
+        _dta->pre_loading ();
+        _dta->loading (false);
+      }));
+    }
+  recorder.write (network, "build", _dta, _build);
+  recorder.write (network, "loading", _dta, _loading);
+
+  // cumulative curve lookups at every loading interval of every link
+  int _num = _dta->m_current_loading_interval;
+  std::vector<double> _query;
+  TFlt _checksum = 0;
+  for (int r = 0; r < options.m_repeats; ++r)
+    {
+      _query.push_back (time_once ([&] () {
+        for (auto _it : _dta->m_link_factory->m_link_map)
+          {
+            for (int i = 0; i < _num; ++i)
+              {
+                _checksum += _it.second->m_N_in->get_result (TFlt (i))
+                             - _it.second->m_N_out->get_result (TFlt (i));
+              }
+          }
+      }));
+    }
+  recorder.write (network, "cc_query", _dta, _query);
+
+  std::unordered_map<TInt, TFlt *> _tt;
+  std::vector<double> _link_tt;
+  for (int r = 0; r < options.m_repeats; ++r)
+    {
+      free_map (_tt);
+      _link_tt.push_back (time_once ([&] () { _tt = link_tt_map (_dta); }));
+    }
+  recorder.write (network, "link_tt", _dta, _link_tt);
+
+  // one tree per destination on the link travel times of the first interval
+  std::unordered_map<TInt, TFlt> _cost;
+  for (auto _it : _tt)
+    {
+      _cost[_it.first] = _it.second[0];
+    }
+  std::vector<TInt> _dest_node_IDs;
+  for (auto _it : _dta->m_od_factory->m_destination_map)
+    {
+      _dest_node_IDs.push_back (_it.second->m_dest_node->m_node_ID);
+    }
+  std::vector<double> _fifo, _dijkstra;
+  for (int r = 0; r < options.m_repeats; ++r)
+    {
+      _fifo.push_back (time_once ([&] () {
+        for (TInt _dest_node_ID : _dest_node_IDs)
+          {
+            std::unordered_map<TInt, TInt> _tree;
+            MNM_Shortest_Path::all_to_one_FIFO (_dest_node_ID, _dta->m_graph,
+                                                _cost, _tree);
+          }
+      }));
+      _dijkstra.push_back (time_once ([&] () {
+        for (TInt _dest_node_ID : _dest_node_IDs)
+          {
+            std::unordered_map<TInt, TInt> _tree;
+            MNM_Shortest_Path::all_to_one_Dijkstra (_dest_node_ID,
+                                                    _dta->m_graph, _cost,
+                                                    _tree);
+          }
+      }));
+    }
+  recorder.write (network, "sp_fifo", _dta, _fifo);
+  recorder.write (network, "sp_dijkstra", _dta, _dijkstra);
+
+  // time-dependent trees over the whole loading horizon, cost = travel time
+  std::vector<double> _tdsp;
+  for (int r = 0; r < options.m_repeats; ++r)
+    {
+      _tdsp.push_back (time_once ([&] () {
+        for (TInt _dest_node_ID : _dest_node_IDs)
+          {
+            MNM_TDSP_Tree _tree (_dest_node_ID, _dta->m_graph, _num);
+            _tree.initialize ();
+            _tree.update_tree (_tt, _tt);
+          }
+      }));
+    }
+  recorder.write (network, "tdsp_update_tree", _dta, _tdsp);
+  free_map (_tt);
+  delete _dta;
+
+  // DAR records of the fixed paths, on a loading with cumulative curve trees
+  MNM_Ults::set_random_state (0);
+  _dta = build_dta (folder);
+  for (auto _it : _dta->m_link_factory->m_link_map)
+    {
+      _it.second->install_cumulative_curve_tree ();
+    }
+  _dta->pre_loading ();
+  _dta->loading (false);
+  std::unordered_map<MNM_Path *, int> _path_map;
+  if (MNM_Routing_Hybrid *_routing
+      = dynamic_cast<MNM_Routing_Hybrid *> (_dta->m_routing))
+    {
+      for (auto _o_it : *_routing->m_routing_fixed->m_path_table)
+        {
+          for (auto _d_it : *_o_it.second)
+            {
+              for (MNM_Path *_path : _d_it.second->m_path_vec)
+                {
+                  _path_map.insert ({ _path, int (_path_map.size ()) });
+                }
+            }
+        }
+    }
+  TInt _assign_frq = _dta->m_settings.m_assign_frq;
+  int _num_assign = _dta->m_current_loading_interval / _assign_frq;
+  std::vector<double> _dar;
+  for (int r = 0; r < options.m_repeats; ++r)
+    {
+      _dar.push_back (time_once ([&] () {
+        for (auto _it : _dta->m_link_factory->m_link_map)
+          {
+            std::vector<dar_record *> _record;
+            for (int t = 0; t < _num_assign; ++t)
+              {
+                MNM_DTA_GRADIENT::add_dar_records (_record, _it.second,
+                                                   _path_map,
+                                                   TFlt (t * _assign_frq),
+                                                   TFlt ((t + 1)
+                                                         * _assign_frq));
+              }
+            for (dar_record *_r : _record)
+              {
+                delete _r;
+              }
+          }
+      }));
+    }
+  recorder.write (network, "dar_records", _dta, _dar);
+  delete _dta;
+  std::fprintf (stderr, "%-28s checksum %f\n", network.c_str (),
+                (double) _checksum);
+}
+
+void
+bench_multiclass (const Options &options, const std::string &network,
+                  const std::string &folder, Recorder &recorder)
+{
+  std::vector<double> _build, _loading;
+  MNM_Dta_Multiclass *_dta = nullptr;
+  for (int r = 0; r < options.m_repeats; ++r)
+    {
+      delete _dta;
+      MNM_Ults::set_random_state (0);
+      _build.push_back (time_once ([&] () {
+        _dta = new MNM_Dta_Multiclass (folder);
+        _dta->build_from_files ();
+        _dta->hook_up_node_and_link ();
+        _dta->is_ok ();
+      }));
+      for (auto _it : _dta->m_link_factory->m_link_map)
+        {
+          dynamic_cast<MNM_Dlink_Multiclass *> (_it.second)
+            ->install_cumulative_curve_multiclass ();
+        }
+      _loading.push_back (time_once ([&] () {
+        _dta->pre_loading ();
+        _dta->loading (false);
+      }));
+    }
+  recorder.write (network, "build", _dta, _build);
+  recorder.write (network, "loading", _dta, _loading);
+  delete _dta;
+}
+
+// MSA iterations with fixed departure times, as Dta::run_due
+void
+bench_due (const Options &options, const std::string &network,
+           const std::string &folder, Recorder &recorder)
+{
+  MNM_Ults::set_random_state (0);
+  MNM_Due_Msa *_due = new MNM_Due_Msa (folder);
+  _due->initialize ();
+  _due->init_path_flow ();
+  std::vector<double> _iteration;
+  for (int i = 0; i < options.m_due_iters; ++i)
+    {
+      _iteration.push_back (time_once ([&] () {
+        MNM_Dta *_dta = _due->run_dta (false);
+        _due->build_link_cost_map (_dta);
+        _due->update_path_table_cost (_dta);
+        _due->compute_merit_function_fixed_departure_time_choice ();
+        _due->update_path_table_fixed_departure_time_choice (_dta, i);
+        dynamic_cast<MNM_Routing_Fixed *> (_dta->m_routing)->m_path_table
+          = nullptr;
+        delete _dta;
+      }));
+    }
+  recorder.write (network, "due_iteration", _due->m_base_dta, _iteration);
+  delete _due;
+}
+
+bool
+selected (const Options &options, const std::string &network)
+{
+  return options.m_filter.empty ()
+         || network.find (options.m_filter) != std::string::npos;
+}
+
+void
+print_usage ()
+{
+  std::cerr
+    << "usage: macposts_bench [options]\n"
+       "  --output FILE      JSON lines results (macposts_bench.jsonl)\n"
+       "  --workdir DIR      where the generated networks go "
+       "(macposts_bench_data)\n"
+       "  --scale N          grid side / ring-radial size (10)\n"
+       "  --repeats N        repeats of every timed case (3)\n"
+       "  --max-interval N   assignment intervals of the demand (10)\n"
+       "  --due-iters N      DUE iterations to time (3)\n"
+       "  --replicate DIR    also run a single class network from DIR, e.g.\n"
+       "                     Sioux Falls, replicated --copies times\n"
+       "  --copies N         replicas of --replicate (4)\n"
+       "  --filter TEXT      only run the networks whose name contains TEXT\n";
+}
+
+Options
+parse_options (int argc, char *argv[])
+{
+  Options _options;
+  for (int i = 1; i < argc; ++i)
+    {
+      std::string _arg = argv[i];
+      if (_arg == "--help" || _arg == "-h")
+        {
+          print_usage ();
+          std::exit (0);
+        }
+      if (i + 1 >= argc)
+        {
+          print_usage ();
+          throw std::runtime_error ("missing value of option " + _arg);
+        }
+      std::string _value = argv[++i];
+      if (_arg == "--output")
+        _options.m_output = _value;
+      else if (_arg == "--workdir")
+        _options.m_workdir = _value;
+      else if (_arg == "--scale")
+        _options.m_scale = std::stoi (_value);
+      else if (_arg == "--repeats")
+        _options.m_repeats = std::max (1, std::stoi (_value));
+      else if (_arg == "--max-interval")
+        _options.m_max_interval = std::stoi (_value);
+      else if (_arg == "--due-iters")
+        _options.m_due_iters = std::stoi (_value);
+      else if (_arg == "--replicate")
+        _options.m_replicate = _value;
+      else if (_arg == "--copies")
+        _options.m_copies = std::stoi (_value);
+      else if (_arg == "--filter")
+        _options.m_filter = _value;
+      else
+        {
+          print_usage ();
+          throw std::runtime_error ("unknown option " + _arg);
+        }
+    }
+  return _options;
+}
+}
+
+int
+main (int argc, char *argv[])
+{
+  Options _options = parse_options (argc, argv);
+  Recorder _recorder (_options.m_output);
+  MNM_Bench::make_folder (_options.m_workdir);
+
+  MNM_Bench::Network_Spec _spec;
+  _spec.max_interval = _options.m_max_interval;
+  int _n = _options.m_scale;
+  std::string _grid = "grid_" + std::to_string (_n) + "x" + std::to_string (_n);
+  std::string _ring = "ring_" + std::to_string (_n / 2 + 1) + "x"
+                      + std::to_string (2 * _n);
+
+  if (selected (_options, _grid))
+    {
+      std::string _folder = _options.m_workdir + "/" + _grid;
+      MNM_Bench::write_grid (_folder, _n, _n, _spec);
+      bench_single_class (_options, _grid, _folder, _recorder);
+    }
+  if (selected (_options, _ring))
+    {
+      std::string _folder = _options.m_workdir + "/" + _ring;
+      MNM_Bench::write_ring_radial (_folder, _n / 2 + 1, 2 * _n, _spec);
+      bench_single_class (_options, _ring, _folder, _recorder);
+    }
+  if (selected (_options, _grid + "_mc"))
+    {
+      std::string _folder = _options.m_workdir + "/" + _grid + "_mc";
+      MNM_Bench::Network_Spec _mc_spec = _spec;
+      _mc_spec.num_class = 2;
+      MNM_Bench::write_grid (_folder, _n, _n, _mc_spec);
+      bench_multiclass (_options, _grid + "_mc", _folder, _recorder);
+    }
+  if (selected (_options, _grid + "_due") && _options.m_due_iters > 0)
+    {
+      std::string _folder = _options.m_workdir + "/" + _grid + "_due";
+      MNM_Bench::Network_Spec _due_spec = _spec;
+      _due_spec.routing_type = "Due";
+      MNM_Bench::write_grid (_folder, _n, _n, _due_spec);
+      bench_due (_options, _grid + "_due", _folder, _recorder);
+    }
+  if (!_options.m_replicate.empty ())
+    {
+      std::string _name = "replicated_x" + std::to_string (_options.m_copies);
+      if (selected (_options, _name))
+        {
+          std::string _folder = _options.m_workdir + "/" + _name;
+          MNM_Bench::replicate_network (_options.m_replicate, _folder,
+                                        _options.m_copies);
+          bench_single_class (_options, _name, _folder, _recorder);
+        }
+    }
+  return 0;
+}
@@ -0,0 +1,590 @@
+#include "synthetic.h"
+
+#include "io.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <queue>
+#include <sstream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <vector>
+
+namespace MNM_Bench
+{
+namespace
+{
+struct Link_Row
+{
+  int m_ID;
+  int m_from;
+  int m_to;
+  bool m_connector;
+};
+
+struct Network
+{
+  // node types indexed by node ID, index 0 unused
+  std::vector<std::string> m_node_type = { "" };
+  std::vector<Link_Row> m_links;
+  // (origin ID, node ID) and (destination ID, node ID)
+  std::vector<std::pair<int, int>> m_origins;
+  std::vector<std::pair<int, int>> m_dests;
+  // (origin ID, destination ID)
+  std::vector<std::pair<int, int>> m_od_pairs;
+
+  int add_node (const std::string &type)
+  {
+    m_node_type.push_back (type);
+    return int (m_node_type.size ()) - 1;
+  }
+  void add_link (int from, int to, bool connector = false)
+  {
+    m_links.push_back ({ int (m_links.size ()) + 1, from, to, connector });
+  }
+  void add_road (int a, int b)
+  {
+    add_link (a, b);
+    add_link (b, a);
+  }
+  // hang a new origin node in front of node_ID
+  int add_origin (int node_ID)
+  {
+    int _node_ID = add_node ("DMOND");
+    add_link (_node_ID, node_ID, true);
+    m_origins.push_back ({ int (m_origins.size ()) + 1, _node_ID });
+    return m_origins.back ().first;
+  }
+  // hang a new destination node behind node_ID
+  int add_dest (int node_ID)
+  {
+    int _node_ID = add_node ("DMDND");
+    add_link (node_ID, _node_ID, true);
+    m_dests.push_back ({ int (m_dests.size ()) + 1, _node_ID });
+    return m_dests.back ().first;
+  }
+};
+
+std::ofstream
+open_file (const std::string &file_name)
+{
+  std::ofstream _file (file_name);
+  if (!_file.is_open ())
+    {
+      throw std::runtime_error ("failed to open file: " + file_name);
+    }
+  return _file;
+}
+
+// fewest-hop node sequence from node from to node to
+std::vector<int>
+hop_path (const Network &net, int from, int to)
+{
+  std::vector<std::vector<int>> _out (net.m_node_type.size ());
+  for (const Link_Row &_link : net.m_links)
+    {
+      _out[_link.m_from].push_back (_link.m_to);
+    }
+  std::vector<int> _pred (net.m_node_type.size (), -1);
+  std::queue<int> _queue;
+  _pred[from] = from;
+  _queue.push (from);
+  while (!_queue.empty () && _pred[to] < 0)
+    {
+      int _node_ID = _queue.front ();
+      _queue.pop ();
+      for (int _next : _out[_node_ID])
+        {
+          if (_pred[_next] < 0)
+            {
+              _pred[_next] = _node_ID;
+              _queue.push (_next);
+            }
+        }
+    }
+  if (_pred[to] < 0)
+    {
+      throw std::runtime_error ("synthetic network is not connected");
+    }
+  std::vector<int> _path;
+  for (int _node_ID = to; _node_ID != from; _node_ID = _pred[_node_ID])
+    {
+      _path.push_back (_node_ID);
+    }
+  _path.push_back (from);
+  std::reverse (_path.begin (), _path.end ());
+  return _path;
+}
+
+void
+write_config (const std::string &folder, const Network &net,
+              const Network_Spec &spec)
+{
+  std::string _routing_type = spec.routing_type;
+  if (spec.num_class == 2 && _routing_type == "Hybrid")
+    {
+      _routing_type = "Biclass_Hybrid";
+    }
+  std::ofstream _file = open_file (folder + "/config.conf");
+  _file << "[DTA]\n"
+        << "network_name = Snap_graph\n"
+        << "unit_time = 5\n"
+        << "total_interval = -1\n"
+        << "assign_frq = " << spec.assign_frq << "\n"
+        << "start_assign_interval = 0\n"
+        << "max_interval = " << spec.max_interval << "\n"
+        << "flow_scalar = 2\n"
+        << "num_of_link = " << net.m_links.size () << "\n"
+        << "num_of_node = " << net.m_node_type.size () - 1 << "\n"
+        << "num_of_O = " << net.m_origins.size () << "\n"
+        << "num_of_D = " << net.m_dests.size () << "\n"
+        << "OD_pair = " << net.m_od_pairs.size () << "\n";
+  if (spec.num_class == 2)
+    {
+      _file << "adaptive_ratio_car = " << spec.adaptive_ratio << "\n"
+            << "adaptive_ratio_truck = " << spec.adaptive_ratio << "\n";
+    }
+  else
+    {
+      _file << "adaptive_ratio = " << spec.adaptive_ratio << "\n";
+    }
+  _file << "routing_type = " << _routing_type << "\n"
+        << "init_demand_split = 0\n\n"
+        << "[STAT]\n"
+        << "rec_mode = LRn\n"
+        << "rec_mode_para = 12\n"
+        << "rec_folder = record\n"
+        << "rec_volume = 0\n"
+        << "volume_load_automatic_rec = 0\n"
+        << "volume_record_automatic_rec = 0\n"
+        << "rec_tt = 1\n"
+        << "tt_load_automatic_rec = 0\n"
+        << "tt_record_automatic_rec = 0\n\n"
+        << "[HYBRID]\n"
+        << "route_frq = " << spec.assign_frq << "\n\n"
+        << "[FIXED]\n"
+        << "path_file_name = path_table\n"
+        << "num_path = " << net.m_od_pairs.size () << "\n"
+        << "choice_portion = Buffer\n"
+        << "buffer_length = " << spec.num_class * spec.max_interval << "\n"
+        << "route_frq = " << spec.assign_frq << "\n\n"
+        << "[ADAPTIVE]\n"
+        << "route_frq = " << spec.assign_frq << "\n\n"
+        << "[DUE]\n"
+        << "vot = 20\n"
+        << "early_penalty = 15\n"
+        << "late_penalty = 40\n"
+        << "target_time = 0\n"
+        << "lambda = 0.5\n";
+}
+
+int
+write_network (const std::string &folder, const Network &net,
+               const Network_Spec &spec)
+{
+  if (spec.num_class != 1 && spec.num_class != 2)
+    {
+      throw std::runtime_error ("num_class must be 1 or 2");
+    }
+  make_folder (folder);
+  make_folder (folder + "/record");
+  write_config (folder, net, spec);
+
+  std::ofstream _graph = open_file (folder + "/Snap_graph");
+  std::ofstream _link = open_file (folder + "/MNM_input_link");
+  _graph << "# EdgeId FromNodeId ToNodeId\n";
+  _link << "# ID Type LEN(mile) FFS(mile/h) Cap(v/hour) RHOJ(v/miles) Lane"
+        << (spec.num_class == 2 ? " FFS_truck Cap_truck RHOJ_truck Convert\n"
+                                : "\n");
+  for (const Link_Row &_row : net.m_links)
+    {
+      _graph << _row.m_ID << " " << _row.m_from << " " << _row.m_to << "\n";
+      if (_row.m_connector)
+        {
+          _link << _row.m_ID << " PQ 1 99999 99999 99999 1"
+                << (spec.num_class == 2 ? " 99999 99999 99999 2\n" : "\n");
+        }
+      else
+        {
+          _link << _row.m_ID << " CTM 0.5 40 2000 200 2"
+                << (spec.num_class == 2 ? " 30 1000 100 2\n" : "\n");
+        }
+    }
+
+  std::ofstream _node = open_file (folder + "/MNM_input_node");
+  _node << "# ID Type" << (spec.num_class == 2 ? " Convert\n" : "\n");
+  for (size_t i = 1; i < net.m_node_type.size (); ++i)
+    {
+      _node << i << " " << net.m_node_type[i]
+            << (spec.num_class == 2 ? " 2\n" : "\n");
+    }
+
+  std::ofstream _od = open_file (folder + "/MNM_input_od");
+  _od << "# origins\n";
+  for (const auto &_origin : net.m_origins)
+    {
+      _od << _origin.first << " " << _origin.second << "\n";
+    }
+  _od << "# destination\n";
+  for (const auto &_dest : net.m_dests)
+    {
+      _od << _dest.first << " " << _dest.second << "\n";
+    }
+
+  std::ofstream _demand = open_file (folder + "/MNM_input_demand");
+  std::ofstream _path = open_file (folder + "/path_table");
+  std::ofstream _buffer = open_file (folder + "/path_table_buffer");
+  for (const auto &_od_pair : net.m_od_pairs)
+    {
+      _demand << _od_pair.first << " " << _od_pair.second;
+      for (int c = 0; c < spec.num_class; ++c)
+        {
+          for (int i = 0; i < spec.max_interval; ++i)
+            {
+              _demand << " " << (c == 0 ? spec.demand : spec.demand / 10.);
+            }
+        }
+      _demand << "\n";
+
+      // a single path per OD pair, it takes all of the fixed demand
+      std::vector<int> _nodes
+        = hop_path (net, net.m_origins[_od_pair.first - 1].second,
+                    net.m_dests[_od_pair.second - 1].second);
+      for (size_t i = 0; i < _nodes.size (); ++i)
+        {
+          _path << (i == 0 ? "" : " ") << _nodes[i];
+        }
+      _path << "\n";
+      for (int i = 0; i < spec.num_class * spec.max_interval; ++i)
+        {
+          _buffer << (i == 0 ? "" : " ") << 1;
+        }
+      _buffer << "\n";
+    }
+  return 0;
+}
+
+// config.conf with the values of some keys replaced, keyed by section and key
+std::string
+rewrite_config (
+  const std::string &file_name,
+  const std::map<std::string, std::map<std::string, std::string>> &values)
+{
+  std::ifstream _file (file_name);
+  if (!_file.is_open ())
+    {
+      throw std::runtime_error ("failed to open file: " + file_name);
+    }
+  std::stringstream _out;
+  std::string _line, _section;
+  while (std::getline (_file, _line))
+    {
+      std::string _trimmed = _line;
+      MNM_IO::trim (_trimmed);
+      if (!_trimmed.empty () && _trimmed[0] == '[')
+        {
+          _section = _trimmed.substr (1, _trimmed.find (']') - 1);
+        }
+      else if (values.count (_section)
+               && _trimmed.find ('=') != std::string::npos)
+        {
+          std::string _key = _trimmed.substr (0, _trimmed.find ('='));
+          MNM_IO::trim (_key);
+          auto _it = values.at (_section).find (_key);
+          if (_it != values.at (_section).end ())
+            {
+              _line = _key + " = " + _it->second;
+            }
+        }
+      _out << _line << "\n";
+    }
+  return _out.str ();
+}
+
+// the data lines (not empty, not comments) of a file, split into words
+std::vector<std::vector<std::string>>
+read_rows (const std::string &file_name, bool required = true)
+{
+  std::vector<std::vector<std::string>> _rows;
+  std::ifstream _file (file_name);
+  if (!_file.is_open ())
+    {
+      if (required)
+        {
+          throw std::runtime_error ("failed to open file: " + file_name);
+        }
+      return _rows;
+    }
+  std::string _line;
+  while (std::getline (_file, _line))
+    {
+      _line = MNM_IO::trim (_line);
+      if (!_line.empty () && _line[0] != '#')
+        {
+          _rows.push_back (MNM_IO::split (_line, ' '));
+        }
+    }
+  return _rows;
+}
+
+int
+max_ID (const std::vector<std::vector<std::string>> &rows, size_t column)
+{
+  int _max = 0;
+  for (const auto &_row : rows)
+    {
+      _max = std::max (_max, std::stoi (_row[column]));
+    }
+  return _max;
+}
+
+// row with the words in the given columns shifted by the given offsets
+std::string
+shift_row (const std::vector<std::string> &row,
+           const std::vector<std::pair<size_t, int>> &offsets)
+{
+  std::string _line;
+  for (size_t i = 0; i < row.size (); ++i)
+    {
+      std::string _word = row[i];
+      MNM_IO::trim (_word);
+      for (const auto &_offset : offsets)
+        {
+          if (_offset.first == i)
+            {
+              _word = std::to_string (std::stoi (_word) + _offset.second);
+            }
+        }
+      _line += (i == 0 ? "" : " ") + _word;
+    }
+  return _line;
+}
+}
+
+int
+make_folder (const std::string &folder)
+{
+  struct stat _info;
+  if (stat (folder.c_str (), &_info) == 0)
+    {
+      return 0;
+    }
+  if (mkdir (folder.c_str (), 0755) != 0)
+    {
+      throw std::runtime_error ("failed to create folder: " + folder);
+    }
+  return 0;
+}
+
+int
+write_grid (const std::string &folder, int rows, int cols,
+            const Network_Spec &spec)
+{
+  if (rows < 1 || cols < 2)
+    {
+      throw std::runtime_error ("grid needs at least one row and two columns");
+    }
+  Network _net;
+  // node of row r and column c is r * cols + c + 1
+  for (int i = 0; i < rows * cols; ++i)
+    {
+      _net.add_node ("FWJ");
+    }
+  for (int r = 0; r < rows; ++r)
+    {
+      for (int c = 0; c < cols; ++c)
+        {
+          int _node_ID = r * cols + c + 1;
+          if (c + 1 < cols)
+            {
+              _net.add_road (_node_ID, _node_ID + 1);
+            }
+          if (r + 1 < rows)
+            {
+              _net.add_road (_node_ID, _node_ID + cols);
+            }
+        }
+    }
+  for (int r = 0; r < rows; ++r)
+    {
+      _net.add_origin (r * cols + 1);
+    }
+  for (int r = 0; r < rows; ++r)
+    {
+      _net.add_dest (r * cols + cols);
+    }
+  for (const auto &_origin : _net.m_origins)
+    {
+      for (const auto &_dest : _net.m_dests)
+        {
+          _net.m_od_pairs.push_back ({ _origin.first, _dest.first });
+        }
+    }
+  return write_network (folder, _net, spec);
+}
+
+int
+write_ring_radial (const std::string &folder, int rings, int spokes,
+                   const Network_Spec &spec)
+{
+  if (rings < 1 || spokes < 3)
+    {
+      throw std::runtime_error (
+        "ring-radial network needs at least one ring and three spokes");
+    }
+  Network _net;
+  // node 1 is the center, node of ring k and spoke s is k * spokes + s + 2
+  _net.add_node ("FWJ");
+  for (int i = 0; i < rings * spokes; ++i)
+    {
+      _net.add_node ("FWJ");
+    }
+  for (int k = 0; k < rings; ++k)
+    {
+      for (int s = 0; s < spokes; ++s)
+        {
+          int _node_ID = k * spokes + s + 2;
+          _net.add_road (_node_ID, k * spokes + (s + 1) % spokes + 2);
+          _net.add_road (_node_ID, k == 0 ? 1 : _node_ID - spokes);
+        }
+    }
+  for (int s = 0; s < spokes; ++s)
+    {
+      _net.add_origin ((rings - 1) * spokes + s + 2);
+    }
+  for (int s = 0; s < spokes; ++s)
+    {
+      _net.add_dest ((rings - 1) * spokes + s + 2);
+    }
+  for (int s = 0; s < spokes; ++s)
+    {
+      _net.m_od_pairs.push_back ({ s + 1, (s + spokes / 2) % spokes + 1 });
+    }
+  return write_network (folder, _net, spec);
+}
+
+int
+replicate_network (const std::string &src_folder,
+                   const std::string &dst_folder, int copies)
+{
+  if (copies < 1)
+    {
+      throw std::runtime_error ("copies must be positive");
+    }
+  MNM_ConfReader *_conf
+    = new MNM_ConfReader (src_folder + "/config.conf", "DTA");
+  std::string _graph_name = _conf->get_string ("network_name");
+  int _num_of_link = _conf->get_int ("num_of_link");
+  int _num_of_node = _conf->get_int ("num_of_node");
+  int _num_of_O = _conf->get_int ("num_of_O");
+  int _num_of_D = _conf->get_int ("num_of_D");
+  int _OD_pair = _conf->get_int ("OD_pair");
+  delete _conf;
+
+  auto _graph = read_rows (src_folder + "/" + _graph_name);
+  auto _links = read_rows (src_folder + "/MNM_input_link");
+  auto _nodes = read_rows (src_folder + "/MNM_input_node");
+  auto _demand = read_rows (src_folder + "/MNM_input_demand");
+  auto _path = read_rows (src_folder + "/path_table", false);
+  auto _buffer = read_rows (src_folder + "/path_table_buffer", false);
+  // origins come first in MNM_input_od
+  auto _ods = read_rows (src_folder + "/MNM_input_od");
+  if (int (_ods.size ()) != _num_of_O + _num_of_D)
+    {
+      throw std::runtime_error ("unexpected number of rows in MNM_input_od");
+    }
+  std::vector<std::vector<std::string>> _origins (_ods.begin (),
+                                                  _ods.begin () + _num_of_O);
+  std::vector<std::vector<std::string>> _dests (_ods.begin () + _num_of_O,
+                                                _ods.end ());
+
+  int _link_shift = max_ID (_links, 0);
+  int _node_shift = max_ID (_nodes, 0);
+  int _origin_shift = max_ID (_origins, 0);
+  int _dest_shift = max_ID (_dests, 0);
+
+  make_folder (dst_folder);
+  make_folder (dst_folder + "/record");
+  std::ofstream _graph_file = open_file (dst_folder + "/" + _graph_name);
+  std::ofstream _link_file = open_file (dst_folder + "/MNM_input_link");
+  std::ofstream _node_file = open_file (dst_folder + "/MNM_input_node");
+  std::ofstream _od_file = open_file (dst_folder + "/MNM_input_od");
+  std::ofstream _demand_file = open_file (dst_folder + "/MNM_input_demand");
+  std::ofstream _path_file, _buffer_file;
+  if (!_path.empty ())
+    {
+      _path_file = open_file (dst_folder + "/path_table");
+      _buffer_file = open_file (dst_folder + "/path_table_buffer");
+    }
+  for (int k = 0; k < copies; ++k)
+    {
+      int _dl = k * _link_shift, _dn = k * _node_shift;
+      for (const auto &_row : _graph)
+        {
+          _graph_file << shift_row (_row, { { 0, _dl }, { 1, _dn }, { 2, _dn } })
+                      << "\n";
+        }
+      for (const auto &_row : _links)
+        {
+          _link_file << shift_row (_row, { { 0, _dl } }) << "\n";
+        }
+      for (const auto &_row : _nodes)
+        {
+          _node_file << shift_row (_row, { { 0, _dn } }) << "\n";
+        }
+      for (const auto &_row : _demand)
+        {
+          _demand_file << shift_row (_row, { { 0, k * _origin_shift },
+                                             { 1, k * _dest_shift } })
+                       << "\n";
+        }
+      for (const auto &_row : _path)
+        {
+          std::vector<std::pair<size_t, int>> _shift;
+          for (size_t i = 0; i < _row.size (); ++i)
+            {
+              _shift.push_back ({ i, _dn });
+            }
+          _path_file << shift_row (_row, _shift) << "\n";
+        }
+      for (const auto &_row : _buffer)
+        {
+          _buffer_file << shift_row (_row, {}) << "\n";
+        }
+    }
+  _od_file << "# origins\n";
+  for (int k = 0; k < copies; ++k)
+    {
+      for (const auto &_row : _origins)
+        {
+          _od_file << shift_row (_row, { { 0, k * _origin_shift },
+                                         { 1, k * _node_shift } })
+                   << "\n";
+        }
+    }
+  _od_file << "# destination\n";
+  for (int k = 0; k < copies; ++k)
+    {
+      for (const auto &_row : _dests)
+        {
+          _od_file << shift_row (_row, { { 0, k * _dest_shift },
+                                         { 1, k * _node_shift } })
+                   << "\n";
+        }
+    }
+
+  std::map<std::string, std::map<std::string, std::string>> _counts;
+  _counts["DTA"] = { { "num_of_link", std::to_string (copies * _num_of_link) },
+                     { "num_of_node", std::to_string (copies * _num_of_node) },
+                     { "num_of_O", std::to_string (copies * _num_of_O) },
+                     { "num_of_D", std::to_string (copies * _num_of_D) },
+                     { "OD_pair", std::to_string (copies * _OD_pair) } };
+  _counts["FIXED"]
+    = { { "num_path", std::to_string (copies * _path.size ()) } };
+  std::string _text = rewrite_config (src_folder + "/config.conf", _counts);
+  std::ofstream _config = open_file (dst_folder + "/config.conf");
+  _config << _text;
+  return 0;
+}
+}
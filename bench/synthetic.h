@@ -0,0 +1,42 @@
+#pragma once
+
+// Synthetic input folders for macposts_bench. The writers produce the same
+// plain text files the library reads (config.conf, the graph file,
+// MNM_input_link, MNM_input_node, MNM_input_od, MNM_input_demand, path_table
+// and path_table_buffer), so every benchmark goes through the regular
+// build_from_files path.
+
+#include <string>
+
+namespace MNM_Bench
+{
+struct Network_Spec
+{
+  // 1 for MNM_Dta, 2 for MNM_Dta_Multiclass (cars and trucks)
+  int num_class = 1;
+  int max_interval = 10;
+  int assign_frq = 180;
+  // vehicles per OD pair and assignment interval (cars, trucks get a tenth)
+  double demand = 20.;
+  double adaptive_ratio = 0.5;
+  // Hybrid (Biclass_Hybrid for two classes) or Due
+  std::string routing_type = "Hybrid";
+};
+
+// rows x cols grid of bidirectional CTM links, one origin on every node of
+// the west edge and one destination on every node of the east edge, every
+// origin sending to every destination
+int write_grid (const std::string &folder, int rows, int cols,
+                const Network_Spec &spec);
+// a center node with rings x spokes nodes around it, links along the rings
+// and the spokes, origins and destinations on the outer ring, every origin
+// sending to the destination across the center
+int write_ring_radial (const std::string &folder, int rings, int spokes,
+                       const Network_Spec &spec);
+// copies disjoint replicas of the network in src_folder (e.g. Sioux Falls)
+// into dst_folder, shifting link, node, origin and destination IDs
+int replicate_network (const std::string &src_folder,
+                       const std::string &dst_folder, int copies);
+
+int make_folder (const std::string &folder);
+}
@@ -14,6 +14,7 @@
 #include <due.h>
 #include <ev_traffic.h>
 #include <multimodal.h>
+#include <realtime_dta.h>
 
 namespace py = pybind11;
 using SparseMatrixR = Eigen::SparseMatrix<double, Eigen::RowMajor>;
@@ -27,13 +28,18 @@ class Dta
 public:
   Dta ();
   ~Dta ();
-  int initialize (const std::string &folder);
+  int initialize (const std::string &folder, const Dta *shared = nullptr);
   bool check_input_files ();
   int generate_shortest_pathsets (const std::string &folder, int max_iter,
                                   double vot, double mid_scale,
-                                  double heavy_scale, double min_path_tt = 0.);
+                                  double heavy_scale, double min_path_tt = 0.,
+                                  int num_threads = 1);
   int install_cc ();
   int install_cc_tree ();
+  int enable_profile (bool enable = true);
+  py::dict get_profile ();
+  int save_profile_trace (const std::string &file_name);
+  py::dict get_memory_usage ();
   int run_whole (bool verbose = false);
   int run_due (int max_iter, const std::string &folder, bool verbose = true,
                bool with_dtc = false, const std::string &method = "MSA");
@@ -80,9 +86,21 @@ public:
   py::array_t<double> get_path_tt (py::array_t<int> link_IDs,
                                    py::array_t<int> start_intervals);
   py::array_t<double> get_registered_path_tt (py::array_t<int> start_intervals);
+  py::array_t<double>
+  get_registered_path_cost (py::array_t<int> start_intervals);
+  // the travel times (and costs, if not null) of all registered paths for
+  // all start intervals, in one batch over m_link_tt_map and m_link_cost_map
+  int evaluate_registered_paths (py::array_t<int> start_intervals,
+                                 const std::string &caller,
+                                 std::vector<TFlt> &tt,
+                                 std::vector<TFlt> *cost);
 
   py::array_t<double> get_link_in_cc (int link_ID);
   py::array_t<double> get_link_out_cc (int link_ID);
+  py::array_t<double> get_link_in_ccs (py::array_t<int> links);
+  py::array_t<double> get_link_out_ccs (py::array_t<int> links);
+  py::array_t<double> get_link_in_cc_view (int link_ID);
+  py::array_t<double> get_link_out_cc_view (int link_ID);
   py::array_t<double> get_dar_matrix (py::array_t<int> link_start_intervals,
                                       py::array_t<int> link_end_intervals);
   int save_dar_matrix (py::array_t<int> link_start_intervals,
@@ -96,34 +114,86 @@ public:
   int delete_all_agents ();
 
   MNM_Dta *m_dta;
+  // set by run_whole; the cumulative curves no longer grow after it, so only
+  // then views into their records are handed out
+  bool m_loaded;
+  // phase timings of loading, DUE iterations and DAR builders, if enabled
+  MNM_Profiler *m_profiler;
   std::vector<MNM_Dlink *> m_link_vec;
   std::vector<MNM_Path *> m_path_vec;
   std::unordered_map<MNM_Path *, int> m_path_map;
   // std::unordered_map<MNM_Dlink*, int> m_link_map;
   std::unordered_map<TInt, MNM_Path *> m_ID_path_mapping;
 
-  std::unordered_map<TInt, TFlt *> m_link_tt_map;
-  std::unordered_map<TInt, TFlt *> m_link_cost_map;
-  std::unordered_map<TInt, bool *> m_link_congested;
+  MNM_Link_Matrix<TFlt> m_link_tt_map;
+  MNM_Link_Matrix<TFlt> m_link_cost_map;
+  MNM_Link_Matrix<bool> m_link_congested;
 
   // time-varying queue dissipated time
-  std::unordered_map<TInt, int *> m_queue_dissipated_time;
+  MNM_Link_Matrix<int> m_queue_dissipated_time;
+};
+
+// Realtime DTA, which estimates the path choice of each interval from the link
+// speeds measured in it and optimizes the path choice of the next one
+class Realtime_Dta
+{
+public:
+  Realtime_Dta ();
+  ~Realtime_Dta ();
+  int initialize (const std::string &folder);
+  int run_iteration (int assign_inter);
+  py::array_t<double> get_path_p ();
+  py::array_t<double> get_link_tt (py::array_t<int> links);
+
+  MNM_Realtime_Dta *m_realtime_dta;
+  std::unordered_map<TInt, MNM_Path *> m_ID_path_mapping;
 };
 
 void
 init (py::module &m)
 {
+  py::class_<Realtime_Dta> (m, "RealtimeDta")
+    .def (py::init<> ())
+    .def ("initialize", &Realtime_Dta::initialize, py::arg ("folder"),
+          py::call_guard<py::gil_scoped_release> ())
+    .def ("run_iteration", &Realtime_Dta::run_iteration,
+          py::arg ("assign_inter"), py::call_guard<py::gil_scoped_release> (),
+          "Estimate interval *assign_inter* and predict the next one.")
+    .def ("get_path_p", &Realtime_Dta::get_path_p,
+          "Choice probabilities of the paths, in the order of their IDs.")
+    .def ("get_link_tt", &Realtime_Dta::get_link_tt, py::arg ("links"),
+          "Sampled travel times of *links* in the last rollout.");
+
   py::class_<Dta> (m, "Dta")
     .def (py::init<> ())
-    .def ("initialize", &Dta::initialize)
+    .def ("initialize", &Dta::initialize, py::arg ("folder"),
+          py::arg ("shared") = nullptr,
+          py::call_guard<py::gil_scoped_release> ())
     .def ("check_input_files", &Dta::check_input_files)
-    .def ("run_whole", &Dta::run_whole, py::arg ("verbose") = false)
-    .def ("run_due", &Dta::run_due)
-    .def ("run_dso", &Dta::run_dso)
-    .def ("run_dnl_delivery_traffic", &Dta::run_dnl_delivery_traffic)
-    .def ("run_dnl_electrified_traffic", &Dta::run_dnl_electrified_traffic)
+    .def ("generate_shortest_pathsets", &Dta::generate_shortest_pathsets,
+          py::arg ("folder"), py::arg ("max_iter"), py::arg ("vot"),
+          py::arg ("mid_scale"), py::arg ("heavy_scale"),
+          py::arg ("min_path_tt") = 0., py::arg ("num_threads") = 1,
+          py::call_guard<py::gil_scoped_release> ())
+    .def ("run_whole", &Dta::run_whole, py::arg ("verbose") = false,
+          py::call_guard<py::gil_scoped_release> ())
+    .def ("run_due", &Dta::run_due, py::call_guard<py::gil_scoped_release> ())
+    .def ("run_dso", &Dta::run_dso, py::call_guard<py::gil_scoped_release> ())
+    .def ("run_dnl_delivery_traffic", &Dta::run_dnl_delivery_traffic,
+          py::call_guard<py::gil_scoped_release> ())
+    .def ("run_dnl_electrified_traffic", &Dta::run_dnl_electrified_traffic,
+          py::call_guard<py::gil_scoped_release> ())
     .def ("install_cc", &Dta::install_cc)
     .def ("install_cc_tree", &Dta::install_cc_tree)
+    .def ("enable_profile", &Dta::enable_profile, py::arg ("enable") = true,
+          "Time the phases of loading, DUE iterations and DAR builders.")
+    .def ("get_profile", &Dta::get_profile,
+          "Phase timings in seconds, see enable_profile.")
+    .def ("save_profile_trace", &Dta::save_profile_trace,
+          py::arg ("file_name"),
+          "Write the phase timings as a Chrome/Perfetto trace file.")
+    .def ("get_memory_usage", &Dta::get_memory_usage,
+          "Estimated bytes and object counts of the simulation by category.")
     .def ("get_travel_stats", &Dta::get_travel_stats)
     .def ("print_emission_stats", &Dta::print_emission_stats)
     .def ("get_cur_loading_interval", &Dta::get_cur_loading_interval)
@@ -141,14 +211,20 @@ init (py::module &m)
     .def ("get_link_tt", &Dta::get_link_tt)
     .def ("get_link_tt_robust", &Dta::get_link_tt_robust)
 
-    .def ("build_link_cost_map", &Dta::build_link_cost_map)
+    .def ("build_link_cost_map", &Dta::build_link_cost_map,
+          py::call_guard<py::gil_scoped_release> ())
     // with build_link_cost_map()
     .def ("get_path_tt", &Dta::get_path_tt)
     .def ("get_registered_path_tt", &Dta::get_registered_path_tt)
+    .def ("get_registered_path_cost", &Dta::get_registered_path_cost)
 
     .def ("get_link_inflow", &Dta::get_link_inflow)
     .def ("get_link_in_cc", &Dta::get_link_in_cc)
     .def ("get_link_out_cc", &Dta::get_link_out_cc)
+    .def ("get_link_in_ccs", &Dta::get_link_in_ccs)
+    .def ("get_link_out_ccs", &Dta::get_link_out_ccs)
+    .def ("get_link_in_cc_view", &Dta::get_link_in_cc_view)
+    .def ("get_link_out_cc_view", &Dta::get_link_out_cc_view)
     .def ("get_dar_matrix", &Dta::get_dar_matrix)
     .def ("get_complete_dar_matrix", &Dta::get_complete_dar_matrix)
     .def ("save_dar_matrix", &Dta::save_dar_matrix)
@@ -158,17 +234,13 @@ init (py::module &m)
 Dta::Dta ()
 {
   m_dta = nullptr;
+  m_loaded = false;
+  m_profiler = nullptr;
   m_link_vec = std::vector<MNM_Dlink *> ();
   m_path_vec = std::vector<MNM_Path *> ();
   m_path_map = std::unordered_map<MNM_Path *, int> ();
   m_ID_path_mapping = std::unordered_map<TInt, MNM_Path *> ();
   // m_link_map = std::unordered_map<MNM_Dlink*, int>();
-
-  m_link_tt_map = std::unordered_map<TInt, TFlt *> ();
-  m_link_cost_map = std::unordered_map<TInt, TFlt *> ();
-  m_link_congested = std::unordered_map<TInt, bool *> ();
-
-  m_queue_dissipated_time = std::unordered_map<TInt, int *> ();
 }
 
 Dta::~Dta ()
@@ -177,40 +249,37 @@ Dta::~Dta ()
     {
       delete m_dta;
     }
+  if (m_profiler != nullptr)
+    {
+      delete m_profiler;
+    }
   m_link_vec.clear ();
   m_path_vec.clear ();
   // m_link_map.clear();
   m_ID_path_mapping.clear ();
+}
 
-  for (auto _tt_it : m_link_tt_map)
-    {
-      delete _tt_it.second;
-    }
-  m_link_tt_map.clear ();
-
-  for (auto _cost_it : m_link_cost_map)
-    {
-      delete _cost_it.second;
-    }
-  m_link_cost_map.clear ();
-
-  for (auto _it : m_link_congested)
+int
+Dta::initialize (const std::string &folder, const Dta *shared)
+{
+  // share the static network of another instance if given, so that only the
+  // demand and routing inputs are read from folder
+  std::shared_ptr<const MNM_Network_Core> _core;
+  if (shared != nullptr)
     {
-      delete _it.second;
+      if (shared->m_dta == nullptr || shared->m_dta->m_core == nullptr)
+        {
+          throw std::runtime_error (
+            "Error, Dta::initialize, shared instance is not initialized");
+        }
+      _core = shared->m_dta->m_core;
     }
-  m_link_congested.clear ();
-
-  for (auto _it : m_queue_dissipated_time)
+  else
     {
-      delete _it.second;
+      _core = MNM_Network_Core::build_from_files (folder);
     }
-  m_queue_dissipated_time.clear ();
-}
-
-int
-Dta::initialize (const std::string &folder)
-{
-  m_dta = new MNM_Dta (folder);
+  m_dta = new MNM_Dta (folder, _core);
+  m_dta->m_profiler = m_profiler;
   m_dta->build_from_files ();
   m_dta->hook_up_node_and_link ();
   m_dta->is_ok ();
@@ -248,7 +317,8 @@ Dta::check_input_files ()
 int
 Dta::generate_shortest_pathsets (const std::string &folder, int max_iter,
                                  double vot, double mid_scale,
-                                 double heavy_scale, double min_path_tt)
+                                 double heavy_scale, double min_path_tt,
+                                 int num_threads)
 {
   m_dta = new MNM_Dta (folder);
   m_dta->build_from_files ();
@@ -258,7 +328,8 @@ Dta::generate_shortest_pathsets (const std::string &folder, int max_iter,
     = MNM::build_pathset (m_dta->m_graph, m_dta->m_od_factory,
                           m_dta->m_link_factory, min_path_tt, max_iter, vot,
                           mid_scale, heavy_scale,
-                          m_dta->m_config->get_int ("max_interval"));
+                          m_dta->m_config->get_int ("max_interval"),
+                          num_threads);
   printf ("driving pathset generated\n");
   MNM::save_driving_path_table (folder, _driving_path_table, "path_table",
                                 "path_table_buffer", true);
@@ -285,6 +356,10 @@ Dta::generate_shortest_pathsets (const std::string &folder, int max_iter,
 int
 Dta::install_cc ()
 {
+  if (m_loaded)
+    {
+      throw std::runtime_error ("Error, Dta::install_cc, already loaded");
+    }
   // for (size_t i = 0; i < m_link_vec.size (); ++i)
   //   {
   //     m_link_vec[i]->install_cumulative_curve ();
@@ -306,9 +381,70 @@ Dta::install_cc_tree ()
   return 0;
 }
 
+// timings are kept until profiling is disabled again
+int
+Dta::enable_profile (bool enable)
+{
+  if (enable && m_profiler == nullptr)
+    {
+      m_profiler = new MNM_Profiler ();
+    }
+  else if (!enable && m_profiler != nullptr)
+    {
+      delete m_profiler;
+      m_profiler = nullptr;
+    }
+  if (m_dta != nullptr)
+    {
+      m_dta->m_profiler = m_profiler;
+    }
+  return 0;
+}
+
+py::dict
+Dta::get_profile ()
+{
+  return utils::get_profile (m_profiler);
+}
+
+int
+Dta::save_profile_trace (const std::string &file_name)
+{
+  if (m_profiler == nullptr)
+    {
+      throw std::runtime_error (
+        "Error, Dta::save_profile_trace, profiling is not enabled");
+    }
+  return m_profiler->save_trace (file_name);
+}
+
+py::dict
+Dta::get_memory_usage ()
+{
+  MNM_Memory_Report _report;
+  if (m_dta != nullptr)
+    {
+      m_dta->add_memory_usage (_report);
+      if (!m_link_tt_map.empty ())
+        {
+          MNM::add_memory (_report, "link_tt_map",
+                           m_link_tt_map.get_memory_bytes (),
+                           m_link_tt_map.get_num_rows ());
+          MNM::add_memory (_report, "link_cost_map",
+                           m_link_cost_map.get_memory_bytes (),
+                           m_link_cost_map.get_num_rows ());
+        }
+    }
+  return utils::get_memory_usage (_report);
+}
+
 int
 Dta::run_whole (bool verbose)
 {
+  if (m_loaded)
+    {
+      throw std::runtime_error ("Error, Dta::run_whole, already loaded");
+    }
   m_dta->pre_loading ();
   m_dta->loading (verbose);
   // FIXME: Force a flush so that we can discard/capture all outputs from
@@ -316,6 +452,7 @@ Dta::run_whole (bool verbose)
   // logging system.
   std::cout.flush ();   // iostream
   std::fflush (stdout); // cstdio
+  m_loaded = true;
   return 0;
 }
 
@@ -331,6 +468,7 @@ Dta::run_due (int max_iter, const std::string &folder, bool verbose,
 
   MNM_Due *_due = new MNM_Due_Msa (folder);
   _due->initialize (); // create and set m_buffer[i] = 0
+  _due->m_profiler = m_profiler;
   _due->init_path_flow ();
 
   std::string _gap_file_name = folder + "/" + _rec_folder + "/gap_iteration";
@@ -345,13 +483,18 @@ Dta::run_due (int max_iter, const std::string &folder, bool verbose,
   for (int i = 0; i < max_iter; ++i)
     {
       printf ("---------- Iteration %d ----------\n", i);
+      if (m_profiler != nullptr)
+        m_profiler->set_iteration (i);
 
       // DNL using dta.cpp, new dta is built from scratch
       m_dta = _due->run_dta (verbose);
 
       // time-dependent link cost
-      build_link_cost_map (false);
-      // TODO: whole map will be copied
+      {
+        MNM_Phase_Timer _timer (m_profiler, "build_link_cost_map");
+        build_link_cost_map (false);
+      }
+      // the rows are shared, not copied
       _due->m_link_tt_map = m_link_tt_map;
       _due->m_link_cost_map = m_link_cost_map;
       // _due -> build_link_cost_map(m_dta);
@@ -406,6 +549,14 @@ Dta::run_due (int max_iter, const std::string &folder, bool verbose,
             }
         }
 
+      if (m_dta->m_memory_log_freq > 0)
+        {
+          MNM_Memory_Report _report = m_dta->get_memory_usage ();
+          _due->add_memory_usage (_report);
+          printf ("Memory after iteration %d: %s\n", i,
+                  MNM::memory_report_to_string (_report).c_str ());
+        }
+
       dynamic_cast<MNM_Routing_Fixed *> (m_dta->m_routing)->m_path_table
         = nullptr;
       delete m_dta;
@@ -414,8 +565,8 @@ Dta::run_due (int max_iter, const std::string &folder, bool verbose,
 
   _gap_file.close ();
 
-  _due->m_link_tt_map = std::unordered_map<TInt, TFlt *> ();
-  _due->m_link_cost_map = std::unordered_map<TInt, TFlt *> ();
+  _due->m_link_tt_map.clear ();
+  _due->m_link_cost_map.clear ();
   delete _due;
   printf ("Dta::run_due, finished\n");
   return 0;
@@ -433,6 +584,7 @@ Dta::run_dso (int max_iter, const std::string &folder, bool verbose,
 
   MNM_Dso *_dso = new MNM_Dso (folder);
   _dso->initialize (); // create and set m_buffer[i] = 0
+  _dso->m_profiler = m_profiler;
   _dso->init_path_flow ();
 
   std::string _gap_file_name = folder + "/" + _rec_folder + "/gap_iteration";
@@ -447,13 +599,18 @@ Dta::run_dso (int max_iter, const std::string &folder, bool verbose,
   for (int i = 0; i < max_iter; ++i)
     {
       printf ("---------- Iteration %d ----------\n", i);
+      if (m_profiler != nullptr)
+        m_profiler->set_iteration (i);
 
       // DNL using dta.cpp, new dta is built from scratch
       m_dta = _dso->run_dta (verbose);
 
       // time-dependent link cost
-      build_link_cost_map (true);
-      // TODO: whole map will be copied
+      {
+        MNM_Phase_Timer _timer (m_profiler, "build_link_cost_map");
+        build_link_cost_map (true);
+      }
+      // the rows are shared, not copied
       _dso->m_link_tt_map = m_link_tt_map;
       _dso->m_link_cost_map = m_link_cost_map;
       _dso->m_link_congested = m_link_congested;
@@ -511,6 +668,14 @@ Dta::run_dso (int max_iter, const std::string &folder, bool verbose,
             }
         }
 
+      if (m_dta->m_memory_log_freq > 0)
+        {
+          MNM_Memory_Report _report = m_dta->get_memory_usage ();
+          _dso->add_memory_usage (_report);
+          printf ("Memory after iteration %d: %s\n", i,
+                  MNM::memory_report_to_string (_report).c_str ());
+        }
+
       dynamic_cast<MNM_Routing_Fixed *> (m_dta->m_routing)->m_path_table
         = nullptr;
       delete m_dta;
@@ -519,9 +684,9 @@ Dta::run_dso (int max_iter, const std::string &folder, bool verbose,
 
   _gap_file.close ();
 
-  _dso->m_link_tt_map = std::unordered_map<TInt, TFlt *> ();
-  _dso->m_link_cost_map = std::unordered_map<TInt, TFlt *> ();
-  _dso->m_link_congested = std::unordered_map<TInt, bool *> ();
+  _dso->m_link_tt_map.clear ();
+  _dso->m_link_cost_map.clear ();
+  _dso->m_link_congested.clear ();
   delete _dso;
   printf ("Dta::run_dso, finished\n");
   return 0;
@@ -982,7 +1147,6 @@ Dta::print_simulation_results (const std::string &folder, int cong_frequency)
 int
 Dta::build_link_cost_map (bool with_congestion_indicator)
 {
-  MNM_Dlink *_link;
   TFlt _vot;
   if (m_dta->m_config->get_string ("routing_type") == "Due")
     {
@@ -1003,57 +1167,45 @@ Dta::build_link_cost_map (bool with_congestion_indicator)
       throw std::runtime_error ("unsupported routing type");
     }
 
+  int _total_loading_inter = get_cur_loading_interval ();
+  std::vector<TInt> _link_IDs;
   for (auto _link_it : m_dta->m_link_factory->m_link_map)
-    {
-      // #pragma omp task
-      _link = _link_it.second;
-      if (m_link_tt_map.find (_link_it.first) == m_link_tt_map.end ())
-        {
-          m_link_tt_map[_link_it.first] = new TFlt[get_cur_loading_interval ()];
-        }
-      if (m_link_cost_map.find (_link_it.first) == m_link_cost_map.end ())
-        {
-          m_link_cost_map[_link_it.first]
-            = new TFlt[get_cur_loading_interval ()];
-        }
+    _link_IDs.push_back (_link_it.first);
+  // rebuilt when loading went on since the last call
+  if (m_link_tt_map.get_num_cols () != size_t (_total_loading_inter)
+      || m_link_tt_map.get_num_rows () != _link_IDs.size ())
+    {
+      m_link_tt_map.reset (_link_IDs, _total_loading_inter);
+      m_link_cost_map.reset (_link_IDs, _total_loading_inter);
+      m_link_congested.clear ();
+      m_queue_dissipated_time.clear ();
+    }
+  if (with_congestion_indicator && m_link_congested.empty ())
+    m_link_congested.reset (_link_IDs, _total_loading_inter);
+  std::vector<TFlt> _start_times;
+  for (int i = 0; i < _total_loading_inter; i++)
+    _start_times.push_back (TFlt (i + 1));
+
+  MNM::fill_link_rows (
+    _link_IDs.size (), int (m_dta->m_settings.m_num_threads), false,
+    "build_link_cost_map", [&] (size_t k) {
+      TInt _link_ID = _link_IDs[k];
+      MNM_Dlink *_link = m_dta->m_link_factory->get_link (_link_ID);
+      TFlt *_tt = m_link_tt_map[_link_ID];
+      TFlt *_cost = m_link_cost_map[_link_ID];
+      MNM_DTA_GRADIENT::get_travel_time_batch (_link, _start_times,
+                                               m_dta->m_unit_time,
+                                               _total_loading_inter,
+                                               _tt); // intervals
+      for (int i = 0; i < _total_loading_inter; i++)
+        _cost[i] = _vot * _tt[i] + _link->m_toll;
       if (with_congestion_indicator)
         {
-          // std::cout << "car, interval: " << i << ", link: " << _link_it.first
-          // << ", tt: " << m_link_tt_map[_link_it.first][i] << ", fftt: " <<
-          // _link -> get_link_freeflow_tt_car() / m_unit_time << "\n";
-          if (m_link_congested.find (_link_it.first) == m_link_congested.end ())
-            {
-              m_link_congested[_link_it.first]
-                = new bool[get_cur_loading_interval ()];
-            }
-        }
-
-      std::cout << "********************** build_link_cost_map link "
-                << _link->m_link_ID << " **********************\n";
-      for (int i = 0; i < get_cur_loading_interval (); i++)
-        {
-          m_link_tt_map[_link_it.first][i] = MNM_DTA_GRADIENT::
-            get_travel_time (_link, TFlt (i + 1), m_dta->m_unit_time,
-                             get_cur_loading_interval ()); // intervals
-          m_link_cost_map[_link_it.first][i]
-            = _vot * m_link_tt_map[_link_it.first][i] + _link->m_toll;
-          // std::cout << "interval: " << i << ", link: " << _link_it.first <<
-          // ", tt: " << m_link_tt_map[_link_it.first][i] << "\n"; std::cout <<
-          // "car in" << "\n"; std::cout << _link -> m_N_in -> to_string() <<
-          // "\n"; std::cout << "car out" << "\n"; std::cout << _link -> m_N_out
-          // -> to_string() << "\n";
-          if (with_congestion_indicator)
-            {
-              m_link_congested[_link_it.first][i]
-                = m_link_tt_map[_link_it.first][i]
-                  > _link->get_link_freeflow_tt_loading ();
-              // std::cout << "car, interval: " << i << ", link: " <<
-              // _link_it.first << ", congested?: " <<
-              // m_link_congested[_link_it.first][i] << "\n";
-            }
+          bool *_congested = m_link_congested[_link_ID];
+          for (int i = 0; i < _total_loading_inter; i++)
+            _congested[i] = _tt[i] > _link->get_link_freeflow_tt_loading ();
         }
-    }
-
+    });
   return 0;
 }
 
@@ -1068,14 +1220,11 @@ Dta::get_link_queue_dissipated_time ()
   bool _flg;
   std::cout << "\n********************** Begin get_link_queue_dissipated_time "
                "**********************\n";
+  if (m_queue_dissipated_time.empty ())
+    m_queue_dissipated_time.reset (m_link_tt_map.get_link_IDs (),
+                                   _total_loading_inter);
   for (auto _link_it : m_dta->m_link_factory->m_link_map)
     {
-      if (m_queue_dissipated_time.find (_link_it.first)
-          == m_queue_dissipated_time.end ())
-        {
-          m_queue_dissipated_time[_link_it.first]
-            = new int[_total_loading_inter];
-        }
       // std::cout << "********************** get_link_queue_dissipated_time
       // link " << _link_it.first << " **********************\n";
       for (int i = 0; i < _total_loading_inter; i++)
@@ -1465,8 +1614,8 @@ Dta::generate_paths_to_cover_registered_links ()
             {
               pair_ptrs_1.emplace_back (p);
             }
-          std::random_shuffle (std::begin (pair_ptrs_1),
-                               std::end (pair_ptrs_1));
+          utils::random_shuffle (std::begin (pair_ptrs_1),
+                                 std::end (pair_ptrs_1));
           for (auto _it : pair_ptrs_1)
             {
               _origin = _it.second;
@@ -1483,8 +1632,8 @@ Dta::generate_paths_to_cover_registered_links ()
                 {
                   pair_ptrs_2.emplace_back (p);
                 }
-              std::random_shuffle (std::begin (pair_ptrs_2),
-                                   std::end (pair_ptrs_2));
+              utils::random_shuffle (std::begin (pair_ptrs_2),
+                                     std::end (pair_ptrs_2));
               for (auto _it_it : pair_ptrs_2)
                 {
                   _dest = _it_it.first;
@@ -1549,7 +1698,7 @@ Dta::generate_paths_to_cover_registered_links ()
             ->m_routing_fixed->m_path_table
             ->find (_origin->m_origin_node->m_node_ID)
             ->second->find (_dest->m_dest_node->m_node_ID)
-            ->second->m_path_vec.push_back (_path);
+            ->second->add_path (_path);
           m_path_vec.push_back (_path);
           _link_existing[i] = true;
 
@@ -1739,6 +1888,7 @@ Dta::get_link_tt (py::array_t<int> start_intervals, bool return_inf)
   auto result_buf = result.request ();
   double *result_ptr = (double *) result_buf.ptr;
   int *start_ptr = (int *) start_buf.ptr;
+  std::vector<TFlt> _start_times;
   for (int t = 0; t < l; ++t)
     {
       if (start_ptr[t] >= get_cur_loading_interval ())
@@ -1747,18 +1897,21 @@ Dta::get_link_tt (py::array_t<int> start_intervals, bool return_inf)
             "Error, Dta::get_link_tt, input start intervals exceeds the "
             "total loading intervals - 1");
         }
-      for (size_t i = 0; i < m_link_vec.size (); ++i)
+      // use start_ptr[t] + 1 as start_time in cc to compute link travel time
+      // for vehicles arriving at the beginning of interval start_ptr[t]
+      _start_times.push_back (TFlt (start_ptr[t] + 1));
+    }
+  // the links are independent, each job fills the row of one link
+  MNM_Ults::parallel_for (
+    m_link_vec.size (), int (m_dta->m_settings.m_num_threads),
+    [&] (size_t i, int worker) {
+      MNM_DTA_GRADIENT::
+        get_travel_time_batch (m_link_vec[i], _start_times, m_dta->m_unit_time,
+                               m_dta->m_current_loading_interval,
+                               result_ptr + i * l);
+      for (int t = 0; t < l; ++t)
         {
-          // use start_ptr[t] + 1 as start_time in cc to compute link travel
-          // time for vehicles arriving at the beginning of interval
-          // start_ptr[t]
-          result_ptr[i * l + t]
-            = MNM_DTA_GRADIENT::get_travel_time (m_link_vec[i],
-                                                 TFlt (start_ptr[t] + 1),
-                                                 m_dta->m_unit_time,
-                                                 m_dta
-                                                   ->m_current_loading_interval)
-              * m_dta->m_unit_time; // second
+          result_ptr[i * l + t] *= m_dta->m_unit_time; // second
           if (result_ptr[i * l + t]
               > TT_UPPER_BOUND * m_link_vec[i]->m_length / m_link_vec[i]->m_ffs)
             {
@@ -1775,7 +1928,7 @@ Dta::get_link_tt (py::array_t<int> start_intervals, bool return_inf)
                 }
             }
         }
-    }
+    });
   return result;
 }
 
@@ -1852,44 +2005,72 @@ Dta::get_link_tt_robust (py::array_t<double> start_intervals,
   return result;
 }
 
-py::array_t<double>
-Dta::get_registered_path_tt (py::array_t<int> start_intervals)
+int
+Dta::evaluate_registered_paths (py::array_t<int> start_intervals,
+                                const std::string &caller,
+                                std::vector<TFlt> &tt, std::vector<TFlt> *cost)
 {
   auto start_buf = start_intervals.request ();
   if (start_buf.ndim != 1)
     {
-      throw std::runtime_error (
-        "Error, Dta::get_registered_path_tt, input dimension mismatch");
+      throw std::runtime_error ("Error, " + caller
+                                + ", input dimension mismatch");
     }
   int l = start_buf.shape[0];
-  int new_shape[2] = { (int) m_path_vec.size (), l };
-  auto result = py::array_t<double> (new_shape);
-  auto result_buf = result.request ();
-  double *result_ptr = (double *) result_buf.ptr;
   int *start_ptr = (int *) start_buf.ptr;
+  std::vector<TFlt> _start_times;
   for (int t = 0; t < l; ++t)
     {
       if (start_ptr[t] >= get_cur_loading_interval ())
         {
-          throw std::runtime_error (
-            "Error, Dta::get_registered_path_tt, input start intervals "
-            "exceeds the total loading intervals - 1");
-        }
-      for (size_t i = 0; i < m_path_vec.size (); ++i)
-        {
-          // MNM_DTA_GRADIENT::get_path_travel_time will process link travel
-          // time and the start_time for cc result_ptr[i * l + t] =
-          // MNM_DTA_GRADIENT::get_path_travel_time(
-          //         m_path_vec[i], TFlt(start_ptr[t]), m_dta -> m_link_factory,
-          //         m_dta -> m_unit_time)() * m_dta -> m_unit_time;  // seconds
-          // assume build_link_cost_map() is invoked before
-          result_ptr[i * l + t]
-            = MNM_DTA_GRADIENT::
-                get_path_travel_time (m_path_vec[i], TFlt (start_ptr[t]),
-                                      m_link_tt_map,
-                                      get_cur_loading_interval ())
-              * m_dta->m_unit_time; // seconds
+          throw std::runtime_error ("Error, " + caller
+                                    + ", input start intervals exceeds the "
+                                      "total loading intervals - 1");
         }
+      _start_times.push_back (TFlt (start_ptr[t]));
+    }
+  // assume build_link_cost_map() is invoked before
+  path_link_csr _csr;
+  MNM_DTA_GRADIENT::build_path_link_csr (m_path_vec, _csr);
+  MNM_DTA_GRADIENT::get_path_travel_time_batch (
+    _csr, _start_times, m_link_tt_map, m_link_cost_map,
+    get_cur_loading_interval (), tt, cost,
+    int (m_dta->m_settings.m_num_threads));
+  return 0;
+}
+
+py::array_t<double>
+Dta::get_registered_path_tt (py::array_t<int> start_intervals)
+{
+  std::vector<TFlt> _tt;
+  evaluate_registered_paths (start_intervals, "Dta::get_registered_path_tt",
+                             _tt, nullptr);
+  int l = start_intervals.request ().shape[0];
+  int new_shape[2] = { (int) m_path_vec.size (), l };
+  auto result = py::array_t<double> (new_shape);
+  auto result_buf = result.request ();
+  double *result_ptr = (double *) result_buf.ptr;
+  for (size_t i = 0; i < _tt.size (); ++i)
+    {
+      result_ptr[i] = _tt[i] * m_dta->m_unit_time; // seconds
+    }
+  return result;
+}
+
+py::array_t<double>
+Dta::get_registered_path_cost (py::array_t<int> start_intervals)
+{
+  std::vector<TFlt> _tt, _cost;
+  evaluate_registered_paths (start_intervals, "Dta::get_registered_path_cost",
+                             _tt, &_cost);
+  int l = start_intervals.request ().shape[0];
+  int new_shape[2] = { (int) m_path_vec.size (), l };
+  auto result = py::array_t<double> (new_shape);
+  auto result_buf = result.request ();
+  double *result_ptr = (double *) result_buf.ptr;
+  for (size_t i = 0; i < _cost.size (); ++i)
+    {
+      result_ptr[i] = _cost[i];
     }
   return result;
 }
@@ -1964,7 +2145,7 @@ Dta::get_link_in_cc (int link_ID)
     {
       throw std::runtime_error ("Error, Dta::get_link_in_cc, cc not installed");
     }
-  std::deque<std::pair<TFlt, TFlt>> _record
+  const auto &_record
     = m_dta->m_link_factory->get_link (TInt (link_ID))->m_N_in->m_recorder;
   int new_shape[2] = { (int) _record.size (), 2 };
   auto result = py::array_t<double> (new_shape);
@@ -1986,7 +2167,7 @@ Dta::get_link_out_cc (int link_ID)
       throw std::runtime_error (
         "Error, Dta::get_link_out_cc, cc not installed");
     }
-  std::deque<std::pair<TFlt, TFlt>> _record
+  const auto &_record
     = m_dta->m_link_factory->get_link (TInt (link_ID))->m_N_out->m_recorder;
   int new_shape[2] = { (int) _record.size (), 2 };
   auto result = py::array_t<double> (new_shape);
@@ -2000,12 +2181,100 @@ Dta::get_link_out_cc (int link_ID)
   return result;
 }
 
+py::array_t<double>
+Dta::get_link_in_ccs (py::array_t<int> links)
+{
+  auto links_buf = links.request ();
+  if (links_buf.ndim != 1)
+    {
+      throw std::runtime_error ("Error, Dta::get_link_in_ccs, input dimension "
+                                "mismatch");
+    }
+  int *links_ptr = (int *) links_buf.ptr;
+  std::vector<MNM_Cumulative_Curve *> _ccs;
+  for (int i = 0; i < links_buf.shape[0]; ++i)
+    {
+      MNM_Dlink *_link = m_dta->m_link_factory->get_link (TInt (links_ptr[i]));
+      if (_link->m_N_in == nullptr)
+        {
+          throw std::runtime_error (
+            "Error, Dta::get_link_in_ccs, cc not installed");
+        }
+      _ccs.push_back (_link->m_N_in);
+    }
+  return utils::get_ccs_on_grid (_ccs, get_cur_loading_interval () + 1);
+}
+
+py::array_t<double>
+Dta::get_link_out_ccs (py::array_t<int> links)
+{
+  auto links_buf = links.request ();
+  if (links_buf.ndim != 1)
+    {
+      throw std::runtime_error ("Error, Dta::get_link_out_ccs, input "
+                                "dimension mismatch");
+    }
+  int *links_ptr = (int *) links_buf.ptr;
+  std::vector<MNM_Cumulative_Curve *> _ccs;
+  for (int i = 0; i < links_buf.shape[0]; ++i)
+    {
+      MNM_Dlink *_link = m_dta->m_link_factory->get_link (TInt (links_ptr[i]));
+      if (_link->m_N_out == nullptr)
+        {
+          throw std::runtime_error (
+            "Error, Dta::get_link_out_ccs, cc not installed");
+        }
+      _ccs.push_back (_link->m_N_out);
+    }
+  return utils::get_ccs_on_grid (_ccs, get_cur_loading_interval () + 1);
+}
+
+py::array_t<double>
+Dta::get_link_in_cc_view (int link_ID)
+{
+  MNM_Dlink *_link = m_dta->m_link_factory->get_link (TInt (link_ID));
+  if (_link->m_N_in == nullptr)
+    {
+      throw std::runtime_error (
+        "Error, Dta::get_link_in_cc_view, cc not installed");
+    }
+  if (!m_loaded)
+    {
+      throw std::runtime_error (
+        "Error, Dta::get_link_in_cc_view, loading not finished");
+    }
+  return utils::get_cc_view (_link->m_N_in,
+                             py::cast (this,
+                                       py::return_value_policy::reference));
+}
+
+py::array_t<double>
+Dta::get_link_out_cc_view (int link_ID)
+{
+  MNM_Dlink *_link = m_dta->m_link_factory->get_link (TInt (link_ID));
+  if (_link->m_N_out == nullptr)
+    {
+      throw std::runtime_error (
+        "Error, Dta::get_link_out_cc_view, cc not installed");
+    }
+  if (!m_loaded)
+    {
+      throw std::runtime_error (
+        "Error, Dta::get_link_out_cc_view, loading not finished");
+    }
+  return utils::get_cc_view (_link->m_N_out,
+                             py::cast (this,
+                                       py::return_value_policy::reference));
+}
+
 py::array_t<double>
 Dta::get_dar_matrix (py::array_t<int> start_intervals,
                      py::array_t<int> end_intervals)
 {
+  MNM_Phase_Timer _timer (m_profiler, "get_dar_matrix");
   auto start_buf = start_intervals.request ();
   auto end_buf = end_intervals.request ();
+  py::gil_scoped_release _release;
   if (start_buf.ndim != 1 || end_buf.ndim != 1)
     {
       throw std::runtime_error (
@@ -2054,6 +2323,7 @@ Dta::get_dar_matrix (py::array_t<int> start_intervals,
         }
     }
 
+  py::gil_scoped_acquire _acquire;
   // path_ID, assign_time, link_ID, start_int, flow
   int new_shape[2] = { (int) _record.size (), 5 };
   auto result = py::array_t<double> (new_shape);
@@ -2084,6 +2354,7 @@ Dta::save_dar_matrix (py::array_t<int> start_intervals,
                       py::array_t<int> end_intervals, py::array_t<double> f,
                       const std::string &file_name)
 {
+  MNM_Phase_Timer _timer (m_profiler, "save_dar_matrix");
   // start_intervals and end_intervals are like [0, 180, 360, ...] and [180,
   // 360, 540, ...] with increment of ass_freq
   auto f_buf = f.request ();
@@ -2096,6 +2367,7 @@ Dta::save_dar_matrix (py::array_t<int> start_intervals,
 
   auto start_buf = start_intervals.request ();
   auto end_buf = end_intervals.request ();
+  py::gil_scoped_release _release;
   if (start_buf.ndim != 1 || end_buf.ndim != 1)
     {
       throw std::runtime_error (
@@ -2195,6 +2467,7 @@ Dta::get_complete_dar_matrix (py::array_t<int> start_intervals,
                               py::array_t<int> end_intervals, int num_intervals,
                               py::array_t<double> f)
 {
+  MNM_Phase_Timer _timer (m_profiler, "get_complete_dar_matrix");
   // start_intervals and end_intervals are like [0, 180, 360, ...] and [180,
   // 360, 720, ...] with increment of ass_freq
   int _num_e_path = m_path_map.size ();
@@ -2202,6 +2475,7 @@ Dta::get_complete_dar_matrix (py::array_t<int> start_intervals,
   auto start_buf = start_intervals.request ();
   auto end_buf = end_intervals.request ();
   auto f_buf = f.request ();
+  py::gil_scoped_release _release;
   if (start_buf.ndim != 1 || end_buf.ndim != 1)
     {
       throw std::runtime_error (
@@ -2273,5 +2547,82 @@ Dta::delete_all_agents ()
   return 0;
 }
 
+Realtime_Dta::Realtime_Dta () { m_realtime_dta = nullptr; }
+
+Realtime_Dta::~Realtime_Dta ()
+{
+  if (m_realtime_dta != nullptr)
+    {
+      delete m_realtime_dta;
+    }
+  m_ID_path_mapping.clear ();
+}
+
+int
+Realtime_Dta::initialize (const std::string &folder)
+{
+  m_realtime_dta = new MNM_Realtime_Dta (folder);
+  m_realtime_dta->init_running ();
+  MNM::get_ID_path_mapping (m_ID_path_mapping, m_realtime_dta->m_path_table);
+  return 0;
+}
+
+int
+Realtime_Dta::run_iteration (int assign_inter)
+{
+  if (m_realtime_dta == nullptr)
+    {
+      throw std::runtime_error (
+        "Error, Realtime_Dta::run_iteration, not initialized");
+    }
+  return m_realtime_dta->one_iteration (TInt (assign_inter));
+}
+
+py::array_t<double>
+Realtime_Dta::get_path_p ()
+{
+  int l = m_ID_path_mapping.size ();
+  auto result = py::array_t<double> (l);
+  auto result_buf = result.request ();
+  double *result_ptr = (double *) result_buf.ptr;
+  for (int i = 0; i < l; ++i)
+    {
+      auto _it = m_ID_path_mapping.find (i);
+      if (_it == m_ID_path_mapping.end ())
+        {
+          throw std::runtime_error (
+            "Error, Realtime_Dta::get_path_p, path IDs are not consecutive");
+        }
+      result_ptr[i] = _it->second->m_p;
+    }
+  return result;
+}
+
+py::array_t<double>
+Realtime_Dta::get_link_tt (py::array_t<int> links)
+{
+  auto links_buf = links.request ();
+  if (links_buf.ndim != 1)
+    {
+      throw std::runtime_error (
+        "Error, Realtime_Dta::get_link_tt, input dimension mismatch");
+    }
+  int l = links_buf.shape[0];
+  int *links_ptr = (int *) links_buf.ptr;
+  auto result = py::array_t<double> (l);
+  auto result_buf = result.request ();
+  double *result_ptr = (double *) result_buf.ptr;
+  for (int i = 0; i < l; ++i)
+    {
+      auto _it = m_realtime_dta->m_average_link_tt.find (links_ptr[i]);
+      if (_it == m_realtime_dta->m_average_link_tt.end ())
+        {
+          throw std::runtime_error (
+            "Error, Realtime_Dta::get_link_tt, link does not exist");
+        }
+      result_ptr[i] = _it->second;
+    }
+  return result;
+}
 }
 }
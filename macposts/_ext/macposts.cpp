@@ -1,7 +1,11 @@
 #include "utils.h"
 #include <common.h>
+#include <multimodal.h>
 #include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
 #include <random>
+#include <shortest_path.h>
+#include <unordered_map>
 
 namespace py = pybind11;
 
@@ -38,7 +42,9 @@ PYBIND11_MODULE (_macposts_ext, m)
          R"pbdoc(Set the random state.
 
 Note that this only affects the random number generator used during network
-simulation.
+simulation. Each thread has its own generator: this reseeds the generator of
+the calling thread, and threads that have not drawn any number yet start from
+the given seed.
 
 )pbdoc");
 
@@ -130,7 +136,63 @@ simulation.
           return py::make_tuple (g.get_id (endpoints.first),
                                  g.get_id (endpoints.second));
         },
-        "Get IDs of the two endpoints (nodes) of link *id*.", py::arg ("id"));
+        "Get IDs of the two endpoints (nodes) of link *id*.", py::arg ("id"))
+      .def (
+        "shortest_path_tree",
+        [] (const G &g, int dest,
+            const std::unordered_map<int, double> &costs) {
+          std::unordered_map<int, double> dist;
+          std::unordered_map<int, int> tree;
+          MNM_Shortest_Path::all_to_one_FIFO (dest, g, dist, costs, tree);
+          return py::make_tuple (tree, dist);
+        },
+        R"pbdoc(Build the shortest path tree to node *dest* under the link
+*costs*, a dict from link ID to cost.
+
+Return *(tree, dist)*, where *tree* maps each node to its next link towards
+*dest* (-1 for none) and *dist* maps each node to its distance to *dest*.
+
+)pbdoc",
+        py::arg ("dest"), py::arg ("costs"))
+      .def (
+        "repair_shortest_path_tree",
+        [] (const G &g, int dest, std::unordered_map<int, double> tree_costs,
+            const std::unordered_map<int, double> &costs,
+            std::unordered_map<int, int> tree,
+            std::unordered_map<int, double> dist) {
+          auto changed
+            = MNM_Shortest_Path::update_changed_link_cost (tree_costs, costs);
+          MNM_Shortest_Path::repair_all_to_one_FIFO (dest, g, dist, tree_costs,
+                                                     changed, tree);
+          return py::make_tuple (tree, dist, tree_costs);
+        },
+        R"pbdoc(Repair a tree from :meth:`shortest_path_tree`.
+
+*tree* and *dist* were built under *tree_costs*. The links whose cost in
+*costs* is not approximately equal to their cost in *tree_costs* are taken
+over, and the tree is repaired for them, as adaptive routing does with
+``incremental_sp``. Return *(tree, dist, tree_costs)* after the repair.
+
+)pbdoc",
+        py::arg ("dest"), py::arg ("tree_costs"), py::arg ("costs"),
+        py::arg ("tree"), py::arg ("dist"))
+      .def (
+        "transit_shortest_path_tree",
+        [] (const G &g, int dest,
+            const std::unordered_map<int, double> &costs) {
+          std::unordered_map<int, int> tree;
+          MNM_Transit_Router router (g);
+          router.set_link_cost (costs);
+          router.update_tree (dest, tree);
+          return tree;
+        },
+        R"pbdoc(Build the shortest path tree to node *dest* under the link
+*costs* with the router of multimodal passenger routing.
+
+Return the tree as :meth:`shortest_path_tree` does.
+
+)pbdoc",
+        py::arg ("dest"), py::arg ("costs"));
   }
 
   macposts::tdsp::init (m);
@@ -28,9 +28,14 @@ public:
   bool check_input_files ();
   int generate_shortest_pathsets (const std::string &folder, int max_iter,
                                   double vot, double mid_scale,
-                                  double heavy_scale, double min_path_tt = 0.);
+                                  double heavy_scale, double min_path_tt = 0.,
+                                  int num_threads = 1);
   int install_cc ();
   int install_cc_tree ();
+  int enable_profile (bool enable = true);
+  py::dict get_profile ();
+  int save_profile_trace (const std::string &file_name);
+  py::dict get_memory_usage ();
   int run_whole (bool verbose = false);
   // FIXME: This returns a Numpy array for consistency, but it should really be
   // better to use a plain list.
@@ -93,6 +98,10 @@ public:
   py::array_t<double> get_car_link_in_cc (int link_ID);
   py::array_t<double> get_truck_link_out_cc (int link_ID);
   py::array_t<double> get_truck_link_in_cc (int link_ID);
+  py::array_t<double> get_car_link_out_ccs (py::array_t<int> links);
+  py::array_t<double> get_car_link_in_ccs (py::array_t<int> links);
+  py::array_t<double> get_truck_link_out_ccs (py::array_t<int> links);
+  py::array_t<double> get_truck_link_in_ccs (py::array_t<int> links);
 
   py::array_t<double> get_enroute_and_queue_veh_stats_agg ();
   py::array_t<double> get_queue_veh_each_link (py::array_t<int> useful_links,
@@ -158,28 +167,36 @@ public:
   int delete_all_agents ();
 
   MNM_Dta_Multiclass *m_mcdta;
+  // phase timings of loading and DAR/LTG builders, if enabled
+  MNM_Profiler *m_profiler;
   std::vector<MNM_Dlink_Multiclass *> m_link_vec;
   std::vector<MNM_Path *> m_path_vec;
   std::set<MNM_Path *> m_path_set;
   std::unordered_map<TInt, MNM_Path *> m_ID_path_mapping;
 
   // time-varying link tt
-  std::unordered_map<TInt, TFlt *> m_link_tt_map;
-  std::unordered_map<TInt, TFlt *> m_link_tt_map_truck;
+  MNM_Link_Matrix<TFlt> m_link_tt_map;
+  MNM_Link_Matrix<TFlt> m_link_tt_map_truck;
 
   // time-varying link cost
-  std::unordered_map<TInt, TFlt *> m_link_cost_map;
-  std::unordered_map<TInt, TFlt *> m_link_cost_map_truck;
+  MNM_Link_Matrix<TFlt> m_link_cost_map;
+  MNM_Link_Matrix<TFlt> m_link_cost_map_truck;
 
   // time-varying indicator
-  std::unordered_map<TInt, bool *> m_link_congested_car;
-  std::unordered_map<TInt, bool *> m_link_congested_truck;
+  MNM_Link_Matrix<bool> m_link_congested_car;
+  MNM_Link_Matrix<bool> m_link_congested_truck;
 
   // time-varying queue dissipated time
-  std::unordered_map<TInt, int *> m_queue_dissipated_time_car;
-  std::unordered_map<TInt, int *> m_queue_dissipated_time_truck;
+  MNM_Link_Matrix<int> m_queue_dissipated_time_car;
+  MNM_Link_Matrix<int> m_queue_dissipated_time_truck;
 
   std::unordered_map<TInt, MNM_TDSP_Tree *> m_tdsp_tree_map;
+
+private:
+  py::array_t<double>
+  get_link_ccs (py::array_t<int> links,
+                MNM_Cumulative_Curve *MNM_Dlink_Multiclass::*cc,
+                const std::string &caller);
 };
 
 void
@@ -187,22 +204,40 @@ init (py::module &m)
 {
   py::class_<Mcdta> (m, "Mcdta")
     .def (py::init<> ())
-    .def ("initialize", &Mcdta::initialize)
+    .def ("initialize", &Mcdta::initialize,
+          py::call_guard<py::gil_scoped_release> ())
     .def ("check_input_files", &Mcdta::check_input_files)
-    .def ("generate_shortest_pathsets", &Mcdta::generate_shortest_pathsets)
-    .def ("run_whole", &Mcdta::run_whole, py::arg ("verbose") = false)
+    .def ("generate_shortest_pathsets", &Mcdta::generate_shortest_pathsets,
+          py::arg ("folder"), py::arg ("max_iter"), py::arg ("vot"),
+          py::arg ("mid_scale"), py::arg ("heavy_scale"),
+          py::arg ("min_path_tt") = 0., py::arg ("num_threads") = 1,
+          py::call_guard<py::gil_scoped_release> ())
+    .def ("run_whole", &Mcdta::run_whole, py::arg ("verbose") = false,
+          py::call_guard<py::gil_scoped_release> ())
     .def ("install_cc", &Mcdta::install_cc)
+    .def ("enable_profile", &Mcdta::enable_profile, py::arg ("enable") = true,
+          "Time the phases of loading and the DAR/LTG builders.")
+    .def ("get_profile", &Mcdta::get_profile,
+          "Phase timings in seconds, see enable_profile.")
+    .def ("save_profile_trace", &Mcdta::save_profile_trace,
+          py::arg ("file_name"),
+          "Write the phase timings as a Chrome/Perfetto trace file.")
+    .def ("get_memory_usage", &Mcdta::get_memory_usage,
+          "Estimated bytes and object counts of the simulation by category.")
     .def ("install_cc_tree", &Mcdta::install_cc_tree)
     .def ("get_travel_stats", &Mcdta::get_travel_stats)
     .def ("print_emission_stats", &Mcdta::print_emission_stats)
     .def ("get_cur_loading_interval", &Mcdta::get_cur_loading_interval)
     .def_property_readonly ("links", &Mcdta::get_all_links, "IDs of all links.")
     .def ("print_simulation_results", &Mcdta::print_simulation_results)
-    .def ("run_whole_vehicle_tracking", &Mcdta::run_whole_vehicle_tracking)
+    .def ("run_whole_vehicle_tracking", &Mcdta::run_whole_vehicle_tracking,
+          py::call_guard<py::gil_scoped_release> ())
 
-    .def ("build_link_cost_map", &Mcdta::build_link_cost_map)
+    .def ("build_link_cost_map", &Mcdta::build_link_cost_map,
+          py::call_guard<py::gil_scoped_release> ())
     .def ("get_link_queue_dissipated_time",
-          &Mcdta::get_link_queue_dissipated_time)
+          &Mcdta::get_link_queue_dissipated_time,
+          py::call_guard<py::gil_scoped_release> ())
     .def ("update_tdsp_tree", &Mcdta::update_tdsp_tree)
     .def ("get_lowest_cost_path", &Mcdta::get_lowest_cost_path)
 
@@ -230,6 +265,10 @@ init (py::module &m)
     .def ("get_truck_link_out_num", &Mcdta::get_truck_link_out_num)
     .def ("get_car_link_in_cc", &Mcdta::get_car_link_in_cc)
     .def ("get_truck_link_in_cc", &Mcdta::get_truck_link_in_cc)
+    .def ("get_car_link_out_ccs", &Mcdta::get_car_link_out_ccs)
+    .def ("get_car_link_in_ccs", &Mcdta::get_car_link_in_ccs)
+    .def ("get_truck_link_out_ccs", &Mcdta::get_truck_link_out_ccs)
+    .def ("get_truck_link_in_ccs", &Mcdta::get_truck_link_in_ccs)
     .def ("get_car_link_out_cc", &Mcdta::get_car_link_out_cc)
     .def ("get_truck_link_out_cc", &Mcdta::get_truck_link_out_cc)
     .def ("get_car_link_speed", &Mcdta::get_car_link_speed)
@@ -279,23 +318,12 @@ init (py::module &m)
 Mcdta::Mcdta ()
 {
   m_mcdta = nullptr;
+  m_profiler = nullptr;
   m_link_vec = std::vector<MNM_Dlink_Multiclass *> ();
   m_path_vec = std::vector<MNM_Path *> ();
   m_path_set = std::set<MNM_Path *> ();
   m_ID_path_mapping = std::unordered_map<TInt, MNM_Path *> ();
 
-  m_link_tt_map = std::unordered_map<TInt, TFlt *> ();
-  m_link_tt_map_truck = std::unordered_map<TInt, TFlt *> ();
-
-  m_link_cost_map = std::unordered_map<TInt, TFlt *> ();
-  m_link_cost_map_truck = std::unordered_map<TInt, TFlt *> ();
-
-  m_link_congested_car = std::unordered_map<TInt, bool *> ();
-  m_link_congested_truck = std::unordered_map<TInt, bool *> ();
-
-  m_queue_dissipated_time_car = std::unordered_map<TInt, int *> ();
-  m_queue_dissipated_time_truck = std::unordered_map<TInt, int *> ();
-
   m_tdsp_tree_map = std::unordered_map<TInt, MNM_TDSP_Tree *> ();
 }
 
@@ -305,56 +333,12 @@ Mcdta::~Mcdta ()
     {
       delete m_mcdta;
     }
-  m_link_vec.clear ();
-  m_path_vec.clear ();
-
-  for (auto _tt_it : m_link_tt_map)
-    {
-      delete _tt_it.second;
-    }
-  m_link_tt_map.clear ();
-
-  for (auto _tt_it : m_link_tt_map_truck)
-    {
-      delete _tt_it.second;
-    }
-  m_link_tt_map_truck.clear ();
-
-  for (auto _cost_it : m_link_cost_map)
-    {
-      delete _cost_it.second;
-    }
-  m_link_cost_map.clear ();
-
-  for (auto _cost_it : m_link_cost_map_truck)
-    {
-      delete _cost_it.second;
-    }
-  m_link_cost_map_truck.clear ();
-
-  for (auto _it : m_link_congested_car)
-    {
-      delete _it.second;
-    }
-  m_link_congested_car.clear ();
-
-  for (auto _it : m_link_congested_truck)
-    {
-      delete _it.second;
-    }
-  m_link_congested_truck.clear ();
-
-  for (auto _it : m_queue_dissipated_time_car)
-    {
-      delete _it.second;
-    }
-  m_queue_dissipated_time_car.clear ();
-
-  for (auto _it : m_queue_dissipated_time_truck)
+  if (m_profiler != nullptr)
     {
-      delete _it.second;
+      delete m_profiler;
     }
-  m_queue_dissipated_time_truck.clear ();
+  m_link_vec.clear ();
+  m_path_vec.clear ();
 
   if (!m_tdsp_tree_map.empty ())
     {
@@ -370,6 +354,7 @@ int
 Mcdta::initialize (const std::string &folder)
 {
   m_mcdta = new MNM_Dta_Multiclass (folder);
+  m_mcdta->m_profiler = m_profiler;
   m_mcdta->build_from_files ();
   m_mcdta->hook_up_node_and_link ();
   m_mcdta->is_ok ();
@@ -417,7 +402,8 @@ Mcdta::check_input_files ()
 int
 Mcdta::generate_shortest_pathsets (const std::string &folder, int max_iter,
                                    double vot, double mid_scale,
-                                   double heavy_scale, double min_path_tt)
+                                   double heavy_scale, double min_path_tt,
+                                   int num_threads)
 {
   // m_mcdta = new MNM_Dta_Multiclass(folder);
   // m_mcdta -> build_from_files();
@@ -432,7 +418,8 @@ Mcdta::generate_shortest_pathsets (const std::string &folder, int max_iter,
                                      max_iter, vot, mid_scale, heavy_scale,
                                      2
                                        * m_mcdta->m_config->get_int (
-                                         "max_interval"));
+                                         "max_interval"),
+                                     num_threads);
   printf ("driving pathset generated\n");
   MNM::save_driving_path_table (folder, _driving_path_table, "path_table",
                                 "path_table_buffer", true);
@@ -478,6 +465,54 @@ Mcdta::install_cc_tree ()
   return 0;
 }
 
+// timings are kept until profiling is disabled again
+int
+Mcdta::enable_profile (bool enable)
+{
+  if (enable && m_profiler == nullptr)
+    {
+      m_profiler = new MNM_Profiler ();
+    }
+  else if (!enable && m_profiler != nullptr)
+    {
+      delete m_profiler;
+      m_profiler = nullptr;
+    }
+  if (m_mcdta != nullptr)
+    {
+      m_mcdta->m_profiler = m_profiler;
+    }
+  return 0;
+}
+
+py::dict
+Mcdta::get_profile ()
+{
+  return utils::get_profile (m_profiler);
+}
+
+int
+Mcdta::save_profile_trace (const std::string &file_name)
+{
+  if (m_profiler == nullptr)
+    {
+      throw std::runtime_error (
+        "Error, Mcdta::save_profile_trace, profiling is not enabled");
+    }
+  return m_profiler->save_trace (file_name);
+}
+
+py::dict
+Mcdta::get_memory_usage ()
+{
+  MNM_Memory_Report _report;
+  if (m_mcdta != nullptr)
+    {
+      m_mcdta->add_memory_usage (_report);
+    }
+  return utils::get_memory_usage (_report);
+}
+
 int
 Mcdta::run_whole (bool verbose)
 {
@@ -861,115 +896,72 @@ Mcdta::get_travel_stats ()
 int
 Mcdta::build_link_cost_map (bool with_congestion_indicator)
 {
-  MNM_Dlink_Multiclass *_link;
   // TODO: what if not hybrid routing, better way to get vot
   TFlt _vot = dynamic_cast<MNM_Routing_Biclass_Hybrid *> (m_mcdta->m_routing)
                 ->m_routing_adaptive->m_vot
               * m_mcdta->m_unit_time; // money / second -> money / interval
+  int _total_loading_inter = get_cur_loading_interval ();
+  std::vector<TInt> _link_IDs;
   for (auto _link_it : m_mcdta->m_link_factory->m_link_map)
-    {
-      // #pragma omp task
-      _link = dynamic_cast<MNM_Dlink_Multiclass *> (_link_it.second);
-
-      if (m_link_tt_map.find (_link_it.first) == m_link_tt_map.end ())
-        {
-          m_link_tt_map[_link_it.first] = new TFlt[get_cur_loading_interval ()];
-        }
-      if (m_link_cost_map.find (_link_it.first) == m_link_cost_map.end ())
-        {
-          m_link_cost_map[_link_it.first]
-            = new TFlt[get_cur_loading_interval ()];
-        }
-      if (m_link_tt_map_truck.find (_link_it.first)
-          == m_link_tt_map_truck.end ())
-        {
-          m_link_tt_map_truck[_link_it.first]
-            = new TFlt[get_cur_loading_interval ()];
-        }
-      if (m_link_cost_map_truck.find (_link_it.first)
-          == m_link_cost_map_truck.end ())
+    _link_IDs.push_back (_link_it.first);
+  // rebuilt when loading went on since the last call
+  if (m_link_tt_map.get_num_cols () != size_t (_total_loading_inter)
+      || m_link_tt_map.get_num_rows () != _link_IDs.size ())
+    {
+      m_link_tt_map.reset (_link_IDs, _total_loading_inter);
+      m_link_tt_map_truck.reset (_link_IDs, _total_loading_inter);
+      m_link_cost_map.reset (_link_IDs, _total_loading_inter);
+      m_link_cost_map_truck.reset (_link_IDs, _total_loading_inter);
+      m_link_congested_car.clear ();
+      m_link_congested_truck.clear ();
+      m_queue_dissipated_time_car.clear ();
+      m_queue_dissipated_time_truck.clear ();
+    }
+  if (with_congestion_indicator && m_link_congested_car.empty ())
+    {
+      m_link_congested_car.reset (_link_IDs, _total_loading_inter);
+      m_link_congested_truck.reset (_link_IDs, _total_loading_inter);
+    }
+  std::vector<TFlt> _start_times;
+  for (int i = 0; i < _total_loading_inter; i++)
+    _start_times.push_back (TFlt (i + 1));
+
+  MNM::fill_link_rows (
+    _link_IDs.size (), int (m_mcdta->m_settings.m_num_threads), false,
+    "build_link_cost_map", [&] (size_t k) {
+      TInt _link_ID = _link_IDs[k];
+      auto *_link = dynamic_cast<MNM_Dlink_Multiclass *> (
+        m_mcdta->m_link_factory->get_link (_link_ID));
+      TFlt *_tt_car = m_link_tt_map[_link_ID];
+      TFlt *_tt_truck = m_link_tt_map_truck[_link_ID];
+      TFlt *_cost_car = m_link_cost_map[_link_ID];
+      TFlt *_cost_truck = m_link_cost_map_truck[_link_ID];
+      MNM_DTA_GRADIENT::get_travel_time_car_batch (_link, _start_times,
+                                                   m_mcdta->m_unit_time,
+                                                   _total_loading_inter,
+                                                   _tt_car); // intervals
+      MNM_DTA_GRADIENT::get_travel_time_truck_batch (_link, _start_times,
+                                                     m_mcdta->m_unit_time,
+                                                     _total_loading_inter,
+                                                     _tt_truck); // intervals
+      for (int i = 0; i < _total_loading_inter; i++)
         {
-          m_link_cost_map_truck[_link_it.first]
-            = new TFlt[get_cur_loading_interval ()];
+          _cost_car[i] = _vot * _tt_car[i] + _link->m_toll_car;
+          _cost_truck[i] = _vot * _tt_truck[i] + _link->m_toll_truck;
         }
-
       if (with_congestion_indicator)
         {
-          if (m_link_congested_car.find (_link_it.first)
-              == m_link_congested_car.end ())
-            {
-              m_link_congested_car[_link_it.first]
-                = new bool[get_cur_loading_interval ()];
-            }
-          if (m_link_congested_truck.find (_link_it.first)
-              == m_link_congested_truck.end ())
-            {
-              m_link_congested_truck[_link_it.first]
-                = new bool[get_cur_loading_interval ()];
-            }
-        }
-
-      std::cout << "********************** build_link_cost_map link "
-                << _link->m_link_ID << " **********************\n";
-      for (int i = 0; i < get_cur_loading_interval (); i++)
-        {
-          m_link_tt_map[_link_it.first][i] = MNM_DTA_GRADIENT::
-            get_travel_time_car (_link, TFlt (i + 1), m_mcdta->m_unit_time,
-                                 get_cur_loading_interval ()); // intervals
-
-          m_link_cost_map[_link_it.first][i]
-            = _vot * m_link_tt_map[_link_it.first][i] + _link->m_toll_car;
-
-          m_link_tt_map_truck[_link_it.first][i] = MNM_DTA_GRADIENT::
-            get_travel_time_truck (_link, TFlt (i + 1), m_mcdta->m_unit_time,
-                                   get_cur_loading_interval ()); // intervals
-
-          m_link_cost_map_truck[_link_it.first][i]
-            = _vot * m_link_tt_map_truck[_link_it.first][i]
-              + _link->m_toll_truck;
-
-          // std::cout << "interval: " << i << ", link: " << _link_it.first <<
-          // ", tt: " << m_link_tt_map[_link_it.first][i] << "\n"; std::cout <<
-          // "car in" << "\n"; std::cout << _link -> m_N_in_car -> to_string()
-          // << "\n"; std::cout << "car out" << "\n"; std::cout << _link ->
-          // m_N_out_car -> to_string() << "\n"; std::cout << "truck in" <<
-          // "\n"; std::cout << _link -> m_N_in_truck -> to_string() << "\n";
-          // std::cout << "truck out" << "\n";
-          // std::cout << _link -> m_N_out_truck -> to_string() << "\n";
-          if (with_congestion_indicator)
+          bool *_congested_car = m_link_congested_car[_link_ID];
+          bool *_congested_truck = m_link_congested_truck[_link_ID];
+          for (int i = 0; i < _total_loading_inter; i++)
             {
-              // std::cout << "car, interval: " << i << ", link: " <<
-              // _link_it.first << ", tt: " << m_link_tt_map[_link_it.first][i]
-              // << ", fftt: " << _link -> get_link_freeflow_tt_car() /
-              // m_unit_time << "\n"; std::cout << "truck, interval: " << i <<
-              // ", link: " << _link_it.first << ", tt: " <<
-              // m_link_tt_map_truck[_link_it.first][i] << ", fftt: " << _link
-              // -> get_link_freeflow_tt_truck() / m_unit_time << "\n";
-              // std::cout << "car, interval: " << i << ", link: " <<
-              // _link_it.first << ", tt: " << m_link_tt_map[_link_it.first][i]
-              // << ", fftt: " << _link -> get_link_freeflow_tt_loading_car() <<
-              // "\n"; std::cout << "truck, interval: " << i << ", link: " <<
-              // _link_it.first << ", tt: " <<
-              // m_link_tt_map_truck[_link_it.first][i] << ", fftt: " << _link
-              // -> get_link_freeflow_tt_loading_truck() << "\n";
-
-              m_link_congested_car[_link_it.first][i]
-                = m_link_tt_map[_link_it.first][i]
-                  > _link->get_link_freeflow_tt_loading_car ();
-
-              m_link_congested_truck[_link_it.first][i]
-                = m_link_tt_map_truck[_link_it.first][i]
-                  > _link->get_link_freeflow_tt_loading_truck ();
-
-              // std::cout << "car, interval: " << i << ", link: " <<
-              // _link_it.first << ", congested?: " <<
-              // m_link_congested_car[_link_it.first][i] << "\n"; std::cout <<
-              // "truck, interval: " << i << ", link: " << _link_it.first << ",
-              // congested?: " << m_link_congested_car[_link_it.first][i] <<
-              // "\n";
+              _congested_car[i]
+                = _tt_car[i] > _link->get_link_freeflow_tt_loading_car ();
+              _congested_truck[i]
+                = _tt_truck[i] > _link->get_link_freeflow_tt_loading_truck ();
             }
         }
-    }
+    });
   return 0;
 }
 
@@ -985,20 +977,15 @@ Mcdta::get_link_queue_dissipated_time ()
   bool _flg;
   std::cout << "\n********************** Begin get_link_queue_dissipated_time "
                "**********************\n";
+  if (m_queue_dissipated_time_car.empty ())
+    {
+      m_queue_dissipated_time_car.reset (m_link_tt_map.get_link_IDs (),
+                                         _total_loading_inter);
+      m_queue_dissipated_time_truck.reset (m_link_tt_map.get_link_IDs (),
+                                           _total_loading_inter);
+    }
   for (auto _link_it : m_mcdta->m_link_factory->m_link_map)
     {
-      if (m_queue_dissipated_time_car.find (_link_it.first)
-          == m_queue_dissipated_time_car.end ())
-        {
-          m_queue_dissipated_time_car[_link_it.first]
-            = new int[_total_loading_inter];
-        }
-      if (m_queue_dissipated_time_truck.find (_link_it.first)
-          == m_queue_dissipated_time_truck.end ())
-        {
-          m_queue_dissipated_time_truck[_link_it.first]
-            = new int[_total_loading_inter];
-        }
       // std::cout << "********************** get_link_queue_dissipated_time
       // link " << _link_it.first << " **********************\n";
       for (int i = 0; i < _total_loading_inter; i++)
@@ -1912,6 +1899,7 @@ Mcdta::get_car_link_tt (py::array_t<double> start_intervals, bool return_inf)
   auto result_buf = result.request ();
   double *result_ptr = (double *) result_buf.ptr;
   double *start_ptr = (double *) start_buf.ptr;
+  std::vector<TFlt> _start_times;
   for (int t = 0; t < l; ++t)
     {
       if (start_ptr[t] >= get_cur_loading_interval ())
@@ -1920,12 +1908,20 @@ Mcdta::get_car_link_tt (py::array_t<double> start_intervals, bool return_inf)
             "Error, Mcdta::get_car_link_tt, input start intervals exceeds "
             "the total loading intervals - 1");
         }
-      for (size_t i = 0; i < m_link_vec.size (); ++i)
+      _start_times.push_back (TFlt (start_ptr[t] + 1));
+    }
+  // the links are independent, each job fills the row of one link
+  MNM_Ults::parallel_for (
+    m_link_vec.size (), int (m_mcdta->m_settings.m_num_threads),
+    [&] (size_t i, int worker) {
+      MNM_DTA_GRADIENT::
+        get_travel_time_car_batch (m_link_vec[i], _start_times,
+                                   m_mcdta->m_unit_time,
+                                   m_mcdta->m_current_loading_interval,
+                                   result_ptr + i * l);
+      for (int t = 0; t < l; ++t)
         {
-          double _tmp = MNM_DTA_GRADIENT::
-            get_travel_time_car (m_link_vec[i], TFlt (start_ptr[t] + 1),
-                                 m_mcdta->m_unit_time,
-                                 m_mcdta->m_current_loading_interval);
+          double _tmp = result_ptr[i * l + t];
           if (_tmp * m_mcdta->m_unit_time
               > TT_UPPER_BOUND
                   * (m_link_vec[i]->m_length / m_link_vec[i]->m_ffs_car))
@@ -1942,7 +1938,7 @@ Mcdta::get_car_link_tt (py::array_t<double> start_intervals, bool return_inf)
             }
           result_ptr[i * l + t] = _tmp * m_mcdta->m_unit_time;
         }
-    }
+    });
   return result;
 }
 
@@ -2035,6 +2031,7 @@ Mcdta::get_truck_link_tt (py::array_t<double> start_intervals, bool return_inf)
   auto result_buf = result.request ();
   double *result_ptr = (double *) result_buf.ptr;
   double *start_ptr = (double *) start_buf.ptr;
+  std::vector<TFlt> _start_times;
   for (int t = 0; t < l; ++t)
     {
       if (start_ptr[t] >= get_cur_loading_interval ())
@@ -2043,12 +2040,20 @@ Mcdta::get_truck_link_tt (py::array_t<double> start_intervals, bool return_inf)
             "Error, Mcdta::get_truck_link_tt, input start intervals "
             "exceeds the total loading intervals - 1");
         }
-      for (size_t i = 0; i < m_link_vec.size (); ++i)
+      _start_times.push_back (TFlt (start_ptr[t] + 1));
+    }
+  // the links are independent, each job fills the row of one link
+  MNM_Ults::parallel_for (
+    m_link_vec.size (), int (m_mcdta->m_settings.m_num_threads),
+    [&] (size_t i, int worker) {
+      MNM_DTA_GRADIENT::
+        get_travel_time_truck_batch (m_link_vec[i], _start_times,
+                                     m_mcdta->m_unit_time,
+                                     m_mcdta->m_current_loading_interval,
+                                     result_ptr + i * l);
+      for (int t = 0; t < l; ++t)
         {
-          double _tmp = MNM_DTA_GRADIENT::
-            get_travel_time_truck (m_link_vec[i], TFlt (start_ptr[t] + 1),
-                                   m_mcdta->m_unit_time,
-                                   m_mcdta->m_current_loading_interval);
+          double _tmp = result_ptr[i * l + t];
           if (_tmp * m_mcdta->m_unit_time
               > TT_UPPER_BOUND
                   * (m_link_vec[i]->m_length / m_link_vec[i]->m_ffs_truck))
@@ -2065,7 +2070,7 @@ Mcdta::get_truck_link_tt (py::array_t<double> start_intervals, bool return_inf)
             }
           result_ptr[i * l + t] = _tmp * m_mcdta->m_unit_time; // seconds
         }
-    }
+    });
   return result;
 }
 
@@ -2571,8 +2576,8 @@ Mcdta::generate_paths_to_cover_registered_links ()
             {
               pair_ptrs_1.emplace_back (p);
             }
-          std::random_shuffle (std::begin (pair_ptrs_1),
-                               std::end (pair_ptrs_1));
+          utils::random_shuffle (std::begin (pair_ptrs_1),
+                                 std::end (pair_ptrs_1));
           for (auto _it : pair_ptrs_1)
             {
               _origin = dynamic_cast<MNM_Origin_Multiclass *> (_it.second);
@@ -2589,8 +2594,8 @@ Mcdta::generate_paths_to_cover_registered_links ()
                 {
                   pair_ptrs_2.emplace_back (p);
                 }
-              std::random_shuffle (std::begin (pair_ptrs_2),
-                                   std::end (pair_ptrs_2));
+              utils::random_shuffle (std::begin (pair_ptrs_2),
+                                     std::end (pair_ptrs_2));
               for (auto _it_it : pair_ptrs_2)
                 {
                   _dest
@@ -2656,7 +2661,7 @@ Mcdta::generate_paths_to_cover_registered_links ()
             ->m_routing_fixed_car->m_path_table
             ->find (_origin->m_origin_node->m_node_ID)
             ->second->find (_dest->m_dest_node->m_node_ID)
-            ->second->m_path_vec.push_back (_path);
+            ->second->add_path (_path);
           m_path_vec.push_back (_path);
           _link_existing[i] = true;
 
@@ -2812,8 +2817,8 @@ Mcdta::generate_paths_to_cover_links (py::array_t<int> links, int max_iter)
             {
               pair_ptrs_1.emplace_back (p);
             }
-          std::random_shuffle (std::begin (pair_ptrs_1),
-                               std::end (pair_ptrs_1));
+          utils::random_shuffle (std::begin (pair_ptrs_1),
+                                 std::end (pair_ptrs_1));
           for (auto _it : pair_ptrs_1)
             {
               _origin = dynamic_cast<MNM_Origin_Multiclass *> (_it.second);
@@ -2826,8 +2831,8 @@ Mcdta::generate_paths_to_cover_links (py::array_t<int> links, int max_iter)
                 {
                   pair_ptrs_2.emplace_back (p);
                 }
-              std::random_shuffle (std::begin (pair_ptrs_2),
-                                   std::end (pair_ptrs_2));
+              utils::random_shuffle (std::begin (pair_ptrs_2),
+                                     std::end (pair_ptrs_2));
               for (auto _it_it : pair_ptrs_2)
                 {
                   _dest
@@ -2902,7 +2907,7 @@ Mcdta::generate_paths_to_cover_links (py::array_t<int> links, int max_iter)
                 ->m_routing_fixed_car->m_path_table
                 ->find (_origin->m_origin_node->m_node_ID)
                 ->second->find (_dest->m_dest_node->m_node_ID)
-                ->second->m_path_vec.push_back (_path);
+                ->second->add_path (_path);
 
               result_ptr[i] += 1;
               m_path_vec.push_back (_path);
@@ -2957,7 +2962,7 @@ Mcdta::get_car_link_out_cc (int link_ID)
       throw std::runtime_error (
         "Error, Mcdta::get_car_link_out_cc, cc not installed");
     }
-  std::deque<std::pair<TFlt, TFlt>> _record = _link->m_N_out_car->m_recorder;
+  const auto &_record = _link->m_N_out_car->m_recorder;
   int new_shape[2] = { (int) _record.size (), 2 };
   auto result = py::array_t<double> (new_shape);
   auto result_buf = result.request ();
@@ -2982,7 +2987,7 @@ Mcdta::get_car_link_in_cc (int link_ID)
       throw std::runtime_error (
         "Error, Mcdta::get_car_link_in_cc, cc not installed");
     }
-  std::deque<std::pair<TFlt, TFlt>> _record = _link->m_N_in_car->m_recorder;
+  const auto &_record = _link->m_N_in_car->m_recorder;
   int new_shape[2] = { (int) _record.size (), 2 };
   auto result = py::array_t<double> (new_shape);
   auto result_buf = result.request ();
@@ -3007,7 +3012,7 @@ Mcdta::get_truck_link_out_cc (int link_ID)
       throw std::runtime_error (
         "Error, Mcdta::get_truck_link_out_cc, cc not installed");
     }
-  std::deque<std::pair<TFlt, TFlt>> _record = _link->m_N_out_truck->m_recorder;
+  const auto &_record = _link->m_N_out_truck->m_recorder;
   int new_shape[2] = { (int) _record.size (), 2 };
   auto result = py::array_t<double> (new_shape);
   auto result_buf = result.request ();
@@ -3032,7 +3037,7 @@ Mcdta::get_truck_link_in_cc (int link_ID)
       throw std::runtime_error (
         "Error, Mcdta::get_truck_link_in_cc, cc not installed");
     }
-  std::deque<std::pair<TFlt, TFlt>> _record = _link->m_N_in_truck->m_recorder;
+  const auto &_record = _link->m_N_in_truck->m_recorder;
   int new_shape[2] = { (int) _record.size (), 2 };
   auto result = py::array_t<double> (new_shape);
   auto result_buf = result.request ();
@@ -3045,6 +3050,62 @@ Mcdta::get_truck_link_in_cc (int link_ID)
   return result;
 }
 
+py::array_t<double>
+Mcdta::get_link_ccs (py::array_t<int> links,
+                     MNM_Cumulative_Curve *MNM_Dlink_Multiclass::*cc,
+                     const std::string &caller)
+{
+  auto links_buf = links.request ();
+  if (links_buf.ndim != 1)
+    {
+      throw std::runtime_error ("Error, Mcdta::" + caller
+                                + ", input dimension mismatch");
+    }
+  int *links_ptr = (int *) links_buf.ptr;
+  std::vector<MNM_Cumulative_Curve *> _ccs;
+  for (int i = 0; i < links_buf.shape[0]; ++i)
+    {
+      MNM_Dlink_Multiclass *_link
+        = (MNM_Dlink_Multiclass *) m_mcdta->m_link_factory->get_link (
+          TInt (links_ptr[i]));
+      if (_link->*cc == nullptr)
+        {
+          throw std::runtime_error ("Error, Mcdta::" + caller
+                                    + ", cc not installed");
+        }
+      _ccs.push_back (_link->*cc);
+    }
+  return utils::get_ccs_on_grid (_ccs, get_cur_loading_interval () + 1);
+}
+
+py::array_t<double>
+Mcdta::get_car_link_out_ccs (py::array_t<int> links)
+{
+  return get_link_ccs (links, &MNM_Dlink_Multiclass::m_N_out_car,
+                       "get_car_link_out_ccs");
+}
+
+py::array_t<double>
+Mcdta::get_car_link_in_ccs (py::array_t<int> links)
+{
+  return get_link_ccs (links, &MNM_Dlink_Multiclass::m_N_in_car,
+                       "get_car_link_in_ccs");
+}
+
+py::array_t<double>
+Mcdta::get_truck_link_out_ccs (py::array_t<int> links)
+{
+  return get_link_ccs (links, &MNM_Dlink_Multiclass::m_N_out_truck,
+                       "get_truck_link_out_ccs");
+}
+
+py::array_t<double>
+Mcdta::get_truck_link_in_ccs (py::array_t<int> links)
+{
+  return get_link_ccs (links, &MNM_Dlink_Multiclass::m_N_in_truck,
+                       "get_truck_link_in_ccs");
+}
+
 py::array_t<double>
 Mcdta::get_enroute_and_queue_veh_stats_agg ()
 {
@@ -3171,8 +3232,10 @@ py::array_t<double>
 Mcdta::get_car_dar_matrix (py::array_t<int> start_intervals,
                            py::array_t<int> end_intervals)
 {
+  MNM_Phase_Timer _timer (m_profiler, "get_car_dar_matrix");
   auto start_buf = start_intervals.request ();
   auto end_buf = end_intervals.request ();
+  py::gil_scoped_release _release;
   if (start_buf.ndim != 1 || end_buf.ndim != 1)
     {
       throw std::runtime_error (
@@ -3222,6 +3285,8 @@ Mcdta::get_car_dar_matrix (py::array_t<int> start_intervals,
                                                  TFlt (end_ptr[t]));
         }
     }
+
+  py::gil_scoped_acquire _acquire;
   // _record.size() = num_timesteps x num_links x num_path x
   // num_assign_timesteps path_ID, assign_time, link_ID, start_int, flow
   int new_shape[2] = { (int) _record.size (), 5 };
@@ -3252,8 +3317,10 @@ py::array_t<double>
 Mcdta::get_truck_dar_matrix (py::array_t<int> start_intervals,
                              py::array_t<int> end_intervals)
 {
+  MNM_Phase_Timer _timer (m_profiler, "get_truck_dar_matrix");
   auto start_buf = start_intervals.request ();
   auto end_buf = end_intervals.request ();
+  py::gil_scoped_release _release;
   if (start_buf.ndim != 1 || end_buf.ndim != 1)
     {
       throw std::runtime_error (
@@ -3302,6 +3369,8 @@ Mcdta::get_truck_dar_matrix (py::array_t<int> start_intervals,
                                                    TFlt (end_ptr[t]));
         }
     }
+
+  py::gil_scoped_acquire _acquire;
   // path_ID, assign_time, link_ID, start_int, flow
   int new_shape[2] = { (int) _record.size (), 5 };
   auto result = py::array_t<double> (new_shape);
@@ -3332,6 +3401,7 @@ Mcdta::save_car_dar_matrix (py::array_t<int> start_intervals,
                             py::array_t<int> end_intervals,
                             py::array_t<double> f, const std::string &file_name)
 {
+  MNM_Phase_Timer _timer (m_profiler, "save_car_dar_matrix");
   // start_intervals and end_intervals are like [0, 180, 360, ...] and [180,
   // 360, 720, ...] with increment of ass_freq
   auto f_buf = f.request ();
@@ -3344,6 +3414,7 @@ Mcdta::save_car_dar_matrix (py::array_t<int> start_intervals,
 
   auto start_buf = start_intervals.request ();
   auto end_buf = end_intervals.request ();
+  py::gil_scoped_release _release;
   if (start_buf.ndim != 1 || end_buf.ndim != 1)
     {
       throw std::runtime_error (
@@ -3445,6 +3516,7 @@ Mcdta::save_truck_dar_matrix (py::array_t<int> start_intervals,
                               py::array_t<double> f,
                               const std::string &file_name)
 {
+  MNM_Phase_Timer _timer (m_profiler, "save_truck_dar_matrix");
   // start_intervals and end_intervals are like [0, 180, 360, ...] and [180,
   // 360, 720, ...] with increment of ass_freq
   auto f_buf = f.request ();
@@ -3457,6 +3529,7 @@ Mcdta::save_truck_dar_matrix (py::array_t<int> start_intervals,
 
   auto start_buf = start_intervals.request ();
   auto end_buf = end_intervals.request ();
+  py::gil_scoped_release _release;
   if (start_buf.ndim != 1 || end_buf.ndim != 1)
     {
       throw std::runtime_error (
@@ -3557,6 +3630,7 @@ Mcdta::get_complete_car_dar_matrix (py::array_t<int> start_intervals,
                                     py::array_t<int> end_intervals,
                                     int num_intervals, py::array_t<double> f)
 {
+  MNM_Phase_Timer _timer (m_profiler, "get_complete_car_dar_matrix");
   // start_intervals and end_intervals are like [0, 180, 360, ...] and [180,
   // 360, 720, ...] with increment of ass_freq
   int _num_e_path = m_path_vec.size ();
@@ -3564,6 +3638,7 @@ Mcdta::get_complete_car_dar_matrix (py::array_t<int> start_intervals,
   auto start_buf = start_intervals.request ();
   auto end_buf = end_intervals.request ();
   auto f_buf = f.request ();
+  py::gil_scoped_release _release;
   if (start_buf.ndim != 1 || end_buf.ndim != 1)
     {
       throw std::runtime_error (
@@ -3674,6 +3749,7 @@ Mcdta::get_complete_truck_dar_matrix (py::array_t<int> start_intervals,
                                       py::array_t<int> end_intervals,
                                       int num_intervals, py::array_t<double> f)
 {
+  MNM_Phase_Timer _timer (m_profiler, "get_complete_truck_dar_matrix");
   // start_intervals and end_intervals are like [0, 180, 360, ...] and [180,
   // 360, 720, ...] with increment of ass_freq
   int _num_e_path = m_path_vec.size ();
@@ -3681,6 +3757,7 @@ Mcdta::get_complete_truck_dar_matrix (py::array_t<int> start_intervals,
   auto start_buf = start_intervals.request ();
   auto end_buf = end_intervals.request ();
   auto f_buf = f.request ();
+  py::gil_scoped_release _release;
   if (start_buf.ndim != 1 || end_buf.ndim != 1)
     {
       throw std::runtime_error (
@@ -3791,10 +3868,12 @@ py::array_t<double>
 Mcdta::get_car_ltg_matrix (py::array_t<int> start_intervals,
                            int threshold_timestamp)
 {
+  MNM_Phase_Timer _timer (m_profiler, "get_car_ltg_matrix");
   // input: intervals in which the agents are released for each path, 1 min
   // interval = 12 5-s intervals assume Mcdta::build_link_cost_map() and
   // Mcdta::get_link_queue_dissipated_time() are invoked already
   auto start_buf = start_intervals.request ();
+  py::gil_scoped_release _release;
   if (start_buf.ndim != 1)
     {
       throw std::runtime_error ("Error, Mcdta::get_car_ltg_matrix_driving, "
@@ -4074,6 +4153,7 @@ Mcdta::get_car_ltg_matrix (py::array_t<int> start_intervals,
         }
     }
 
+  py::gil_scoped_acquire _acquire;
   // _record.size() = num_timesteps x num_links x num_path x
   // num_assign_timesteps path_ID, assign_time, link_ID, start_int, gradient
   int new_shape[2] = { (int) _record.size (), 5 };
@@ -4108,10 +4188,12 @@ py::array_t<double>
 Mcdta::get_truck_ltg_matrix (py::array_t<int> start_intervals,
                              int threshold_timestamp)
 {
+  MNM_Phase_Timer _timer (m_profiler, "get_truck_ltg_matrix");
   // input: intervals in which the agents are released for each path, 1 min
   // interval = 12 5-s intervals assume Mcdta::build_link_cost_map() and
   // Mcdta::get_link_queue_dissipated_time() are invoked already
   auto start_buf = start_intervals.request ();
+  py::gil_scoped_release _release;
   if (start_buf.ndim != 1)
     {
       throw std::runtime_error (
@@ -4392,6 +4474,7 @@ Mcdta::get_truck_ltg_matrix (py::array_t<int> start_intervals,
         }
     }
 
+  py::gil_scoped_acquire _acquire;
   // _record.size() = num_timesteps x num_links x num_path x
   // num_assign_timesteps path_ID, assign_time, link_ID, start_int, gradient
   int new_shape[2] = { (int) _record.size (), 5 };
@@ -4426,6 +4509,7 @@ SparseMatrixR
 Mcdta::get_complete_car_ltg_matrix (py::array_t<int> start_intervals,
                                     int threshold_timestamp, int num_intervals)
 {
+  MNM_Phase_Timer _timer (m_profiler, "get_complete_car_ltg_matrix");
   // input: intervals in which the agents are released for each path, 1 min
   // interval = 12 5-s intervals assume Mcdta::build_link_cost_map() and
   // Mcdta::get_link_queue_dissipated_time() are invoked already
@@ -4439,6 +4523,7 @@ Mcdta::get_complete_car_ltg_matrix (py::array_t<int> start_intervals,
   _record.reserve (int (1e9));
 
   auto start_buf = start_intervals.request ();
+  py::gil_scoped_release _release;
   if (start_buf.ndim != 1)
     {
       throw std::runtime_error (
@@ -4760,6 +4845,7 @@ Mcdta::get_complete_truck_ltg_matrix (py::array_t<int> start_intervals,
                                       int threshold_timestamp,
                                       int num_intervals)
 {
+  MNM_Phase_Timer _timer (m_profiler, "get_complete_truck_ltg_matrix");
   // input: intervals in which the agents are released for each path, 1 min
   // interval = 12 5-s intervals assume Mcdta::build_link_cost_map() and
   // Mcdta::get_link_queue_dissipated_time() are invoked already
@@ -4773,6 +4859,7 @@ Mcdta::get_complete_truck_ltg_matrix (py::array_t<int> start_intervals,
   _record.reserve (int (1e9));
 
   auto start_buf = start_intervals.request ();
+  py::gil_scoped_release _release;
   if (start_buf.ndim != 1)
     {
       throw std::runtime_error (
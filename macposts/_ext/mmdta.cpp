@@ -28,11 +28,16 @@ public:
   int initialize_mmdue (const std::string &folder);
   int generate_shortest_pathsets (const std::string &folder, int max_iter,
                                   double mid_scale, double heavy_scale,
-                                  double min_path_tt = 0.);
+                                  double min_path_tt = 0.,
+                                  int num_threads = 1);
   bool check_input_files ();
 
   int install_cc ();
   int install_cc_tree ();
+  int enable_profile (bool enable = true);
+  py::dict get_profile ();
+  int save_profile_trace (const std::string &file_name);
+  py::dict get_memory_usage ();
 
   int run_whole (bool verbose = false);
   int run_mmdue (const std::string &folder, bool verbose = true);
@@ -288,6 +293,8 @@ public:
   MNM_MM_Due *m_mmdue;
   MNM_Dta_Multimodal *m_mmdta;
   bool m_is_mmdta_new;
+  // phase timings of loading, DUE iterations and DAR/LTG builders, if enabled
+  MNM_Profiler *m_profiler;
 
   std::vector<MNM_Dlink_Multiclass *> m_link_vec_driving;
   std::vector<MNM_Walking_Link *> m_link_vec_walking;
@@ -329,14 +336,32 @@ init (py::module &m)
 {
   py::class_<Mmdta> (m, "Mmdta")
     .def (py::init<> ())
-    .def ("initialize", &Mmdta::initialize)
-    .def ("run_whole", &Mmdta::run_whole, py::arg ("verbose") = false)
+    .def ("initialize", &Mmdta::initialize,
+          py::call_guard<py::gil_scoped_release> ())
+    .def ("run_whole", &Mmdta::run_whole, py::arg ("verbose") = false,
+          py::call_guard<py::gil_scoped_release> ())
     .def ("initialize_mmdue", &Mmdta::initialize_mmdue)
-    .def ("generate_shortest_pathsets", &Mmdta::generate_shortest_pathsets)
+    .def ("generate_shortest_pathsets", &Mmdta::generate_shortest_pathsets,
+          py::arg ("folder"), py::arg ("max_iter"), py::arg ("mid_scale"),
+          py::arg ("heavy_scale"), py::arg ("min_path_tt") = 0.,
+          py::arg ("num_threads") = 1,
+          py::call_guard<py::gil_scoped_release> ())
     .def ("check_input_files", &Mmdta::check_input_files)
-    .def ("run_mmdue", &Mmdta::run_mmdue)
-    .def ("run_mmdta_adaptive", &Mmdta::run_mmdta_adaptive)
+    .def ("run_mmdue", &Mmdta::run_mmdue,
+          py::call_guard<py::gil_scoped_release> ())
+    .def ("run_mmdta_adaptive", &Mmdta::run_mmdta_adaptive,
+          py::call_guard<py::gil_scoped_release> ())
     .def ("install_cc", &Mmdta::install_cc)
+    .def ("enable_profile", &Mmdta::enable_profile, py::arg ("enable") = true,
+          "Time the phases of loading, DUE iterations and DAR/LTG "
+          "builders.")
+    .def ("get_profile", &Mmdta::get_profile,
+          "Phase timings in seconds, see enable_profile.")
+    .def ("save_profile_trace", &Mmdta::save_profile_trace,
+          py::arg ("file_name"),
+          "Write the phase timings as a Chrome/Perfetto trace file.")
+    .def ("get_memory_usage", &Mmdta::get_memory_usage,
+          "Estimated bytes and object counts of the simulation by category.")
     .def ("install_cc_tree", &Mmdta::install_cc_tree)
     .def ("get_travel_stats", &Mmdta::get_travel_stats)
     .def ("print_emission_stats", &Mmdta::print_emission_stats)
@@ -446,10 +471,13 @@ init (py::module &m)
     .def ("update_tdsp_tree", &Mmdta::update_tdsp_tree)
     .def ("get_lowest_cost_path", &Mmdta::get_lowest_cost_path)
 
-    .def ("build_link_cost_map", &Mmdta::build_link_cost_map)
+    .def ("build_link_cost_map", &Mmdta::build_link_cost_map,
+          py::call_guard<py::gil_scoped_release> ())
     .def ("get_link_queue_dissipated_time",
-          &Mmdta::get_link_queue_dissipated_time)
-    .def ("build_link_cost_map_snapshot", &Mmdta::build_link_cost_map_snapshot)
+          &Mmdta::get_link_queue_dissipated_time,
+          py::call_guard<py::gil_scoped_release> ())
+    .def ("build_link_cost_map_snapshot", &Mmdta::build_link_cost_map_snapshot,
+          py::call_guard<py::gil_scoped_release> ())
     .def ("update_snapshot_route_table", &Mmdta::update_snapshot_route_table)
     .def ("get_lowest_cost_path_snapshot",
           &Mmdta::get_lowest_cost_path_snapshot)
@@ -533,6 +561,7 @@ Mmdta::Mmdta ()
   m_mmdta = nullptr;
   m_mmdue = nullptr;
   m_is_mmdta_new = false;
+  m_profiler = nullptr;
 
   m_num_path_driving = TInt (0);
   m_num_path_bustransit = TInt (0);
@@ -580,6 +609,10 @@ Mmdta::~Mmdta ()
     {
       delete m_mmdue;
     }
+  if (m_profiler != nullptr)
+    {
+      delete m_profiler;
+    }
 
   m_link_vec_driving.clear ();
   m_link_vec_walking.clear ();
@@ -626,9 +659,11 @@ Mmdta::~Mmdta ()
 int
 Mmdta::generate_shortest_pathsets (const std::string &folder, int max_iter,
                                    double mid_scale, double heavy_scale,
-                                   double min_path_tt)
+                                   double min_path_tt,
+                                   int num_threads)
 {
   m_mmdue = new MNM_MM_Due (folder);
+  m_mmdue->m_profiler = m_profiler;
   m_mmdue->initialize ();
 
   if (std::find (m_mmdue->m_mode_vec.begin (), m_mmdue->m_mode_vec.end (),
@@ -644,7 +679,8 @@ Mmdta::generate_shortest_pathsets (const std::string &folder, int max_iter,
                                                heavy_scale,
                                                2
                                                  * m_mmdue
-                                                     ->m_total_assign_inter);
+                                                     ->m_total_assign_inter,
+                                               num_threads);
       printf ("driving pathset generated\n");
       MNM::save_driving_path_table (folder, _driving_path_table,
                                     "driving_path_table",
@@ -676,7 +712,8 @@ Mmdta::generate_shortest_pathsets (const std::string &folder, int max_iter,
                                              ->m_transitlink_factory,
                                            min_path_tt, max_iter, mid_scale,
                                            heavy_scale,
-                                           m_mmdue->m_total_assign_inter);
+                                           m_mmdue->m_total_assign_inter,
+                                           num_threads);
       printf ("bus transit pathset generated\n");
       MNM::save_bustransit_path_table (folder, _bustransit_path_table,
                                        "bustransit_path_table",
@@ -735,6 +772,7 @@ int
 Mmdta::initialize (const std::string &folder)
 {
   m_mmdue = new MNM_MM_Due (folder);
+  m_mmdue->m_profiler = m_profiler;
   m_mmdue->initialize ();
   m_mmdue->init_passenger_path_table ();
   // m_mmdue -> m_passenger_path_table are created, at least one path for each
@@ -824,6 +862,7 @@ int
 Mmdta::initialize_mmdue (const std::string &folder)
 {
   m_mmdue = new MNM_MM_Due (folder);
+  m_mmdue->m_profiler = m_profiler;
   printf ("================================ DUE set! "
           "=================================\n");
 
@@ -928,6 +967,62 @@ Mmdta::install_cc_tree ()
   return 0;
 }
 
+// timings are kept until profiling is disabled again
+int
+Mmdta::enable_profile (bool enable)
+{
+  if (enable && m_profiler == nullptr)
+    {
+      m_profiler = new MNM_Profiler ();
+    }
+  else if (!enable && m_profiler != nullptr)
+    {
+      delete m_profiler;
+      m_profiler = nullptr;
+    }
+  if (m_mmdue != nullptr)
+    {
+      m_mmdue->m_profiler = m_profiler;
+    }
+  if (m_mmdta != nullptr)
+    {
+      m_mmdta->m_profiler = m_profiler;
+    }
+  return 0;
+}
+
+py::dict
+Mmdta::get_profile ()
+{
+  return utils::get_profile (m_profiler);
+}
+
+int
+Mmdta::save_profile_trace (const std::string &file_name)
+{
+  if (m_profiler == nullptr)
+    {
+      throw std::runtime_error (
+        "Error, Mmdta::save_profile_trace, profiling is not enabled");
+    }
+  return m_profiler->save_trace (file_name);
+}
+
+py::dict
+Mmdta::get_memory_usage ()
+{
+  MNM_Memory_Report _report;
+  if (m_mmdta != nullptr)
+    {
+      m_mmdta->add_memory_usage (_report);
+    }
+  if (m_mmdue != nullptr)
+    {
+      m_mmdue->add_memory_usage (_report);
+    }
+  return utils::get_memory_usage (_report);
+}
+
 int
 Mmdta::run_whole (bool verbose)
 {
@@ -971,13 +1066,19 @@ Mmdta::run_mmdue (const std::string &folder, bool verbose)
   for (int i = 0; i < m_mmdue->m_max_iter; ++i)
     {
       printf ("---------- Iteration %d ----------\n", i);
+      if (m_profiler != nullptr)
+        m_profiler->set_iteration (i);
 
       // DNL using dta, new dta is built from scratch
       mmdta = m_mmdue->run_mmdta (verbose);
 
+      MNM_Phase_Timer _timer (m_profiler);
       // update time dependent cost and save existing path table
+      _timer.start ("build_link_cost_map");
       m_mmdue->build_link_cost_map (mmdta);
+      _timer.start ("path_cost");
       m_mmdue->update_path_table_cost (mmdta);
+      _timer.start ("save_path_table");
 
       MNM::save_driving_path_table (folder, m_mmdue->m_driving_path_table,
                                     "driving_path_table",
@@ -993,7 +1094,9 @@ Mmdta::run_mmdue (const std::string &folder, bool verbose)
       // with departure time choice
       // gap = m_mmdue -> compute_merit_function(mmdta);
       // fixed departure time choice
+      _timer.start ("merit_function");
       gap = m_mmdue->compute_merit_function_fixed_departure_time_choice (mmdta);
+      _timer.stop ();
       printf ("\n\n*******************GAP = %lf*******************\n\n",
               (TFlt) gap);
       gap_file << std::to_string (gap) + "\n";
@@ -1004,7 +1107,17 @@ Mmdta::run_mmdue (const std::string &folder, bool verbose)
       // fixed departure time choice
       // m_mmdue->update_path_table_fixed_departure_time_choice(mmdta, i);
       // gradient projection
+      _timer.start ("path_update");
       m_mmdue->update_path_table_gp_fixed_departure_time_choice (mmdta, i);
+      _timer.stop ();
+
+      if (mmdta->m_memory_log_freq > 0)
+        {
+          MNM_Memory_Report _report = mmdta->get_memory_usage ();
+          m_mmdue->add_memory_usage (_report);
+          printf ("Memory after iteration %d: %s\n", i,
+                  MNM::memory_report_to_string (_report).c_str ());
+        }
 
       if (i == m_mmdue->m_max_iter - 1)
         {
@@ -1745,9 +1858,10 @@ Mmdta::get_travel_stats ()
     {
       _passenger = _map_it.second;
       IAssert (_passenger->m_finish_time < 0);
-      _count_passenger += 1;
+      _count_passenger += _passenger->m_count;
       _tot_tt_passenger += (_end_time - _passenger->m_start_time)
-                           * m_mmdta->m_unit_time / 3600.0;
+                           * _passenger->m_count * m_mmdta->m_unit_time
+                           / 3600.0;
     }
 
   // // for vehicles and passenger not deleted
@@ -2508,8 +2622,8 @@ Mmdta::generate_paths_to_cover_registered_links_driving ()
             {
               pair_ptrs_1.emplace_back (p);
             }
-          std::random_shuffle (std::begin (pair_ptrs_1),
-                               std::end (pair_ptrs_1));
+          utils::random_shuffle (std::begin (pair_ptrs_1),
+                                 std::end (pair_ptrs_1));
           for (auto _it : pair_ptrs_1)
             {
               _origin = dynamic_cast<MNM_Origin_Multimodal *> (_it.second);
@@ -2526,8 +2640,8 @@ Mmdta::generate_paths_to_cover_registered_links_driving ()
                 {
                   pair_ptrs_2.emplace_back (p);
                 }
-              std::random_shuffle (std::begin (pair_ptrs_2),
-                                   std::end (pair_ptrs_2));
+              utils::random_shuffle (std::begin (pair_ptrs_2),
+                                     std::end (pair_ptrs_2));
               for (auto _it_it : pair_ptrs_2)
                 {
                   _dest
@@ -2594,7 +2708,7 @@ Mmdta::generate_paths_to_cover_registered_links_driving ()
             ->m_routing_fixed_car->m_path_table
             ->find (_origin->m_origin_node->m_node_ID)
             ->second->find (_dest->m_dest_node->m_node_ID)
-            ->second->m_path_vec.push_back (_path);
+            ->second->add_path (_path);
           m_path_vec_driving.push_back (_path);
           _link_existing_driving[i] = true;
 
@@ -2792,8 +2906,8 @@ Mmdta::generate_paths_to_cover_registered_links_bus_walking ()
             {
               pair_ptrs_1.emplace_back (p);
             }
-          std::random_shuffle (std::begin (pair_ptrs_1),
-                               std::end (pair_ptrs_1));
+          utils::random_shuffle (std::begin (pair_ptrs_1),
+                                 std::end (pair_ptrs_1));
           for (auto _it : pair_ptrs_1)
             {
               _origin = dynamic_cast<MNM_Origin_Multimodal *> (_it.second);
@@ -2810,8 +2924,8 @@ Mmdta::generate_paths_to_cover_registered_links_bus_walking ()
                 {
                   pair_ptrs_2.emplace_back (p);
                 }
-              std::random_shuffle (std::begin (pair_ptrs_2),
-                                   std::end (pair_ptrs_2));
+              utils::random_shuffle (std::begin (pair_ptrs_2),
+                                     std::end (pair_ptrs_2));
               for (auto _it_it : pair_ptrs_2)
                 {
                   _dest
@@ -2856,8 +2970,8 @@ Mmdta::generate_paths_to_cover_registered_links_bus_walking ()
                     {
                       pair_ptrs_2.emplace_back (p);
                     }
-                  std::random_shuffle (std::begin (pair_ptrs_2),
-                                       std::end (pair_ptrs_2));
+                  utils::random_shuffle (std::begin (pair_ptrs_2),
+                                         std::end (pair_ptrs_2));
                   for (auto _it_it : pair_ptrs_2)
                     {
                       _dest = dynamic_cast<MNM_Destination_Multimodal *> (
@@ -2963,7 +3077,7 @@ Mmdta::generate_paths_to_cover_registered_links_bus_walking ()
                 ->m_routing_passenger_fixed->m_bustransit_path_table
                 ->find (_origin->m_origin_node->m_node_ID)
                 ->second->find (_dest->m_dest_node->m_node_ID)
-                ->second->m_path_vec.push_back (_path);
+                ->second->add_path (_path);
               m_path_vec_bustransit.push_back (_path);
             }
           else if (_is_pnr)
@@ -2992,7 +3106,7 @@ Mmdta::generate_paths_to_cover_registered_links_bus_walking ()
                 ->m_routing_car_pnr_fixed->m_pnr_path_table
                 ->find (_origin->m_origin_node->m_node_ID)
                 ->second->find (_dest->m_dest_node->m_node_ID)
-                ->second->m_path_vec.push_back (_pnr_path);
+                ->second->add_path (_pnr_path);
               m_path_vec_pnr.push_back (_pnr_path);
             }
           else
@@ -3127,8 +3241,8 @@ Mmdta::generate_paths_to_cover_registered_links_bus_walking ()
             {
               pair_ptrs_1.emplace_back (p);
             }
-          std::random_shuffle (std::begin (pair_ptrs_1),
-                               std::end (pair_ptrs_1));
+          utils::random_shuffle (std::begin (pair_ptrs_1),
+                                 std::end (pair_ptrs_1));
           for (auto _it : pair_ptrs_1)
             {
               _origin = dynamic_cast<MNM_Origin_Multimodal *> (_it.second);
@@ -3145,8 +3259,8 @@ Mmdta::generate_paths_to_cover_registered_links_bus_walking ()
                 {
                   pair_ptrs_2.emplace_back (p);
                 }
-              std::random_shuffle (std::begin (pair_ptrs_2),
-                                   std::end (pair_ptrs_2));
+              utils::random_shuffle (std::begin (pair_ptrs_2),
+                                     std::end (pair_ptrs_2));
               for (auto _it_it : pair_ptrs_2)
                 {
                   _dest
@@ -3191,8 +3305,8 @@ Mmdta::generate_paths_to_cover_registered_links_bus_walking ()
                     {
                       pair_ptrs_2.emplace_back (p);
                     }
-                  std::random_shuffle (std::begin (pair_ptrs_2),
-                                       std::end (pair_ptrs_2));
+                  utils::random_shuffle (std::begin (pair_ptrs_2),
+                                         std::end (pair_ptrs_2));
                   for (auto _it_it : pair_ptrs_2)
                     {
                       _dest = dynamic_cast<MNM_Destination_Multimodal *> (
@@ -3298,7 +3412,7 @@ Mmdta::generate_paths_to_cover_registered_links_bus_walking ()
                 ->m_routing_passenger_fixed->m_bustransit_path_table
                 ->find (_origin->m_origin_node->m_node_ID)
                 ->second->find (_dest->m_dest_node->m_node_ID)
-                ->second->m_path_vec.push_back (_path);
+                ->second->add_path (_path);
               m_path_vec_bustransit.push_back (_path);
             }
           else if (_is_pnr)
@@ -3327,7 +3441,7 @@ Mmdta::generate_paths_to_cover_registered_links_bus_walking ()
                 ->m_routing_car_pnr_fixed->m_pnr_path_table
                 ->find (_origin->m_origin_node->m_node_ID)
                 ->second->find (_dest->m_dest_node->m_node_ID)
-                ->second->m_path_vec.push_back (_pnr_path);
+                ->second->add_path (_pnr_path);
               m_path_vec_pnr.push_back (_pnr_path);
             }
           else
@@ -6277,7 +6391,7 @@ Mmdta::get_car_link_out_cc (int link_ID)
       throw std::runtime_error (
         "Error, Mmdta::get_car_link_out_cc, cc not installed");
     }
-  std::deque<std::pair<TFlt, TFlt>> _record = _link->m_N_out_car->m_recorder;
+  const auto &_record = _link->m_N_out_car->m_recorder;
   int new_shape[2] = { (int) _record.size (), 2 };
   auto result = py::array_t<double> (new_shape);
   auto result_buf = result.request ();
@@ -6302,7 +6416,7 @@ Mmdta::get_car_link_in_cc (int link_ID)
       throw std::runtime_error (
         "Error, Mmdta::get_car_link_in_cc, cc not installed");
     }
-  std::deque<std::pair<TFlt, TFlt>> _record = _link->m_N_in_car->m_recorder;
+  const auto &_record = _link->m_N_in_car->m_recorder;
   int new_shape[2] = { (int) _record.size (), 2 };
   auto result = py::array_t<double> (new_shape);
   auto result_buf = result.request ();
@@ -6327,7 +6441,7 @@ Mmdta::get_truck_link_out_cc (int link_ID)
       throw std::runtime_error (
         "Error, Mmdta::get_truck_link_out_cc, cc not installed");
     }
-  std::deque<std::pair<TFlt, TFlt>> _record = _link->m_N_out_truck->m_recorder;
+  const auto &_record = _link->m_N_out_truck->m_recorder;
   int new_shape[2] = { (int) _record.size (), 2 };
   auto result = py::array_t<double> (new_shape);
   auto result_buf = result.request ();
@@ -6352,7 +6466,7 @@ Mmdta::get_truck_link_in_cc (int link_ID)
       throw std::runtime_error (
         "Error, Mmdta::get_truck_link_in_cc, cc not installed");
     }
-  std::deque<std::pair<TFlt, TFlt>> _record = _link->m_N_in_truck->m_recorder;
+  const auto &_record = _link->m_N_in_truck->m_recorder;
   int new_shape[2] = { (int) _record.size (), 2 };
   auto result = py::array_t<double> (new_shape);
   auto result_buf = result.request ();
@@ -6377,7 +6491,7 @@ Mmdta::get_bus_link_out_passenger_cc (int link_ID)
       throw std::runtime_error (
         "Error, Mmdta::get_bus_link_out_passenger_cc, cc not installed");
     }
-  std::deque<std::pair<TFlt, TFlt>> _record = _link->m_N_out->m_recorder;
+  const auto &_record = _link->m_N_out->m_recorder;
   int new_shape[2] = { (int) _record.size (), 2 };
   auto result = py::array_t<double> (new_shape);
   auto result_buf = result.request ();
@@ -6402,7 +6516,7 @@ Mmdta::get_bus_link_in_passenger_cc (int link_ID)
       throw std::runtime_error (
         "Error, Mmdta::get_bus_link_in_passenger_cc, cc not installed");
     }
-  std::deque<std::pair<TFlt, TFlt>> _record = _link->m_N_in->m_recorder;
+  const auto &_record = _link->m_N_in->m_recorder;
   int new_shape[2] = { (int) _record.size (), 2 };
   auto result = py::array_t<double> (new_shape);
   auto result_buf = result.request ();
@@ -6434,8 +6548,7 @@ Mmdta::get_bus_link_to_busstop_in_cc (int link_ID)
       throw std::runtime_error (
         "Error, Mmdta::get_bus_link_to_busstop_in_cc, cc not installed");
     }
-  std::deque<std::pair<TFlt, TFlt>> _record
-    = _link->m_to_busstop->m_N_in_bus->m_recorder;
+  const auto &_record = _link->m_to_busstop->m_N_in_bus->m_recorder;
   int new_shape[2] = { (int) _record.size (), 2 };
   auto result = py::array_t<double> (new_shape);
   auto result_buf = result.request ();
@@ -6467,8 +6580,7 @@ Mmdta::get_bus_link_to_busstop_out_cc (int link_ID)
       throw std::runtime_error (
         "Error, Mmdta::get_bus_link_to_busstop_out_cc, cc not installed");
     }
-  std::deque<std::pair<TFlt, TFlt>> _record
-    = _link->m_to_busstop->m_N_out_bus->m_recorder;
+  const auto &_record = _link->m_to_busstop->m_N_out_bus->m_recorder;
   int new_shape[2] = { (int) _record.size (), 2 };
   auto result = py::array_t<double> (new_shape);
   auto result_buf = result.request ();
@@ -6500,8 +6612,7 @@ Mmdta::get_bus_link_from_busstop_in_cc (int link_ID)
       throw std::runtime_error (
         "Error, Mmdta::get_bus_link_from_busstop_in_cc, cc not installed");
     }
-  std::deque<std::pair<TFlt, TFlt>> _record
-    = _link->m_from_busstop->m_N_in_bus->m_recorder;
+  const auto &_record = _link->m_from_busstop->m_N_in_bus->m_recorder;
   int new_shape[2] = { (int) _record.size (), 2 };
   auto result = py::array_t<double> (new_shape);
   auto result_buf = result.request ();
@@ -6533,8 +6644,7 @@ Mmdta::get_bus_link_from_busstop_out_cc (int link_ID)
       throw std::runtime_error (
         "Error, Mmdta::get_bus_link_from_busstop_out_cc, cc not installed");
     }
-  std::deque<std::pair<TFlt, TFlt>> _record
-    = _link->m_from_busstop->m_N_out_bus->m_recorder;
+  const auto &_record = _link->m_from_busstop->m_N_out_bus->m_recorder;
   int new_shape[2] = { (int) _record.size (), 2 };
   auto result = py::array_t<double> (new_shape);
   auto result_buf = result.request ();
@@ -6559,7 +6669,7 @@ Mmdta::get_walking_link_out_cc (int link_ID)
       throw std::runtime_error (
         "Error, Mmdta::get_walking_link_out_cc, cc not installed");
     }
-  std::deque<std::pair<TFlt, TFlt>> _record = _link->m_N_out->m_recorder;
+  const auto &_record = _link->m_N_out->m_recorder;
   int new_shape[2] = { (int) _record.size (), 2 };
   auto result = py::array_t<double> (new_shape);
   auto result_buf = result.request ();
@@ -6584,7 +6694,7 @@ Mmdta::get_walking_link_in_cc (int link_ID)
       throw std::runtime_error (
         "Error, Mmdta::get_walking_link_in_cc, cc not installed");
     }
-  std::deque<std::pair<TFlt, TFlt>> _record = _link->m_N_in->m_recorder;
+  const auto &_record = _link->m_N_in->m_recorder;
   int new_shape[2] = { (int) _record.size (), 2 };
   auto result = py::array_t<double> (new_shape);
   auto result_buf = result.request ();
@@ -6938,8 +7048,10 @@ py::array_t<double>
 Mmdta::get_car_dar_matrix_driving (py::array_t<int> start_intervals,
                                    py::array_t<int> end_intervals)
 {
+  MNM_Phase_Timer _timer (m_profiler, "get_car_dar_matrix_driving");
   auto start_buf = start_intervals.request ();
   auto end_buf = end_intervals.request ();
+  py::gil_scoped_release _release;
   if (start_buf.ndim != 1 || end_buf.ndim != 1)
     {
       throw std::runtime_error ("Error, Mmdta::get_car_dar_matrix_driving, "
@@ -6991,6 +7103,8 @@ Mmdta::get_car_dar_matrix_driving (py::array_t<int> start_intervals,
                                                  TFlt (end_ptr[t]));
         }
     }
+
+  py::gil_scoped_acquire _acquire;
   // _record.size() = num_timesteps x num_links x num_path x
   // num_assign_timesteps path_ID, assign_time, link_ID, start_int, flow
   int new_shape[2] = { (int) _record.size (), 5 };
@@ -7026,8 +7140,10 @@ py::array_t<double>
 Mmdta::get_truck_dar_matrix_driving (py::array_t<int> start_intervals,
                                      py::array_t<int> end_intervals)
 {
+  MNM_Phase_Timer _timer (m_profiler, "get_truck_dar_matrix_driving");
   auto start_buf = start_intervals.request ();
   auto end_buf = end_intervals.request ();
+  py::gil_scoped_release _release;
   if (start_buf.ndim != 1 || end_buf.ndim != 1)
     {
       throw std::runtime_error (
@@ -7081,6 +7197,8 @@ Mmdta::get_truck_dar_matrix_driving (py::array_t<int> start_intervals,
                                                    TFlt (end_ptr[t]));
         }
     }
+
+  py::gil_scoped_acquire _acquire;
   // path_ID, assign_time, link_ID, start_int, flow
   int new_shape[2] = { (int) _record.size (), 5 };
   auto result = py::array_t<double> (new_shape);
@@ -7115,8 +7233,10 @@ py::array_t<double>
 Mmdta::get_car_dar_matrix_pnr (py::array_t<int> start_intervals,
                                py::array_t<int> end_intervals)
 {
+  MNM_Phase_Timer _timer (m_profiler, "get_car_dar_matrix_pnr");
   auto start_buf = start_intervals.request ();
   auto end_buf = end_intervals.request ();
+  py::gil_scoped_release _release;
   if (start_buf.ndim != 1 || end_buf.ndim != 1)
     {
       throw std::runtime_error (
@@ -7168,6 +7288,8 @@ Mmdta::get_car_dar_matrix_pnr (py::array_t<int> start_intervals,
                                                  TFlt (end_ptr[t]));
         }
     }
+
+  py::gil_scoped_acquire _acquire;
   // _record.size() = num_timesteps x num_links x num_path x
   // num_assign_timesteps path_ID, assign_time, link_ID, start_int, flow
   int new_shape[2] = { (int) _record.size (), 5 };
@@ -7203,8 +7325,10 @@ py::array_t<double>
 Mmdta::get_bus_dar_matrix_bustransit_link (py::array_t<int> start_intervals,
                                            py::array_t<int> end_intervals)
 {
+  MNM_Phase_Timer _timer (m_profiler, "get_bus_dar_matrix_bustransit_link");
   auto start_buf = start_intervals.request ();
   auto end_buf = end_intervals.request ();
+  py::gil_scoped_release _release;
   if (start_buf.ndim != 1 || end_buf.ndim != 1)
     {
       throw std::runtime_error (
@@ -7256,6 +7380,8 @@ Mmdta::get_bus_dar_matrix_bustransit_link (py::array_t<int> start_intervals,
                                                  TFlt (end_ptr[t]));
         }
     }
+
+  py::gil_scoped_acquire _acquire;
   // path_ID, assign_time, link_ID, start_int, flow
   int new_shape[2] = { (int) _record.size (), 5 };
   auto result = py::array_t<double> (new_shape);
@@ -7290,8 +7416,10 @@ py::array_t<double>
 Mmdta::get_bus_dar_matrix_driving_link (py::array_t<int> start_intervals,
                                         py::array_t<int> end_intervals)
 {
+  MNM_Phase_Timer _timer (m_profiler, "get_bus_dar_matrix_driving_link");
   auto start_buf = start_intervals.request ();
   auto end_buf = end_intervals.request ();
+  py::gil_scoped_release _release;
   if (start_buf.ndim != 1 || end_buf.ndim != 1)
     {
       throw std::runtime_error (
@@ -7342,6 +7470,8 @@ Mmdta::get_bus_dar_matrix_driving_link (py::array_t<int> start_intervals,
                                                    TFlt (end_ptr[t]));
         }
     }
+
+  py::gil_scoped_acquire _acquire;
   // path_ID, assign_time, link_ID, start_int, flow
   int new_shape[2] = { (int) _record.size (), 5 };
   auto result = py::array_t<double> (new_shape);
@@ -7376,8 +7506,10 @@ py::array_t<double>
 Mmdta::get_passenger_dar_matrix_bustransit (py::array_t<int> start_intervals,
                                             py::array_t<int> end_intervals)
 {
+  MNM_Phase_Timer _timer (m_profiler, "get_passenger_dar_matrix_bustransit");
   auto start_buf = start_intervals.request ();
   auto end_buf = end_intervals.request ();
+  py::gil_scoped_release _release;
   if (start_buf.ndim != 1 || end_buf.ndim != 1)
     {
       throw std::runtime_error (
@@ -7468,6 +7600,8 @@ Mmdta::get_passenger_dar_matrix_bustransit (py::array_t<int> start_intervals,
                                                        TFlt (end_ptr[t]));
         }
     }
+
+  py::gil_scoped_acquire _acquire;
   // path_ID, assign_time, link_ID, start_int, flow
   int new_shape[2] = { (int) _record.size (), 5 };
   auto result = py::array_t<double> (new_shape);
@@ -7502,8 +7636,10 @@ py::array_t<double>
 Mmdta::get_passenger_dar_matrix_pnr (py::array_t<int> start_intervals,
                                      py::array_t<int> end_intervals)
 {
+  MNM_Phase_Timer _timer (m_profiler, "get_passenger_dar_matrix_pnr");
   auto start_buf = start_intervals.request ();
   auto end_buf = end_intervals.request ();
+  py::gil_scoped_release _release;
   if (start_buf.ndim != 1 || end_buf.ndim != 1)
     {
       throw std::runtime_error (
@@ -7594,6 +7730,8 @@ Mmdta::get_passenger_dar_matrix_pnr (py::array_t<int> start_intervals,
                                                        TFlt (end_ptr[t]));
         }
     }
+
+  py::gil_scoped_acquire _acquire;
   // path_ID, assign_time, link_ID, start_int, flow
   int new_shape[2] = { (int) _record.size (), 5 };
   auto result = py::array_t<double> (new_shape);
@@ -7628,8 +7766,10 @@ py::array_t<double>
 Mmdta::get_car_dar_matrix_bus_driving_link (py::array_t<int> start_intervals,
                                             py::array_t<int> end_intervals)
 {
+  MNM_Phase_Timer _timer (m_profiler, "get_car_dar_matrix_bus_driving_link");
   auto start_buf = start_intervals.request ();
   auto end_buf = end_intervals.request ();
+  py::gil_scoped_release _release;
   if (start_buf.ndim != 1 || end_buf.ndim != 1)
     {
       throw std::runtime_error (
@@ -7683,6 +7823,8 @@ Mmdta::get_car_dar_matrix_bus_driving_link (py::array_t<int> start_intervals,
                                                  TFlt (end_ptr[t]));
         }
     }
+
+  py::gil_scoped_acquire _acquire;
   // path_ID, assign_time, link_ID, start_int, flow
   int new_shape[2] = { (int) _record.size (), 5 };
   auto result = py::array_t<double> (new_shape);
@@ -7717,8 +7859,10 @@ py::array_t<double>
 Mmdta::get_truck_dar_matrix_bus_driving_link (py::array_t<int> start_intervals,
                                               py::array_t<int> end_intervals)
 {
+  MNM_Phase_Timer _timer (m_profiler, "get_truck_dar_matrix_bus_driving_link");
   auto start_buf = start_intervals.request ();
   auto end_buf = end_intervals.request ();
+  py::gil_scoped_release _release;
   if (start_buf.ndim != 1 || end_buf.ndim != 1)
     {
       throw std::runtime_error (
@@ -7773,6 +7917,8 @@ Mmdta::get_truck_dar_matrix_bus_driving_link (py::array_t<int> start_intervals,
                                                    TFlt (end_ptr[t]));
         }
     }
+
+  py::gil_scoped_acquire _acquire;
   // path_ID, assign_time, link_ID, start_int, flow
   int new_shape[2] = { (int) _record.size (), 5 };
   auto result = py::array_t<double> (new_shape);
@@ -7807,8 +7953,11 @@ py::array_t<double>
 Mmdta::get_passenger_dar_matrix_bustransit_bus_link (
   py::array_t<int> start_intervals, py::array_t<int> end_intervals)
 {
+  MNM_Phase_Timer _timer (m_profiler,
+                          "get_passenger_dar_matrix_bustransit_bus_link");
   auto start_buf = start_intervals.request ();
   auto end_buf = end_intervals.request ();
+  py::gil_scoped_release _release;
   if (start_buf.ndim != 1 || end_buf.ndim != 1)
     {
       throw std::runtime_error (
@@ -7866,6 +8015,8 @@ Mmdta::get_passenger_dar_matrix_bustransit_bus_link (
                                                        TFlt (end_ptr[t]));
         }
     }
+
+  py::gil_scoped_acquire _acquire;
   // path_ID, assign_time, link_ID, start_int, flow
   int new_shape[2] = { (int) _record.size (), 5 };
   auto result = py::array_t<double> (new_shape);
@@ -7900,8 +8051,10 @@ py::array_t<double>
 Mmdta::get_passenger_dar_matrix_pnr_bus_link (py::array_t<int> start_intervals,
                                               py::array_t<int> end_intervals)
 {
+  MNM_Phase_Timer _timer (m_profiler, "get_passenger_dar_matrix_pnr_bus_link");
   auto start_buf = start_intervals.request ();
   auto end_buf = end_intervals.request ();
+  py::gil_scoped_release _release;
   if (start_buf.ndim != 1 || end_buf.ndim != 1)
     {
       throw std::runtime_error (
@@ -7956,6 +8109,8 @@ Mmdta::get_passenger_dar_matrix_pnr_bus_link (py::array_t<int> start_intervals,
                                                        TFlt (end_ptr[t]));
         }
     }
+
+  py::gil_scoped_acquire _acquire;
   // path_ID, assign_time, link_ID, start_int, flow
   int new_shape[2] = { (int) _record.size (), 5 };
   auto result = py::array_t<double> (new_shape);
@@ -8054,10 +8209,12 @@ py::array_t<double>
 Mmdta::get_car_ltg_matrix_driving (py::array_t<int> start_intervals,
                                    int threshold_timestamp)
 {
+  MNM_Phase_Timer _timer (m_profiler, "get_car_ltg_matrix_driving");
   // input: intervals in which the agents are released for each path, 1 min
   // interval = 12 5-s intervals assume Mmdta::build_link_cost_map() and
   // Mmdta::get_link_queue_dissipated_time() are invoked already
   auto start_buf = start_intervals.request ();
+  py::gil_scoped_release _release;
   if (start_buf.ndim != 1)
     {
       throw std::runtime_error ("Error, Mmdta::get_car_ltg_matrix_driving, "
@@ -8340,6 +8497,7 @@ Mmdta::get_car_ltg_matrix_driving (py::array_t<int> start_intervals,
         }
     }
 
+  py::gil_scoped_acquire _acquire;
   // _record.size() = num_timesteps x num_links x num_path x
   // num_assign_timesteps path_ID, assign_time, link_ID, start_int, gradient
   int new_shape[2] = { (int) _record.size (), 5 };
@@ -8374,10 +8532,12 @@ py::array_t<double>
 Mmdta::get_car_ltg_matrix_pnr (py::array_t<int> start_intervals,
                                int threshold_timestamp)
 {
+  MNM_Phase_Timer _timer (m_profiler, "get_car_ltg_matrix_pnr");
   // input: intervals in which the agents are released for each path, 1 min
   // interval = 12 5-s intervals assume Mmdta::build_link_cost_map() and
   // Mmdta::get_link_queue_dissipated_time() are invoked already
   auto start_buf = start_intervals.request ();
+  py::gil_scoped_release _release;
   if (start_buf.ndim != 1)
     {
       throw std::runtime_error (
@@ -8392,6 +8552,7 @@ Mmdta::get_car_ltg_matrix_pnr (py::array_t<int> start_intervals,
   // int _t_arrival, _t_depart, _t_arrival_lift_up, _t_depart_lift_up,
   // _cost_map_index;
 
+  py::gil_scoped_acquire _acquire;
   // _record.size() = num_timesteps x num_links x num_path x
   // num_assign_timesteps path_ID, assign_time, link_ID, start_int, gradient
   int new_shape[2] = { (int) _record.size (), 5 };
@@ -8426,10 +8587,12 @@ py::array_t<double>
 Mmdta::get_truck_ltg_matrix_driving (py::array_t<int> start_intervals,
                                      int threshold_timestamp)
 {
+  MNM_Phase_Timer _timer (m_profiler, "get_truck_ltg_matrix_driving");
   // input: intervals in which the agents are released for each path, 1 min
   // interval = 12 5-s intervals assume Mmdta::build_link_cost_map() and
   // Mmdta::get_link_queue_dissipated_time() are invoked already
   auto start_buf = start_intervals.request ();
+  py::gil_scoped_release _release;
   if (start_buf.ndim != 1)
     {
       throw std::runtime_error (
@@ -8713,6 +8876,7 @@ Mmdta::get_truck_ltg_matrix_driving (py::array_t<int> start_intervals,
         }
     }
 
+  py::gil_scoped_acquire _acquire;
   // _record.size() = num_timesteps x num_links x num_path x
   // num_assign_timesteps path_ID, assign_time, link_ID, start_int, gradient
   int new_shape[2] = { (int) _record.size (), 5 };
@@ -8747,10 +8911,12 @@ py::array_t<double>
 Mmdta::get_passenger_ltg_matrix_bustransit (py::array_t<int> start_intervals,
                                             int threshold_timestamp)
 {
+  MNM_Phase_Timer _timer (m_profiler, "get_passenger_ltg_matrix_bustransit");
   // input: intervals in which the agents are released for each path, 1 min
   // interval = 12 5-s intervals assume Mmdta::build_link_cost_map() and
   // Mmdta::get_link_queue_dissipated_time() are invoked already
   auto start_buf = start_intervals.request ();
+  py::gil_scoped_release _release;
   if (start_buf.ndim != 1)
     {
       throw std::runtime_error (
@@ -8766,6 +8932,7 @@ Mmdta::get_passenger_ltg_matrix_bustransit (py::array_t<int> start_intervals,
   // int _t_arrival, _t_depart, _t_arrival_lift_up, _t_depart_lift_up,
   // _cost_map_index;
 
+  py::gil_scoped_acquire _acquire;
   // _record.size() = num_timesteps x num_links x num_path x
   // num_assign_timesteps path_ID, assign_time, link_ID, start_int, gradient
   int new_shape[2] = { (int) _record.size (), 5 };
@@ -8800,10 +8967,12 @@ py::array_t<double>
 Mmdta::get_passenger_ltg_matrix_pnr (py::array_t<int> start_intervals,
                                      int threshold_timestamp)
 {
+  MNM_Phase_Timer _timer (m_profiler, "get_passenger_ltg_matrix_pnr");
   // input: intervals in which the agents are released for each path, 1 min
   // interval = 12 5-s intervals assume Mmdta::build_link_cost_map() and
   // Mmdta::get_link_queue_dissipated_time() are invoked already
   auto start_buf = start_intervals.request ();
+  py::gil_scoped_release _release;
   if (start_buf.ndim != 1)
     {
       throw std::runtime_error (
@@ -8819,6 +8988,7 @@ Mmdta::get_passenger_ltg_matrix_pnr (py::array_t<int> start_intervals,
   // int _t_arrival, _t_depart, _t_arrival_lift_up, _t_depart_lift_up,
   // _cost_map_index;
 
+  py::gil_scoped_acquire _acquire;
   // _record.size() = num_timesteps x num_links x num_path x
   // num_assign_timesteps path_ID, assign_time, link_ID, start_int, gradient
   int new_shape[2] = { (int) _record.size (), 5 };
@@ -2,17 +2,18 @@
 #pragma once
 
 #include <algorithm>
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
 #include <random>
+#include <stdexcept>
+#include <vector>
 
-namespace MNM_Ults
-{
-void set_random_state (unsigned int s);
-}
+#include <dlink.h>
+#include <memory_usage.h>
+#include <profiler.h>
 
 namespace macposts
 {
-// The default random number generator.
-static std::mt19937 rng;
 // FIXME: Upper bound for travel time (?).
 static const double TT_UPPER_BOUND = 20;
 
@@ -22,14 +23,13 @@ inline void
 set_random_state (unsigned int s)
 {
   MNM_Ults::set_random_state (s);
-  rng.seed (s);
 }
 
 template <typename RandomIt>
 inline void
 random_shuffle (RandomIt first, RandomIt last)
 {
-  random_shuffle (first, last, rng);
+  std::shuffle (first, last, MNM_Ults::rng ());
 }
 
 template <typename RandomIt, typename RandomGen>
@@ -38,5 +38,96 @@ random_shuffle (RandomIt first, RandomIt last, RandomGen &&rng)
 {
   std::shuffle (first, last, rng);
 }
+
+// Put the cumulative curves on the interval grid in one go, as an array of
+// shape (num_intervals, ccs.size ()) with one column per curve.
+inline pybind11::array_t<double>
+get_ccs_on_grid (const std::vector<MNM_Cumulative_Curve *> &ccs,
+                 int num_intervals)
+{
+  int new_shape[2] = { num_intervals, (int) ccs.size () };
+  auto result = pybind11::array_t<double> (new_shape);
+  auto result_buf = result.request ();
+  double *result_ptr = (double *) result_buf.ptr;
+  for (size_t j = 0; j < ccs.size (); ++j)
+    {
+      ccs[j]->fill_on_grid (result_ptr + j, num_intervals, (int) ccs.size ());
+    }
+  return result;
+}
+
+// Expose the records of a cumulative curve as a read-only (n, 2) array
+// without copying.  The array keeps base alive, but the records move as soon
+// as the curve grows, so callers only hand out views of curves that are done
+// loading.
+inline pybind11::array_t<double>
+get_cc_view (MNM_Cumulative_Curve *cc, pybind11::handle base)
+{
+  if (cc->m_recorder.empty ())
+    {
+      int new_shape[2] = { 0, 2 };
+      return pybind11::array_t<double> (new_shape);
+    }
+  static_assert (sizeof (std::pair<TFlt, TFlt>) == 2 * sizeof (double),
+                 "cumulative curve records are not two packed doubles");
+  std::vector<size_t> shape = { cc->m_recorder.size (), 2 };
+  std::vector<size_t> strides
+    = { sizeof (std::pair<TFlt, TFlt>), sizeof (double) };
+  auto result = pybind11::array_t<double> (shape, strides,
+                                           &cc->m_recorder[0].first, base);
+  pybind11::detail::array_proxy (result.ptr ())->flags
+    &= ~pybind11::detail::npy_api::NPY_ARRAY_WRITEABLE_;
+  return result;
+}
+
+// A memory report as a dict {category: {"bytes", "count"}}.
+inline pybind11::dict
+get_memory_usage (const MNM_Memory_Report &report)
+{
+  pybind11::dict result;
+  for (const auto &it : report)
+    {
+      pybind11::dict stat;
+      stat["bytes"] = it.second.m_bytes;
+      stat["count"] = it.second.m_count;
+      result[pybind11::str (it.first)] = stat;
+    }
+  return result;
+}
+
+// The phase timings of a profiler as a dict {phase: {"count", "total", "max",
+// "intervals", "iterations"}} in seconds, where "intervals" and "iterations"
+// are (n, 2) arrays of (loading interval or iteration, total seconds).
+inline pybind11::dict
+get_profile (MNM_Profiler *profiler)
+{
+  pybind11::dict result;
+  if (profiler == nullptr)
+    {
+      return result;
+    }
+  auto to_array = [] (const std::map<int, double> &totals) {
+    int new_shape[2] = { (int) totals.size (), 2 };
+    auto array = pybind11::array_t<double> (new_shape);
+    double *ptr = (double *) array.request ().ptr;
+    for (const auto &it : totals)
+      {
+        *ptr++ = it.first;
+        *ptr++ = it.second;
+      }
+    return array;
+  };
+  for (const auto &it : profiler->get_summary ())
+    {
+      pybind11::dict stat;
+      stat["count"] = it.second.m_count;
+      stat["total"] = it.second.m_total;
+      stat["max"] = it.second.m_max;
+      stat["intervals"] = to_array (it.second.m_by_interval);
+      stat["iterations"] = to_array (it.second.m_by_iteration);
+      result[pybind11::str (it.first)] = stat;
+    }
+  return result;
+}
 }
 }
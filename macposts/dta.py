@@ -38,27 +38,31 @@ class _CommonMixin:
             links = self.links
         super().register_links(links)
 
-    def _get_ccs(self, link_func, links):
+    def _get_ccs(self, links_func, links):
         if links is None:
             links = self.registered_links
-        ccs = np.empty((self.get_cur_loading_interval() + 1, len(links)))
-        ccs[:] = np.nan
-        for col, link in enumerate(links):
-            cc = link_func(link)
-            ticks = cc[:, 0].astype(int)
-            ccs[ticks, col] = cc[:, 1]
-        # Forward fill NaNs
-        # Ref: https://stackoverflow.com/a/41191127
-        mask = np.isnan(ccs)
-        idxs = np.where(~mask, np.arange(mask.shape[0])[:, None], 0)
-        np.maximum.accumulate(idxs, axis=0, out=idxs)
-        ccs[mask] = ccs[idxs[mask], np.nonzero(mask)[1]]
-        return ccs
+        # The native accessor puts the curves on the loading interval grid
+        # and forward fills them, leaving NaNs before the first record.
+        return links_func(np.atleast_1d(np.asarray(links, dtype=np.int32)))
 
 
 class Dta(_CommonMixin, _ext.Dta):
     """Single class DTA."""
 
+    @classmethod
+    def from_files(cls, directory, shared=None):
+        """Create an instance of *cls* with files in *directory*.
+
+        If *shared* is another initialized Dta instance, its static network
+        (graph, node and link attributes) is reused instead of being read
+        again, and only the demand and routing inputs are read from
+        *directory*. Instances sharing a network may run in different threads.
+
+        """
+        obj = cls()
+        obj.initialize(str(directory), shared)
+        return obj
+
     def get_in_ccs(self, links=None):
         """Get the incoming cumulative curves for registered links.
 
@@ -72,7 +76,7 @@ class Dta(_CommonMixin, _ext.Dta):
         Return a Numpy array of shape (CURRENT-INTERVAL, NUM-LINKS).
 
         """
-        return self._get_ccs(self.get_link_in_cc, links)
+        return self._get_ccs(self.get_link_in_ccs, links)
 
     def get_out_ccs(self, links=None):
         """Get the outgoing cumulative curves for registered links.
@@ -87,7 +91,7 @@ class Dta(_CommonMixin, _ext.Dta):
         Return a Numpy array of shape (CURRENT-INTERVAL, NUM-LINKS).
 
         """
-        return self._get_ccs(self.get_link_out_cc, links)
+        return self._get_ccs(self.get_link_out_ccs, links)
 
 
 class Mcdta(_CommonMixin, _ext.Mcdta):
@@ -104,7 +108,7 @@ class Mcdta(_CommonMixin, _ext.Mcdta):
         Return a Numpy array of shape (CURRENT-INTERVAL, NUM-LINKS).
 
         """
-        return self._get_ccs(self.get_car_link_in_cc, links)
+        return self._get_ccs(self.get_car_link_in_ccs, links)
 
     def get_car_out_ccs(self, links=None):
         """Get the outgoing car cumulative curves for registered links.
@@ -117,7 +121,7 @@ class Mcdta(_CommonMixin, _ext.Mcdta):
         Return a Numpy array of shape (CURRENT-INTERVAL, NUM-LINKS).
 
         """
-        return self._get_ccs(self.get_car_link_out_cc, links)
+        return self._get_ccs(self.get_car_link_out_ccs, links)
 
     def get_truck_in_ccs(self, links=None):
         """Get the incoming truck cumulative curves for registered links.
@@ -130,7 +134,7 @@ class Mcdta(_CommonMixin, _ext.Mcdta):
         Return a Numpy array of shape (CURRENT-INTERVAL, NUM-LINKS).
 
         """
-        return self._get_ccs(self.get_truck_link_in_cc, links)
+        return self._get_ccs(self.get_truck_link_in_ccs, links)
 
     def get_truck_out_ccs(self, links=None):
         """Get the outgoing truck cumulative curves for registered links.
@@ -143,8 +147,24 @@ class Mcdta(_CommonMixin, _ext.Mcdta):
         Return a Numpy array of shape (CURRENT-INTERVAL, NUM-LINKS).
 
         """
-        return self._get_ccs(self.get_truck_link_out_cc, links)
+        return self._get_ccs(self.get_truck_link_out_ccs, links)
 
 
 class Mmdta(_CommonMixin, _ext.Mmdta):
     """Multi-modal DTA."""
+
+
+class RealtimeDta(_ext.RealtimeDta):
+    """Realtime DTA."""
+
+    @classmethod
+    def from_files(cls, directory):
+        """Create an instance of *cls* with files in *directory*.
+
+        The path choice is set up for running, so :meth:`run_iteration` may
+        be called right away.
+
+        """
+        obj = cls()
+        obj.initialize(str(directory))
+        return obj
@@ -65,3 +65,22 @@ MNM_Tree_Cumulative_Curve::print_out ()
     }
   return 0;
 }
+
+int
+MNM_Tree_Cumulative_Curve::add_memory_usage (MNM_Memory_Report &report)
+{
+  size_t _bytes
+    = sizeof (MNM_Tree_Cumulative_Curve) + MNM::unordered_bytes (m_record);
+  size_t _count = 0;
+  for (auto &_path_it : m_record)
+    {
+      _bytes += MNM::unordered_bytes (_path_it.second);
+      for (auto &_depart_it : _path_it.second)
+        {
+          _bytes += _depart_it.second->get_memory_bytes ();
+        }
+      _count += _path_it.second.size ();
+    }
+  MNM::add_memory (report, "tree_cumulative_curves", _bytes, _count);
+  return 0;
+}
@@ -68,13 +68,18 @@ MNM_Veh_Factory_Delivery::make_veh_delivery (TInt timestamp,
   // (int)m_num_veh + 1);
   MNM_Veh_Delivery *_veh = new MNM_Veh_Delivery (m_num_veh + 1, timestamp);
   _veh->m_type = veh_type;
-  m_veh_map.insert (std::pair<TInt, MNM_Veh *> (m_num_veh + 1, _veh));
-  m_num_veh += 1;
-  m_enroute += 1;
-  m_veh_delivery += 1;
+  add_veh (_veh);
   return _veh;
 }
 
+int
+MNM_Veh_Factory_Delivery::count_new_veh (MNM_Veh *veh)
+{
+  if (dynamic_cast<MNM_Veh_Delivery *> (veh) != nullptr)
+    m_veh_delivery += 1;
+  return 0;
+}
+
 //#################################################################
 //                  PQ Link with Delay Releasing
 //#################################################################
@@ -292,8 +297,8 @@ MNM_Origin_Delivery::release_one_interval (TInt current_interval,
         }
     }
 
-  std::random_shuffle (m_origin_node->m_in_veh_queue.begin (),
-                       m_origin_node->m_in_veh_queue.end ());
+  MNM_Ults::random_shuffle (m_origin_node->m_in_veh_queue.begin (),
+                            m_origin_node->m_in_veh_queue.end ());
   return 0;
 }
 
@@ -405,7 +410,7 @@ MNM_Destination_Delivery::receive (TInt current_interval, MNM_Routing *routing,
                 _veh_deliver);
               routing
                 ->remove_finished (_veh_deliver,
-                                   del); // remove STATIC users from m_tracker
+                                   del); // reset the route of STATIC users
               _veh_deliver->m_path = nullptr;
             }
           else
@@ -413,7 +418,7 @@ MNM_Destination_Delivery::receive (TInt current_interval, MNM_Routing *routing,
               _veh_deliver->finish (current_interval);
               routing
                 ->remove_finished (_veh_deliver,
-                                   del); // remove STATIC users from m_tracker
+                                   del); // reset the route of STATIC users
               veh_factory->remove_finished_veh (_veh_deliver, del);
             }
         }
@@ -421,7 +426,7 @@ MNM_Destination_Delivery::receive (TInt current_interval, MNM_Routing *routing,
         {
           _veh->finish (current_interval);
           routing->remove_finished (_veh,
-                                    del); // remove STATIC users from m_tracker
+                                    del); // reset the route of STATIC users
           veh_factory->remove_finished_veh (_veh, del);
         }
     }
@@ -463,7 +468,7 @@ MNM_OD_Factory_Delivery::make_origin (TInt ID, TInt max_interval,
 //#################################################################
 
 MNM_Routing_Delivery_Fixed::MNM_Routing_Delivery_Fixed (
-  macposts::Graph &graph, MNM_OD_Factory *od_factory,
+  const macposts::Graph &graph, MNM_OD_Factory *od_factory,
   MNM_Node_Factory *node_factory, MNM_Link_Factory *link_factory,
   TInt routing_frq, TInt buffer_len)
     : MNM_Routing_Fixed::MNM_Routing_Fixed (graph, od_factory, node_factory,
@@ -488,12 +493,10 @@ MNM_Routing_Delivery_Fixed::remove_finished (MNM_Veh *veh, bool del)
                && veh->m_finish_time > veh->m_start_time);
     }
 
-  if (m_tracker.find (veh) != m_tracker.end () && del)
+  if (veh->m_route.is_set () && del)
     {
-      Assert (veh->m_type == MNM_TYPE_STATIC); // adaptive user not in m_tracker
-      m_tracker.find (veh)->second->clear ();
-      delete m_tracker.find (veh)->second;
-      m_tracker.erase (veh);
+      Assert (veh->m_type == MNM_TYPE_STATIC); // adaptive user has no route
+      veh->m_route.reset ();
     }
   return 0;
 }
@@ -503,7 +506,7 @@ MNM_Routing_Delivery_Fixed::remove_finished (MNM_Veh *veh, bool del)
 //#################################################################
 
 MNM_Routing_Delivery_Hybrid::MNM_Routing_Delivery_Hybrid (
-  const std::string &file_folder, macposts::Graph &graph,
+  const std::string &file_folder, const macposts::Graph &graph,
   MNM_Statistics *statistics, MNM_OD_Factory *od_factory,
   MNM_Node_Factory *node_factory, MNM_Link_Factory *link_factory,
   TInt route_frq_fixed, TInt buffer_len)
@@ -863,7 +866,7 @@ MNM_Dta_Delivery::build_from_files ()
                                               m_od_factory, m_node_factory);
   std::cout << "# of OD pairs: " << m_od_factory->m_origin_map.size () << "\n";
 
-  m_graph = MNM_IO::build_graph (m_file_folder, m_config);
+  m_own_graph = MNM_IO::build_graph (m_file_folder, m_config);
 
   MNM_IO::build_demand (m_file_folder, m_config, m_od_factory);
   MNM_IO_Delivery::build_demand_multi_OD_seq (m_file_folder, m_config,
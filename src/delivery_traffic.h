@@ -27,6 +27,7 @@ public:
   MNM_Veh_Factory_Delivery ();
   virtual ~MNM_Veh_Factory_Delivery ();
   MNM_Veh_Delivery *make_veh_delivery (TInt timestamp, Vehicle_type veh_type);
+  virtual int count_new_veh (MNM_Veh *veh) override;
   TInt m_veh_delivery;
 };
 
@@ -100,7 +101,7 @@ public:
 class MNM_Routing_Delivery_Fixed : public MNM_Routing_Fixed
 {
 public:
-  MNM_Routing_Delivery_Fixed (macposts::Graph &graph,
+  MNM_Routing_Delivery_Fixed (const macposts::Graph &graph,
                               MNM_OD_Factory *od_factory,
                               MNM_Node_Factory *node_factory,
                               MNM_Link_Factory *link_factory,
@@ -115,7 +116,7 @@ class MNM_Routing_Delivery_Hybrid : public MNM_Routing_Hybrid
 {
 public:
   MNM_Routing_Delivery_Hybrid (
-    const std::string &file_folder, macposts::Graph &graph,
+    const std::string &file_folder, const macposts::Graph &graph,
     MNM_Statistics *statistics, MNM_OD_Factory *od_factory,
     MNM_Node_Factory *node_factory, MNM_Link_Factory *link_factory,
     TInt route_frq_fixed = TInt (-1), TInt buffer_len = TInt (-1));
@@ -1,5 +1,7 @@
 #include "dlink.h"
 #include <cfloat>
+#include <cmath>
+#include <limits>
 
 MNM_Dlink::MNM_Dlink (TInt ID, TInt number_of_lane, TFlt length, TFlt ffs)
 {
@@ -95,6 +97,44 @@ MNM_Dlink::install_cumulative_curve_tree ()
   return 0;
 }
 
+int
+MNM_Dlink::add_memory_usage (MNM_Memory_Report &report)
+{
+  for (MNM_Cumulative_Curve *_cc : { m_N_in, m_N_out })
+    {
+      if (_cc != nullptr)
+        MNM::add_memory (report, "cumulative_curves", _cc->get_memory_bytes (),
+                         _cc->m_recorder.size ());
+    }
+  for (MNM_Tree_Cumulative_Curve *_cc_tree : { m_N_in_tree, m_N_out_tree })
+    {
+      if (_cc_tree != nullptr)
+        _cc_tree->add_memory_usage (report);
+    }
+  return 0;
+}
+
+const std::vector<MNM_Veh *> &
+MNM_Dlink::get_new_finished (TInt timestamp)
+{
+  if (timestamp != m_new_finished_stamp)
+    {
+      if (m_track_finished)
+        {
+          m_new_finished.swap (m_arrived_veh);
+          m_arrived_veh.clear ();
+        }
+      else
+        {
+          m_new_finished.assign (m_finished_array.begin (),
+                                 m_finished_array.end ());
+          m_track_finished = true;
+        }
+      m_new_finished_stamp = timestamp;
+    }
+  return m_new_finished;
+}
+
 int
 MNM_Dlink::move_veh_queue (std::deque<MNM_Veh *> *from_queue,
                            std::deque<MNM_Veh *> *to_queue, TInt number_tomove)
@@ -336,7 +376,7 @@ MNM_Dlink_Ctm::move_last_cell ()
       m_cell_array[m_num_cells - 1]->m_veh_queue.pop_front ();
       if (_veh->has_next_link ())
         {
-          m_finished_array.push_back (_veh);
+          add_finished_veh (_veh);
         }
       else
         {
@@ -575,7 +615,7 @@ MNM_Dlink_Pq::evolve (TInt timestamp)
     {
       if (_que_it->second >= std::max (0, m_max_stamp - 1))
         {
-          m_finished_array.push_back (_que_it->first);
+          add_finished_veh (_que_it->first);
           _que_it = m_veh_queue.erase (_que_it); // c++ 11
         }
       else
@@ -792,7 +832,7 @@ MNM_Dlink_Lq::evolve (TInt timestamp)
       for (int i = 0; i < _veh_to_move; ++i)
         {
           _veh = m_veh_queue.front ();
-          m_finished_array.push_back (_veh);
+          add_finished_veh (_veh);
           m_veh_queue.pop_front ();
         }
     }
@@ -956,7 +996,7 @@ MNM_Cumulative_Curve::MNM_Cumulative_Curve ()
   // should use m_recorder[i].first + 1 as the start_time this also means the
   // maximum allowable m_recorder[i].first == m_total_loading_interval, not
   // m_total_loading_interval - 1
-  m_recorder = std::deque<std::pair<TFlt, TFlt>> ();
+  m_recorder = std::vector<std::pair<TFlt, TFlt>> ();
 }
 
 MNM_Cumulative_Curve::~MNM_Cumulative_Curve () { m_recorder.clear (); }
@@ -1293,6 +1333,37 @@ MNM_Cumulative_Curve::get_time (TFlt result, bool rounding_up)
   return TFlt (-1);
 }
 
+int
+MNM_Cumulative_Curve::fill_on_grid (TFlt *out, TInt num_intervals, TInt stride)
+{
+  const TFlt _nan = std::numeric_limits<double>::quiet_NaN ();
+  for (int i = 0; i < num_intervals; ++i)
+    {
+      out[i * stride] = _nan;
+    }
+  // records are normally sorted by time, but a later record on the same tick
+  // always wins, which matches assigning them in order
+  int _tick;
+  for (size_t i = 0; i < m_recorder.size (); ++i)
+    {
+      _tick = int (m_recorder[i].first);
+      if (_tick < 0 || _tick >= num_intervals)
+        {
+          throw std::runtime_error (
+            "Error, MNM_Cumulative_Curve::fill_on_grid, time out of range");
+        }
+      out[_tick * stride] = m_recorder[i].second;
+    }
+  for (int i = 1; i < num_intervals; ++i)
+    {
+      if (std::isnan (out[i * stride]))
+        {
+          out[i * stride] = out[(i - 1) * stride];
+        }
+    }
+  return 0;
+}
+
 std::string
 MNM_Cumulative_Curve::to_string ()
 {
@@ -1307,6 +1378,129 @@ MNM_Cumulative_Curve::to_string ()
   return _output;
 }
 
+size_t
+MNM_Cumulative_Curve::get_memory_bytes ()
+{
+  return sizeof (MNM_Cumulative_Curve) + MNM::vector_bytes (m_recorder);
+}
+
+MNM_Cumulative_Curve_Cursor::MNM_Cumulative_Curve_Cursor (
+  MNM_Cumulative_Curve *curve)
+{
+  m_curve = curve;
+  m_time_pos = 0;
+  m_last_time = -DBL_MAX;
+  m_flow_pos = 0;
+  m_last_result = -DBL_MAX;
+  m_first_pos = 0;
+  // the searches of the curve are lower bounds under approximate comparisons,
+  // which only agree with a forward scan when the records are sorted and not
+  // negative
+  m_sorted = true;
+  const std::vector<std::pair<TFlt, TFlt>> &_records = curve->m_recorder;
+  for (size_t i = 0; i < _records.size () && m_sorted; ++i)
+    {
+      m_sorted = _records[i].first >= 0 && _records[i].second >= 0
+                 && (i == 0
+                     || (_records[i].first >= _records[i - 1].first
+                         && _records[i].second >= _records[i - 1].second));
+    }
+}
+
+TFlt
+MNM_Cumulative_Curve_Cursor::get_result (TFlt time)
+{
+  if (!m_sorted || time < m_last_time)
+    {
+      return m_curve->get_result (time);
+    }
+  const std::vector<std::pair<TFlt, TFlt>> &_records = m_curve->m_recorder;
+  if (_records.empty ())
+    {
+      return TFlt (0);
+    }
+  if (_records.size () == 1 || _records[0].first >= time)
+    {
+      return _records[0].second;
+    }
+
+  while (m_time_pos < _records.size ()
+         && MNM_Ults::approximate_less_than (_records[m_time_pos].first, time))
+    {
+      ++m_time_pos;
+    }
+  m_last_time = time;
+  size_t j = m_time_pos;
+  if (j == 0)
+    {
+      return m_curve->get_result (time);
+    }
+  if (j < _records.size ())
+    {
+      if (MNM_Ults::approximate_equal (_records[j].first, time))
+        {
+          return _records[j].second;
+        }
+      else if (_records[j].first > time)
+        {
+          return _records[j - 1].second; // rounding down
+        }
+    }
+  return _records.back ().second;
+}
+
+TFlt
+MNM_Cumulative_Curve_Cursor::get_time (TFlt result, bool rounding_up)
+{
+  if (!m_sorted || result < m_last_result)
+    {
+      return m_curve->get_time (result, rounding_up);
+    }
+  const std::vector<std::pair<TFlt, TFlt>> &_records = m_curve->m_recorder;
+  if (_records.size () <= 1 || _records[0].second >= result)
+    {
+      return TFlt (-1);
+    }
+
+  while (m_flow_pos < _records.size ()
+         && MNM_Ults::approximate_less_than (_records[m_flow_pos].second,
+                                             result))
+    {
+      ++m_flow_pos;
+    }
+  m_last_result = result;
+  size_t j = m_flow_pos;
+  if (j == 0 || (rounding_up && j == _records.size ()))
+    {
+      return m_curve->get_time (result, rounding_up);
+    }
+  if (rounding_up)
+    {
+      return _records[j].first;
+    }
+  if (j < _records.size ())
+    {
+      if (MNM_Ults::approximate_equal (_records[j].second, result))
+        {
+          return _records[j].first;
+        }
+      else if (_records[j].second > result)
+        {
+          // the flow of record j - 1 never decreases as j moves forward
+          while (m_first_pos < j
+                 && MNM_Ults::approximate_less_than (_records[m_first_pos]
+                                                       .second,
+                                                     _records[j - 1].second))
+            {
+              ++m_first_pos;
+            }
+          IAssert (m_first_pos < j);
+          return _records[m_first_pos].first; // rounding down
+        }
+    }
+  return TFlt (-1);
+}
+
 /**************************************************************************
                           Link Transmission model
 **************************************************************************/
@@ -1528,7 +1722,7 @@ MNM_Dlink_Ltm::evolve (TInt timestamp)
             {
               throw std::runtime_error ("no enough vehicles in vehicle queue");
             }
-          m_finished_array.push_back (_veh);
+          add_finished_veh (_veh);
           m_veh_queue.pop_front ();
         }
     }
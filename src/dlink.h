@@ -2,6 +2,7 @@
 
 #include "enum.h"
 #include "limits.h"
+#include "memory_usage.h"
 #include "ults.h"
 #include "vehicle.h"
 
@@ -13,6 +14,7 @@
 class MNM_Veh;
 class MNM_Dnode;
 class MNM_Path;
+class MNM_Cumulative_Emission;
 
 /**************************************************************************
                           Cumulative curve
@@ -22,8 +24,9 @@ class MNM_Cumulative_Curve
 public:
   MNM_Cumulative_Curve ();
   ~MNM_Cumulative_Curve ();
-  // <timestamp, flow>
-  std::deque<std::pair<TFlt, TFlt>> m_recorder;
+  // <timestamp, flow>, stored contiguously so that the records can be
+  // exposed to callers as a flat (n x 2) buffer
+  std::vector<std::pair<TFlt, TFlt>> m_recorder;
   int add_record (std::pair<TFlt, TFlt> r);
   int add_increment (std::pair<TFlt, TFlt> r);
   TFlt get_result (TFlt time);
@@ -31,12 +34,43 @@ public:
   TFlt get_time (TFlt result, bool rounding_up = false);
   std::string to_string ();
   int shrink (TInt number);
+  // write the curve on the integer interval grid [0, num_intervals) to out,
+  // with consecutive intervals stride elements apart; intervals before the
+  // first record are NaN and the others are forward filled
+  int fill_on_grid (TFlt *out, TInt num_intervals, TInt stride = 1);
+  size_t get_memory_bytes ();
 
 private:
   int arrange ();
   int arrange2 ();
 };
 
+// Answers the get_result and get_time queries of a curve, with the same
+// results, for a sequence of non-decreasing arguments by moving forward over
+// the records instead of searching them, so a sweep of T queries costs
+// O(records + T).  A query smaller than the previous one, or a curve whose
+// records are not sorted, is passed to the curve itself.  The curve must not
+// change while the cursor is in use.
+class MNM_Cumulative_Curve_Cursor
+{
+public:
+  explicit MNM_Cumulative_Curve_Cursor (MNM_Cumulative_Curve *curve);
+  TFlt get_result (TFlt time);
+  TFlt get_time (TFlt result, bool rounding_up = false);
+
+private:
+  MNM_Cumulative_Curve *m_curve;
+  bool m_sorted;
+  // first record not approximately before the last time asked
+  size_t m_time_pos;
+  TFlt m_last_time;
+  // first record not approximately below the last result asked
+  size_t m_flow_pos;
+  TFlt m_last_result;
+  // first record reaching the flow of the record before m_flow_pos
+  size_t m_first_pos;
+};
+
 // will majorly used to construct DAR matrix
 class MNM_Tree_Cumulative_Curve
 {
@@ -48,6 +82,8 @@ public:
     m_record;
   int add_flow (TFlt timestamp, TFlt flow, MNM_Path *path, TInt departing_int);
   int print_out ();
+  // adds to "tree_cumulative_curves", counting the curves
+  int add_memory_usage (MNM_Memory_Report &report);
 };
 
 /**************************************************************************
@@ -62,6 +98,11 @@ public:
 
   virtual int evolve (TInt timestamp) { return 0; };
   virtual TFlt get_link_supply () { return TFlt (0); };
+  // what the upstream node may send in, nothing while the link is closed
+  TFlt get_available_supply ()
+  {
+    return m_closed ? TFlt (0) : get_link_supply ();
+  };
   virtual int clear_incoming_array (TInt timestamp) { return 0; };
   virtual void print_info (){};
   int hook_up_node (MNM_Dnode *from, MNM_Dnode *to);
@@ -79,8 +120,24 @@ public:
     return TInt (-1);
   }; // intervals
 
+  // the link models put every vehicle that reaches the end of the link into
+  // m_finished_array through add_finished_veh
+  int add_finished_veh (MNM_Veh *veh)
+  {
+    m_finished_array.push_back (veh);
+    if (m_track_finished)
+      m_arrived_veh.push_back (veh);
+    return 0;
+  };
+  // the vehicles that entered m_finished_array since the previous routing
+  // interval, the same array for every routing called with timestamp; the
+  // first call returns the whole m_finished_array and starts the tracking
+  const std::vector<MNM_Veh *> &get_new_finished (TInt timestamp);
   int install_cumulative_curve ();
   int install_cumulative_curve_tree ();
+  // adds the installed curves to "cumulative_curves", counting the records,
+  // and to "tree_cumulative_curves"
+  virtual int add_memory_usage (MNM_Memory_Report &report);
 
   // protected:
   DLink_type m_link_type;
@@ -92,6 +149,11 @@ public:
   TFlt m_ffs;
   std::deque<MNM_Veh *> m_finished_array;
   std::deque<MNM_Veh *> m_incoming_array;
+  // routing worklist, see get_new_finished
+  bool m_track_finished = false;
+  TInt m_new_finished_stamp = TInt (-1);
+  std::vector<MNM_Veh *> m_new_finished;
+  std::vector<MNM_Veh *> m_arrived_veh;
 
   MNM_Cumulative_Curve *m_N_in;
   MNM_Cumulative_Curve *m_N_out;
@@ -100,6 +162,11 @@ public:
   MNM_Tree_Cumulative_Curve *m_N_out_tree;
 
   TFlt m_toll = 0.;
+  // set by MNM_Workzone for the intervals the link is closed
+  bool m_closed = false;
+  // set by MNM_Cumulative_Emission::register_link, told about every vehicle
+  // entering the link
+  MNM_Cumulative_Emission *m_emission = nullptr;
 
   // protected:
   virtual int move_veh_queue (std::deque<MNM_Veh *> *from_queue,
@@ -57,11 +57,11 @@ MNM_DMOND::evolve (TInt timestamp)
   for (unsigned i = 0; i < m_out_link_array.size (); ++i)
     {
       _link = m_out_link_array[i];
-      if ((_link->get_link_supply () * m_flow_scalar)
+      if ((_link->get_available_supply () * m_flow_scalar)
           < TFlt (m_out_volume.find (_link)->second))
         {
           m_out_volume.find (_link)->second = TInt (
-            MNM_Ults::round (_link->get_link_supply () * m_flow_scalar));
+            MNM_Ults::round (_link->get_available_supply () * m_flow_scalar));
         }
     }
   /* move vehicle */
@@ -276,7 +276,7 @@ MNM_Dnode_Inout::prepare_supplyANDdemand ()
       _out_link = m_out_link_array[j];
       // printf("Get link s\n");
       // printf("The out link is %d\n", _out_link -> m_link_ID);
-      m_supply[j] = _out_link->get_link_supply ();
+      m_supply[j] = _out_link->get_available_supply ();
       // printf(" get link s fin\n");
       // printf("Link %d, supply is %.4f\n", _out_link -> m_link_ID,
       // m_supply[j]);
@@ -310,9 +310,10 @@ MNM_Dnode_Inout::round_flow_to_vehicle ()
         }
       // printf("Going to loop %d vs supply %lf\n", _to_move, _out_link ->
       // get_link_supply());
-      while (TFlt (_to_move) > (_out_link->get_link_supply () * m_flow_scalar))
+      while (TFlt (_to_move)
+             > (_out_link->get_available_supply () * m_flow_scalar))
         {
-          _rand_idx = rand () % m_in_link_array.size ();
+          _rand_idx = MNM_Ults::rand_int (m_in_link_array.size ());
           if (m_veh_tomove[_rand_idx * _offset + j] >= 1)
             {
               m_veh_tomove[_rand_idx * _offset + j] -= 1;
@@ -397,8 +398,8 @@ MNM_Dnode_Inout::move_vehicle (TInt timestamp)
       _out_link = m_out_link_array[j];
 
       // shuffle the in links, reserve the FIFO
-      std::random_shuffle (_in_link_ind_array.begin (),
-                           _in_link_ind_array.end ());
+      MNM_Ults::random_shuffle (_in_link_ind_array.begin (),
+                                _in_link_ind_array.end ());
       for (size_t i : _in_link_ind_array)
         {
           _in_link = m_in_link_array[i];
@@ -3,23 +3,9 @@
 MNM_Dso::MNM_Dso (std::string file_folder)
     : MNM_Due_Msa::MNM_Due_Msa (file_folder)
 {
-  m_link_congested = std::unordered_map<TInt, bool *> ();
-  m_queue_dissipated_time = std::unordered_map<TInt, int *> ();
 }
 
-MNM_Dso::~MNM_Dso ()
-{
-  for (auto _it : m_link_congested)
-    {
-      delete _it.second;
-    }
-  m_link_congested.clear ();
-  for (auto _it : m_queue_dissipated_time)
-    {
-      delete _it.second;
-    }
-  m_queue_dissipated_time.clear ();
-}
+MNM_Dso::~MNM_Dso () {}
 
 TFlt
 MNM_Dso::get_disutility (TFlt depart_time, TFlt tt)
@@ -28,37 +14,39 @@ MNM_Dso::get_disutility (TFlt depart_time, TFlt tt)
 }
 
 int
-MNM_Dso::build_link_cost_map (MNM_Dta *dta)
+MNM_Dso::build_link_cost_map (MNM_Dta *dta, bool verbose)
 {
-  MNM_Dlink *_link;
-  for (auto _link_it : dta->m_link_factory->m_link_map)
+  if (m_link_congested.empty ())
     {
-      if (m_link_congested.find (_link_it.first) == m_link_congested.end ())
-        {
-          m_link_congested[_link_it.first] = new bool[m_total_loading_inter];
-        }
-      std::cout << "********************** link " << _link_it.first
-                << " **********************\n";
+      m_link_congested.reset (m_link_tt_map.get_link_IDs (),
+                              m_total_loading_inter);
+    }
+  std::vector<MNM_Dlink *> _links;
+  for (auto _link_it : dta->m_link_factory->m_link_map)
+    _links.push_back (_link_it.second);
+  // use i+1 as start_time in cc to compute link travel time for vehicles
+  // arriving at the beginning of interval i, i+1 is the end of the interval i,
+  // the beginning of interval i + 1
+  std::vector<TFlt> _start_times;
+  for (int i = 0; i < m_total_loading_inter; i++)
+    _start_times.push_back (TFlt (i + 1));
+  MNM::fill_link_rows (
+    _links.size (), int (m_dta_settings.m_num_threads), verbose,
+    "build_link_cost_map", [&] (size_t k) {
+      MNM_Dlink *_link = _links[k];
+      TFlt *_tt = m_link_tt_map[_link->m_link_ID];
+      TFlt *_cost = m_link_cost_map[_link->m_link_ID];
+      bool *_congested = m_link_congested[_link->m_link_ID];
+      MNM_DTA_GRADIENT::
+        get_travel_time_batch (_link, _start_times, m_unit_time,
+                               dta->m_current_loading_interval,
+                               _tt); // intervals
       for (int i = 0; i < m_total_loading_inter; i++)
         {
-          _link = _link_it.second;
-          // use i+1 as start_time in cc to compute link travel time for
-          // vehicles arriving at the beginning of interval i, i+1 is the end of
-          // the interval i, the beginning of interval i + 1
-          m_link_tt_map[_link_it.first][i] = MNM_DTA_GRADIENT::
-            get_travel_time (_link, TFlt (i + 1), m_unit_time,
-                             dta->m_current_loading_interval); // intervals
-          m_link_cost_map[_link_it.first][i]
-            = m_vot * m_link_tt_map[_link_it.first][i] + _link->m_toll;
-          // std::cout << "interval: " << i << ", link: " << _link_it.first <<
-          // ", tt: " << m_link_cost_map[_link_it.first][i] << "\n";
-          m_link_congested[_link_it.first][i]
-            = m_link_tt_map[_link_it.first][i]
-              > _link->get_link_freeflow_tt_loading ();
-          // std::cout << "interval: " << i << ", link: " << _link_it.first <<
-          // ", congested?: " << m_link_congested[_link_it.first][i] << "\n";
+          _cost[i] = m_vot * _tt[i] + _link->m_toll;
+          _congested[i] = _tt[i] > _link->get_link_freeflow_tt_loading ();
         }
-    }
+    });
   return 0;
 }
 
@@ -74,14 +62,13 @@ MNM_Dso::get_link_marginal_cost (MNM_Dta *dta)
   bool _flg;
   std::cout << "\n********************** Begin MNM_Dso::get_link_marginal_cost "
                "**********************\n";
+  if (m_queue_dissipated_time.empty ())
+    {
+      m_queue_dissipated_time.reset (m_link_tt_map.get_link_IDs (),
+                                     _total_loading_inter);
+    }
   for (auto _link_it : dta->m_link_factory->m_link_map)
     {
-      if (m_queue_dissipated_time.find (_link_it.first)
-          == m_queue_dissipated_time.end ())
-        {
-          m_queue_dissipated_time[_link_it.first]
-            = new int[_total_loading_inter];
-        }
       _link = dynamic_cast<MNM_Dlink *> (_link_it.second);
       _link_fft = _link->get_link_freeflow_tt_loading ();
       // std::cout << "********************** get_link_queue_dissipated_time
@@ -11,12 +11,12 @@ public:
 
   virtual TFlt get_disutility (TFlt depart_time, TFlt tt) override;
 
-  virtual int build_link_cost_map (MNM_Dta *dta) override;
+  virtual int build_link_cost_map (MNM_Dta *dta, bool verbose = false) override;
 
   int get_link_marginal_cost (MNM_Dta *dta);
 
-  std::unordered_map<TInt, bool *> m_link_congested;
+  MNM_Link_Matrix<bool> m_link_congested;
 
   // time-varying queue dissipated time
-  std::unordered_map<TInt, int *> m_queue_dissipated_time;
+  MNM_Link_Matrix<int> m_queue_dissipated_time;
 };
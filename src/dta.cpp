@@ -3,10 +3,38 @@
 using macposts::graph::Direction;
 
 MNM_Dta::MNM_Dta (const std::string &file_folder)
+    : m_core (nullptr), m_own_graph (), m_graph (m_own_graph)
 {
   m_file_folder = file_folder;
   m_current_loading_interval = TInt (0);
   m_emission = nullptr;
+  m_profiler = nullptr;
+  m_memory_log_freq = 0;
+  m_routing = nullptr;
+  m_statistics = nullptr;
+  m_gridlock_recorder = nullptr;
+  m_workzone = nullptr;
+  m_veh_factory = nullptr;
+  m_node_factory = nullptr;
+  m_link_factory = nullptr;
+  m_od_factory = nullptr;
+  m_config = nullptr;
+  m_queue_veh_num = std::deque<TInt> ();
+  m_enroute_veh_num = std::deque<TInt> ();
+  m_queue_veh_map = std::unordered_map<TInt, std::deque<TInt> *> ();
+
+  initialize ();
+}
+
+MNM_Dta::MNM_Dta (const std::string &file_folder,
+                  std::shared_ptr<const MNM_Network_Core> core)
+    : m_core (core), m_own_graph (), m_graph (core->m_graph)
+{
+  m_file_folder = file_folder;
+  m_current_loading_interval = TInt (0);
+  m_emission = nullptr;
+  m_profiler = nullptr;
+  m_memory_log_freq = 0;
   m_routing = nullptr;
   m_statistics = nullptr;
   m_gridlock_recorder = nullptr;
@@ -79,6 +107,7 @@ MNM_Dta::initialize ()
   m_link_factory = new MNM_Link_Factory ();
   m_od_factory = new MNM_OD_Factory ();
   m_config = new MNM_ConfReader (m_file_folder + "/config.conf", "DTA");
+  m_settings.load (m_config);
   m_unit_time = m_config->get_int ("unit_time");
   m_flow_scalar = m_config->get_int ("flow_scalar");
   TInt _ev_label;
@@ -309,26 +338,35 @@ MNM_Dta::set_routing ()
 int
 MNM_Dta::build_workzone ()
 {
-  // TODO: Disabled for the new builtin `macposts::Graph' class because it does
-  // not support removing a link yet.
-  //
-  // m_workzone = new MNM_Workzone (m_node_factory, m_link_factory, m_graph);
-  // MNM_IO::build_workzone_list (m_file_folder, m_workzone);
+  // closures never touch the graph, see MNM_Workzone
+  m_workzone = new MNM_Workzone (m_node_factory, m_link_factory, m_graph);
+  MNM_IO::build_workzone_list (m_file_folder, m_workzone);
   return 0;
 }
 
 int
 MNM_Dta::build_from_files ()
 {
-  MNM_IO::build_node_factory (m_file_folder, m_config, m_node_factory);
+  if (m_core != nullptr)
+    {
+      m_core->build_node_factory (m_node_factory);
+      m_core->build_link_factory (m_link_factory);
+    }
+  else
+    {
+      MNM_IO::build_node_factory (m_file_folder, m_config, m_node_factory);
+      MNM_IO::build_link_factory (m_file_folder, m_config, m_link_factory);
+    }
   std::cout << "# of nodes: " << m_node_factory->m_node_map.size () << "\n";
-  MNM_IO::build_link_factory (m_file_folder, m_config, m_link_factory);
   std::cout << "# of links: " << m_link_factory->m_link_map.size () << "\n";
   MNM_IO::build_od_factory (m_file_folder, m_config, m_od_factory,
                             m_node_factory);
   std::cout << "# of OD pairs: " << m_od_factory->m_origin_map.size () << "\n";
   // std::cout << m_od_factory -> m_destination_map.size() << "\n";
-  m_graph = MNM_IO::build_graph (m_file_folder, m_config);
+  if (m_core == nullptr)
+    {
+      m_own_graph = MNM_IO::build_graph (m_file_folder, m_config);
+    }
   MNM_IO::build_demand (m_file_folder, m_config, m_od_factory);
   MNM_IO::read_origin_vehicle_label_ratio (m_file_folder, m_config,
                                            m_od_factory);
@@ -508,8 +546,8 @@ MNM_Dta::pre_loading ()
       _node->prepare_loading ();
     }
   // printf("dsf\n");
-  // TODO: workzone not compatible with new graph(), but workzone can be realized using time-dependent link attribute
-  // m_workzone -> init_workzone();
+  if (m_workzone != nullptr)
+    m_workzone->init_workzone ();
 
   // https://stackoverflow.com/questions/7443787/using-c-ifstream-extraction-operator-to-read-formatted-data-from-a-file
   std::ifstream _emission_file (m_file_folder + "/MNM_input_emission_linkID");
@@ -538,13 +576,14 @@ MNM_Dta::pre_loading ()
 int
 MNM_Dta::load_once (bool verbose, TInt load_int, TInt assign_int)
 {
-  MNM_Origin *_origin;
   MNM_Dnode *_node;
   MNM_Dlink *_link;
   MNM_Destination *_dest;
 
   // update some link attributes over time
   m_link_factory->update_link_attribute (load_int, verbose);
+  if (m_workzone != nullptr)
+    m_workzone->update_workzone (load_int);
   // compute empty network link tt, for adaptive routing
   if (load_int == 0)
     m_statistics->update_record (-1);
@@ -552,83 +591,86 @@ MNM_Dta::load_once (bool verbose, TInt load_int, TInt assign_int)
     printf ("-------------------------------    Interval %d   "
             "------------------------------ \n",
             (int) load_int);
+  MNM_Phase_Timer _timer (m_profiler, load_int);
   // step 1: Origin release vehicle
   if (verbose)
     printf ("Releasing!\n");
-
+  _timer.start ("release");
+
+  auto _release = [&] (MNM_Origin *origin) {
+    if (assign_int >= m_total_assign_inter)
+      {
+        origin->release_one_interval (load_int, m_veh_factory, -1, TFlt (-1));
+      }
+    else
+      {
+        if (m_settings.m_routing_type == MNM_Routing_Type::Fixed
+            || m_settings.m_routing_type == MNM_Routing_Type::Due)
+          {
+            // printf("Fixed Releasing.\n");
+            origin->release_one_interval (load_int, m_veh_factory, assign_int,
+                                          TFlt (0));
+          }
+        else if (m_settings.m_routing_type == MNM_Routing_Type::Adaptive)
+          {
+            origin->release_one_interval (load_int, m_veh_factory, assign_int,
+                                          TFlt (1));
+          }
+        else if (m_settings.m_routing_type == MNM_Routing_Type::Hybrid)
+          {
+            origin->release_one_interval (load_int, m_veh_factory, assign_int,
+                                          m_settings.m_adaptive_ratio);
+          }
+        else if (m_settings.m_routing_type == MNM_Routing_Type::Biclass_Hybrid)
+          {
+            // NOTE: in this case the release function is different
+            origin->release_one_interval_biclass (
+              load_int, m_veh_factory, assign_int,
+              m_settings.m_adaptive_ratio_car,
+              m_settings.m_adaptive_ratio_truck);
+          }
+      }
+  };
   if (load_int % m_assign_freq == 0 || load_int == 0)
     {
-      for (auto _origin_it = m_od_factory->m_origin_map.begin ();
-           _origin_it != m_od_factory->m_origin_map.end (); _origin_it++)
+      // checked here once, the release may run on worker threads
+      if (assign_int < m_total_assign_inter
+          && m_settings.m_routing_type != MNM_Routing_Type::Fixed
+          && m_settings.m_routing_type != MNM_Routing_Type::Due
+          && m_settings.m_routing_type != MNM_Routing_Type::Adaptive
+          && m_settings.m_routing_type != MNM_Routing_Type::Hybrid
+          && m_settings.m_routing_type != MNM_Routing_Type::Biclass_Hybrid)
         {
-          _origin = _origin_it->second;
-          if (assign_int >= m_total_assign_inter)
-            {
-              _origin->release_one_interval (load_int, m_veh_factory, -1,
-                                             TFlt (-1));
-            }
-          else
+          printf ("WARNING:No assignment!\n");
+        }
+      else if (m_settings.m_release_threads > 0)
+        {
+          std::vector<MNM_Origin *> _origins;
+          for (auto _origin_it : m_od_factory->m_origin_map)
+            _origins.push_back (_origin_it.second);
+          MNM::release_origins (_origins.size (), m_settings.m_release_threads,
+                                m_veh_factory,
+                                [&] (size_t i) { _release (_origins[i]); });
+        }
+      else
+        {
+          for (auto _origin_it = m_od_factory->m_origin_map.begin ();
+               _origin_it != m_od_factory->m_origin_map.end (); _origin_it++)
             {
-              if (m_config->get_string ("routing_type") == "Fixed"
-                  || m_config->get_string ("routing_type") == "Due")
-                {
-                  // printf("Fixed Releasing.\n");
-                  _origin->release_one_interval (load_int, m_veh_factory,
-                                                 assign_int, TFlt (0));
-                }
-              else if ((m_config->get_string ("routing_type") == "Adaptive"))
-                {
-                  _origin->release_one_interval (load_int, m_veh_factory,
-                                                 assign_int, TFlt (1));
-                }
-              else if ((m_config->get_string ("routing_type") == "Hybrid"))
-                {
-                  TFlt _ad_ratio = m_config->get_float ("adaptive_ratio");
-                  if (_ad_ratio > 1)
-                    _ad_ratio = 1;
-                  if (_ad_ratio < 0)
-                    _ad_ratio = 0;
-                  _origin->release_one_interval (load_int, m_veh_factory,
-                                                 assign_int, _ad_ratio);
-                }
-              else if ((m_config->get_string ("routing_type")
-                        == "Biclass_Hybrid"))
-                {
-                  TFlt _ad_ratio_car
-                    = m_config->get_float ("adaptive_ratio_car");
-                  if (_ad_ratio_car > 1)
-                    _ad_ratio_car = 1;
-                  if (_ad_ratio_car < 0)
-                    _ad_ratio_car = 0;
-
-                  TFlt _ad_ratio_truck
-                    = m_config->get_float ("adaptive_ratio_truck");
-                  if (_ad_ratio_truck > 1)
-                    _ad_ratio_truck = 1;
-                  if (_ad_ratio_truck < 0)
-                    _ad_ratio_truck = 0;
-                  // NOTE: in this case the release function is different
-                  _origin->release_one_interval_biclass (load_int,
-                                                         m_veh_factory,
-                                                         assign_int,
-                                                         _ad_ratio_car,
-                                                         _ad_ratio_truck);
-                }
-              else
-                {
-                  printf ("WARNING:No assignment!\n");
-                }
+              _release (_origin_it->second);
             }
         }
     }
 
   if (verbose)
     printf ("Routing!\n");
+  _timer.start ("routing");
   // step 2: route the vehicle
   m_routing->update_routing (load_int);
 
   if (verbose)
     printf ("Moving through node!\n");
+  _timer.start ("node_evolve");
   // step 3: move vehicles through node
   for (auto _node_it = m_node_factory->m_node_map.begin ();
        _node_it != m_node_factory->m_node_map.end (); _node_it++)
@@ -643,16 +685,17 @@ MNM_Dta::load_once (bool verbose, TInt load_int, TInt assign_int)
   record_queue_vehicles ();
   if (verbose)
     printf ("Moving through link!\n");
+  _timer.start ("link_evolve");
   // step 4: move vehicles through link
   for (auto _link_it = m_link_factory->m_link_map.begin ();
        _link_it != m_link_factory->m_link_map.end (); _link_it++)
     {
       _link = _link_it->second;
       if ((m_gridlock_recorder != nullptr)
-          && ((m_config->get_int ("total_interval") <= 0
+          && ((m_settings.m_total_interval <= 0
                && load_int >= 1.5 * m_total_assign_inter * m_assign_freq)
-              || (m_config->get_int ("total_interval") > 0
-                  && load_int >= 0.95 * m_config->get_int ("total_interval"))))
+              || (m_settings.m_total_interval > 0
+                  && load_int >= 0.95 * m_settings.m_total_interval)))
         {
           m_gridlock_recorder->save_one_link (load_int, _link);
         }
@@ -661,10 +704,14 @@ MNM_Dta::load_once (bool verbose, TInt load_int, TInt assign_int)
     }
 
   if (m_emission != nullptr)
-    m_emission->update (m_veh_factory);
+    {
+      _timer.start ("emission");
+      m_emission->update (m_veh_factory);
+    }
 
   if (verbose)
     printf ("Receiving!\n");
+  _timer.start ("destination_receive");
   // step 5: Destination receive vehicle
   for (auto _dest_it = m_od_factory->m_destination_map.begin ();
        _dest_it != m_od_factory->m_destination_map.end (); _dest_it++)
@@ -676,10 +723,12 @@ MNM_Dta::load_once (bool verbose, TInt load_int, TInt assign_int)
 
   if (verbose)
     printf ("Update record!\n");
+  _timer.start ("statistics");
   // step 5: update record
   m_statistics->update_record (load_int);
 
   record_enroute_vehicles ();
+  _timer.stop ();
   if (verbose)
     MNM::print_vehicle_statistics (m_veh_factory);
   // test();
@@ -694,6 +743,7 @@ MNM_Dta::loading (bool verbose)
 {
   int _current_inter = 0;
   int _assign_inter = m_start_assign_interval;
+  m_memory_log_freq = m_settings.m_memory_log_freq;
 
   // It at least will release all vehicles no matter what value total_interval
   // is set the least length of simulation = max_interval * assign_frq
@@ -705,10 +755,15 @@ MNM_Dta::loading (bool verbose)
           std::cout << std::endl
                     << "Current loading interval: " << _current_inter << ", "
                     << "Current assignment interval: "
-                    << int (_current_inter / m_config->get_int ("assign_frq"))
+                    << int (_current_inter / m_settings.m_assign_frq)
                     << std::endl;
         }
       load_once (verbose, _current_inter, _assign_inter);
+      if (m_memory_log_freq > 0 && _current_inter % m_memory_log_freq == 0)
+        {
+          printf ("Memory after interval %d: %s\n", _current_inter,
+                  MNM::memory_report_to_string (get_memory_usage ()).c_str ());
+        }
       // link cc will be updated with the record at the end of this interval
       // (i.e., _current_inter + 1)
       if (++_current_inter % m_assign_freq == 0)
@@ -763,11 +818,66 @@ MNM_Dta::record_enroute_vehicles ()
   return 0;
 }
 
+int
+MNM_Dta::add_memory_usage (MNM_Memory_Report &report)
+{
+  if (m_veh_factory != nullptr)
+    {
+      // derived vehicle classes only add a few fields
+      MNM::add_memory (report, "vehicles",
+                       MNM::unordered_bytes (m_veh_factory->m_veh_map)
+                         + m_veh_factory->m_veh_map.size () * sizeof (MNM_Veh),
+                       m_veh_factory->m_veh_map.size ());
+    }
+  if (m_link_factory != nullptr)
+    {
+      for (auto _link_it : m_link_factory->m_link_map)
+        {
+          _link_it.second->add_memory_usage (report);
+        }
+    }
+  if (m_routing != nullptr)
+    {
+      m_routing->add_memory_usage (report);
+    }
+
+  size_t _bytes = MNM::unordered_bytes (m_queue_veh_map)
+                  + MNM::deque_bytes (m_queue_veh_num)
+                  + MNM::deque_bytes (m_enroute_veh_num);
+  size_t _count = m_queue_veh_num.size () + m_enroute_veh_num.size ();
+  for (auto _it : m_queue_veh_map)
+    {
+      _bytes += sizeof (*_it.second) + MNM::deque_bytes (*_it.second);
+      _count += _it.second->size ();
+    }
+  if (m_statistics != nullptr)
+    {
+      for (auto *_map : { &m_statistics->m_load_interval_volume,
+                          &m_statistics->m_record_interval_volume,
+                          &m_statistics->m_record_interval_tt,
+                          &m_statistics->m_load_interval_tt })
+        {
+          _bytes += MNM::unordered_bytes (*_map);
+          _count += _map->size ();
+        }
+    }
+  MNM::add_memory (report, "statistics", _bytes, _count);
+  return 0;
+}
+
+MNM_Memory_Report
+MNM_Dta::get_memory_usage ()
+{
+  MNM_Memory_Report _report;
+  add_memory_usage (_report);
+  return _report;
+}
+
 bool
 MNM_Dta::finished_loading (int cur_int)
 {
   // printf("Entering MNM_Dta::finished_loading\n");
-  TInt _total_int = m_config->get_int ("total_interval");
+  TInt _total_int = m_settings.m_total_interval;
   if (_total_int > 0)
     {
       // printf("Exiting MNM_Dta::finished_loading 1\n");
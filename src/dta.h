@@ -7,9 +7,13 @@
 #include "factory.h"
 #include "gridlock_checker.h"
 #include "io.h"
+#include "memory_usage.h"
+#include "network_core.h"
 #include "od.h"
 #include "pre_routing.h"
+#include "profiler.h"
 #include "routing.h"
+#include "settings.h"
 #include "shortest_path.h"
 #include "statistics.h"
 #include "ults.h"
@@ -19,6 +23,10 @@ class MNM_Dta
 {
 public:
   explicit MNM_Dta (const std::string &file_folder);
+  // build the network from a shared core instead of the input files; the
+  // graph is then the one of the core
+  MNM_Dta (const std::string &file_folder,
+           std::shared_ptr<const MNM_Network_Core> core);
   virtual ~MNM_Dta ();
   virtual int initialize ();
   virtual int build_from_files ();
@@ -38,6 +46,10 @@ public:
 
   virtual int record_queue_vehicles ();
   int record_enroute_vehicles ();
+  // estimated heap usage of the vehicles, link curves, routing and
+  // statistics, by category
+  virtual int add_memory_usage (MNM_Memory_Report &report);
+  MNM_Memory_Report get_memory_usage ();
 
   TInt m_start_assign_interval;
   TInt m_total_assign_inter;
@@ -47,17 +59,30 @@ public:
   TInt m_init_demand_split;
   std::string m_file_folder;
   MNM_ConfReader *m_config;
+  // the keys of m_config read while loading, see initialize
+  MNM_Dta_Settings m_settings;
   MNM_Veh_Factory *m_veh_factory;
   MNM_Node_Factory *m_node_factory;
   MNM_Link_Factory *m_link_factory;
   MNM_OD_Factory *m_od_factory;
-  macposts::Graph m_graph;
+  std::shared_ptr<const MNM_Network_Core> m_core;
+  // the graph built from the files when there is no core, filled in by
+  // build_from_files
+  macposts::Graph m_own_graph;
+  // either m_own_graph or the graph of m_core, read only as the latter is
+  // shared with other instances
+  const macposts::Graph &m_graph;
   MNM_Statistics *m_statistics;
   MNM_Gridlock_Link_Recorder *m_gridlock_recorder;
   MNM_Routing *m_routing;
   MNM_Workzone *m_workzone;
   TInt m_current_loading_interval;
   MNM_Cumulative_Emission *m_emission;
+  // not owned, times the phases of load_once if set
+  MNM_Profiler *m_profiler;
+  // memory_log_freq in config.conf/DTA, loading prints the memory usage every
+  // so many intervals, 0 for never
+  TInt m_memory_log_freq;
 
   std::unordered_map<TInt, std::deque<TInt> *>
     m_queue_veh_map;                  // queuing vehicle number for each link
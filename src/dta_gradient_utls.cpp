@@ -1,4 +1,5 @@
 #include "dta_gradient_utls.h"
+#include <algorithm>
 #include <cfloat>
 
 namespace MNM_DTA_GRADIENT
@@ -163,10 +164,13 @@ get_last_valid_time_bus (MNM_Cumulative_Curve *N_in,
     }
 }
 
+namespace
+{
+// Curve is MNM_Cumulative_Curve or MNM_Cumulative_Curve_Cursor
+template <typename Curve>
 TFlt
-get_travel_time_from_cc (TFlt start_time, MNM_Cumulative_Curve *N_in,
-                         MNM_Cumulative_Curve *N_out, TFlt last_valid_time,
-                         TFlt fftt, bool rounding_up)
+travel_time_from_cc (TFlt start_time, Curve *N_in, Curve *N_out,
+                     TFlt last_valid_time, TFlt fftt, bool rounding_up)
 {
   if (last_valid_time <= 0)
     return fftt;
@@ -199,6 +203,25 @@ get_travel_time_from_cc (TFlt start_time, MNM_Cumulative_Curve *N_in,
       return (_end_time - start_time); // each interval is 5s
     }
 }
+}
+
+TFlt
+get_travel_time_from_cc (TFlt start_time, MNM_Cumulative_Curve *N_in,
+                         MNM_Cumulative_Curve *N_out, TFlt last_valid_time,
+                         TFlt fftt, bool rounding_up)
+{
+  return travel_time_from_cc (start_time, N_in, N_out, last_valid_time, fftt,
+                              rounding_up);
+}
+
+TFlt
+get_travel_time_from_cc (TFlt start_time, MNM_Cumulative_Curve_Cursor *N_in,
+                         MNM_Cumulative_Curve_Cursor *N_out,
+                         TFlt last_valid_time, TFlt fftt, bool rounding_up)
+{
+  return travel_time_from_cc (start_time, N_in, N_out, last_valid_time, fftt,
+                              rounding_up);
+}
 
 TFlt
 get_travel_time_from_FD (MNM_Dlink *link, TFlt start_time, TFlt unit_interval)
@@ -243,6 +266,43 @@ get_travel_time (MNM_Dlink *link, TFlt start_time, TFlt unit_interval,
                                   link->m_last_valid_time, fftt);
 }
 
+int
+get_travel_time_batch (MNM_Dlink *link, const std::vector<TFlt> &start_times,
+                       TFlt unit_interval, TInt end_loading_timestamp,
+                       TFlt *tt)
+{
+  if (link == nullptr)
+    {
+      throw std::runtime_error (
+        "Error, get_travel_time_batch link is null");
+    }
+  if (link->m_N_in == nullptr)
+    {
+      throw std::runtime_error ("Error, get_travel_time_batch link "
+                                "cumulative curve is not installed");
+    }
+
+  TFlt fftt = TFlt (
+    int (link->get_link_freeflow_tt_loading ())); // actual intervals in loading
+
+  if (link->m_last_valid_time < 0)
+    {
+      link->m_last_valid_time
+        = get_last_valid_time (link->m_N_in, link->m_N_out,
+                               end_loading_timestamp);
+    }
+  IAssert (link->m_last_valid_time >= 0);
+
+  MNM_Cumulative_Curve_Cursor _N_in (link->m_N_in);
+  MNM_Cumulative_Curve_Cursor _N_out (link->m_N_out);
+  for (size_t k = 0; k < start_times.size (); ++k)
+    {
+      tt[k] = get_travel_time_from_cc (start_times[k], &_N_in, &_N_out,
+                                       link->m_last_valid_time, fftt);
+    }
+  return 0;
+}
+
 TFlt
 get_travel_time_robust (MNM_Dlink *link, TFlt start_time, TFlt end_time,
                         TFlt unit_interval, TInt end_loading_timestamp,
@@ -297,7 +357,7 @@ get_path_travel_time (MNM_Path *path, TFlt start_time,
 
 TFlt
 get_path_travel_time (MNM_Path *path, TFlt start_time,
-                      std::unordered_map<TInt, TFlt *> &link_tt_map,
+                      const std::unordered_map<TInt, TFlt *> &link_tt_map,
                       TInt end_loading_timestamp)
 {
   // start_time means the actual departure time
@@ -309,17 +369,17 @@ get_path_travel_time (MNM_Path *path, TFlt start_time,
   for (TInt _link_ID : path->m_link_vec)
     {
       _cur_time += MNM_Ults::round_up_time (
-        link_tt_map[_link_ID][_cur_time < (int) end_loading_timestamp
-                                ? _cur_time
-                                : (int) end_loading_timestamp - 1]);
+        link_tt_map.at (_link_ID)[_cur_time < (int) end_loading_timestamp
+                                    ? _cur_time
+                                    : (int) end_loading_timestamp - 1]);
     }
   return TFlt (_cur_time - start_time);
 }
 
 TFlt
 get_path_travel_cost (MNM_Path *path, TFlt start_time,
-                      std::unordered_map<TInt, TFlt *> &link_tt_map,
-                      std::unordered_map<TInt, TFlt *> &link_cost_map,
+                      const std::unordered_map<TInt, TFlt *> &link_tt_map,
+                      const std::unordered_map<TInt, TFlt *> &link_cost_map,
                       TInt end_loading_timestamp)
 {
   // start_time means the actual departure time
@@ -331,17 +391,168 @@ get_path_travel_cost (MNM_Path *path, TFlt start_time,
   TFlt _cost = 0.;
   for (TInt _link_ID : path->m_link_vec)
     {
-      _cost += link_cost_map[_link_ID][_cur_time < (int) end_loading_timestamp
-                                         ? _cur_time
-                                         : (int) end_loading_timestamp - 1];
+      _cost += link_cost_map.at (
+        _link_ID)[_cur_time < (int) end_loading_timestamp
+                    ? _cur_time
+                    : (int) end_loading_timestamp - 1];
       _cur_time += MNM_Ults::round_up_time (
-        link_tt_map[_link_ID][_cur_time < (int) end_loading_timestamp
-                                ? _cur_time
-                                : (int) end_loading_timestamp - 1]);
+        link_tt_map.at (_link_ID)[_cur_time < (int) end_loading_timestamp
+                                    ? _cur_time
+                                    : (int) end_loading_timestamp - 1]);
     }
   return _cost;
 }
 
+int
+build_path_link_csr (Path_Table *path_table, path_link_csr &csr)
+{
+  if (path_table == nullptr)
+    {
+      throw std::runtime_error ("Error, build_path_link_csr path table is null");
+    }
+  std::vector<MNM_Path *> _paths;
+  for (auto _o_it : *path_table)
+    {
+      for (auto _d_it : *(_o_it.second))
+        {
+          for (MNM_Path *_path : _d_it.second->m_path_vec)
+            {
+              _paths.push_back (_path);
+            }
+        }
+    }
+  return build_path_link_csr (_paths, csr);
+}
+
+int
+build_path_link_csr (const std::vector<MNM_Path *> &paths, path_link_csr &csr)
+{
+  csr.paths.clear ();
+  csr.row_ptr.assign (1, 0);
+  csr.link_idx.clear ();
+  csr.link_ID.clear ();
+  std::unordered_map<TInt, int> _link_pos;
+  for (MNM_Path *_path : paths)
+    {
+      if (_path == nullptr)
+        {
+          throw std::runtime_error ("Error, build_path_link_csr path is null");
+        }
+      csr.paths.push_back (_path);
+      for (TInt _link_ID : _path->m_link_vec)
+        {
+          auto _pos_it = _link_pos.find (_link_ID);
+          if (_pos_it == _link_pos.end ())
+            {
+              _pos_it = _link_pos
+                          .insert (std::pair<TInt, int> (_link_ID,
+                                                         csr.link_ID.size ()))
+                          .first;
+              csr.link_ID.push_back (_link_ID);
+            }
+          csr.link_idx.push_back (_pos_it->second);
+        }
+      csr.row_ptr.push_back (csr.link_idx.size ());
+    }
+  return 0;
+}
+
+int
+get_path_travel_time_batch (
+  const path_link_csr &csr, const std::vector<TFlt> &start_times,
+  const std::unordered_map<TInt, TFlt *> &link_tt_map,
+  const std::unordered_map<TInt, TFlt *> &link_cost_map,
+  TInt end_loading_timestamp, std::vector<TFlt> &tt, std::vector<TFlt> *cost,
+  int num_threads)
+{
+  const int _num_interval = end_loading_timestamp;
+  const size_t _num_link = csr.link_ID.size ();
+  const size_t _num_path = csr.paths.size ();
+  const size_t _num_time = start_times.size ();
+
+  // dense [link][interval] copies, so a hop is an index instead of a hash
+  // lookup; link travel times are rounded up once here, not once per use
+  std::vector<int> _tt (_num_link * _num_interval);
+  std::vector<TFlt> _cost (cost == nullptr ? 0 : _num_link * _num_interval);
+  for (size_t l = 0; l < _num_link; ++l)
+    {
+      auto _tt_it = link_tt_map.find (csr.link_ID[l]);
+      if (_tt_it == link_tt_map.end ())
+        {
+          throw std::runtime_error (
+            "Error, get_path_travel_time_batch no travel time for link "
+            + std::to_string (csr.link_ID[l]));
+        }
+      for (int t = 0; t < _num_interval; ++t)
+        {
+          _tt[l * _num_interval + t]
+            = MNM_Ults::round_up_time (_tt_it->second[t]);
+        }
+      if (cost != nullptr)
+        {
+          auto _cost_it = link_cost_map.find (csr.link_ID[l]);
+          if (_cost_it == link_cost_map.end ())
+            {
+              throw std::runtime_error (
+                "Error, get_path_travel_time_batch no cost for link "
+                + std::to_string (csr.link_ID[l]));
+            }
+          std::copy (_cost_it->second, _cost_it->second + _num_interval,
+                     _cost.begin () + l * _num_interval);
+        }
+    }
+
+  tt.assign (_num_path * _num_time, TFlt (0));
+  if (cost != nullptr)
+    cost->assign (_num_path * _num_time, TFlt (0));
+
+  // all start times of a path advance together hop by hop, which keeps the
+  // inner loop free of branches and lets it vectorize
+  auto _evaluate = [&] (size_t first_path, size_t last_path) {
+    std::vector<int> _cur_time (_num_time);
+    std::vector<TFlt> _path_cost (_num_time);
+    int _row;
+    for (size_t i = first_path; i < last_path; ++i)
+      {
+        for (size_t k = 0; k < _num_time; ++k)
+          {
+            _cur_time[k] = int (round (start_times[k]));
+            _path_cost[k] = 0;
+          }
+        for (int h = csr.row_ptr[i]; h < csr.row_ptr[i + 1]; ++h)
+          {
+            _row = csr.link_idx[h] * _num_interval;
+            if (cost != nullptr)
+              {
+                for (size_t k = 0; k < _num_time; ++k)
+                  _path_cost[k]
+                    += _cost[_row
+                             + std::min (_cur_time[k], _num_interval - 1)];
+              }
+            for (size_t k = 0; k < _num_time; ++k)
+              _cur_time[k]
+                += _tt[_row + std::min (_cur_time[k], _num_interval - 1)];
+          }
+        for (size_t k = 0; k < _num_time; ++k)
+          {
+            tt[i * _num_time + k] = TFlt (_cur_time[k] - start_times[k]);
+            if (cost != nullptr)
+              (*cost)[i * _num_time + k] = _path_cost[k];
+          }
+      }
+  };
+
+  // the jobs are blocks of paths and each path is written by exactly one of
+  // them, so the result does not depend on num_threads
+  const size_t _block = 64;
+  MNM_Ults::parallel_for ((_num_path + _block - 1) / _block, num_threads,
+                          [&] (size_t b, int worker) {
+                            _evaluate (b * _block,
+                                       std::min (_num_path, (b + 1) * _block));
+                          });
+  return 0;
+}
+
 int
 add_dar_records (std::vector<dar_record *> &record, MNM_Dlink *link,
                  std::unordered_map<MNM_Path *, int> path_map, TFlt start_time,
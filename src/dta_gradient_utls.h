@@ -29,6 +29,16 @@ struct ltg_record
   TFlt gradient;
 };
 
+// The links of a set of paths in compressed row form: the hops of path i are
+// link_idx[row_ptr[i]] .. link_idx[row_ptr[i + 1] - 1], indices into link_ID.
+struct path_link_csr
+{
+  std::vector<MNM_Path *> paths;
+  std::vector<int> row_ptr;
+  std::vector<int> link_idx;
+  std::vector<TInt> link_ID;
+};
+
 namespace MNM_DTA_GRADIENT
 {
 TFlt get_link_inflow (MNM_Dlink *link, TFlt start_time, TFlt end_time);
@@ -45,11 +55,24 @@ TFlt get_last_valid_time_bus (MNM_Cumulative_Curve *N_in,
 TFlt get_travel_time_from_cc (TFlt start_time, MNM_Cumulative_Curve *N_in,
                               MNM_Cumulative_Curve *N_out, TFlt last_valid_time,
                               TFlt fftt, bool rounding_up = false);
+// the same with the lookups going through cursors, for sweeps of start times
+TFlt get_travel_time_from_cc (TFlt start_time,
+                              MNM_Cumulative_Curve_Cursor *N_in,
+                              MNM_Cumulative_Curve_Cursor *N_out,
+                              TFlt last_valid_time, TFlt fftt,
+                              bool rounding_up = false);
 
 TFlt get_travel_time_from_FD (MNM_Dlink *link, TFlt start_time,
                               TFlt unit_interval);
 TFlt get_travel_time (MNM_Dlink *link, TFlt start_time, TFlt unit_interval,
                       TInt end_loading_timestamp);
+// get_travel_time at each of start_times, written to tt; when the start times
+// do not decrease, e.g. 1, ..., T for the vehicles arriving at the beginning
+// of intervals 0, ..., T - 1, the curves of the link are swept only once
+int get_travel_time_batch (MNM_Dlink *link,
+                           const std::vector<TFlt> &start_times,
+                           TFlt unit_interval, TInt end_loading_timestamp,
+                           TFlt *tt);
 TFlt get_travel_time_robust (MNM_Dlink *link, TFlt start_time, TFlt end_time,
                              TFlt unit_interval, TInt end_loading_timestamp,
                              TInt num_trials = TInt (10));
@@ -57,12 +80,25 @@ TFlt get_path_travel_time (MNM_Path *path, TFlt start_time,
                            MNM_Link_Factory *link_factory, TFlt unit_interval,
                            TInt end_loading_timestamp);
 TFlt get_path_travel_time (MNM_Path *path, TFlt start_time,
-                           std::unordered_map<TInt, TFlt *> &link_tt_map,
-                           TInt end_loading_timestamp);
-TFlt get_path_travel_cost (MNM_Path *path, TFlt start_time,
-                           std::unordered_map<TInt, TFlt *> &link_tt_map,
-                           std::unordered_map<TInt, TFlt *> &link_cost_map,
+                           const std::unordered_map<TInt, TFlt *> &link_tt_map,
                            TInt end_loading_timestamp);
+TFlt get_path_travel_cost (
+  MNM_Path *path, TFlt start_time,
+  const std::unordered_map<TInt, TFlt *> &link_tt_map,
+  const std::unordered_map<TInt, TFlt *> &link_cost_map,
+  TInt end_loading_timestamp);
+int build_path_link_csr (Path_Table *path_table, path_link_csr &csr);
+int build_path_link_csr (const std::vector<MNM_Path *> &paths,
+                         path_link_csr &csr);
+// get_path_travel_time and get_path_travel_cost of every path in csr for every
+// start time, written to tt[i * start_times.size () + k] (and cost, if not
+// null); link_cost_map is only read when cost is requested
+int get_path_travel_time_batch (
+  const path_link_csr &csr, const std::vector<TFlt> &start_times,
+  const std::unordered_map<TInt, TFlt *> &link_tt_map,
+  const std::unordered_map<TInt, TFlt *> &link_cost_map,
+  TInt end_loading_timestamp, std::vector<TFlt> &tt, std::vector<TFlt> *cost,
+  int num_threads = 1);
 
 int add_dar_records (std::vector<dar_record *> &record, MNM_Dlink *link,
                      std::unordered_map<MNM_Path *, int> path_map,
@@ -5,7 +5,9 @@ MNM_Due::MNM_Due (std::string file_folder)
 {
   m_file_folder = file_folder;
   m_dta_config = new MNM_ConfReader (m_file_folder + "/config.conf", "DTA");
-  IAssert (m_dta_config->get_string ("routing_type") == "Due");
+  m_dta_settings.load (m_dta_config);
+  IAssert (m_dta_settings.m_routing_type == MNM_Routing_Type::Due);
+  m_core = MNM_Network_Core::build_from_files (m_file_folder);
   // IAssert(m_dta_config->get_int("total_interval") > 0);
   // IAssert(m_dta_config->get_int("total_interval") >=
   //         m_dta_config->get_int("assign_frq") *
@@ -15,9 +17,9 @@ MNM_Due::MNM_Due (std::string file_folder)
   m_due_config = new MNM_ConfReader (m_file_folder + "/config.conf", "DUE");
   m_total_assign_inter = m_dta_config->get_int ("max_interval");
   if (m_total_loading_inter <= 0)
-    m_total_loading_inter
-      = m_total_assign_inter * m_dta_config->get_int ("assign_frq");
+    m_total_loading_inter = m_total_assign_inter * m_dta_settings.m_assign_frq;
   m_path_table = nullptr;
+  m_profiler = nullptr;
   // m_od_factory = nullptr;
 
   // the unit of m_vot here is different from that of m_vot in adaptive routing
@@ -43,10 +45,7 @@ MNM_Due::MNM_Due (std::string file_folder)
   m_target_time = m_due_config->get_float ("target_time") * 60
                   / m_unit_time; // in terms of number of unit intervals
 
-  m_step_size = m_due_config->get_float ("lambda");    // 0.01;  // MSA
-  m_link_tt_map = std::unordered_map<TInt, TFlt *> (); // time-varying link tt
-  m_link_cost_map
-    = std::unordered_map<TInt, TFlt *> (); // time-varying link cost
+  m_step_size = m_due_config->get_float ("lambda"); // 0.01;  // MSA
 }
 
 // int MNM_Due::init_path_table()
@@ -77,7 +76,9 @@ MNM_Due::~MNM_Due ()
 MNM_Dta *
 MNM_Due::run_dta (bool verbose)
 {
-  MNM_Dta *_dta = new MNM_Dta (m_file_folder);
+  MNM_Phase_Timer _timer (m_profiler, "due_build_dta");
+  MNM_Dta *_dta = new MNM_Dta (m_file_folder, m_core);
+  _dta->m_profiler = m_profiler;
   // printf("dd\n");
   _dta->build_from_files ();
   // _dta -> m_od_factory = m_od_factory;
@@ -100,6 +101,7 @@ MNM_Due::run_dta (bool verbose)
       _link_it->second->install_cumulative_curve ();
     }
 
+  _timer.stop ();
   _dta->pre_loading (); // initiate record file, junction model for node, and
                         // vehicle queue for link
   _dta->loading (verbose);
@@ -150,6 +152,17 @@ MNM_Due::compute_total_demand (MNM_Origin *orig, MNM_Destination *dest,
   return _tot_dmd;
 }
 
+int
+MNM_Due::add_memory_usage (MNM_Memory_Report &report)
+{
+  MNM::add_memory (report, "link_tt_map", m_link_tt_map.get_memory_bytes (),
+                   m_link_tt_map.get_num_rows ());
+  MNM::add_memory (report, "link_cost_map",
+                   m_link_cost_map.get_memory_bytes (),
+                   m_link_cost_map.get_num_rows ());
+  return 0;
+}
+
 TFlt
 MNM_Due::compute_total_travel_time ()
 {
@@ -161,7 +174,7 @@ MNM_Due::compute_total_travel_time ()
         {
           for (int _col = 0; _col < m_total_assign_inter; _col++)
             {
-              _depart_time = TFlt (_col * m_dta_config->get_int ("assign_frq"));
+              _depart_time = TFlt (_col * m_dta_settings.m_assign_frq);
               for (MNM_Path *_path : _it_it.second->m_path_vec)
                 {
                   _tt = get_tt (_depart_time, _path);
@@ -181,6 +194,7 @@ MNM_Due::compute_total_travel_time ()
 TFlt
 MNM_Due::compute_merit_function ()
 {
+  MNM_Phase_Timer _timer (m_profiler, "merit_function");
   TFlt _tt, _depart_time, _dis_utl, _lowest_dis_utl;
   TFlt _total_gap = 0.0;
   for (auto _it : *m_path_table)
@@ -190,7 +204,7 @@ MNM_Due::compute_merit_function ()
           _lowest_dis_utl = DBL_MAX;
           for (int _col = 0; _col < m_total_assign_inter; _col++)
             {
-              _depart_time = TFlt (_col * m_dta_config->get_int ("assign_frq"));
+              _depart_time = TFlt (_col * m_dta_settings.m_assign_frq);
               for (MNM_Path *_path : _it_it.second->m_path_vec)
                 { // get lowest disutility route at time interval _col and
                   // current OD pair
@@ -206,7 +220,7 @@ MNM_Due::compute_merit_function ()
             }
           for (int _col = 0; _col < m_total_assign_inter; _col++)
             {
-              _depart_time = TFlt (_col * m_dta_config->get_int ("assign_frq"));
+              _depart_time = TFlt (_col * m_dta_settings.m_assign_frq);
               for (MNM_Path *_path : _it_it.second->m_path_vec)
                 {
                   // _tt = get_tt(_depart_time, _path);
@@ -227,6 +241,7 @@ MNM_Due::compute_merit_function ()
 TFlt
 MNM_Due::compute_merit_function_fixed_departure_time_choice ()
 {
+  MNM_Phase_Timer _timer (m_profiler, "merit_function");
   TFlt _tt, _depart_time, _dis_utl, _lowest_dis_utl;
   TFlt _total_gap = 0.0;
   TFlt _min_flow_cost = 0.0;
@@ -237,7 +252,7 @@ MNM_Due::compute_merit_function_fixed_departure_time_choice ()
           for (int _col = 0; _col < m_total_assign_inter; _col++)
             {
               _lowest_dis_utl = DBL_MAX;
-              _depart_time = TFlt (_col * m_dta_config->get_int ("assign_frq"));
+              _depart_time = TFlt (_col * m_dta_settings.m_assign_frq);
               for (MNM_Path *_path : _it_it.second->m_path_vec)
                 { // get lowest disutility route at time interval _col and
                   // current OD pair
@@ -309,28 +324,41 @@ MNM_Due::get_tt (TFlt depart_time, MNM_Path *path)
 }
 
 int
-MNM_Due::build_link_cost_map (MNM_Dta *dta)
+MNM_Due::build_link_cost_map (MNM_Dta *dta, bool verbose)
 {
+  MNM_Phase_Timer _timer (m_profiler, "build_link_cost_map");
   IAssert (m_total_loading_inter <= dta->m_current_loading_interval);
-  MNM_Dlink *_link;
+  std::vector<MNM_Dlink *> _links;
   for (auto _link_it : dta->m_link_factory->m_link_map)
-    {
-      std::cout << "********************** link " << _link_it.first
-                << " **********************\n";
+    _links.push_back (_link_it.second);
+  // use i+1 as start_time in cc to compute link travel time for vehicles
+  // arriving at the beginning of interval i, i+1 is the end of the interval i,
+  // the beginning of interval i + 1
+  std::vector<TFlt> _start_times;
+  for (int i = 0; i < m_total_loading_inter; i++)
+    _start_times.push_back (TFlt (i + 1));
+  // the links are independent, each job only writes the rows of its link
+  MNM::fill_link_rows (
+    _links.size (), int (m_dta_settings.m_num_threads), verbose,
+    "build_link_cost_map", [&] (size_t k) {
+      MNM_Dlink *_link = _links[k];
+      TFlt *_tt = m_link_tt_map[_link->m_link_ID];
+      TFlt *_cost = m_link_cost_map[_link->m_link_ID];
+      MNM_DTA_GRADIENT::
+        get_travel_time_batch (_link, _start_times, m_unit_time,
+                               dta->m_current_loading_interval,
+                               _tt); // intervals
       for (int i = 0; i < m_total_loading_inter; i++)
-        {
-          _link = _link_it.second;
-          // use i+1 as start_time in cc to compute link travel time for
-          // vehicles arriving at the beginning of interval i, i+1 is the end of
-          // the interval i, the beginning of interval i + 1
-          m_link_tt_map[_link_it.first][i] = MNM_DTA_GRADIENT::
-            get_travel_time (_link, TFlt (i + 1), m_unit_time,
-                             dta->m_current_loading_interval); // intervals
-          m_link_cost_map[_link_it.first][i]
-            = m_vot * m_link_tt_map[_link_it.first][i] + _link->m_toll;
-          // std::cout << "interval: " << i << ", link: " << _link_it.first <<
-          // ", tt: " << m_link_cost_map[_link_it.first][i] << "\n";
-        }
+        _cost[i] = m_vot * _tt[i] + _link->m_toll;
+    });
+  if (dta->m_workzone != nullptr)
+    {
+      // a closed link costs as much as a jammed one, the toll is irrelevant
+      TFlt _tt_penalty = MNM_Ults::max_link_cost () / m_unit_time; // intervals
+      dta->m_workzone->mask_link_cost (m_link_tt_map, m_total_loading_inter,
+                                       _tt_penalty);
+      dta->m_workzone->mask_link_cost (m_link_cost_map, m_total_loading_inter,
+                                       m_vot * _tt_penalty);
     }
   return 0;
 }
@@ -338,19 +366,40 @@ MNM_Due::build_link_cost_map (MNM_Dta *dta)
 int
 MNM_Due::update_path_table_cost (MNM_Dta *dta)
 {
-  TInt _o_node_ID, _d_node_ID;
-  // #pragma omp parallel num_threads(20)
-  for (auto _o_it : *m_path_table)
+  // same as update_one_path_cost on every path, but all paths and departure
+  // intervals are evaluated in one batch over dense link travel times
+  MNM_Phase_Timer _timer (m_profiler, "path_cost");
+  path_link_csr _csr;
+  MNM_DTA_GRADIENT::build_path_link_csr (m_path_table, _csr);
+
+  TInt _assign_freq = m_dta_settings.m_assign_frq;
+  std::vector<TFlt> _depart_times;
+  for (int _col = 0; _col < m_total_assign_inter; _col++)
     {
-      _o_node_ID = _o_it.first;
-      for (auto _d_it : *(_o_it.second))
+      _depart_times.push_back (TFlt (_col * _assign_freq));
+    }
+
+  std::vector<TFlt> _tt;
+  MNM_DTA_GRADIENT::
+    get_path_travel_time_batch (_csr, _depart_times, m_link_tt_map,
+                                m_link_cost_map, m_total_loading_inter, _tt,
+                                nullptr,
+                                int (m_dta_settings.m_num_threads));
+
+  MNM_Path *_path;
+  TFlt _travel_time;
+  for (size_t i = 0; i < _csr.paths.size (); ++i)
+    {
+      _path = _csr.paths[i];
+      _path->m_travel_time_vec.clear ();
+      _path->m_travel_disutility_vec.clear ();
+      for (int _col = 0; _col < m_total_assign_inter; _col++)
         {
-          _d_node_ID = _d_it.first;
-          for (auto _path : _d_it.second->m_path_vec)
-            {
-              update_one_path_cost (_path, _o_node_ID, _d_node_ID, dta);
-              printf ("update_one_path_cost\n");
-            }
+          _travel_time = _tt[i * _depart_times.size () + _col]; // intervals
+          _path->m_travel_disutility_vec.push_back (
+            get_disutility (_depart_times[_col], _travel_time));
+          _path->m_travel_time_vec.push_back (_travel_time
+                                              * m_unit_time); // seconds
         }
     }
   printf ("Finish update path table cost\n");
@@ -369,7 +418,7 @@ MNM_Due::update_one_path_cost (MNM_Path *path, TInt o_node_ID, TInt d_node_ID,
   path->m_travel_disutility_vec.clear ();
   for (int _col = 0; _col < m_total_assign_inter; _col++)
     {
-      _depart_time = _col * m_dta_config->get_int ("assign_frq");
+      _depart_time = _col * m_dta_settings.m_assign_frq;
 
       _travel_time = get_tt (TFlt (_depart_time), path); // intervals
       // _travel_cost = _travel_time * m_vot;
@@ -394,25 +443,12 @@ MNM_Due_Msa::MNM_Due_Msa (std::string file_folder)
   m_base_dta = nullptr;
 }
 
-MNM_Due_Msa::~MNM_Due_Msa ()
-{
-  for (auto _tt_it : m_link_tt_map)
-    {
-      delete _tt_it.second;
-    }
-  m_link_tt_map.clear ();
-  for (auto _cost_it : m_link_cost_map)
-    {
-      delete _cost_it.second;
-    }
-  m_link_cost_map.clear ();
-  delete m_base_dta;
-}
+MNM_Due_Msa::~MNM_Due_Msa () { delete m_base_dta; }
 
 int
 MNM_Due_Msa::initialize ()
 {
-  m_base_dta = new MNM_Dta (m_file_folder);
+  m_base_dta = new MNM_Dta (m_file_folder, m_core);
   m_base_dta->build_from_files ();
 
   // build shortest path for each OD pair, no matter it is in demand or not
@@ -429,11 +465,11 @@ MNM_Due_Msa::initialize ()
                           1, 1, m_total_assign_inter);
   // MNM::save_path_table(m_path_table, m_base_dta -> m_od_factory, true);
 
+  std::vector<TInt> _link_IDs;
   for (auto _link_it : m_base_dta->m_link_factory->m_link_map)
-    {
-      m_link_tt_map[_link_it.first] = new TFlt[m_total_loading_inter];
-      m_link_cost_map[_link_it.first] = new TFlt[m_total_loading_inter];
-    }
+    _link_IDs.push_back (_link_it.first);
+  m_link_tt_map.reset (_link_IDs, m_total_loading_inter);
+  m_link_cost_map.reset (_link_IDs, m_total_loading_inter);
 
   // printf("%d, %d\n", m_od_factory -> m_origin_map.size(), m_od_factory ->
   // m_destination_map.size());
@@ -517,7 +553,7 @@ std::pair<MNM_Path *, TInt>
 MNM_Due_Msa::get_best_route_for_single_interval (TInt interval, TInt o_node_ID,
                                                  MNM_TDSP_Tree *tdsp_tree)
 {
-  IAssert (interval + m_dta_config->get_int ("assign_frq")
+  IAssert (interval + m_dta_settings.m_assign_frq
            <= tdsp_tree->m_max_interval); // tdsp_tree -> m_max_interval =
                                           // total_loading_interval
   TFlt _cur_best_cost = TFlt (std::numeric_limits<double>::max ());
@@ -563,16 +599,19 @@ MNM_Due_Msa::update_path_table (MNM_Dta *dta, int iter)
 
   // assume build_link_cost_map(dta) and update_path_table_cost(dta) are invoked
   // beforehand
+  MNM_Phase_Timer _timer (m_profiler);
   for (auto _it : dta->m_od_factory->m_destination_map)
     {
       _dest = _it.second;
       _dest_node_ID = _dest->m_dest_node->m_node_ID;
+      _timer.start ("tdsp");
       MNM_TDSP_Tree *_tdsp_tree
         = new MNM_TDSP_Tree (_dest_node_ID, dta->m_graph,
                              m_total_loading_inter);
       _tdsp_tree->initialize ();
       // printf("111\n");
       _tdsp_tree->update_tree (m_link_cost_map, m_link_tt_map);
+      _timer.start ("path_update");
       for (auto _map_it : dta->m_od_factory->m_origin_map)
         {
           _orig = _map_it.second;
@@ -588,7 +627,7 @@ MNM_Due_Msa::update_path_table (MNM_Dta *dta, int iter)
           _path = _path_result.first;
           _best_time_col = int (_path_result.second);
           _best_assign_col
-            = floor (_best_time_col / m_dta_config->get_int ("assign_frq"));
+            = floor (_best_time_col / m_dta_settings.m_assign_frq);
           if (_best_assign_col >= m_total_assign_inter)
             _best_assign_col = m_total_assign_inter - 1;
           // printf("Best time col %d\n", _best_time_col);
@@ -654,7 +693,7 @@ MNM_Due_Msa::update_path_table (MNM_Dta *dta, int iter)
                   tmp_path->m_buffer[_best_assign_col]
                     -= m_step_size / TFlt (iter + 1) / _len;
                 }
-              _path_set->m_path_vec.push_back (_path);
+              _path_set->add_path (_path);
 
               // Modified by Zou
               //                _path->allocate_buffer(m_total_assign_inter);
@@ -707,16 +746,19 @@ MNM_Due_Msa::update_path_table_fixed_departure_time_choice (MNM_Dta *dta,
 
   // assume build_link_cost_map(dta) and update_path_table_cost(dta) are invoked
   // beforehand
+  MNM_Phase_Timer _timer (m_profiler);
   for (auto _it : dta->m_od_factory->m_destination_map)
     {
       _dest = _it.second;
       _dest_node_ID = _dest->m_dest_node->m_node_ID;
 
+      _timer.start ("tdsp");
       MNM_TDSP_Tree *_tdsp_tree
         = new MNM_TDSP_Tree (_dest_node_ID, dta->m_graph,
                              m_total_loading_inter);
       _tdsp_tree->initialize ();
       _tdsp_tree->update_tree (m_link_cost_map, m_link_tt_map);
+      _timer.start ("path_update");
 
       for (auto _map_it : dta->m_od_factory->m_origin_map)
         {
@@ -759,7 +801,7 @@ MNM_Due_Msa::update_path_table_fixed_departure_time_choice (MNM_Dta *dta,
                   // update_one_path_cost(_path, _orig_node_ID, _dest_node_ID,
                   // dta);
                   _path->allocate_buffer (m_total_assign_inter);
-                  _path_set->m_path_vec.push_back (_path);
+                  _path_set->add_path (_path);
                   _exist = false;
                 }
 
@@ -809,16 +851,19 @@ MNM_Due_Msa::update_path_table_gp_fixed_departure_time_choice (MNM_Dta *dta,
 
   // assume build_link_cost_map(dta) and update_path_table_cost(dta) are invoked
   // beforehand
+  MNM_Phase_Timer _timer (m_profiler);
   for (auto _it : dta->m_od_factory->m_destination_map)
     {
       _dest = _it.second;
       _dest_node_ID = _dest->m_dest_node->m_node_ID;
 
+      _timer.start ("tdsp");
       MNM_TDSP_Tree *_tdsp_tree
         = new MNM_TDSP_Tree (_dest_node_ID, dta->m_graph,
                              m_total_loading_inter);
       _tdsp_tree->initialize ();
       _tdsp_tree->update_tree (m_link_cost_map, m_link_tt_map);
+      _timer.start ("path_update");
 
       for (auto _map_it : dta->m_od_factory->m_origin_map)
         {
@@ -864,7 +909,7 @@ MNM_Due_Msa::update_path_table_gp_fixed_departure_time_choice (MNM_Dta *dta,
                   update_one_path_cost (_path, _orig_node_ID, _dest_node_ID,
                                         dta);
                   _path->allocate_buffer (m_total_assign_inter);
-                  _path_set->m_path_vec.push_back (_path);
+                  _path_set->add_path (_path);
                   _exist = false;
                 }
 
@@ -3,6 +3,7 @@
 #include "dta.h"
 #include "dta_gradient_utls.h"
 #include "limits.h"
+#include "link_matrix.h"
 #include "path.h"
 #include "realtime_dta.h"
 
@@ -43,7 +44,8 @@ public:
 
   TFlt get_tt (TFlt depart_time, MNM_Path *path);
 
-  virtual int build_link_cost_map (MNM_Dta *dta);
+  // with verbose, prints how many links are done
+  virtual int build_link_cost_map (MNM_Dta *dta, bool verbose = false);
 
   int update_path_table_cost (MNM_Dta *dta);
 
@@ -55,13 +57,21 @@ public:
   TFlt compute_total_demand (MNM_Origin *orig, MNM_Destination *dest,
                              TInt total_assign_inter);
 
+  // the link travel time and cost maps, the path table is counted by the
+  // routing of the DTA it is handed to
+  int add_memory_usage (MNM_Memory_Report &report);
+
   std::string m_file_folder;
+  // network shared by the DTA runs of all iterations
+  std::shared_ptr<const MNM_Network_Core> m_core;
   TFlt m_unit_time;
   TInt m_total_loading_inter;
   Path_Table *m_path_table;
   // MNM_OD_Factory *m_od_factory;
   TInt m_total_assign_inter;
   MNM_ConfReader *m_dta_config;
+  // the keys of m_dta_config read in the path table updates
+  MNM_Dta_Settings m_dta_settings;
   MNM_ConfReader *m_due_config;
 
   TFlt m_vot;
@@ -70,8 +80,13 @@ public:
   TFlt m_target_time;
   TFlt m_step_size;
 
-  std::unordered_map<TInt, TFlt *> m_link_tt_map;
-  std::unordered_map<TInt, TFlt *> m_link_cost_map;
+  // time-varying link tt and cost, in intervals, a row for each link
+  MNM_Link_Matrix<TFlt> m_link_tt_map;
+  MNM_Link_Matrix<TFlt> m_link_cost_map;
+
+  // not owned, times the steps of the iterations and is handed to the DTA
+  // runs if set
+  MNM_Profiler *m_profiler;
 };
 
 class MNM_Due_Msa : public MNM_Due
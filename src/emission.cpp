@@ -18,27 +18,110 @@ MNM_Cumulative_Emission::MNM_Cumulative_Emission (TFlt unit_time, TInt freq,
   m_ev_label = ev_label;
 }
 
-MNM_Cumulative_Emission::~MNM_Cumulative_Emission () { m_link_vector.clear (); }
+MNM_Cumulative_Emission::~MNM_Cumulative_Emission ()
+{
+  // the links outlive the emission object in MNM_Dta
+  for (MNM_Dlink *link : m_link_vector)
+    {
+      if (link->m_emission == this)
+        link->m_emission = nullptr;
+    }
+  m_link_vector.clear ();
+}
 
 int
 MNM_Cumulative_Emission::register_link (MNM_Dlink *link)
 {
   m_link_vector.push_back (link);
   m_link_set.insert (link);
+  link->m_emission = this;
   return 0;
 }
 
-TFlt
-MNM_Cumulative_Emission::calculate_fuel_rate (TFlt v)
+// The polynomials are kept in Horner form, shared by the scalar and the
+// batched rate functions so that both give the same numbers.
+static inline TFlt
+fuel_rate_poly (TFlt v)
 {
   TFlt _fule_eco
-    = 1.19102380 * 1e-07 * pow (v, 5) - 2.67383161 * 1e-05 * pow (v, 4)
-      + 2.35409750 * 1e-03 * pow (v, 3) - 1.11752399 * 1e-01 * pow (v, 2)
-      + 2.96137050 * pow (v, 1) - 1.51623933;
-  // printf("fuel rate is %lf\n", 1.0/_fule_eco());
+    = ((((1.19102380e-07 * v - 2.67383161e-05) * v + 2.35409750e-03) * v
+        - 1.11752399e-01)
+         * v
+       + 2.96137050)
+        * v
+      - 1.51623933;
   return std::max (TFlt (1) / _fule_eco, TFlt (0));
 }
 
+static inline TFlt
+HC_rate_poly (TFlt v)
+{
+  TFlt _HC_rate
+    = (((((((1.61479076909784e-13 * v - 1.27884474982285e-10) * v
+            + 2.92924270300974e-8)
+             * v
+           - 3.23670086149171e-6)
+            * v
+          + 0.000201135990745703)
+           * v
+         - 0.00737871178398462)
+          * v
+        + 0.15792241257931)
+         * v
+       - 1.82687242201925)
+        * v
+      + 9.84559996919605;
+  return std::max (_HC_rate, TFlt (0));
+}
+
+static inline TFlt
+CO_rate_poly (TFlt v)
+{
+  TFlt _CO_rate
+    = (((((((-1.08317411174986e-12 * v + 2.53340626614398e-10) * v
+            - 2.12944112670644e-8)
+             * v
+           + 5.97070024385679e-7)
+            * v
+          + 1.79281854904105e-5)
+           * v
+         - 0.00170366500109581)
+          * v
+        + 0.047711166912908)
+         * v
+       - 0.615061016205463)
+        * v
+      + 4.12900319568868;
+  return std::max (_CO_rate, TFlt (0));
+}
+
+static inline TFlt
+NOX_rate_poly (TFlt v)
+{
+  TFlt _NOX_rate
+    = (((((((-6.52009367269462e-13 * v + 1.25335312366681e-10) * v
+            - 4.67202313364846e-9)
+             * v
+           - 6.63892272105462e-7)
+            * v
+          + 8.01942113220463e-5)
+           * v
+         - 0.00374632777368871)
+          * v
+        + 0.0895029037098895)
+         * v
+       - 1.07265851515536)
+        * v
+      + 6.06514023873933;
+  return std::max (_NOX_rate, TFlt (0));
+}
+
+TFlt
+MNM_Cumulative_Emission::calculate_fuel_rate (TFlt v)
+{
+  return fuel_rate_poly (v);
+}
+
 // TFlt MNM_Cumulative_Emission:: calculate_fuel_rate_deprecated(TFlt v)
 // {
 //   TFlt _fule_eco = -1.47718733159777 * 1e-13 * pow(v, 10)
@@ -73,44 +156,65 @@ MNM_Cumulative_Emission::calculate_CO2_rate (TFlt v)
 TFlt
 MNM_Cumulative_Emission::calculate_HC_rate (TFlt v)
 {
-  TFlt _HC_rate
-    = 1.61479076909784e-13 * pow (v, 8.0) - 1.27884474982285e-10 * pow (v, 7.0)
-      + 2.92924270300974e-8 * pow (v, 6.0) - 3.23670086149171e-6 * pow (v, 5.0)
-      + 0.000201135990745703 * pow (v, 4.0) - 0.00737871178398462 * pow (v, 3.0)
-      + 0.15792241257931 * pow (v, 2.0) - 1.82687242201925 * v
-      + 9.84559996919605;
-  // printf("HC rate is %lf\n", _HC_rate());
-  return std::max (_HC_rate, TFlt (0));
+  return HC_rate_poly (v);
 }
 
 TFlt
 MNM_Cumulative_Emission::calculate_CO_rate (TFlt v)
 {
-  TFlt _CO_rate = -1.08317411174986 * 1e-12 * pow (v, 8)
-                  + 2.53340626614398 * 1e-10 * pow (v, 7)
-                  - 2.12944112670644 * 1e-8 * pow (v, 6)
-                  + 5.97070024385679 * 1e-7 * pow (v, 5)
-                  + 1.79281854904105 * 1e-5 * pow (v, 4)
-                  - 0.00170366500109581 * pow (v, 3)
-                  + 0.047711166912908 * pow (v, 2) - 0.615061016205463 * v
-                  + 4.12900319568868;
-  // printf("CO rate is %lf\n", _CO_rate());
-  return std::max (_CO_rate, TFlt (0));
+  return CO_rate_poly (v);
 }
 
 TFlt
 MNM_Cumulative_Emission::calculate_NOX_rate (TFlt v)
 {
-  TFlt _NOX_rate = -6.52009367269462 * 1e-13 * pow (v, 8)
-                   + 1.25335312366681 * 1e-10 * pow (v, 7)
-                   - 4.67202313364846 * 1e-9 * pow (v, 6)
-                   - 6.63892272105462 * 1e-7 * pow (v, 5)
-                   + 8.01942113220463 * 1e-5 * pow (v, 4)
-                   - 0.00374632777368871 * pow (v, 3)
-                   + 0.0895029037098895 * pow (v, 2) - 1.07265851515536 * v
-                   + 6.06514023873933;
-  // printf("NOX rate is %lf\n", _NOX_rate());
-  return std::max (_NOX_rate, TFlt (0));
+  return NOX_rate_poly (v);
+}
+
+void
+MNM_Cumulative_Emission::calculate_rates (size_t n, const TFlt *v,
+                                          TFlt *fuel, TFlt *CO2, TFlt *HC,
+                                          TFlt *CO, TFlt *NOX)
+{
+  // one loop per pollutant keeps each body branch free
+  for (size_t i = 0; i < n; ++i)
+    fuel[i] = fuel_rate_poly (v[i]);
+  for (size_t i = 0; i < n; ++i)
+    CO2[i] = std::max (fuel[i] * TFlt (8887), TFlt (0));
+  for (size_t i = 0; i < n; ++i)
+    HC[i] = HC_rate_poly (v[i]);
+  for (size_t i = 0; i < n; ++i)
+    CO[i] = CO_rate_poly (v[i]);
+  for (size_t i = 0; i < n; ++i)
+    NOX[i] = NOX_rate_poly (v[i]);
+}
+
+void
+MNM_Cumulative_Emission::update_link_rates ()
+{
+  size_t _num_link = m_link_vector.size ();
+  m_dist.resize (_num_link);
+  m_speed.resize (_num_link);
+  m_fuel_rate.resize (_num_link);
+  m_CO2_rate.resize (_num_link);
+  m_HC_rate.resize (_num_link);
+  m_CO_rate.resize (_num_link);
+  m_NOX_rate.resize (_num_link);
+
+  TFlt _v;
+  for (size_t i = 0; i < _num_link; ++i)
+    {
+      MNM_Dlink *_link = m_link_vector[i];
+      _v = _link->m_length / _link->get_link_tt (); // m/s
+      m_dist[i] = _v * m_unit_time / TFlt (1600);
+      m_speed[i] = _v * TFlt (3600) / TFlt (1600); // mile / hour
+    }
+  for (size_t i = 0; i < _num_link; ++i)
+    m_speed[i] = std::min (std::max (m_speed[i], TFlt (5)), TFlt (65));
+
+  calculate_rates (_num_link, m_speed.data (), m_fuel_rate.data (),
+                   m_CO2_rate.data (), m_HC_rate.data (), m_CO_rate.data (),
+                   m_NOX_rate.data ());
 }
 
 int
@@ -119,36 +223,24 @@ MNM_Cumulative_Emission::update (MNM_Veh_Factory *veh_factory)
   // printf("CO2 is %lf, HC is %lf\n",m_CO2(), m_HC());
   m_counter += 1;
   // printf("ce counter is now %d\n", m_counter());
-  TFlt _v, _nonev_ct, _ev_ct;
-  TFlt _v_converted;
+  update_link_rates ();
+
+  TFlt _nonev_ct, _ev_ct;
   std::vector<TFlt> _veh_ct;
-  for (MNM_Dlink *link : m_link_vector)
+  for (size_t i = 0; i < m_link_vector.size (); ++i)
     {
-      _v = link->m_length / link->get_link_tt ();    // m/s
-      _v_converted = _v * TFlt (3600) / TFlt (1600); // mile / hour
-      _v_converted = std::max (_v_converted, TFlt (5));
-      _v_converted = std::min (_v_converted, TFlt (65));
-      _veh_ct = link->get_link_flow_emission (
+      _veh_ct = m_link_vector[i]->get_link_flow_emission (
         m_ev_label); // already divided by flow_scalar
       IAssert (_veh_ct.size () == 2);
       _nonev_ct = _veh_ct[0];
       _ev_ct = _veh_ct[1];
-      m_fuel += calculate_fuel_rate (_v_converted)
-                * (_v * m_unit_time / TFlt (1600)) * _nonev_ct;
-      m_CO2 += calculate_CO2_rate (_v_converted)
-               * (_v * m_unit_time / TFlt (1600)) * _nonev_ct;
-      m_HC += calculate_HC_rate (_v_converted)
-              * (_v * m_unit_time / TFlt (1600)) * _nonev_ct;
-      m_CO += calculate_CO_rate (_v_converted)
-              * (_v * m_unit_time / TFlt (1600)) * _nonev_ct;
-      m_NOX += calculate_NOX_rate (_v_converted)
-               * (_v * m_unit_time / TFlt (1600)) * _nonev_ct;
-      m_VMT += (_v * m_unit_time / TFlt (1600)) * (_nonev_ct + _ev_ct);
-      m_VMT_ev += (_v * m_unit_time / TFlt (1600)) * _ev_ct;
-      // printf("link ID is %d, flow is :%lf, _v is %lf, CO2 is %lf, HC is
-      // %lf\n",
-      //       (link -> m_link_ID)(), link -> get_link_flow()(), _v(), m_CO2(),
-      //       m_HC());
+      m_fuel += m_fuel_rate[i] * m_dist[i] * _nonev_ct;
+      m_CO2 += m_CO2_rate[i] * m_dist[i] * _nonev_ct;
+      m_HC += m_HC_rate[i] * m_dist[i] * _nonev_ct;
+      m_CO += m_CO_rate[i] * m_dist[i] * _nonev_ct;
+      m_NOX += m_NOX_rate[i] * m_dist[i] * _nonev_ct;
+      m_VMT += m_dist[i] * (_nonev_ct + _ev_ct);
+      m_VMT_ev += m_dist[i] * _ev_ct;
     }
   // printf("%lf, %lf, %lf, %lf, %lf\n", m_fuel(), m_CO2(), m_HC(), m_CO(),
   // m_NOX()); printf("m_counter is %d and freq is %d\n", m_counter(),
@@ -17,6 +17,9 @@ public:
   std::unordered_set<MNM_Dlink *> m_link_set;
 
   int register_link (MNM_Dlink *link);
+  // called by MNM_Veh::set_current_link whenever a vehicle enters a
+  // registered link
+  virtual int register_trip (MNM_Veh *veh) { return 0; };
   // v should be in mile/hour
   TFlt calculate_fuel_rate (TFlt v);
   TFlt calculate_fuel_rate_deprecated (TFlt v);
@@ -25,6 +28,10 @@ public:
   TFlt calculate_HC_rate (TFlt v);
   TFlt calculate_CO_rate (TFlt v);
   TFlt calculate_NOX_rate (TFlt v);
+  // the five rates above for n speeds at once (mile/hour), written as plain
+  // loops over arrays so that the compiler can vectorize them
+  static void calculate_rates (size_t n, const TFlt *v, TFlt *fuel, TFlt *CO2,
+                               TFlt *HC, TFlt *CO, TFlt *NOX);
 
   virtual int update (MNM_Veh_Factory *veh_factory);
   virtual std::string output ();
@@ -40,4 +47,18 @@ public:
   TFlt m_VMT;
   TFlt m_VMT_ev;
   TInt m_ev_label;
+
+protected:
+  // fill m_dist and m_speed (clamped to 5-65 mile/hour) for every registered
+  // link and evaluate the rates at those speeds
+  void update_link_rates ();
+
+  // per registered link, indexed as m_link_vector
+  std::vector<TFlt> m_dist; // miles driven by one vehicle in one unit time
+  std::vector<TFlt> m_speed;
+  std::vector<TFlt> m_fuel_rate;
+  std::vector<TFlt> m_CO2_rate;
+  std::vector<TFlt> m_HC_rate;
+  std::vector<TFlt> m_CO_rate;
+  std::vector<TFlt> m_NOX_rate;
 };
@@ -139,11 +139,7 @@ MNM_Veh_Factory_EV::make_veh_electrified (TInt timestamp, Vehicle_type veh_type,
     = new MNM_Veh_Electrified (m_num_veh + 1, timestamp, starting_range,
                                using_roadside_charging, full_range);
   _veh->m_type = veh_type;
-  m_veh_map.insert (std::pair<TInt, MNM_Veh *> (m_num_veh + 1, _veh));
-  m_num_veh += 1;
-  m_enroute += 1;
-  m_veh_electrified += 1;
-  m_veh_non_roadside_charging += (!using_roadside_charging);
+  add_veh (_veh);
   return _veh;
 }
 
@@ -161,15 +157,22 @@ MNM_Veh_Factory_EV::make_veh_electrified_delivery (TInt timestamp,
                                         starting_range, using_roadside_charging,
                                         full_range);
   _veh->m_type = veh_type;
-  m_veh_map.insert (std::pair<TInt, MNM_Veh *> (m_num_veh + 1, _veh));
-  m_num_veh += 1;
-  m_enroute += 1;
-  m_veh_delivery += 1;
-  m_veh_electrified += 1;
-  m_veh_non_roadside_charging += (!using_roadside_charging);
+  add_veh (_veh);
   return _veh;
 }
 
+int
+MNM_Veh_Factory_EV::count_new_veh (MNM_Veh *veh)
+{
+  MNM_Veh_Factory_Delivery::count_new_veh (veh);
+  if (auto *_veh = dynamic_cast<MNM_Veh_Electrified *> (veh))
+    {
+      m_veh_electrified += 1;
+      m_veh_non_roadside_charging += (!_veh->m_using_roadside_charging);
+    }
+  return 0;
+}
+
 int
 MNM_Veh_Factory_EV::set_ev_range (TFlt EV_starting_range_roadside_charging,
                                   TFlt EV_starting_range_non_roadside_charging,
@@ -373,8 +376,8 @@ MNM_Origin_EV::release_one_interval (TInt current_interval,
         }
     }
 
-  std::random_shuffle (m_origin_node->m_in_veh_queue.begin (),
-                       m_origin_node->m_in_veh_queue.end ());
+  MNM_Ults::random_shuffle (m_origin_node->m_in_veh_queue.begin (),
+                            m_origin_node->m_in_veh_queue.end ());
   return 0;
 }
 
@@ -757,7 +760,7 @@ MNM_Node_Factory_EV::make_charging_station (TInt ID, TFlt flow_scalar,
 //#################################################################
 
 MNM_Routing_Adaptive_With_POIs::MNM_Routing_Adaptive_With_POIs (
-  const std::string &file_folder, macposts::Graph &graph,
+  const std::string &file_folder, const macposts::Graph &graph,
   MNM_Statistics *statistics, MNM_OD_Factory *od_factory,
   MNM_Node_Factory *node_factory, MNM_Link_Factory *link_factory,
   OD_Candidate_POI_Table *od_candidate_poi_table)
@@ -768,6 +771,8 @@ MNM_Routing_Adaptive_With_POIs::MNM_Routing_Adaptive_With_POIs (
   // hopefully this will not route non-EV to charging station since extra delay
   // is added at charging station
   get_POIs ();
+  // update_best_POI reads the labels of the destination trees
+  m_keep_dist_table = true;
   m_od_candidate_poi_table = od_candidate_poi_table;
   if (m_od_candidate_poi_table->empty ())
     {
@@ -1008,6 +1013,12 @@ MNM_Routing_Adaptive_With_POIs::init_routing (Path_Table *path_table)
         std::pair<MNM_Dnode *,
                   std::unordered_map<TInt, TInt> *> (_it, _shortest_path_tree));
     }
+  m_POI_index.clear ();
+  for (size_t i = 0; i < m_mid_POIs.size (); ++i)
+    {
+      m_POI_index.insert (std::pair<MNM_Dnode *, size_t> (m_mid_POIs[i], i));
+    }
+  m_POI_active.assign (m_mid_POIs.size (), false);
   return 0;
 }
 
@@ -1082,39 +1093,13 @@ MNM_Routing_Adaptive_With_POIs::update_routing (TInt timestamp)
 {
   // relying on m_statistics -> m_record_interval_tt, which is obtained in
   // simulation, not after simulation link::get_link_tt(), based on density
-  MNM_Destination *_dest;
-  TInt _dest_node_ID;
   std::unordered_map<TInt, TInt> *_shortest_path_tree;
   // update m_table
   if ((timestamp) % m_routing_freq == 0 || timestamp == 0)
     {
       // printf("Calculating the shortest path trees!\n");
-      update_link_cost ();
-      for (auto _it = m_od_factory->m_destination_map.begin ();
-           _it != m_od_factory->m_destination_map.end (); _it++)
-        {
-          // #pragma omp task firstprivate(_it)
-          // {
-          _dest = _it->second;
-          _dest_node_ID = _dest->m_dest_node->m_node_ID;
-          // printf("Destination ID: %d\n", (int) _dest_node_ID);
-          _shortest_path_tree = m_table->find (_dest)->second;
-          MNM_Shortest_Path::all_to_one_FIFO (_dest_node_ID, m_graph,
-                                              m_link_cost,
-                                              *_shortest_path_tree);
-          // MNM_Shortest_Path::all_to_one_FIFO(_dest_node_ID, m_graph,
-          // m_statistics -> m_record_interval_tt, *_shortest_path_tree);
-          // MNM_Shortest_Path::all_to_one_Dijkstra(_dest_node_ID, m_graph,
-          // m_statistics -> m_record_interval_tt, *_shortest_path_tree);
-          // }
-        }
-      for (auto _it : m_mid_POIs)
-        {
-          _shortest_path_tree = m_table_POIs->find (_it)->second;
-          MNM_Shortest_Path::all_to_one_FIFO (_it->m_node_ID, m_graph,
-                                              m_link_cost,
-                                              *_shortest_path_tree);
-        }
+      update_shortest_path_trees ();
+      // also brings the POI trees up to date
       update_best_POI ();
       // update_best_POI2();
     }
@@ -1297,7 +1282,7 @@ MNM_Routing_Adaptive_With_POIs::update_routing (TInt timestamp)
                           printf ("MNM_Routing_Adaptive_With_POIs::update_"
                                   "routing, Assign randomly a next link!\n");
                           auto &&it = outs.begin ();
-                          int idx = MNM_Ults::mod (rand (), deg);
+                          int idx = MNM_Ults::rand_int (deg);
                           while (idx--)
                             it++;
                           _next_link_ID = m_graph.get_id (*it);
@@ -1396,66 +1381,114 @@ MNM_Routing_Adaptive_With_POIs::update_routing (TInt timestamp)
   return 0;
 }
 
+int
+MNM_Routing_Adaptive_With_POIs::update_POI_trees (bool all_POIs)
+{
+  MNM_Dnode *_node;
+  for (size_t i = 0; i < m_mid_POIs.size (); ++i)
+    {
+      if (!all_POIs && !m_POI_active[i])
+        continue;
+      _node = m_mid_POIs[i];
+      MNM_Shortest_Path::all_to_one_FIFO (_node->m_node_ID, m_graph,
+                                          m_dist_table_POIs[_node],
+                                          m_link_cost,
+                                          *(m_table_POIs->find (_node)->second));
+    }
+  return 0;
+}
+
 int
 MNM_Routing_Adaptive_With_POIs::update_best_POI ()
 {
+  // The cost of going through a POI is the label of the origin in the POI
+  // tree plus the label of the POI in the destination tree. The labels to
+  // the POIs either come from the trees to all POIs, or from one forward
+  // search out of each origin when that takes fewer searches, in which case
+  // only the trees to the POIs ever chosen are built afterwards.
+  size_t _num_active
+    = std::count (m_POI_active.begin (), m_POI_active.end (), true);
+  bool _from_origins
+    = m_od_candidate_poi_table->size () + _num_active < m_mid_POIs.size ();
+  if (!_from_origins)
+    update_POI_trees (true);
+
   MNM_Origin *_origin;
   MNM_Destination *_dest;
-  std::unordered_map<TInt, TInt> *_shortest_path_tree;
-  MNM_Path *_path;
-  TFlt _path_cost, _current_best_path_cost;
+  TInt _origin_node_ID;
+  std::unordered_map<TInt, TFlt> _dist_from_origin;
+  std::vector<TFlt> _origin_to_POI (m_mid_POIs.size ());
+  std::vector<TFlt> _cost;
+  size_t _best_idx;
+  TFlt _best_cost;
   MNM_Dnode *_current_best_poi_node;
   for (auto _it : *m_od_candidate_poi_table)
     {
       _origin = _it.first;
+      _origin_node_ID = _origin->m_origin_node->m_node_ID;
+      if (_from_origins)
+        {
+          MNM_Shortest_Path::one_to_all_FIFO (_origin_node_ID, m_graph,
+                                              _dist_from_origin, m_link_cost);
+          for (size_t i = 0; i < m_mid_POIs.size (); ++i)
+            _origin_to_POI[i]
+              = _dist_from_origin.find (m_mid_POIs[i]->m_node_ID)->second;
+        }
+      else
+        {
+          for (size_t i = 0; i < m_mid_POIs.size (); ++i)
+            _origin_to_POI[i] = m_dist_table_POIs.find (m_mid_POIs[i])
+                                  ->second.find (_origin_node_ID)
+                                  ->second;
+        }
+
       for (auto _it_it : *(_it.second))
         {
           _dest = _it_it.first;
-          _current_best_poi_node = nullptr;
-          if (_it_it.second->empty ())
+          const std::vector<MNM_Dnode *> &_candidates = *(_it_it.second);
+          const std::unordered_map<TInt, TFlt> &_dist_to_dest
+            = m_dist_table.find (_dest)->second;
+          _cost.resize (_candidates.size ());
+          for (size_t i = 0; i < _candidates.size (); ++i)
             {
-              // printf("MNM_Routing_Adaptive_With_POIs::update_best_POI, empty
-              // candidate POI list\n"); exit(-1);
-              m_best_poi_table->find (_origin)->second->find (_dest)->second
-                = _current_best_poi_node;
-              continue;
+              auto _index_it = m_POI_index.find (_candidates[i]);
+              if (_index_it == m_POI_index.end ())
+                {
+                  throw std::runtime_error (
+                    "MNM_Routing_Adaptive_With_POIs::update_best_POI, "
+                    "candidate POI is not a charging station");
+                }
+              _cost[i] = _origin_to_POI[_index_it->second]
+                         + _dist_to_dest.find (_candidates[i]->m_node_ID)
+                             ->second;
             }
-          _current_best_path_cost = std::numeric_limits<double>::infinity ();
-          std::random_shuffle (std::begin (*(_it_it.second)),
-                               std::end (*(_it_it.second)));
-          for (auto _node : *(_it_it.second))
+          // unreachable POIs have infinite cost and are never chosen, an
+          // empty candidate list leaves the vehicles heading to the
+          // destination
+          _best_idx = _candidates.size ();
+          _best_cost = TFlt (std::numeric_limits<double>::infinity ());
+          for (size_t i = 0; i < _cost.size (); ++i)
             {
-              // mid_node to dest
-              _shortest_path_tree = m_table->find (_dest)->second;
-              _path = nullptr;
-              _path = MNM::extract_path (_node->m_node_ID,
-                                         _dest->m_dest_node->m_node_ID,
-                                         *_shortest_path_tree, m_graph);
-              Assert (_path != nullptr);
-              _path_cost = MNM::get_path_tt_snapshot (_path, m_link_cost);
-              delete _path;
-
-              // origin to mid_node
-              _shortest_path_tree = m_table_POIs->find (_node)->second;
-              _path = nullptr;
-              _path = MNM::extract_path (_origin->m_origin_node->m_node_ID,
-                                         _node->m_node_ID, *_shortest_path_tree,
-                                         m_graph);
-              Assert (_path != nullptr);
-              _path_cost += MNM::get_path_tt_snapshot (_path, m_link_cost);
-              delete _path;
-
-              if (_current_best_path_cost > _path_cost)
+              if (_cost[i] < _best_cost)
                 {
-                  _current_best_poi_node = _node;
-                  _current_best_path_cost = _path_cost;
+                  _best_cost = _cost[i];
+                  _best_idx = i;
                 }
             }
-          Assert (_current_best_poi_node != nullptr);
+          _current_best_poi_node = nullptr;
+          if (_best_idx < _candidates.size ())
+            {
+              _current_best_poi_node = _candidates[_best_idx];
+              m_POI_active[m_POI_index.find (_current_best_poi_node)->second]
+                = true;
+            }
           m_best_poi_table->find (_origin)->second->find (_dest)->second
             = _current_best_poi_node;
         }
     }
+
+  if (_from_origins)
+    update_POI_trees ();
   return 0;
 }
 
@@ -1482,8 +1515,8 @@ MNM_Routing_Adaptive_With_POIs::update_best_POI2 ()
               continue;
             }
           _current_best_path_cost = std::numeric_limits<double>::infinity ();
-          std::random_shuffle (std::begin (*(_it_it.second)),
-                               std::end (*(_it_it.second)));
+          MNM_Ults::random_shuffle (std::begin (*(_it_it.second)),
+                                    std::end (*(_it_it.second)));
           for (auto _node : *(_it_it.second))
             {
               _path_cost = dynamic_cast<MNM_Charging_Station *> (_node)
@@ -1495,10 +1528,13 @@ MNM_Routing_Adaptive_With_POIs::update_best_POI2 ()
                 }
             }
           Assert (_current_best_poi_node != nullptr);
+          m_POI_active[m_POI_index.find (_current_best_poi_node)->second]
+            = true;
           m_best_poi_table->find (_origin)->second->find (_dest)->second
             = _current_best_poi_node;
         }
     }
+  update_POI_trees ();
   return 0;
 }
 
@@ -1507,7 +1543,7 @@ MNM_Routing_Adaptive_With_POIs::update_best_POI2 ()
 //#################################################################
 
 MNM_Routing_Hybrid_EV::MNM_Routing_Hybrid_EV (
-  const std::string &file_folder, macposts::Graph &graph,
+  const std::string &file_folder, const macposts::Graph &graph,
   MNM_Statistics *statistics, MNM_OD_Factory *od_factory,
   MNM_Node_Factory *node_factory, MNM_Link_Factory *link_factory,
   OD_Candidate_POI_Table *od_candidate_poi_table, TInt route_frq_fixed,
@@ -1967,7 +2003,7 @@ MNM_Dta_EV::build_from_files ()
                                   m_node_factory);
   std::cout << "# of OD pairs: " << m_od_factory->m_origin_map.size () << "\n";
 
-  m_graph = MNM_IO::build_graph (m_file_folder, m_config);
+  m_own_graph = MNM_IO::build_graph (m_file_folder, m_config);
 
   dynamic_cast<MNM_Veh_Factory_EV *> (m_veh_factory)
     ->set_ev_range (m_config->get_float ("EV_starting_range_roadside_charging"),
@@ -2132,6 +2168,8 @@ MNM_Dta_EV::load_once (bool verbose, TInt load_int, TInt assign_int)
   MNM_Dnode *_node;
   MNM_Dlink *_link;
   MNM_Destination *_dest;
+  if (m_workzone != nullptr)
+    m_workzone->update_workzone (load_int);
   if (load_int == 0)
     m_statistics->update_record (load_int);
   if (verbose)
@@ -2141,11 +2179,7 @@ MNM_Dta_EV::load_once (bool verbose, TInt load_int, TInt assign_int)
   // step 1: Origin release vehicle
   if (verbose)
     printf ("Releasing!\n");
-  TFlt _ad_ratio = m_config->get_float ("adaptive_ratio");
-  if (_ad_ratio > 1.)
-    _ad_ratio = 1.;
-  if (_ad_ratio < 0.)
-    _ad_ratio = 0.;
+  TFlt _ad_ratio = m_settings.m_adaptive_ratio;
   bool _releasing = (load_int % m_assign_freq == 0 || load_int == 0);
   for (auto _origin_it = m_od_factory->m_origin_map.begin ();
        _origin_it != m_od_factory->m_origin_map.end (); _origin_it++)
@@ -2162,7 +2196,7 @@ MNM_Dta_EV::load_once (bool verbose, TInt load_int, TInt assign_int)
             }
           else
             {
-              if ((m_config->get_string ("routing_type") == "Hybrid"))
+              if (m_settings.m_routing_type == MNM_Routing_Type::Hybrid)
                 {
                   _origin->release_one_interval (load_int, m_veh_factory,
                                                  assign_int, _ad_ratio);
@@ -2219,10 +2253,10 @@ MNM_Dta_EV::load_once (bool verbose, TInt load_int, TInt assign_int)
       //   _link -> print_info();
       // }
       if ((m_gridlock_recorder != nullptr)
-          && ((m_config->get_int ("total_interval") <= 0
+          && ((m_settings.m_total_interval <= 0
                && load_int >= 1.5 * m_total_assign_inter * m_assign_freq)
-              || (m_config->get_int ("total_interval") > 0
-                  && load_int >= 0.95 * m_config->get_int ("total_interval"))))
+              || (m_settings.m_total_interval > 0
+                  && load_int >= 0.95 * m_settings.m_total_interval)))
         {
           m_gridlock_recorder->save_one_link (load_int, _link);
         }
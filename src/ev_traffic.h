@@ -52,6 +52,7 @@ public:
   MNM_Veh_Electrified_Delivery *
   make_veh_electrified_delivery (TInt timestamp, Vehicle_type veh_type,
                                  bool using_roadside_charging = false);
+  virtual int count_new_veh (MNM_Veh *veh) override;
 
   int set_ev_range (TFlt EV_starting_range_roadside_charging,
                     TFlt EV_starting_range_non_roadside_charging,
@@ -147,7 +148,7 @@ class MNM_Routing_Adaptive_With_POIs : public MNM_Routing_Adaptive
 {
 public:
   MNM_Routing_Adaptive_With_POIs (
-    const std::string &file_folder, macposts::Graph &graph,
+    const std::string &file_folder, const macposts::Graph &graph,
     MNM_Statistics *statistics, MNM_OD_Factory *od_factory,
     MNM_Node_Factory *node_factory, MNM_Link_Factory *link_factory,
     OD_Candidate_POI_Table *od_candidate_poi_table = nullptr);
@@ -156,8 +157,12 @@ public:
   virtual int update_link_cost () override;
   virtual int update_routing (TInt timestamp) override;
   virtual int get_POIs ();
+  // pick the best POI of each OD pair from the distance labels of the trees,
+  // without extracting any path
   virtual int update_best_POI ();
   virtual int update_best_POI2 ();
+  // rebuild the trees (and labels) to the POIs that vehicles may be sent to
+  int update_POI_trees (bool all_POIs = false);
   int
   set_shortest_path_tree (std::unordered_map<TInt, TInt> **shortest_path_tree,
                           MNM_Dnode *poi_node = nullptr,
@@ -167,6 +172,14 @@ public:
 
   Routing_Table2 *m_table_POIs;
   std::vector<MNM_Dnode *> m_mid_POIs;
+  // index of each POI in m_mid_POIs
+  std::unordered_map<MNM_Dnode *, size_t> m_POI_index;
+  // cost from every node to each POI, the labels of the m_table_POIs trees
+  std::unordered_map<MNM_Dnode *, std::unordered_map<TInt, TFlt>>
+    m_dist_table_POIs;
+  // POIs that have been chosen for some OD pair, only their trees are kept
+  // up to date once the POI costs come from searches out of the origins
+  std::vector<bool> m_POI_active;
   OD_Candidate_POI_Table *m_od_candidate_poi_table;
   Best_POI_Table *m_best_poi_table;
 };
@@ -174,7 +187,8 @@ public:
 class MNM_Routing_Hybrid_EV : public MNM_Routing
 {
 public:
-  MNM_Routing_Hybrid_EV (const std::string &file_folder, macposts::Graph &graph,
+  MNM_Routing_Hybrid_EV (const std::string &file_folder,
+                         const macposts::Graph &graph,
                          MNM_Statistics *statistics, MNM_OD_Factory *od_factory,
                          MNM_Node_Factory *node_factory,
                          MNM_Link_Factory *link_factory,
@@ -1,5 +1,11 @@
 #include "factory.h"
 
+namespace
+{
+// the batch of the release job run by this thread, see add_veh
+thread_local std::vector<MNM_Veh *> *veh_batch = nullptr;
+}
+
 /**************************************************************************
                           Vehicle node
 **************************************************************************/
@@ -32,10 +38,46 @@ MNM_Veh_Factory::make_veh (TInt timestamp, Vehicle_type veh_type)
   // (int)m_num_veh + 1);
   MNM_Veh *_veh = new MNM_Veh (m_num_veh + 1, timestamp);
   _veh->m_type = veh_type;
-  m_veh_map.insert (std::pair<TInt, MNM_Veh *> (m_num_veh + 1, _veh));
+  add_veh (_veh);
+  return _veh;
+}
+
+int
+MNM_Veh_Factory::add_veh (MNM_Veh *veh)
+{
+  if (veh_batch != nullptr)
+    {
+      veh_batch->push_back (veh);
+      return 0;
+    }
   m_num_veh += 1;
+  veh->m_veh_ID = m_num_veh;
+  m_veh_map.insert (std::pair<TInt, MNM_Veh *> (m_num_veh, veh));
   m_enroute += 1;
-  return _veh;
+  count_new_veh (veh);
+  return 0;
+}
+
+void
+MNM_Veh_Factory::set_thread_batch (std::vector<MNM_Veh *> *batch)
+{
+  veh_batch = batch;
+}
+
+int
+MNM_Veh_Factory::commit_batches (std::vector<std::vector<MNM_Veh *>> &batches)
+{
+  size_t _num_new = 0;
+  for (auto &_batch : batches)
+    _num_new += _batch.size ();
+  m_veh_map.reserve (m_veh_map.size () + _num_new);
+  for (auto &_batch : batches)
+    {
+      for (MNM_Veh *_veh : _batch)
+        add_veh (_veh);
+      _batch.clear ();
+    }
+  return 0;
 }
 
 int
@@ -287,20 +329,20 @@ MNM_OD_Factory::get_random_od_pair ()
   MNM_Destination *_dest;
 
   auto _origin_it = m_origin_map.begin ();
-  int random_index = rand () % m_origin_map.size ();
+  int random_index = MNM_Ults::rand_int (m_origin_map.size ());
   std::advance (_origin_it, random_index);
 
   _origin = _origin_it->second;
   while (_origin->m_demand.empty ())
     {
       _origin_it = m_origin_map.begin ();
-      random_index = rand () % m_origin_map.size ();
+      random_index = MNM_Ults::rand_int (m_origin_map.size ());
       std::advance (_origin_it, random_index);
       _origin = _origin_it->second;
     }
 
   auto _dest_it = _origin->m_demand.begin ();
-  random_index = rand () % _origin->m_demand.size ();
+  random_index = MNM_Ults::rand_int (_origin->m_demand.size ());
   std::advance (_dest_it, random_index);
   _dest = _dest_it->first;
 
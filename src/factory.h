@@ -9,6 +9,7 @@
 
 #include <iostream>
 #include <unordered_map>
+#include <vector>
 
 class MNM_Veh;
 class MNM_Dnode;
@@ -22,6 +23,18 @@ public:
   MNM_Veh_Factory ();
   virtual ~MNM_Veh_Factory ();
   MNM_Veh *make_veh (TInt timestamp, Vehicle_type veh_type);
+  // Registers a vehicle made by the make_veh functions: gives it the next ID,
+  // puts it in m_veh_map and counts it.  On a thread with a batch set by
+  // set_thread_batch the vehicle is only appended to the batch, and
+  // commit_batches registers it later, so origins can release on several
+  // threads.
+  int add_veh (MNM_Veh *veh);
+  // counters of the subclasses kept for each new vehicle
+  virtual int count_new_veh (MNM_Veh *veh) { return 0; };
+  // nullptr to register vehicles of this thread right away again
+  static void set_thread_batch (std::vector<MNM_Veh *> *batch);
+  // registers the vehicles of the batches, in order
+  int commit_batches (std::vector<std::vector<MNM_Veh *>> &batches);
   TInt m_num_veh;
   std::unordered_map<TInt, MNM_Veh *> m_veh_map;
 
@@ -31,6 +44,25 @@ public:
   virtual int remove_finished_veh (MNM_Veh *veh, bool del = true);
 };
 
+// static attributes of a node/link as read from the input files, units
+// already converted to the ones used by the simulation
+struct node_spec
+{
+  TInt node_ID;
+  DNode_type node_type;
+};
+
+struct link_spec
+{
+  TInt link_ID;
+  DLink_type link_type;
+  TFlt lane_hold_cap;
+  TFlt lane_flow_cap;
+  TInt number_of_lane;
+  TFlt length;
+  TFlt ffs;
+};
+
 class MNM_Node_Factory
 {
 public:
@@ -2,7 +2,7 @@
 
 using macposts::graph::Direction;
 
-MNM_Gridlock_Checker::MNM_Gridlock_Checker (macposts::Graph &graph,
+MNM_Gridlock_Checker::MNM_Gridlock_Checker (const macposts::Graph &graph,
                                             MNM_Link_Factory *link_factory)
     : m_full_graph (graph)
 {
@@ -33,7 +33,7 @@ MNM_Gridlock_Checker::get_last_veh (MNM_Dlink *link)
 }
 
 bool
-MNM_Gridlock_Checker::has_cycle (macposts::Graph &graph)
+MNM_Gridlock_Checker::has_cycle (const macposts::Graph &graph)
 {
   std::deque<TInt> _link_queue = std::deque<TInt> ();
   std::set<TInt> _remained_link_set = std::set<TInt> ();
@@ -9,17 +9,18 @@
 class MNM_Gridlock_Checker
 {
 public:
-  MNM_Gridlock_Checker (macposts::Graph &graph, MNM_Link_Factory *link_factory);
+  MNM_Gridlock_Checker (const macposts::Graph &graph,
+                        MNM_Link_Factory *link_factory);
   ~MNM_Gridlock_Checker ();
 
   bool is_gridlocked ();
   int initialize ();
   MNM_Veh *get_last_veh (MNM_Dlink *link);
-  bool static has_cycle (macposts::Graph &graph);
+  bool static has_cycle (const macposts::Graph &graph);
 
   MNM_Link_Factory *m_link_factory;
   std::unordered_map<TInt, MNM_Veh *> m_link_veh_map;
-  macposts::Graph &m_full_graph;
+  const macposts::Graph &m_full_graph;
   macposts::Graph m_gridlock_graph;
 };
 
@@ -8,6 +8,22 @@ MNM_IO::build_node_factory (const std::string &file_folder,
                             MNM_ConfReader *conf_reader,
                             MNM_Node_Factory *node_factory,
                             const std::string &file_name)
+{
+  TFlt _flow_scalar = conf_reader->get_float ("flow_scalar");
+  std::vector<node_spec> _specs;
+  read_node_specs (file_folder, conf_reader, _specs, file_name);
+  for (const node_spec &_spec : _specs)
+    {
+      node_factory->make_node (_spec.node_ID, _spec.node_type, _flow_scalar);
+    }
+  return 0;
+}
+
+int
+MNM_IO::read_node_specs (const std::string &file_folder,
+                         MNM_ConfReader *conf_reader,
+                         std::vector<node_spec> &specs,
+                         const std::string &file_name)
 {
   /* find file */
   std::string _node_file_name = file_folder + "/" + file_name;
@@ -16,7 +32,6 @@ MNM_IO::build_node_factory (const std::string &file_folder,
 
   /* read confid */
   TInt _num_of_node = conf_reader->get_int ("num_of_node");
-  TFlt _flow_scalar = conf_reader->get_float ("flow_scalar");
 
   /* read file */
   std::string _line;
@@ -26,6 +41,7 @@ MNM_IO::build_node_factory (const std::string &file_folder,
 
   if (_node_file.is_open ())
     {
+      specs.reserve (specs.size () + _num_of_node);
       for (int i = 0; i < _num_of_node;)
         {
           std::getline (_node_file, _line);
@@ -44,26 +60,22 @@ MNM_IO::build_node_factory (const std::string &file_folder,
               _type = trim (_words[1]);
               if (_type == "FWJ")
                 {
-                  node_factory->make_node (_node_ID, MNM_TYPE_FWJ,
-                                           _flow_scalar);
+                  specs.push_back ({ _node_ID, MNM_TYPE_FWJ });
                   continue;
                 }
               if (_type == "GRJ")
                 {
-                  node_factory->make_node (_node_ID, MNM_TYPE_GRJ,
-                                           _flow_scalar);
+                  specs.push_back ({ _node_ID, MNM_TYPE_GRJ });
                   continue;
                 }
               if (_type == "DMOND")
                 {
-                  node_factory->make_node (_node_ID, MNM_TYPE_ORIGIN,
-                                           _flow_scalar);
+                  specs.push_back ({ _node_ID, MNM_TYPE_ORIGIN });
                   continue;
                 }
               if (_type == "DMDND")
                 {
-                  node_factory->make_node (_node_ID, MNM_TYPE_DEST,
-                                           _flow_scalar);
+                  specs.push_back ({ _node_ID, MNM_TYPE_DEST });
                   continue;
                 }
               throw std::runtime_error ("unknown node type: " + _type);
@@ -83,6 +95,26 @@ MNM_IO::build_link_factory (const std::string &file_folder,
                             MNM_ConfReader *conf_reader,
                             MNM_Link_Factory *link_factory,
                             const std::string &file_name)
+{
+  TFlt _flow_scalar = conf_reader->get_float ("flow_scalar");
+  TFlt _unit_time = conf_reader->get_float ("unit_time");
+  std::vector<link_spec> _specs;
+  read_link_specs (file_folder, conf_reader, _specs, file_name);
+  for (const link_spec &_spec : _specs)
+    {
+      link_factory->make_link (_spec.link_ID, _spec.link_type,
+                               _spec.lane_hold_cap, _spec.lane_flow_cap,
+                               _spec.number_of_lane, _spec.length, _spec.ffs,
+                               _unit_time, _flow_scalar);
+    }
+  return 0;
+}
+
+int
+MNM_IO::read_link_specs (const std::string &file_folder,
+                         MNM_ConfReader *conf_reader,
+                         std::vector<link_spec> &specs,
+                         const std::string &file_name)
 {
   /* find file */
   std::string _link_file_name = file_folder + "/" + file_name;
@@ -91,22 +123,16 @@ MNM_IO::build_link_factory (const std::string &file_folder,
 
   /* read config */
   TInt _num_of_link = conf_reader->get_int ("num_of_link");
-  TFlt _flow_scalar = conf_reader->get_float ("flow_scalar");
-  TFlt _unit_time = conf_reader->get_float ("unit_time");
 
   /* read file */
   std::string _line;
   std::vector<std::string> _words;
-  TInt _link_ID;
-  TFlt _lane_hold_cap;
-  TFlt _lane_flow_cap;
-  TInt _number_of_lane;
-  TFlt _length;
-  TFlt _ffs;
+  link_spec _spec;
   std::string _type;
 
   if (_link_file.is_open ())
     {
+      specs.reserve (specs.size () + _num_of_link);
       for (int i = 0; i < _num_of_link;)
         {
           std::getline (_link_file, _line);
@@ -121,54 +147,42 @@ MNM_IO::build_link_factory (const std::string &file_folder,
           if (_words.size () >= 7)
             {
               // std::cout << "Processing: " << _line << "\n";
-              _link_ID = TInt (std::stoi (_words[0]));
+              _spec.link_ID = TInt (std::stoi (_words[0]));
               _type = trim (_words[1]);
-              _length = TFlt (std::stod (_words[2]));
-              _ffs = TFlt (std::stod (_words[3]));
-              _lane_flow_cap = TFlt (std::stod (_words[4]));
-              _lane_hold_cap = TFlt (std::stod (_words[5]));
-              _number_of_lane = TInt (std::stoi (_words[6]));
+              _spec.length = TFlt (std::stod (_words[2]));
+              _spec.ffs = TFlt (std::stod (_words[3]));
+              _spec.lane_flow_cap = TFlt (std::stod (_words[4]));
+              _spec.lane_hold_cap = TFlt (std::stod (_words[5]));
+              _spec.number_of_lane = TInt (std::stoi (_words[6]));
 
               /* unit conversion */
-              _length = _length * TFlt (1600);
-              _ffs = _ffs * TFlt (1600) / TFlt (3600);
-              _lane_flow_cap = _lane_flow_cap / TFlt (3600);
-              _lane_hold_cap = _lane_hold_cap / TFlt (1600);
+              _spec.length = _spec.length * TFlt (1600);
+              _spec.ffs = _spec.ffs * TFlt (1600) / TFlt (3600);
+              _spec.lane_flow_cap = _spec.lane_flow_cap / TFlt (3600);
+              _spec.lane_hold_cap = _spec.lane_hold_cap / TFlt (1600);
 
               /* build */
               if (_type == "PQ")
                 {
-                  link_factory->make_link (_link_ID, MNM_TYPE_PQ,
-                                           _lane_hold_cap, _lane_flow_cap,
-                                           _number_of_lane, _length, _ffs,
-                                           _unit_time, _flow_scalar);
-                  continue;
+                  _spec.link_type = MNM_TYPE_PQ;
                 }
-              if (_type == "CTM")
+              else if (_type == "CTM")
                 {
-                  link_factory->make_link (_link_ID, MNM_TYPE_CTM,
-                                           _lane_hold_cap, _lane_flow_cap,
-                                           _number_of_lane, _length, _ffs,
-                                           _unit_time, _flow_scalar);
-                  continue;
+                  _spec.link_type = MNM_TYPE_CTM;
                 }
-              if (_type == "LQ")
+              else if (_type == "LQ")
                 {
-                  link_factory->make_link (_link_ID, MNM_TYPE_LQ,
-                                           _lane_hold_cap, _lane_flow_cap,
-                                           _number_of_lane, _length, _ffs,
-                                           _unit_time, _flow_scalar);
-                  continue;
+                  _spec.link_type = MNM_TYPE_LQ;
                 }
-              if (_type == "LTM")
+              else if (_type == "LTM")
                 {
-                  link_factory->make_link (_link_ID, MNM_TYPE_LTM,
-                                           _lane_hold_cap, _lane_flow_cap,
-                                           _number_of_lane, _length, _ffs,
-                                           _unit_time, _flow_scalar);
-                  continue;
+                  _spec.link_type = MNM_TYPE_LTM;
                 }
-              throw std::runtime_error ("unknown link type: " + _type);
+              else
+                {
+                  throw std::runtime_error ("unknown link type: " + _type);
+                }
+              specs.push_back (_spec);
             }
           else
             {
@@ -340,6 +354,67 @@ MNM_IO::hook_up_od_node (const std::string &file_folder,
   return 0;
 }
 
+int
+MNM_IO::read_od_node (const std::string &file_folder,
+                      MNM_ConfReader *conf_reader,
+                      std::unordered_map<TInt, TInt> *origin_node,
+                      std::unordered_map<TInt, TInt> *dest_node,
+                      const std::string &file_name)
+{
+  /* find file */
+  std::string _od_file_name = file_folder + "/" + file_name;
+  std::ifstream _od_file;
+  _od_file.open (_od_file_name, std::ios::in);
+
+  /* read config */
+  TInt _num_of_O = conf_reader->get_int ("num_of_O");
+  TInt _num_of_D = conf_reader->get_int ("num_of_D");
+
+  /* read */
+  std::string _line;
+  std::vector<std::string> _words;
+  if (_od_file.is_open ())
+    {
+      for (int i = 0; i < _num_of_O;)
+        {
+          std::getline (_od_file, _line);
+          _line = trim (_line);
+          if (_line.empty () || _line[0] == '#')
+            {
+              continue;
+            }
+          ++i;
+          _words = split (_line, ' ');
+          if (_words.size () == 2)
+            {
+              origin_node->insert (
+                std::pair<TInt, TInt> (TInt (std::stoi (_words[0])),
+                                       TInt (std::stoi (_words[1]))));
+            }
+        }
+
+      for (int i = 0; i < _num_of_D;)
+        {
+          std::getline (_od_file, _line);
+          _line = trim (_line);
+          if (_line.empty () || _line[0] == '#')
+            {
+              continue;
+            }
+          ++i;
+          _words = split (_line, ' ');
+          if (_words.size () == 2)
+            {
+              dest_node->insert (
+                std::pair<TInt, TInt> (TInt (std::stoi (_words[0])),
+                                       TInt (std::stoi (_words[1]))));
+            }
+        }
+    }
+  _od_file.close ();
+  return 0;
+}
+
 int
 MNM_IO::build_od_factory (const std::string &file_folder,
                           MNM_ConfReader *conf_reader,
@@ -939,7 +1014,7 @@ MNM_IO::load_path_table (const std::string &file_name,
 
               _path_table->find (_origin_node_ID)
                 ->second->find (_dest_node_ID)
-                ->second->m_path_vec.push_back (_path);
+                ->second->add_path (_path);
             }
         }
       _path_table_file.close ();
@@ -1133,10 +1208,20 @@ MNM_IO::build_workzone_list (const std::string &file_folder,
           std::getline (_workzone_file, _line);
           // std::cout << "Processing: " << _line << "\n";
           _words = split (_line, ' ');
+          // link_ID [start_interval end_interval], closed for the whole
+          // simulation without the interval
           if (TInt (_words.size ()) == 1)
             {
               _link_ID = TInt (std::stoi (trim (_words[0])));
-              Link_Workzone _w = { _link_ID };
+              Link_Workzone _w = { _link_ID, 0, -1 };
+              workzone->m_workzone_list.push_back (_w);
+            }
+          else if (TInt (_words.size ()) == 3)
+            {
+              _link_ID = TInt (std::stoi (trim (_words[0])));
+              Link_Workzone _w = { _link_ID,
+                                   TInt (std::stoi (trim (_words[1]))),
+                                   TInt (std::stoi (trim (_words[2]))) };
               workzone->m_workzone_list.push_back (_w);
             }
           else
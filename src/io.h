@@ -27,6 +27,14 @@ public:
                                  MNM_Link_Factory *link_factory,
                                  const std::string &file_name
                                  = "MNM_input_link");
+  static int read_node_specs (const std::string &file_folder,
+                              MNM_ConfReader *conf_reader,
+                              std::vector<node_spec> &specs,
+                              const std::string &file_name = "MNM_input_node");
+  static int read_link_specs (const std::string &file_folder,
+                              MNM_ConfReader *conf_reader,
+                              std::vector<link_spec> &specs,
+                              const std::string &file_name = "MNM_input_link");
   static int build_od_factory (const std::string &file_folder,
                                MNM_ConfReader *conf_reader,
                                MNM_OD_Factory *od_factory,
@@ -41,6 +49,13 @@ public:
                               MNM_OD_Factory *od_factory,
                               MNM_Node_Factory *node_factory,
                               const std::string &file_name = "MNM_input_od");
+  // the node of each origin and of each destination, the pairs
+  // hook_up_od_node hooks up
+  static int read_od_node (const std::string &file_folder,
+                           MNM_ConfReader *conf_reader,
+                           std::unordered_map<TInt, TInt> *origin_node,
+                           std::unordered_map<TInt, TInt> *dest_node,
+                           const std::string &file_name = "MNM_input_od");
   static macposts::Graph build_graph (const std::string &file_folder,
                                       MNM_ConfReader *conf_reader);
   static int build_demand (const std::string &file_folder,
@@ -0,0 +1,32 @@
+#include "link_matrix.h"
+#include "ults.h"
+
+#include <cstdio>
+#include <mutex>
+
+namespace MNM
+{
+int
+fill_link_rows (size_t num_rows, int num_threads, bool verbose,
+                const std::string &name,
+                const std::function<void (size_t)> &fill)
+{
+  std::mutex _mutex;
+  size_t _done = 0;
+  return MNM_Ults::parallel_for (num_rows, num_threads,
+                                 [&] (size_t i, int worker) {
+                                   fill (i);
+                                   if (!verbose)
+                                     return;
+                                   std::lock_guard<std::mutex> _lock (_mutex);
+                                   ++_done;
+                                   if (_done * 10 / num_rows
+                                         != (_done - 1) * 10 / num_rows
+                                       || _done == num_rows)
+                                     {
+                                       printf ("%s: %zu / %zu done\n",
+                                               name.c_str (), _done, num_rows);
+                                     }
+                                 });
+}
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "common.h"
+#include "memory_usage.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// A time dependent attribute of a set of links (travel time, cost, congestion
+// indicator, ...) stored as one block of [link][interval] entries.  Each row
+// starts on a cache line and is padded to a whole number of lines, so the
+// kernels reading the row of a link go through contiguous memory and threads
+// filling different links never write to the same line.  The rows are also
+// indexed by link ID in a map of row pointers, the form taken by the TDSP and
+// path cost functions.  Copies share the rows, as the copies of the maps of
+// separately allocated rows it replaces did, and the block is freed with the
+// last copy.
+template <typename T> class MNM_Link_Matrix
+{
+  static_assert (std::is_trivial<T>::value && 64 % sizeof (T) == 0,
+                 "link matrix entries must be trivial and pack a cache line");
+
+public:
+  typedef std::unordered_map<TInt, T *> Row_Map;
+
+  // one zeroed row of num_cols entries for each link, in the given order
+  int reset (const std::vector<TInt> &link_IDs, size_t num_cols);
+  // drops the rows of this copy
+  int clear ();
+
+  bool empty () const { return m_link_ID.empty (); }
+  size_t get_num_rows () const { return m_link_ID.size (); }
+  size_t get_num_cols () const { return m_num_cols; }
+  // distance between the starts of consecutive rows, in entries
+  size_t get_stride () const { return m_stride; }
+  TInt get_link_ID (size_t row) const { return m_link_ID[row]; }
+  const std::vector<TInt> &get_link_IDs () const { return m_link_ID; }
+  T *get_row (size_t row) const { return m_data + row * m_stride; }
+  // nullptr if the link has no row
+  T *find_row (TInt link_ID) const;
+  // throws if the link has no row
+  T *operator[] (TInt link_ID) const;
+  const Row_Map &get_row_map () const { return m_row_map; }
+  operator const Row_Map & () const { return m_row_map; }
+  // the block plus the link index, a block shared by copies is counted by
+  // each of them
+  size_t get_memory_bytes () const;
+
+private:
+  static const size_t LINE = 64;
+
+  std::shared_ptr<unsigned char> m_buffer;
+  T *m_data = nullptr;
+  size_t m_num_cols = 0;
+  size_t m_stride = 0;
+  std::vector<TInt> m_link_ID;
+  Row_Map m_row_map;
+};
+
+template <typename T>
+int
+MNM_Link_Matrix<T>::reset (const std::vector<TInt> &link_IDs, size_t num_cols)
+{
+  clear ();
+  size_t _per_line = LINE / sizeof (T);
+  m_num_cols = num_cols;
+  m_stride = (num_cols + _per_line - 1) / _per_line * _per_line;
+  size_t _size = link_IDs.size () * m_stride;
+  m_buffer = std::shared_ptr<unsigned char> (
+    new unsigned char[_size * sizeof (T) + LINE],
+    std::default_delete<unsigned char[]> ());
+  uintptr_t _base = reinterpret_cast<uintptr_t> (m_buffer.get ());
+  m_data = reinterpret_cast<T *> ((_base + LINE - 1) / LINE * LINE);
+  std::fill_n (m_data, _size, T ());
+
+  m_link_ID = link_IDs;
+  m_row_map.reserve (link_IDs.size ());
+  for (size_t i = 0; i < link_IDs.size (); ++i)
+    {
+      if (!m_row_map.insert ({ link_IDs[i], get_row (i) }).second)
+        {
+          throw std::runtime_error ("MNM_Link_Matrix::reset, repeated link "
+                                    + std::to_string (link_IDs[i]));
+        }
+    }
+  return 0;
+}
+
+template <typename T>
+int
+MNM_Link_Matrix<T>::clear ()
+{
+  m_buffer.reset ();
+  m_data = nullptr;
+  m_num_cols = 0;
+  m_stride = 0;
+  m_link_ID.clear ();
+  m_row_map.clear ();
+  return 0;
+}
+
+template <typename T>
+T *
+MNM_Link_Matrix<T>::find_row (TInt link_ID) const
+{
+  auto _it = m_row_map.find (link_ID);
+  return _it == m_row_map.end () ? nullptr : _it->second;
+}
+
+template <typename T>
+T *
+MNM_Link_Matrix<T>::operator[] (TInt link_ID) const
+{
+  T *_row = find_row (link_ID);
+  if (_row == nullptr)
+    {
+      throw std::runtime_error ("MNM_Link_Matrix, no row for link "
+                                + std::to_string (link_ID));
+    }
+  return _row;
+}
+
+template <typename T>
+size_t
+MNM_Link_Matrix<T>::get_memory_bytes () const
+{
+  size_t _bytes
+    = MNM::vector_bytes (m_link_ID) + MNM::unordered_bytes (m_row_map);
+  if (m_buffer != nullptr)
+    _bytes += m_link_ID.size () * m_stride * sizeof (T) + LINE;
+  return _bytes;
+}
+
+namespace MNM
+{
+// Calls fill (i) for every i in [0, num_rows) on up to num_threads threads,
+// where fill (i) writes the rows of the i-th link, or group of links whose
+// travel times share some state.  With verbose, name and the number of calls
+// done are printed about every tenth of them.
+int fill_link_rows (size_t num_rows, int num_threads, bool verbose,
+                    const std::string &name,
+                    const std::function<void (size_t)> &fill);
+}
@@ -0,0 +1,44 @@
+#include "memory_usage.h"
+
+#include <cstdio>
+
+namespace MNM
+{
+int
+add_memory (MNM_Memory_Report &report, const std::string &category,
+            size_t bytes, size_t count)
+{
+  MNM_Memory_Stat &_stat = report[category];
+  _stat.m_bytes += bytes;
+  _stat.m_count += count;
+  return 0;
+}
+
+size_t
+get_memory_total (const MNM_Memory_Report &report)
+{
+  size_t _total = 0;
+  for (const auto &_it : report)
+    {
+      _total += _it.second.m_bytes;
+    }
+  return _total;
+}
+
+std::string
+memory_report_to_string (const MNM_Memory_Report &report)
+{
+  std::string _s;
+  char _buf[128];
+  for (const auto &_it : report)
+    {
+      snprintf (_buf, sizeof (_buf), "%s: %.1f MiB (%zu), ",
+                _it.first.c_str (), _it.second.m_bytes / 1048576.,
+                _it.second.m_count);
+      _s += _buf;
+    }
+  snprintf (_buf, sizeof (_buf), "total: %.1f MiB",
+            get_memory_total (report) / 1048576.);
+  return _s + _buf;
+}
+}
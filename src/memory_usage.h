@@ -0,0 +1,79 @@
+#pragma once
+
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Live bytes and object counts of the large containers of a run, by category
+// (vehicles, cumulative curves, path tables, ...).  The bytes are estimated
+// from the element counts and the node layout of the libstdc++ containers,
+// they are not read from the allocator and leave out small fixed overheads.
+struct MNM_Memory_Stat
+{
+  size_t m_bytes = 0;
+  size_t m_count = 0;
+};
+
+typedef std::map<std::string, MNM_Memory_Stat> MNM_Memory_Report;
+
+namespace MNM
+{
+int add_memory (MNM_Memory_Report &report, const std::string &category,
+                size_t bytes, size_t count);
+size_t get_memory_total (const MNM_Memory_Report &report);
+// one line, "category: MiB (count), ..."
+std::string memory_report_to_string (const MNM_Memory_Report &report);
+
+// heap bytes owned by the containers themselves, not by what they point to
+template <typename T>
+size_t
+vector_bytes (const std::vector<T> &v)
+{
+  return v.capacity () * sizeof (T);
+}
+
+template <typename T>
+size_t
+deque_bytes (const std::deque<T> &d)
+{
+  // 512 byte chunks plus the chunk map, which starts with 8 slots
+  size_t _per_chunk = sizeof (T) < 512 ? 512 / sizeof (T) : 1;
+  size_t _chunks = d.size () / _per_chunk + 1;
+  size_t _slots = _chunks + 2 > 8 ? _chunks + 2 : 8;
+  return _chunks * _per_chunk * sizeof (T) + _slots * sizeof (void *);
+}
+
+template <typename K, typename C, typename A>
+size_t
+set_bytes (const std::set<K, C, A> &s)
+{
+  // red-black tree nodes: color, parent, left and right
+  return s.size () * (sizeof (K) + 4 * sizeof (void *));
+}
+
+// any of the unordered containers
+template <typename M>
+size_t
+unordered_bytes (const M &m)
+{
+  // buckets plus singly linked nodes that may cache the hash
+  return m.bucket_count () * sizeof (void *)
+         + m.size () * (sizeof (typename M::value_type) + 2 * sizeof (void *));
+}
+
+// an unordered map of arrays of length elements each, e.g. the link travel
+// time maps of DUE, counting the arrays
+template <typename M>
+int
+add_array_map_memory (MNM_Memory_Report &report, const std::string &category,
+                      const M &m, size_t length)
+{
+  typedef typename std::remove_pointer<typename M::mapped_type>::type T;
+  return add_memory (report, category,
+                     unordered_bytes (m) + m.size () * length * sizeof (T),
+                     m.size ());
+}
+}
@@ -131,6 +131,27 @@ MNM_Dlink_Multiclass::install_cumulative_curve_tree_multiclass ()
   return 0;
 }
 
+int
+MNM_Dlink_Multiclass::add_memory_usage (MNM_Memory_Report &report)
+{
+  MNM_Dlink::add_memory_usage (report);
+  for (MNM_Cumulative_Curve *_cc :
+       { m_N_in_car, m_N_out_car, m_N_in_truck, m_N_out_truck })
+    {
+      if (_cc != nullptr)
+        MNM::add_memory (report, "cumulative_curves", _cc->get_memory_bytes (),
+                         _cc->m_recorder.size ());
+    }
+  for (MNM_Tree_Cumulative_Curve *_cc_tree :
+       { m_N_in_tree_car, m_N_out_tree_car, m_N_in_tree_truck,
+         m_N_out_tree_truck })
+    {
+      if (_cc_tree != nullptr)
+        _cc_tree->add_memory_usage (report);
+    }
+  return 0;
+}
+
 TFlt
 MNM_Dlink_Multiclass::get_link_freeflow_tt_car ()
 {
@@ -754,7 +775,7 @@ MNM_Dlink_Ctm_Multiclass::move_last_cell ()
               m_cell_array[m_num_cells - 1]->m_veh_queue_car.pop_front ();
               if (_veh->has_next_link ())
                 {
-                  m_finished_array.push_back (_veh);
+                  add_finished_veh (_veh);
                 }
               else
                 {
@@ -769,7 +790,7 @@ MNM_Dlink_Ctm_Multiclass::move_last_cell ()
               m_cell_array[m_num_cells - 1]->m_veh_queue_truck.pop_front ();
               if (_veh->has_next_link ())
                 {
-                  m_finished_array.push_back (_veh);
+                  add_finished_veh (_veh);
                 }
               else
                 {
@@ -788,7 +809,7 @@ MNM_Dlink_Ctm_Multiclass::move_last_cell ()
               m_cell_array[m_num_cells - 1]->m_veh_queue_truck.pop_front ();
               if (_veh->has_next_link ())
                 {
-                  m_finished_array.push_back (_veh);
+                  add_finished_veh (_veh);
                 }
               else
                 {
@@ -803,7 +824,7 @@ MNM_Dlink_Ctm_Multiclass::move_last_cell ()
               m_cell_array[m_num_cells - 1]->m_veh_queue_car.pop_front ();
               if (_veh->has_next_link ())
                 {
-                  m_finished_array.push_back (_veh);
+                  add_finished_veh (_veh);
                 }
               else
                 {
@@ -1627,7 +1648,7 @@ MNM_Dlink_Lq_Multiclass::evolve (TInt timestamp)
               m_veh_out_buffer_car.pop_front ();
               if (_veh->has_next_link ())
                 {
-                  m_finished_array.push_back (_veh);
+                  add_finished_veh (_veh);
                 }
               else
                 {
@@ -1642,7 +1663,7 @@ MNM_Dlink_Lq_Multiclass::evolve (TInt timestamp)
               m_veh_out_buffer_truck.pop_front ();
               if (_veh->has_next_link ())
                 {
-                  m_finished_array.push_back (_veh);
+                  add_finished_veh (_veh);
                 }
               else
                 {
@@ -1661,7 +1682,7 @@ MNM_Dlink_Lq_Multiclass::evolve (TInt timestamp)
               m_veh_out_buffer_truck.pop_front ();
               if (_veh->has_next_link ())
                 {
-                  m_finished_array.push_back (_veh);
+                  add_finished_veh (_veh);
                 }
               else
                 {
@@ -1676,7 +1697,7 @@ MNM_Dlink_Lq_Multiclass::evolve (TInt timestamp)
               m_veh_out_buffer_car.pop_front ();
               if (_veh->has_next_link ())
                 {
-                  m_finished_array.push_back (_veh);
+                  add_finished_veh (_veh);
                 }
               else
                 {
@@ -2093,7 +2114,7 @@ MNM_Dlink_Pq_Multiclass::evolve (TInt timestamp)
       // 0
       if (_que_it->second >= std::max (0, m_max_stamp - 1))
         {
-          m_finished_array.push_back (_que_it->first);
+          add_finished_veh (_que_it->first);
           _que_it = m_veh_pool.erase (_que_it); // c++ 11
         }
       else
@@ -2573,8 +2594,8 @@ MNM_Dnode_Inout_Multiclass::move_vehicle (TInt timestamp)
       _out_link = m_out_link_array[j];
 
       // shuffle the in links, reserve the FIFO
-      std::random_shuffle (_in_link_ind_array.begin (),
-                           _in_link_ind_array.end ());
+      MNM_Ults::random_shuffle (_in_link_ind_array.begin (),
+                                _in_link_ind_array.end ());
       for (size_t i : _in_link_ind_array)
         {
           _in_link = m_in_link_array[i];
@@ -3174,8 +3195,8 @@ MNM_Origin_Multiclass::release_one_interval (TInt current_interval,
           m_origin_node->m_in_veh_queue.push_back (_veh);
         }
     }
-  std::random_shuffle (m_origin_node->m_in_veh_queue.begin (),
-                       m_origin_node->m_in_veh_queue.end ());
+  MNM_Ults::random_shuffle (m_origin_node->m_in_veh_queue.begin (),
+                            m_origin_node->m_in_veh_queue.end ());
   return 0;
 }
 
@@ -3289,8 +3310,8 @@ MNM_Origin_Multiclass::release_one_interval_biclass (
           m_origin_node->m_in_veh_queue.push_back (_veh);
         }
     }
-  std::random_shuffle (m_origin_node->m_in_veh_queue.begin (),
-                       m_origin_node->m_in_veh_queue.end ());
+  MNM_Ults::random_shuffle (m_origin_node->m_in_veh_queue.begin (),
+                            m_origin_node->m_in_veh_queue.end ());
   return 0;
 }
 
@@ -3348,21 +3369,24 @@ MNM_Veh_Factory_Multiclass::make_veh_multiclass (TInt timestamp,
   MNM_Veh_Multiclass *_veh
     = new MNM_Veh_Multiclass (m_num_veh + 1, vehicle_cls, timestamp);
   _veh->m_type = veh_type;
-  m_veh_map.insert ({ m_num_veh + 1, _veh });
+  add_veh (_veh);
+  return _veh;
+}
 
-  m_num_veh += 1;
-  m_enroute += 1;
-  if (vehicle_cls == 0)
+int
+MNM_Veh_Factory_Multiclass::count_new_veh (MNM_Veh *veh)
+{
+  if (veh->get_class () == 0)
     {
       m_num_car += 1;
       m_enroute_car += 1;
     }
-  else if (vehicle_cls == 1)
+  else if (veh->get_class () == 1)
     {
       m_num_truck += 1;
       m_enroute_truck += 1;
     }
-  return _veh;
+  return 0;
 }
 
 int
@@ -3552,20 +3576,20 @@ MNM_OD_Factory_Multiclass::get_random_od_pair ()
   MNM_Destination_Multiclass *_dest;
 
   auto _origin_it = m_origin_map.begin ();
-  int random_index = rand () % m_origin_map.size ();
+  int random_index = MNM_Ults::rand_int (m_origin_map.size ());
   std::advance (_origin_it, random_index);
 
   _origin = dynamic_cast<MNM_Origin_Multiclass *> (_origin_it->second);
   while (_origin->m_demand_car.empty ())
     {
       _origin_it = m_origin_map.begin ();
-      random_index = rand () % m_origin_map.size ();
+      random_index = MNM_Ults::rand_int (m_origin_map.size ());
       std::advance (_origin_it, random_index);
       _origin = dynamic_cast<MNM_Origin_Multiclass *> (_origin_it->second);
     }
 
   auto _dest_it = _origin->m_demand_car.begin ();
-  random_index = rand () % _origin->m_demand_car.size ();
+  random_index = MNM_Ults::rand_int (_origin->m_demand_car.size ());
   std::advance (_dest_it, random_index);
   _dest = _dest_it->first;
 
@@ -4353,6 +4377,7 @@ MNM_Dta_Multiclass::initialize ()
   m_od_factory = new MNM_OD_Factory_Multiclass ();
   // printf("4\n");
   m_config = new MNM_ConfReader (m_file_folder + "/config.conf", "DTA");
+  m_settings.load (m_config);
   m_unit_time = m_config->get_int ("unit_time");
   m_flow_scalar = m_config->get_int ("flow_scalar");
   // printf("5\n");
@@ -4411,7 +4436,7 @@ MNM_Dta_Multiclass::build_from_files ()
   // m_od_factory, m_node_factory);
   MNM_IO_Multiclass::build_od_factory (m_file_folder, m_config, m_od_factory,
                                        m_node_factory);
-  m_graph = MNM_IO_Multiclass::build_graph (m_file_folder, m_config);
+  m_own_graph = MNM_IO_Multiclass::build_graph (m_file_folder, m_config);
   MNM_IO_Multiclass::build_demand_multiclass (m_file_folder, m_config,
                                               m_od_factory);
   MNM_IO_Multiclass::read_origin_car_label_ratio (m_file_folder, m_config,
@@ -4546,7 +4571,7 @@ MNM_Dta_Multiclass::loading_vehicle_tracking (bool verbose,
           std::cout << std::endl
                     << "Current loading interval: " << _current_inter << ", "
                     << "Current assignment interval: "
-                    << int (_current_inter / m_config->get_int ("assign_frq"))
+                    << int (_current_inter / m_settings.m_assign_frq)
                     << std::endl;
         }
       load_once (verbose, _current_inter, _assign_inter);
@@ -4824,6 +4849,44 @@ get_travel_time_car (MNM_Dlink_Multiclass *link, TFlt start_time,
                                   fftt);
 }
 
+int
+get_travel_time_car_batch (MNM_Dlink_Multiclass *link,
+                           const std::vector<TFlt> &start_times,
+                           TFlt unit_interval, TInt end_loading_timestamp,
+                           TFlt *tt)
+{
+  if (link == nullptr)
+    {
+      throw std::runtime_error (
+        "Error, get_travel_time_car_batch link is null");
+    }
+  if (link->m_N_in_car == nullptr)
+    {
+      throw std::runtime_error ("Error, get_travel_time_car_batch link "
+                                "cumulative curve is not installed");
+    }
+
+  TFlt fftt = TFlt (int (
+    link->get_link_freeflow_tt_loading_car ())); // actual intervals in loading
+
+  if (link->m_last_valid_time < 0)
+    {
+      link->m_last_valid_time
+        = get_last_valid_time (link->m_N_in_car, link->m_N_out_car,
+                               end_loading_timestamp);
+    }
+  IAssert (link->m_last_valid_time >= 0);
+
+  MNM_Cumulative_Curve_Cursor _N_in (link->m_N_in_car);
+  MNM_Cumulative_Curve_Cursor _N_out (link->m_N_out_car);
+  for (size_t k = 0; k < start_times.size (); ++k)
+    {
+      tt[k] = get_travel_time_from_cc (start_times[k], &_N_in, &_N_out,
+                                       link->m_last_valid_time, fftt);
+    }
+  return 0;
+}
+
 TFlt
 get_travel_time_car_robust (MNM_Dlink_Multiclass *link, TFlt start_time,
                             TFlt end_time, TFlt unit_interval,
@@ -4876,6 +4939,45 @@ get_travel_time_truck (MNM_Dlink_Multiclass *link, TFlt start_time,
                                   link->m_last_valid_time_truck, fftt);
 }
 
+int
+get_travel_time_truck_batch (MNM_Dlink_Multiclass *link,
+                             const std::vector<TFlt> &start_times,
+                             TFlt unit_interval, TInt end_loading_timestamp,
+                             TFlt *tt)
+{
+  if (link == nullptr)
+    {
+      throw std::runtime_error (
+        "Error, get_travel_time_truck_batch link is null");
+    }
+  if (link->m_N_in_truck == nullptr)
+    {
+      throw std::runtime_error ("Error, get_travel_time_truck_batch link "
+                                "cumulative curve is not installed");
+    }
+
+  TFlt fftt = TFlt (int (
+    link
+      ->get_link_freeflow_tt_loading_truck ())); // actual intervals in loading
+
+  if (link->m_last_valid_time_truck < 0)
+    {
+      link->m_last_valid_time_truck
+        = get_last_valid_time (link->m_N_in_truck, link->m_N_out_truck,
+                               end_loading_timestamp);
+    }
+  IAssert (link->m_last_valid_time_truck >= 0);
+
+  MNM_Cumulative_Curve_Cursor _N_in (link->m_N_in_truck);
+  MNM_Cumulative_Curve_Cursor _N_out (link->m_N_out_truck);
+  for (size_t k = 0; k < start_times.size (); ++k)
+    {
+      tt[k] = get_travel_time_from_cc (start_times[k], &_N_in, &_N_out,
+                                       link->m_last_valid_time_truck, fftt);
+    }
+  return 0;
+}
+
 TFlt
 get_travel_time_truck_robust (MNM_Dlink_Multiclass *link, TFlt start_time,
                               TFlt end_time, TFlt unit_interval,
@@ -4927,9 +5029,10 @@ get_path_travel_time_car (MNM_Path *path, TFlt start_time,
 }
 
 TFlt
-get_path_travel_time_car (MNM_Path *path, TFlt start_time,
-                          std::unordered_map<TInt, TFlt *> &link_tt_map_car,
-                          TInt end_loading_timestamp)
+get_path_travel_time_car (
+  MNM_Path *path, TFlt start_time,
+  const std::unordered_map<TInt, TFlt *> &link_tt_map_car,
+  TInt end_loading_timestamp)
 {
   return get_path_travel_time (path, start_time, link_tt_map_car,
                                end_loading_timestamp);
@@ -4968,9 +5071,10 @@ get_path_travel_time_truck (MNM_Path *path, TFlt start_time,
 }
 
 TFlt
-get_path_travel_time_truck (MNM_Path *path, TFlt start_time,
-                            std::unordered_map<TInt, TFlt *> &link_tt_map_truck,
-                            TInt end_loading_timestamp)
+get_path_travel_time_truck (
+  MNM_Path *path, TFlt start_time,
+  const std::unordered_map<TInt, TFlt *> &link_tt_map_truck,
+  TInt end_loading_timestamp)
 {
   return get_path_travel_time (path, start_time, link_tt_map_truck,
                                end_loading_timestamp);
@@ -5564,10 +5668,12 @@ print_vehicle_statistics (MNM_Veh_Factory_Multiclass *veh_factory)
 }
 
 Path_Table *
-build_pathset_multiclass (macposts::Graph &graph, MNM_OD_Factory *od_factory,
+build_pathset_multiclass (const macposts::Graph &graph,
+                          MNM_OD_Factory *od_factory,
                           MNM_Link_Factory *link_factory, TFlt min_path_length,
                           size_t MaxIter, TFlt vot, TFlt Mid_Scale,
-                          TFlt Heavy_Scale, TInt buffer_length)
+                          TFlt Heavy_Scale, TInt buffer_length,
+                          int num_threads)
 {
   // printf("11\n");
   // MaxIter: maximum iteration to find alternative shortest path, when MaxIter
@@ -5605,21 +5711,16 @@ build_pathset_multiclass (macposts::Graph &graph, MNM_OD_Factory *od_factory,
         }
     }
 
-  // printf("111\n");
-  std::unordered_map<TInt, TInt> _mid_shortest_path_tree
-    = std::unordered_map<TInt, TInt> ();
-  std::unordered_map<TInt, TFlt> _mid_cost_map
-    = std::unordered_map<TInt, TFlt> ();
-  std::unordered_map<TInt, TInt> _heavy_shortest_path_tree
-    = std::unordered_map<TInt, TInt> ();
-  std::unordered_map<TInt, TFlt> _heavy_cost_map
-    = std::unordered_map<TInt, TFlt> ();
-
-  std::unordered_map<TInt, TFlt> _free_cost_map
-    = std::unordered_map<TInt, TFlt> ();
-  std::unordered_map<TInt, TInt> _free_shortest_path_tree
-    = std::unordered_map<TInt, TInt> ();
-  MNM_Path *_path;
+  std::vector<MNM_Pathset_Dest_Job> _jobs = MNM::get_pathset_dest_jobs (
+    _path_table, od_factory, [] (MNM_Origin *origin, MNM_Destination *dest) {
+      MNM_Origin_Multiclass *_origin
+        = dynamic_cast<MNM_Origin_Multiclass *> (origin);
+      return _origin->m_demand_car.find (
+               dynamic_cast<MNM_Destination_Multiclass *> (dest))
+             != _origin->m_demand_car.end ();
+    });
+
+  std::unordered_map<TInt, TFlt> _free_cost_map;
   for (auto _link_it = link_factory->m_link_map.begin ();
        _link_it != link_factory->m_link_map.end (); _link_it++)
     {
@@ -5628,185 +5729,19 @@ build_pathset_multiclass (macposts::Graph &graph, MNM_OD_Factory *od_factory,
                                vot * _link_it->second->get_link_tt ()
                                  + _link_it->second->m_toll));
     }
-  // printf("1111\n");
-  for (auto _d_it = od_factory->m_destination_map.begin ();
-       _d_it != od_factory->m_destination_map.end (); _d_it++)
-    {
-      _dest_node_ID = _d_it->second->m_dest_node->m_node_ID;
-      MNM_Shortest_Path::all_to_one_FIFO (_dest_node_ID, graph, _free_cost_map,
-                                          _free_shortest_path_tree);
-      for (auto _o_it = od_factory->m_origin_map.begin ();
-           _o_it != od_factory->m_origin_map.end (); _o_it++)
-        {
-          if (dynamic_cast<MNM_Origin_Multiclass *> (_o_it->second)
-                ->m_demand_car.find (
-                  dynamic_cast<MNM_Destination_Multiclass *> (_d_it->second))
-              == dynamic_cast<MNM_Origin_Multiclass *> (_o_it->second)
-                   ->m_demand_car.end ())
-            {
-              continue;
-            }
-          _origin_node_ID = _o_it->second->m_origin_node->m_node_ID;
-          _path = MNM::extract_path (_origin_node_ID, _dest_node_ID,
-                                     _free_shortest_path_tree, graph);
-          if (_path != nullptr)
-            {
-              if (_path->get_path_length (link_factory) > min_path_length)
-                {
-                  if (buffer_length > 0)
-                    {
-                      _path->allocate_buffer (buffer_length);
-                    }
-                  _path_table->find (_origin_node_ID)
-                    ->second->find (_dest_node_ID)
-                    ->second->m_path_vec.push_back (_path);
-                }
-            }
-          else
-            {
-              throw std::runtime_error (
-                "no path between origin " + std::to_string (_origin_node_ID)
-                + " and destination " + std::to_string (_dest_node_ID));
-            }
-        }
-    }
-  // printf("22\n");
-  _mid_cost_map.insert (_free_cost_map.begin (), _free_cost_map.end ());
-  _heavy_cost_map.insert (_free_cost_map.begin (), _free_cost_map.end ());
-
-  MNM_Dlink *_link;
-  MNM_Path *_path_mid, *_path_heavy;
-  size_t _CurIter = 0;
-  while (_CurIter < MaxIter)
-    {
-      printf ("Current trial %d\n", (int) _CurIter);
-      for (auto _o_it : *_path_table)
-        {
-          for (auto _d_it : *_o_it.second)
-            {
-              for (auto &_path : _d_it.second->m_path_vec)
-                {
-                  for (auto &_link_ID : _path->m_link_vec)
-                    {
-                      _link = link_factory->get_link (_link_ID);
-                      if (Mid_Scale > 1)
-                        {
-                          _mid_cost_map.find (_link_ID)->second
-                            = vot * _link->get_link_tt () * Mid_Scale
-                              + _link->m_toll;
-                        }
-                      if (Heavy_Scale > 1)
-                        {
-                          _heavy_cost_map.find (_link_ID)->second
-                            = vot * _link->get_link_tt () * Heavy_Scale
-                              + _link->m_toll;
-                        }
-                    }
-                }
-            }
-        }
-
-      for (auto _d_it = od_factory->m_destination_map.begin ();
-           _d_it != od_factory->m_destination_map.end (); _d_it++)
-        {
-          _dest_node_ID = _d_it->second->m_dest_node->m_node_ID;
-          if (Mid_Scale > 1)
-            {
-              MNM_Shortest_Path::all_to_one_FIFO (_dest_node_ID, graph,
-                                                  _mid_cost_map,
-                                                  _mid_shortest_path_tree);
-            }
-          if (Heavy_Scale > 1)
-            {
-              MNM_Shortest_Path::all_to_one_FIFO (_dest_node_ID, graph,
-                                                  _heavy_cost_map,
-                                                  _heavy_shortest_path_tree);
-            }
-          for (auto _o_it = od_factory->m_origin_map.begin ();
-               _o_it != od_factory->m_origin_map.end (); _o_it++)
-            {
-              if (dynamic_cast<MNM_Origin_Multiclass *> (_o_it->second)
-                    ->m_demand_car.find (
-                      dynamic_cast<MNM_Destination_Multiclass *> (
-                        _d_it->second))
-                  == dynamic_cast<MNM_Origin_Multiclass *> (_o_it->second)
-                       ->m_demand_car.end ())
-                {
-                  continue;
-                }
-              _origin_node_ID = _o_it->second->m_origin_node->m_node_ID;
-              _path_mid = nullptr;
-              _path_heavy = nullptr;
-              if (Mid_Scale > 1)
-                {
-                  _path_mid
-                    = MNM::extract_path (_origin_node_ID, _dest_node_ID,
-                                         _mid_shortest_path_tree, graph);
-                }
-              if (Heavy_Scale > 1)
-                {
-                  _path_heavy
-                    = MNM::extract_path (_origin_node_ID, _dest_node_ID,
-                                         _heavy_shortest_path_tree, graph);
-                }
-              if (_path_mid != nullptr)
-                {
-                  if (!_path_table->find (_origin_node_ID)
-                         ->second->find (_dest_node_ID)
-                         ->second->is_in (_path_mid))
-                    {
-                      if (_path_mid->get_path_length (link_factory)
-                          > min_path_length)
-                        {
-                          if (buffer_length > 0)
-                            {
-                              _path_mid->allocate_buffer (buffer_length);
-                            }
-                          _path_table->find (_origin_node_ID)
-                            ->second->find (_dest_node_ID)
-                            ->second->m_path_vec.push_back (_path_mid);
-                        }
-                    }
-                  else
-                    {
-                      delete _path_mid;
-                    }
-                }
-              if (_path_heavy != nullptr)
-                {
-                  if (!_path_table->find (_origin_node_ID)
-                         ->second->find (_dest_node_ID)
-                         ->second->is_in (_path_heavy))
-                    {
-                      if (_path_heavy->get_path_length (link_factory)
-                          > min_path_length)
-                        {
-                          if (buffer_length > 0)
-                            {
-                              _path_heavy->allocate_buffer (buffer_length);
-                            }
-                          _path_table->find (_origin_node_ID)
-                            ->second->find (_dest_node_ID)
-                            ->second->m_path_vec.push_back (_path_heavy);
-                        }
-                    }
-                  else
-                    {
-                      delete _path_heavy;
-                    }
-                }
-            }
-        }
-      _CurIter += 1;
-    }
-
-  _mid_shortest_path_tree.clear ();
-  _mid_cost_map.clear ();
-  _heavy_shortest_path_tree.clear ();
-  _heavy_cost_map.clear ();
-
-  _free_cost_map.clear ();
-  _free_shortest_path_tree.clear ();
+  // a scale of at most 1 is no penalty, skip that tree
+  MNM::build_penalty_pathsets (
+    graph, _jobs, _free_cost_map,
+    [&] (TInt link_ID, TFlt scale) {
+      MNM_Dlink *_link = link_factory->get_link (link_ID);
+      return vot * _link->get_link_tt () * scale + _link->m_toll;
+    },
+    MaxIter, Mid_Scale > 1 ? Mid_Scale : TFlt (0),
+    Heavy_Scale > 1 ? Heavy_Scale : TFlt (0),
+    [&] (MNM_Path *path) {
+      return path->get_path_length (link_factory) > min_path_length;
+    },
+    true, buffer_length, num_threads);
 
   return _path_table;
 }
@@ -5969,109 +5904,62 @@ MNM_Cumulative_Emission_Multiclass::~MNM_Cumulative_Emission_Multiclass () { ; }
 
 // All convert_factors from MOVES
 // Reference: MOVES default database - class 2b trucks with 4 tires
+// Truck/car emission ratios for v < 25, 25 <= v < 55 and v >= 55
+static const TFlt FUEL_TRUCK_FACTOR[3] = { 1.53, 1.50, 1.55 };
+static const TFlt CO2_TRUCK_FACTOR[3] = { 1.53, 1.50, 1.55 };
+static const TFlt HC_TRUCK_FACTOR[3] = { 1.87, 2.41, 2.01 };
+static const TFlt CO_TRUCK_FACTOR[3] = { 3.97, 2.67, 5.01 };
+static const TFlt NOX_TRUCK_FACTOR[3] = { 7.32, 6.03, 5.75 };
+
+static inline TFlt
+emission_truck_factor (TFlt v, const TFlt (&factor)[3])
+{
+  return factor[v < 25 ? 0 : (v < 55 ? 1 : 2)];
+}
+
 TFlt
 MNM_Cumulative_Emission_Multiclass::calculate_fuel_rate_truck (TFlt v)
 {
-  TFlt _convert_factor = 1.0;
-  if (v < 25)
-    {
-      _convert_factor = 1.53;
-    }
-  else if (v < 55)
-    {
-      _convert_factor = 1.50;
-    }
-  else
-    {
-      _convert_factor = 1.55;
-    }
-  TFlt _fuel_rate_car = calculate_fuel_rate (v);
-  TFlt _fuel_rate_truck = _fuel_rate_car * _convert_factor;
-  return _fuel_rate_truck;
+  return calculate_fuel_rate (v)
+         * emission_truck_factor (v, FUEL_TRUCK_FACTOR);
 }
 
 TFlt
 MNM_Cumulative_Emission_Multiclass::calculate_CO2_rate_truck (TFlt v)
 {
-  TFlt _convert_factor = 1.0;
-  if (v < 25)
-    {
-      _convert_factor = 1.53;
-    }
-  else if (v < 55)
-    {
-      _convert_factor = 1.50;
-    }
-  else
-    {
-      _convert_factor = 1.55;
-    }
-  TFlt _CO2_rate_car = calculate_CO2_rate (v);
-  TFlt _CO2_rate_truck = _CO2_rate_car * _convert_factor;
-  return _CO2_rate_truck;
+  return calculate_CO2_rate (v) * emission_truck_factor (v, CO2_TRUCK_FACTOR);
 }
 
 TFlt
 MNM_Cumulative_Emission_Multiclass::calculate_HC_rate_truck (TFlt v)
 {
-  TFlt _convert_factor = 1.0;
-  if (v < 25)
-    {
-      _convert_factor = 1.87;
-    }
-  else if (v < 55)
-    {
-      _convert_factor = 2.41;
-    }
-  else
-    {
-      _convert_factor = 2.01;
-    }
-  TFlt _HC_rate_car = calculate_HC_rate (v);
-  TFlt _HC_rate_truck = _HC_rate_car * _convert_factor;
-  return _HC_rate_truck;
+  return calculate_HC_rate (v) * emission_truck_factor (v, HC_TRUCK_FACTOR);
 }
 
 TFlt
 MNM_Cumulative_Emission_Multiclass::calculate_CO_rate_truck (TFlt v)
 {
-  TFlt _convert_factor = 1.0;
-  if (v < 25)
-    {
-      _convert_factor = 3.97;
-    }
-  else if (v < 55)
-    {
-      _convert_factor = 2.67;
-    }
-  else
-    {
-      _convert_factor = 5.01;
-    }
-  TFlt _CO_rate_car = calculate_CO_rate (v);
-  TFlt _CO_rate_truck = _CO_rate_car * _convert_factor;
-  return _CO_rate_truck;
+  return calculate_CO_rate (v) * emission_truck_factor (v, CO_TRUCK_FACTOR);
 }
 
 TFlt
 MNM_Cumulative_Emission_Multiclass::calculate_NOX_rate_truck (TFlt v)
 {
-  TFlt _convert_factor = 1.0;
-  if (v < 25)
-    {
-      _convert_factor = 7.32;
-    }
-  else if (v < 55)
+  return calculate_NOX_rate (v) * emission_truck_factor (v, NOX_TRUCK_FACTOR);
+}
+
+int
+MNM_Cumulative_Emission_Multiclass::register_trip (MNM_Veh *veh)
+{
+  if (veh->get_class () == 0)
     {
-      _convert_factor = 6.03;
+      m_car_set.insert (veh);
     }
-  else
+  else if (veh->get_class () == 1)
     {
-      _convert_factor = 5.75;
+      m_truck_set.insert (veh);
     }
-  TFlt _NOX_rate_car = calculate_NOX_rate (v);
-  TFlt _NOX_rate_truck = _NOX_rate_car * _convert_factor;
-  return _NOX_rate_truck;
+  return 0;
 }
 
 int
@@ -6079,18 +5967,17 @@ MNM_Cumulative_Emission_Multiclass::update (MNM_Veh_Factory *veh_factory)
 {
   // assume car truck the same speed on the same link when computing the
   // emissions possible to change to more accurate speeds for cars and trucks
-  TFlt _v, _nonev_ct_car, _ev_ct_car, _nonev_ct_truck, _ev_ct_truck;
-  TFlt _v_converted;
+  update_link_rates ();
+
+  TFlt _v, _dist, _nonev_ct_car, _ev_ct_car, _nonev_ct_truck, _ev_ct_truck;
   std::vector<TFlt> _veh_ct;
-  for (MNM_Dlink *link : m_link_vector)
+  for (size_t i = 0; i < m_link_vector.size (); ++i)
     {
       MNM_Dlink_Multiclass *_mlink
-        = dynamic_cast<MNM_Dlink_Multiclass *> (link);
+        = dynamic_cast<MNM_Dlink_Multiclass *> (m_link_vector[i]);
       IAssert (_mlink != nullptr);
-      _v = _mlink->m_length / _mlink->get_link_tt (); // m/s
-      _v_converted = _v * TFlt (3600) / TFlt (1600);  // mile / hour
-      _v_converted = std::max (_v_converted, TFlt (5));
-      _v_converted = std::min (_v_converted, TFlt (65));
+      _v = m_speed[i];
+      _dist = m_dist[i];
 
       _veh_ct = _mlink->get_link_flow_emission_car (m_ev_label);
       IAssert (_veh_ct.size () == 2);
@@ -6103,58 +5990,36 @@ MNM_Cumulative_Emission_Multiclass::update (MNM_Veh_Factory *veh_factory)
       _ev_ct_truck = _veh_ct[1];
 
       // cars
-      m_fuel += calculate_fuel_rate (_v_converted)
-                * (_v * m_unit_time / TFlt (1600)) * _nonev_ct_car;
-      m_CO2 += calculate_CO2_rate (_v_converted)
-               * (_v * m_unit_time / TFlt (1600)) * _nonev_ct_car;
-      m_HC += calculate_HC_rate (_v_converted)
-              * (_v * m_unit_time / TFlt (1600)) * _nonev_ct_car;
-      m_CO += calculate_CO_rate (_v_converted)
-              * (_v * m_unit_time / TFlt (1600)) * _nonev_ct_car;
-      m_NOX += calculate_NOX_rate (_v_converted)
-               * (_v * m_unit_time / TFlt (1600)) * _nonev_ct_car;
-      m_VMT += (_v * m_unit_time / TFlt (1600)) * (_nonev_ct_car + _ev_ct_car);
-      m_VMT_ev += (_v * m_unit_time / TFlt (1600)) * _ev_ct_car;
+      m_fuel += m_fuel_rate[i] * _dist * _nonev_ct_car;
+      m_CO2 += m_CO2_rate[i] * _dist * _nonev_ct_car;
+      m_HC += m_HC_rate[i] * _dist * _nonev_ct_car;
+      m_CO += m_CO_rate[i] * _dist * _nonev_ct_car;
+      m_NOX += m_NOX_rate[i] * _dist * _nonev_ct_car;
+      m_VMT += _dist * (_nonev_ct_car + _ev_ct_car);
+      m_VMT_ev += _dist * _ev_ct_car;
 
       // trucks
-      m_fuel_truck += calculate_fuel_rate_truck (_v_converted)
-                      * (_v * m_unit_time / TFlt (1600)) * _nonev_ct_truck;
-      m_CO2_truck += calculate_CO2_rate_truck (_v_converted)
-                     * (_v * m_unit_time / TFlt (1600)) * _nonev_ct_truck;
-      m_HC_truck += calculate_HC_rate_truck (_v_converted)
-                    * (_v * m_unit_time / TFlt (1600)) * _nonev_ct_truck;
-      m_CO_truck += calculate_CO_rate_truck (_v_converted)
-                    * (_v * m_unit_time / TFlt (1600)) * _nonev_ct_truck;
-      m_NOX_truck += calculate_NOX_rate_truck (_v_converted)
-                     * (_v * m_unit_time / TFlt (1600)) * _nonev_ct_truck;
-      m_VMT_truck
-        += (_v * m_unit_time / TFlt (1600)) * (_nonev_ct_truck + _ev_ct_truck);
-      m_VMT_ev_truck += (_v * m_unit_time / TFlt (1600)) * _ev_ct_truck;
+      m_fuel_truck += m_fuel_rate[i]
+                      * emission_truck_factor (_v, FUEL_TRUCK_FACTOR) * _dist
+                      * _nonev_ct_truck;
+      m_CO2_truck += m_CO2_rate[i]
+                     * emission_truck_factor (_v, CO2_TRUCK_FACTOR) * _dist
+                     * _nonev_ct_truck;
+      m_HC_truck += m_HC_rate[i] * emission_truck_factor (_v, HC_TRUCK_FACTOR)
+                    * _dist * _nonev_ct_truck;
+      m_CO_truck += m_CO_rate[i] * emission_truck_factor (_v, CO_TRUCK_FACTOR)
+                    * _dist * _nonev_ct_truck;
+      m_NOX_truck += m_NOX_rate[i]
+                     * emission_truck_factor (_v, NOX_TRUCK_FACTOR) * _dist
+                     * _nonev_ct_truck;
+      m_VMT_truck += _dist * (_nonev_ct_truck + _ev_ct_truck);
+      m_VMT_ev_truck += _dist * _ev_ct_truck;
 
       // VHT (hours)
       m_VHT_car += m_unit_time * (_nonev_ct_car + _ev_ct_car) / 3600;
       m_VHT_truck += m_unit_time * (_nonev_ct_truck + _ev_ct_truck) / 3600;
     }
-  // trips
-  MNM_Veh *_veh;
-  MNM_Veh_Multiclass *_veh_multiclass;
-  for (auto pair_it : veh_factory->m_veh_map)
-    {
-      _veh = pair_it.second;
-      _veh_multiclass = dynamic_cast<MNM_Veh_Multiclass *> (_veh);
-      if (m_link_set.find (_veh_multiclass->m_current_link)
-          != m_link_set.end ())
-        {
-          if (_veh_multiclass->m_class == 0)
-            {
-              m_car_set.insert (_veh_multiclass);
-            }
-          if (_veh_multiclass->m_class == 1)
-            {
-              m_truck_set.insert (_veh_multiclass);
-            }
-        }
-    }
+  // trips are counted by register_trip as vehicles enter the links
 
   return 0;
 }
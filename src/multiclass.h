@@ -37,6 +37,8 @@ public:
   int install_cumulative_curve_multiclass ();
   // use this one instead of the one in Dlink class
   int install_cumulative_curve_tree_multiclass ();
+  // the car and truck curves as well
+  virtual int add_memory_usage (MNM_Memory_Report &report) override;
 
   virtual TFlt get_link_flow_car () { return 0; };
   virtual TFlt get_link_flow_truck () { return 0; };
@@ -475,6 +477,7 @@ public:
   // use this one instead of make_veh in the base class
   MNM_Veh_Multiclass *
   make_veh_multiclass (TInt timestamp, Vehicle_type veh_type, TInt vehicle_cls);
+  virtual int count_new_veh (MNM_Veh *veh) override;
   virtual int remove_finished_veh (MNM_Veh *veh, bool del = true) override;
   TInt m_num_car;
   TInt m_num_truck;
@@ -648,12 +651,22 @@ TFlt get_travel_time_from_FD_truck (MNM_Dlink_Multiclass *link, TFlt start_time,
 
 TFlt get_travel_time_car (MNM_Dlink_Multiclass *link, TFlt start_time,
                           TFlt unit_interval, TInt end_loading_timestamp);
+// get_travel_time_car at each of start_times, see get_travel_time_batch
+int get_travel_time_car_batch (MNM_Dlink_Multiclass *link,
+                               const std::vector<TFlt> &start_times,
+                               TFlt unit_interval, TInt end_loading_timestamp,
+                               TFlt *tt);
 TFlt get_travel_time_car_robust (MNM_Dlink_Multiclass *link, TFlt start_time,
                                  TFlt end_time, TFlt unit_interval,
                                  TInt end_loading_timestamp,
                                  TInt num_trials = TInt (10));
 TFlt get_travel_time_truck (MNM_Dlink_Multiclass *link, TFlt start_time,
                             TFlt unit_interval, TInt end_loading_timestamp);
+// get_travel_time_truck at each of start_times, see get_travel_time_batch
+int get_travel_time_truck_batch (MNM_Dlink_Multiclass *link,
+                                 const std::vector<TFlt> &start_times,
+                                 TFlt unit_interval, TInt end_loading_timestamp,
+                                 TFlt *tt);
 TFlt get_travel_time_truck_robust (MNM_Dlink_Multiclass *link, TFlt start_time,
                                    TFlt end_time, TFlt unit_interval,
                                    TInt end_loading_timestamp,
@@ -662,18 +675,18 @@ TFlt get_travel_time_truck_robust (MNM_Dlink_Multiclass *link, TFlt start_time,
 TFlt get_path_travel_time_car (MNM_Path *path, TFlt start_time,
                                MNM_Link_Factory *link_factory,
                                TFlt unit_interval, TInt end_loading_timestamp);
-TFlt
-get_path_travel_time_car (MNM_Path *path, TFlt start_time,
-                          std::unordered_map<TInt, TFlt *> &link_tt_map_car,
-                          TInt end_loading_timestamp);
+TFlt get_path_travel_time_car (
+  MNM_Path *path, TFlt start_time,
+  const std::unordered_map<TInt, TFlt *> &link_tt_map_car,
+  TInt end_loading_timestamp);
 TFlt get_path_travel_time_truck (MNM_Path *path, TFlt start_time,
                                  MNM_Link_Factory *link_factory,
                                  TFlt unit_interval,
                                  TInt end_loading_timestamp);
-TFlt
-get_path_travel_time_truck (MNM_Path *path, TFlt start_time,
-                            std::unordered_map<TInt, TFlt *> &link_tt_map_truck,
-                            TInt end_loading_timestamp);
+TFlt get_path_travel_time_truck (
+  MNM_Path *path, TFlt start_time,
+  const std::unordered_map<TInt, TFlt *> &link_tt_map_truck,
+  TInt end_loading_timestamp);
 
 int add_dar_records_car (std::vector<dar_record *> &record,
                          MNM_Dlink_Multiclass *link,
@@ -737,13 +750,14 @@ namespace MNM
 {
 int print_vehicle_statistics (MNM_Veh_Factory_Multiclass *veh_factory);
 
-Path_Table *build_pathset_multiclass (macposts::Graph &graph,
+Path_Table *build_pathset_multiclass (const macposts::Graph &graph,
                                       MNM_OD_Factory *od_factory,
                                       MNM_Link_Factory *link_factory,
                                       TFlt min_path_length = 0.0,
                                       size_t MaxIter = 10, TFlt vot = 6.,
                                       TFlt Mid_Scale = 3, TFlt Heavy_Scale = 6,
-                                      TInt buffer_length = -1);
+                                      TInt buffer_length = -1,
+                                      int num_threads = 1);
 
 int print_vehicle_route_results (
   MNM_Veh_Factory_Multiclass *veh_factory, const std::string &folder,
@@ -772,6 +786,7 @@ public:
   TFlt calculate_CO_rate_truck (TFlt v);
   TFlt calculate_NOX_rate_truck (TFlt v);
 
+  virtual int register_trip (MNM_Veh *veh) override;
   virtual int update (MNM_Veh_Factory *veh_factory) override;
   virtual std::string output () override;
 
@@ -42,6 +42,7 @@ MNM_Busstop::MNM_Busstop (TInt ID, TInt linkID, TFlt linkloc, TFlt flow_scalar)
   m_flow_scalar = flow_scalar;
 
   m_routing = nullptr;
+  m_passenger_factory = nullptr;
 }
 
 MNM_Busstop::~MNM_Busstop () { ; }
@@ -143,7 +144,8 @@ MNM_Busstop_Physical::evolve (TInt timestamp)
               // passenger
               _in_walking_link->m_N_out->add_increment (
                 std::pair<TFlt, TFlt> (TFlt (timestamp + 1),
-                                       TFlt (1 / m_flow_scalar)));
+                                       TFlt (_passenger->m_count
+                                             / m_flow_scalar)));
             }
           if (_out_walking_link->m_N_in != nullptr)
             {
@@ -152,7 +154,8 @@ MNM_Busstop_Physical::evolve (TInt timestamp)
               // passenger
               _out_walking_link->m_N_in->add_increment (
                 std::pair<TFlt, TFlt> (TFlt (timestamp + 1),
-                                       TFlt (1 / m_flow_scalar)));
+                                       TFlt (_passenger->m_count
+                                             / m_flow_scalar)));
             }
           if (_in_walking_link->m_N_out_tree != nullptr)
             {
@@ -162,7 +165,8 @@ MNM_Busstop_Physical::evolve (TInt timestamp)
                   // + 1), TFlt(1), _passenger -> m_pnr_path, _passenger ->
                   // m_assign_interval); add flow_scalar to passenger
                   _in_walking_link->m_N_out_tree
-                    ->add_flow (TFlt (timestamp + 1), TFlt (1 / m_flow_scalar),
+                    ->add_flow (TFlt (timestamp + 1),
+                                TFlt (_passenger->m_count / m_flow_scalar),
                                 _passenger->m_pnr_path,
                                 _passenger->m_assign_interval);
                 }
@@ -172,7 +176,8 @@ MNM_Busstop_Physical::evolve (TInt timestamp)
                   // + 1), TFlt(1), _passenger -> m_transit_path, _passenger ->
                   // m_assign_interval); add flow_scalar to passenger
                   _in_walking_link->m_N_out_tree
-                    ->add_flow (TFlt (timestamp + 1), TFlt (1 / m_flow_scalar),
+                    ->add_flow (TFlt (timestamp + 1),
+                                TFlt (_passenger->m_count / m_flow_scalar),
                                 _passenger->m_transit_path,
                                 _passenger->m_assign_interval);
                 }
@@ -185,7 +190,8 @@ MNM_Busstop_Physical::evolve (TInt timestamp)
                   // + 1), TFlt(1), _passenger -> m_pnr_path, _passenger ->
                   // m_assign_interval); add flow_scalar to passenger
                   _out_walking_link->m_N_in_tree
-                    ->add_flow (TFlt (timestamp + 1), TFlt (1 / m_flow_scalar),
+                    ->add_flow (TFlt (timestamp + 1),
+                                TFlt (_passenger->m_count / m_flow_scalar),
                                 _passenger->m_pnr_path,
                                 _passenger->m_assign_interval);
                 }
@@ -195,7 +201,8 @@ MNM_Busstop_Physical::evolve (TInt timestamp)
                   // + 1), TFlt(1), _passenger -> m_transit_path, _passenger ->
                   // m_assign_interval); add flow_scalar to passenger
                   _out_walking_link->m_N_in_tree
-                    ->add_flow (TFlt (timestamp + 1), TFlt (1 / m_flow_scalar),
+                    ->add_flow (TFlt (timestamp + 1),
+                                TFlt (_passenger->m_count / m_flow_scalar),
                                 _passenger->m_transit_path,
                                 _passenger->m_assign_interval);
                 }
@@ -244,7 +251,8 @@ MNM_Busstop_Physical::evolve (TInt timestamp)
               // passenger
               _in_walking_link->m_N_out->add_increment (
                 std::pair<TFlt, TFlt> (TFlt (timestamp + 1),
-                                       TFlt (1 / m_flow_scalar)));
+                                       TFlt (_passenger->m_count
+                                             / m_flow_scalar)));
               if (MNM_Ults::approximate_less_than (_in_walking_link->m_N_in
                                                      ->m_recorder.back ()
                                                      .second,
@@ -262,7 +270,8 @@ MNM_Busstop_Physical::evolve (TInt timestamp)
               // passenger
               _out_walking_link->m_N_in->add_increment (
                 std::pair<TFlt, TFlt> (TFlt (timestamp + 1),
-                                       TFlt (1 / m_flow_scalar)));
+                                       TFlt (_passenger->m_count
+                                             / m_flow_scalar)));
             }
           if (_in_walking_link->m_N_out_tree != nullptr)
             {
@@ -272,7 +281,8 @@ MNM_Busstop_Physical::evolve (TInt timestamp)
                   // + 1), TFlt(1), _passenger -> m_pnr_path, _passenger ->
                   // m_assign_interval); add flow_scalar to passenger
                   _in_walking_link->m_N_out_tree
-                    ->add_flow (TFlt (timestamp + 1), TFlt (1 / m_flow_scalar),
+                    ->add_flow (TFlt (timestamp + 1),
+                                TFlt (_passenger->m_count / m_flow_scalar),
                                 _passenger->m_pnr_path,
                                 _passenger->m_assign_interval);
                 }
@@ -282,7 +292,8 @@ MNM_Busstop_Physical::evolve (TInt timestamp)
                   // + 1), TFlt(1), _passenger -> m_transit_path, _passenger ->
                   // m_assign_interval); add flow_scalar to passenger
                   _in_walking_link->m_N_out_tree
-                    ->add_flow (TFlt (timestamp + 1), TFlt (1 / m_flow_scalar),
+                    ->add_flow (TFlt (timestamp + 1),
+                                TFlt (_passenger->m_count / m_flow_scalar),
                                 _passenger->m_transit_path,
                                 _passenger->m_assign_interval);
                 }
@@ -295,7 +306,8 @@ MNM_Busstop_Physical::evolve (TInt timestamp)
                   // + 1), TFlt(1), _passenger -> m_pnr_path, _passenger ->
                   // m_assign_interval); add flow_scalar to passenger
                   _out_walking_link->m_N_in_tree
-                    ->add_flow (TFlt (timestamp + 1), TFlt (1 / m_flow_scalar),
+                    ->add_flow (TFlt (timestamp + 1),
+                                TFlt (_passenger->m_count / m_flow_scalar),
                                 _passenger->m_pnr_path,
                                 _passenger->m_assign_interval);
                 }
@@ -305,7 +317,8 @@ MNM_Busstop_Physical::evolve (TInt timestamp)
                   // + 1), TFlt(1), _passenger -> m_transit_path, _passenger ->
                   // m_assign_interval); add flow_scalar to passenger
                   _out_walking_link->m_N_in_tree
-                    ->add_flow (TFlt (timestamp + 1), TFlt (1 / m_flow_scalar),
+                    ->add_flow (TFlt (timestamp + 1),
+                                TFlt (_passenger->m_count / m_flow_scalar),
                                 _passenger->m_transit_path,
                                 _passenger->m_assign_interval);
                 }
@@ -443,7 +456,7 @@ MNM_Busstop_Virtual::hold_bus (MNM_Veh *veh, MNM_Veh_Multimodal *veh_multimodal,
           && _walking_link->m_walking_type == "alighting"
           && m_alighting_link == _walking_link)
         {
-          _num_alighting_passengers += 1;
+          _num_alighting_passengers += _passenger->m_count;
         }
     }
   // any remaining boarding capacity?
@@ -451,7 +464,7 @@ MNM_Busstop_Virtual::hold_bus (MNM_Veh *veh, MNM_Veh_Multimodal *veh_multimodal,
   // (int)veh_multimodal -> m_passenger_pool.size() + _num_alighting_passengers;
   // add flow_scalar to passenger
   TInt _remaining_capacity = veh_multimodal->m_capacity * flow_scalar
-                             - (int) veh_multimodal->m_passenger_pool.size ()
+                             - veh_multimodal->get_num_passenger ()
                              + _num_alighting_passengers;
   // any boarding passengers?
   if (_remaining_capacity > 0 && m_boarding_link != nullptr)
@@ -464,7 +477,7 @@ MNM_Busstop_Virtual::hold_bus (MNM_Veh *veh, MNM_Veh_Multimodal *veh_multimodal,
               && _bus_link->m_route_ID == veh_multimodal->m_bus_route_ID)
             {
               IAssert (_bus_link->m_link_ID == m_bus_out_link->m_link_ID);
-              _num_boarding_passengers += 1;
+              _num_boarding_passengers += _passenger->m_count;
             }
         }
     }
@@ -573,7 +586,8 @@ MNM_Busstop_Virtual::release_bus (TInt timestamp,
                   // passenger
                   m_bus_out_link->m_N_in->add_increment (
                     std::pair<TFlt, TFlt> (TFlt (timestamp + 1),
-                                           TFlt (1 / m_flow_scalar)));
+                                           TFlt (_passenger->m_count
+                                                 / m_flow_scalar)));
                 }
               if (m_bus_in_link->m_N_out != nullptr)
                 {
@@ -582,7 +596,8 @@ MNM_Busstop_Virtual::release_bus (TInt timestamp,
                   // passenger
                   m_bus_in_link->m_N_out->add_increment (
                     std::pair<TFlt, TFlt> (TFlt (timestamp + 1),
-                                           TFlt (1 / m_flow_scalar)));
+                                           TFlt (_passenger->m_count
+                                                 / m_flow_scalar)));
                 }
 
               // update cc tree for passengers already on board before this bus
@@ -597,7 +612,7 @@ MNM_Busstop_Virtual::release_bus (TInt timestamp,
                       // flow_scalar to passenger
                       m_bus_out_link->m_N_in_tree
                         ->add_flow (TFlt (timestamp + 1),
-                                    TFlt (1 / m_flow_scalar),
+                                    TFlt (_passenger->m_count / m_flow_scalar),
                                     _passenger->m_pnr_path,
                                     _passenger->m_assign_interval);
                     }
@@ -609,7 +624,7 @@ MNM_Busstop_Virtual::release_bus (TInt timestamp,
                       // flow_scalar to passenger
                       m_bus_out_link->m_N_in_tree
                         ->add_flow (TFlt (timestamp + 1),
-                                    TFlt (1 / m_flow_scalar),
+                                    TFlt (_passenger->m_count / m_flow_scalar),
                                     _passenger->m_transit_path,
                                     _passenger->m_assign_interval);
                     }
@@ -624,7 +639,7 @@ MNM_Busstop_Virtual::release_bus (TInt timestamp,
                       // flow_scalar to passenger
                       m_bus_in_link->m_N_out_tree
                         ->add_flow (TFlt (timestamp + 1),
-                                    TFlt (1 / m_flow_scalar),
+                                    TFlt (_passenger->m_count / m_flow_scalar),
                                     _passenger->m_pnr_path,
                                     _passenger->m_assign_interval);
                     }
@@ -636,7 +651,7 @@ MNM_Busstop_Virtual::release_bus (TInt timestamp,
                       // flow_scalar to passenger
                       m_bus_in_link->m_N_out_tree
                         ->add_flow (TFlt (timestamp + 1),
-                                    TFlt (1 / m_flow_scalar),
+                                    TFlt (_passenger->m_count / m_flow_scalar),
                                     _passenger->m_transit_path,
                                     _passenger->m_assign_interval);
                     }
@@ -935,7 +950,8 @@ MNM_Busstop_Virtual::virtual_evolve (TInt timestamp)
                   // passenger
                   m_bus_in_link->m_N_out->add_increment (
                     std::pair<TFlt, TFlt> (TFlt (timestamp + 1),
-                                           TFlt (1 / m_flow_scalar)));
+                                           TFlt (_passenger->m_count
+                                                 / m_flow_scalar)));
                 }
               if (_out_bus_link->m_N_in != nullptr)
                 {
@@ -944,7 +960,8 @@ MNM_Busstop_Virtual::virtual_evolve (TInt timestamp)
                   // passenger
                   _out_bus_link->m_N_in->add_increment (
                     std::pair<TFlt, TFlt> (TFlt (timestamp + 1),
-                                           TFlt (1 / m_flow_scalar)));
+                                           TFlt (_passenger->m_count
+                                                 / m_flow_scalar)));
                 }
               if (m_bus_in_link->m_N_out_tree != nullptr)
                 {
@@ -956,7 +973,7 @@ MNM_Busstop_Virtual::virtual_evolve (TInt timestamp)
                       // flow_scalar to passenger
                       m_bus_in_link->m_N_out_tree
                         ->add_flow (TFlt (timestamp + 1),
-                                    TFlt (1 / m_flow_scalar),
+                                    TFlt (_passenger->m_count / m_flow_scalar),
                                     _passenger->m_pnr_path,
                                     _passenger->m_assign_interval);
                     }
@@ -968,7 +985,7 @@ MNM_Busstop_Virtual::virtual_evolve (TInt timestamp)
                       // flow_scalar to passenger
                       m_bus_in_link->m_N_out_tree
                         ->add_flow (TFlt (timestamp + 1),
-                                    TFlt (1 / m_flow_scalar),
+                                    TFlt (_passenger->m_count / m_flow_scalar),
                                     _passenger->m_transit_path,
                                     _passenger->m_assign_interval);
                     }
@@ -982,7 +999,7 @@ MNM_Busstop_Virtual::virtual_evolve (TInt timestamp)
                       // m_assign_interval); add flow_scalar to passenger
                       _out_bus_link->m_N_in_tree
                         ->add_flow (TFlt (timestamp + 1),
-                                    TFlt (1 / m_flow_scalar),
+                                    TFlt (_passenger->m_count / m_flow_scalar),
                                     _passenger->m_pnr_path,
                                     _passenger->m_assign_interval);
                     }
@@ -993,7 +1010,7 @@ MNM_Busstop_Virtual::virtual_evolve (TInt timestamp)
                       // -> m_assign_interval); add flow_scalar to passenger
                       _out_bus_link->m_N_in_tree
                         ->add_flow (TFlt (timestamp + 1),
-                                    TFlt (1 / m_flow_scalar),
+                                    TFlt (_passenger->m_count / m_flow_scalar),
                                     _passenger->m_transit_path,
                                     _passenger->m_assign_interval);
                     }
@@ -1006,18 +1023,30 @@ MNM_Busstop_Virtual::virtual_evolve (TInt timestamp)
               IAssert (m_alighting_link != nullptr);
               IAssert (m_alighting_link->m_link_ID
                        == _passenger->get_next_link ()->m_link_ID);
-              if (_alighting_counter >= m_max_alighting_passengers_per_unit_time
-                                          * int (m_flow_scalar))
+              TInt _room = m_max_alighting_passengers_per_unit_time
+                             * int (m_flow_scalar)
+                           - _alighting_counter;
+              if (_room <= 0)
                 {
                   break;
                 }
+              if (_passenger->m_count > _room)
+                {
+                  // the rest of the cohort alights in the next interval
+                  _passenger
+                    = m_passenger_factory->split_passenger (_passenger, _room);
+                  _passenger_it++;
+                }
+              else
+                {
+                  _passenger_it
+                    = m_bus_in_link->m_finished_array.erase (_passenger_it);
+                }
               auto *_out_walking_link = dynamic_cast<MNM_Walking_Link *> (
                 _passenger->get_next_link ());
               _out_walking_link->m_finished_array.push_back (_passenger);
               _passenger->set_current_link (_out_walking_link);
-              _passenger_it
-                = m_bus_in_link->m_finished_array.erase (_passenger_it);
-              _alighting_counter += 1;
+              _alighting_counter += _passenger->m_count;
               if (m_bus_in_link->m_N_out != nullptr)
                 {
                   // m_bus_in_link -> m_N_out -> add_increment(std::pair<TFlt,
@@ -1025,7 +1054,8 @@ MNM_Busstop_Virtual::virtual_evolve (TInt timestamp)
                   // passenger
                   m_bus_in_link->m_N_out->add_increment (
                     std::pair<TFlt, TFlt> (TFlt (timestamp + 1),
-                                           TFlt (1 / m_flow_scalar)));
+                                           TFlt (_passenger->m_count
+                                                 / m_flow_scalar)));
                 }
               if (_out_walking_link->m_N_in != nullptr)
                 {
@@ -1034,7 +1064,8 @@ MNM_Busstop_Virtual::virtual_evolve (TInt timestamp)
                   // TFlt(1))); add flow_scalar to passenger
                   _out_walking_link->m_N_in->add_increment (
                     std::pair<TFlt, TFlt> (TFlt (timestamp + 1),
-                                           TFlt (1 / m_flow_scalar)));
+                                           TFlt (_passenger->m_count
+                                                 / m_flow_scalar)));
                 }
               if (m_bus_in_link->m_N_out_tree != nullptr)
                 {
@@ -1046,7 +1077,7 @@ MNM_Busstop_Virtual::virtual_evolve (TInt timestamp)
                       // flow_scalar to passenger
                       m_bus_in_link->m_N_out_tree
                         ->add_flow (TFlt (timestamp + 1),
-                                    TFlt (1 / m_flow_scalar),
+                                    TFlt (_passenger->m_count / m_flow_scalar),
                                     _passenger->m_pnr_path,
                                     _passenger->m_assign_interval);
                     }
@@ -1058,7 +1089,7 @@ MNM_Busstop_Virtual::virtual_evolve (TInt timestamp)
                       // flow_scalar to passenger
                       m_bus_in_link->m_N_out_tree
                         ->add_flow (TFlt (timestamp + 1),
-                                    TFlt (1 / m_flow_scalar),
+                                    TFlt (_passenger->m_count / m_flow_scalar),
                                     _passenger->m_transit_path,
                                     _passenger->m_assign_interval);
                     }
@@ -1073,7 +1104,7 @@ MNM_Busstop_Virtual::virtual_evolve (TInt timestamp)
                       // flow_scalar to passenger
                       _out_walking_link->m_N_in_tree
                         ->add_flow (TFlt (timestamp + 1),
-                                    TFlt (1 / m_flow_scalar),
+                                    TFlt (_passenger->m_count / m_flow_scalar),
                                     _passenger->m_pnr_path,
                                     _passenger->m_assign_interval);
                     }
@@ -1085,7 +1116,7 @@ MNM_Busstop_Virtual::virtual_evolve (TInt timestamp)
                       // flow_scalar to passenger
                       _out_walking_link->m_N_in_tree
                         ->add_flow (TFlt (timestamp + 1),
-                                    TFlt (1 / m_flow_scalar),
+                                    TFlt (_passenger->m_count / m_flow_scalar),
                                     _passenger->m_transit_path,
                                     _passenger->m_assign_interval);
                     }
@@ -1112,19 +1143,31 @@ MNM_Busstop_Virtual::virtual_evolve (TInt timestamp)
               IAssert (m_bus_out_link != nullptr);
               IAssert (m_bus_out_link->m_link_ID
                        == _passenger->get_next_link ()->m_link_ID);
-              if (_boarding_counter >= m_max_boarding_passengers_per_unit_time
-                                         * int (m_flow_scalar))
+              TInt _room = m_max_boarding_passengers_per_unit_time
+                             * int (m_flow_scalar)
+                           - _boarding_counter;
+              if (_room <= 0)
                 {
                   break;
                 }
+              if (_passenger->m_count > _room)
+                {
+                  // the rest of the cohort boards in the next interval
+                  _passenger
+                    = m_passenger_factory->split_passenger (_passenger, _room);
+                  _passenger_it++;
+                }
+              else
+                {
+                  _passenger_it
+                    = m_boarding_link->m_finished_array.erase (_passenger_it);
+                }
               auto *_out_bus_link
                 = dynamic_cast<MNM_Bus_Link *> (_passenger->get_next_link ());
               // waiting for bus is done in boarding link evolve()
               _out_bus_link->m_incoming_array.push_back (_passenger);
               _passenger->set_current_link (_out_bus_link);
-              _passenger_it
-                = m_boarding_link->m_finished_array.erase (_passenger_it);
-              _boarding_counter += 1;
+              _boarding_counter += _passenger->m_count;
               if (m_boarding_link->m_N_out != nullptr)
                 {
                   // m_boarding_link -> m_N_out -> add_increment(std::pair<TFlt,
@@ -1132,7 +1175,8 @@ MNM_Busstop_Virtual::virtual_evolve (TInt timestamp)
                   // passenger
                   m_boarding_link->m_N_out->add_increment (
                     std::pair<TFlt, TFlt> (TFlt (timestamp + 1),
-                                           TFlt (1 / m_flow_scalar)));
+                                           TFlt (_passenger->m_count
+                                                 / m_flow_scalar)));
                 }
               if (_out_bus_link->m_N_in != nullptr)
                 {
@@ -1141,7 +1185,8 @@ MNM_Busstop_Virtual::virtual_evolve (TInt timestamp)
                   // passenger
                   _out_bus_link->m_N_in->add_increment (
                     std::pair<TFlt, TFlt> (TFlt (timestamp + 1),
-                                           TFlt (1 / m_flow_scalar)));
+                                           TFlt (_passenger->m_count
+                                                 / m_flow_scalar)));
                 }
               if (m_boarding_link->m_N_out_tree != nullptr)
                 {
@@ -1153,7 +1198,7 @@ MNM_Busstop_Virtual::virtual_evolve (TInt timestamp)
                       // flow_scalar to passenger
                       m_boarding_link->m_N_out_tree
                         ->add_flow (TFlt (timestamp + 1),
-                                    TFlt (1 / m_flow_scalar),
+                                    TFlt (_passenger->m_count / m_flow_scalar),
                                     _passenger->m_pnr_path,
                                     _passenger->m_assign_interval);
                     }
@@ -1165,7 +1210,7 @@ MNM_Busstop_Virtual::virtual_evolve (TInt timestamp)
                       // flow_scalar to passenger
                       m_boarding_link->m_N_out_tree
                         ->add_flow (TFlt (timestamp + 1),
-                                    TFlt (1 / m_flow_scalar),
+                                    TFlt (_passenger->m_count / m_flow_scalar),
                                     _passenger->m_transit_path,
                                     _passenger->m_assign_interval);
                     }
@@ -1179,7 +1224,7 @@ MNM_Busstop_Virtual::virtual_evolve (TInt timestamp)
                       // m_assign_interval); add flow_scalar to passenger
                       _out_bus_link->m_N_in_tree
                         ->add_flow (TFlt (timestamp + 1),
-                                    TFlt (1 / m_flow_scalar),
+                                    TFlt (_passenger->m_count / m_flow_scalar),
                                     _passenger->m_pnr_path,
                                     _passenger->m_assign_interval);
                     }
@@ -1190,7 +1235,7 @@ MNM_Busstop_Virtual::virtual_evolve (TInt timestamp)
                       // -> m_assign_interval); add flow_scalar to passenger
                       _out_bus_link->m_N_in_tree
                         ->add_flow (TFlt (timestamp + 1),
-                                    TFlt (1 / m_flow_scalar),
+                                    TFlt (_passenger->m_count / m_flow_scalar),
                                     _passenger->m_transit_path,
                                     _passenger->m_assign_interval);
                     }
@@ -1217,7 +1262,8 @@ MNM_Busstop_Virtual::virtual_evolve (TInt timestamp)
                   // passenger
                   m_boarding_link->m_N_out->add_increment (
                     std::pair<TFlt, TFlt> (TFlt (timestamp + 1),
-                                           TFlt (1 / m_flow_scalar)));
+                                           TFlt (_passenger->m_count
+                                                 / m_flow_scalar)));
                 }
               if (_out_walking_link->m_N_in != nullptr)
                 {
@@ -1226,7 +1272,8 @@ MNM_Busstop_Virtual::virtual_evolve (TInt timestamp)
                   // TFlt(1))); add flow_scalar to passenger
                   _out_walking_link->m_N_in->add_increment (
                     std::pair<TFlt, TFlt> (TFlt (timestamp + 1),
-                                           TFlt (1 / m_flow_scalar)));
+                                           TFlt (_passenger->m_count
+                                                 / m_flow_scalar)));
                 }
               if (m_boarding_link->m_N_out_tree != nullptr)
                 {
@@ -1238,7 +1285,7 @@ MNM_Busstop_Virtual::virtual_evolve (TInt timestamp)
                       // flow_scalar to passenger
                       m_boarding_link->m_N_out_tree
                         ->add_flow (TFlt (timestamp + 1),
-                                    TFlt (1 / m_flow_scalar),
+                                    TFlt (_passenger->m_count / m_flow_scalar),
                                     _passenger->m_pnr_path,
                                     _passenger->m_assign_interval);
                     }
@@ -1250,7 +1297,7 @@ MNM_Busstop_Virtual::virtual_evolve (TInt timestamp)
                       // flow_scalar to passenger
                       m_boarding_link->m_N_out_tree
                         ->add_flow (TFlt (timestamp + 1),
-                                    TFlt (1 / m_flow_scalar),
+                                    TFlt (_passenger->m_count / m_flow_scalar),
                                     _passenger->m_transit_path,
                                     _passenger->m_assign_interval);
                     }
@@ -1265,7 +1312,7 @@ MNM_Busstop_Virtual::virtual_evolve (TInt timestamp)
                       // flow_scalar to passenger
                       _out_walking_link->m_N_in_tree
                         ->add_flow (TFlt (timestamp + 1),
-                                    TFlt (1 / m_flow_scalar),
+                                    TFlt (_passenger->m_count / m_flow_scalar),
                                     _passenger->m_pnr_path,
                                     _passenger->m_assign_interval);
                     }
@@ -1277,7 +1324,7 @@ MNM_Busstop_Virtual::virtual_evolve (TInt timestamp)
                       // flow_scalar to passenger
                       _out_walking_link->m_N_in_tree
                         ->add_flow (TFlt (timestamp + 1),
-                                    TFlt (1 / m_flow_scalar),
+                                    TFlt (_passenger->m_count / m_flow_scalar),
                                     _passenger->m_transit_path,
                                     _passenger->m_assign_interval);
                     }
@@ -1431,6 +1478,11 @@ MNM_Parking_Lot::release_one_interval_passenger (
 
   IAssert (m_in_passenger_queue.empty ());
 
+  // One passenger is made per parked car, so PnR passengers keep a count of
+  // one even when the passenger factory makes cohorts. Cars reach the parking
+  // lot one at a time with their own PnR path and assign interval, so there
+  // is nothing to group them by here, and PnR demand is small next to the
+  // transit demand cohorts are meant for.
   auto _veh_it = m_dest_node->m_out_veh_queue.begin ();
   while (_veh_it != m_dest_node->m_out_veh_queue.end ())
     {
@@ -1483,7 +1535,7 @@ MNM_Parking_Lot::release_one_interval_passenger (
                       _passenger->m_pnr_path = _pnr_path;
                       _passenger->m_driving_path = _pnr_path->m_driving_path;
                       _passenger->m_transit_path
-                        = _pnr_path->m_transit_path; // put this in m_tracker in
+                        = _pnr_path->m_transit_path; // routed by the
                                                      // passenger fixed routing
                       _passenger->m_assign_interval = _veh->m_assign_interval;
                       m_in_passenger_queue.push_back (_passenger);
@@ -1606,7 +1658,8 @@ MNM_Parking_Lot::evolve (TInt timestamp)
           // TFlt>(TFlt(timestamp + 1), TFlt(1))); add flow_scalar to passenger
           _link->m_N_in->add_increment (
             std::pair<TFlt, TFlt> (TFlt (timestamp + 1),
-                                   TFlt (1 / m_dest_node->m_flow_scalar)));
+                                   TFlt (_passenger->m_count
+                                         / m_dest_node->m_flow_scalar)));
         }
       if (_link->m_N_in_tree != nullptr)
         {
@@ -1615,7 +1668,8 @@ MNM_Parking_Lot::evolve (TInt timestamp)
           // _passenger -> m_pnr_path, _passenger -> m_assign_interval); add
           // flow_scalar to passenger
           _link->m_N_in_tree->add_flow (TFlt (timestamp + 1),
-                                        TFlt (1 / m_dest_node->m_flow_scalar),
+                                        TFlt (_passenger->m_count
+                                              / m_dest_node->m_flow_scalar),
                                         _passenger->m_pnr_path,
                                         _passenger->m_assign_interval);
         }
@@ -1690,10 +1744,12 @@ MNM_Passenger::MNM_Passenger (TInt ID, TInt start_time, TInt passenger_type)
   m_parking_lot = nullptr;
   m_start_time = start_time;
   m_finish_time = -1; // use to calculate number of still running passenger
+  m_waiting_time = 0;
   m_assign_interval = -1;
   m_driving_path = nullptr;
   m_transit_path = nullptr;
   m_pnr_path = nullptr;
+  m_count = 1;
 }
 
 MNM_Passenger::~MNM_Passenger ()
@@ -1778,6 +1834,12 @@ MNM_Passenger::set_origin (MNM_Origin *origin)
                                                                                          Passenger  Factory
 *******************************************************************************************************************
 ******************************************************************************************************************/
+namespace
+{
+// the batch of the release job run by this thread, see add_passenger
+thread_local std::vector<MNM_Passenger *> *passenger_batch = nullptr;
+}
+
 MNM_Passenger_Factory::MNM_Passenger_Factory ()
 {
   m_num_passenger = 0; // include m_num_passenger_pnr
@@ -1788,6 +1850,8 @@ MNM_Passenger_Factory::MNM_Passenger_Factory ()
   m_enroute_passenger_pnr = 0;
   m_finished_passenger_pnr = 0;
   m_passenger_map = std::unordered_map<TInt, MNM_Passenger *> ();
+  m_cohort = false;
+  m_last_passenger_ID = 0;
 }
 
 MNM_Passenger_Factory::~MNM_Passenger_Factory ()
@@ -1800,16 +1864,73 @@ MNM_Passenger_Factory::~MNM_Passenger_Factory ()
 }
 
 MNM_Passenger *
-MNM_Passenger_Factory::make_passenger (TInt timestamp, TInt passenger_type)
+MNM_Passenger_Factory::make_passenger (TInt timestamp, TInt passenger_type,
+                                      TInt count)
 {
   // printf("A passenger is produce at time %d, ID is %d\n", (int)timestamp,
   // (int)m_num_passenger + 1);
   MNM_Passenger *_passenger
-    = new MNM_Passenger (m_num_passenger + 1, timestamp, passenger_type);
-  m_passenger_map.insert ({ m_num_passenger + 1, _passenger });
-  m_num_passenger += 1; // m_enroute_passenger_pnr is updated in parking_lot ->
-                        // release_one_interval_passenger()
-  m_enroute_passenger += 1;
+    = new MNM_Passenger (m_last_passenger_ID + 1, timestamp, passenger_type);
+  _passenger->m_count = count;
+  add_passenger (_passenger);
+  return _passenger;
+}
+
+int
+MNM_Passenger_Factory::add_passenger (MNM_Passenger *passenger)
+{
+  if (passenger_batch != nullptr)
+    {
+      passenger_batch->push_back (passenger);
+      return 0;
+    }
+  m_last_passenger_ID += 1;
+  passenger->m_passenger_ID = m_last_passenger_ID;
+  m_passenger_map.insert ({ m_last_passenger_ID, passenger });
+  // m_enroute_passenger_pnr is updated in
+  // parking_lot -> release_one_interval_passenger()
+  m_num_passenger += passenger->m_count;
+  m_enroute_passenger += passenger->m_count;
+  return 0;
+}
+
+void
+MNM_Passenger_Factory::set_thread_batch (std::vector<MNM_Passenger *> *batch)
+{
+  passenger_batch = batch;
+}
+
+int
+MNM_Passenger_Factory::commit_batches (
+  std::vector<std::vector<MNM_Passenger *>> &batches)
+{
+  size_t _num_new = 0;
+  for (auto &_batch : batches)
+    _num_new += _batch.size ();
+  m_passenger_map.reserve (m_passenger_map.size () + _num_new);
+  for (auto &_batch : batches)
+    {
+      for (MNM_Passenger *_passenger : _batch)
+        add_passenger (_passenger);
+      _batch.clear ();
+    }
+  return 0;
+}
+
+MNM_Passenger *
+MNM_Passenger_Factory::split_passenger (MNM_Passenger *passenger, TInt count)
+{
+  if (count <= 0 || count >= passenger->m_count)
+    {
+      throw std::runtime_error (
+        "Error, MNM_Passenger_Factory::split_passenger, wrong count");
+    }
+  m_last_passenger_ID += 1;
+  MNM_Passenger *_passenger = new MNM_Passenger (*passenger);
+  _passenger->m_passenger_ID = m_last_passenger_ID;
+  _passenger->m_count = count;
+  passenger->m_count -= count;
+  m_passenger_map.insert ({ m_last_passenger_ID, _passenger });
   return _passenger;
 }
 
@@ -1843,19 +1964,19 @@ MNM_Passenger_Factory::remove_finished_passenger (MNM_Passenger *passenger,
     }
 
   IAssert (passenger->m_finish_time > passenger->m_start_time);
-  m_total_time_passenger
-    += (passenger->m_finish_time - passenger->m_start_time);
-  if (del)
-    {
-      delete passenger;
-    }
+  m_total_time_passenger += (passenger->m_finish_time - passenger->m_start_time)
+                            * passenger->m_count;
 
-  m_finished_passenger += 1;
-  m_enroute_passenger -= 1;
+  m_finished_passenger += passenger->m_count;
+  m_enroute_passenger -= passenger->m_count;
   if (passenger->m_pnr)
     {
-      m_finished_passenger_pnr += 1;
-      m_enroute_passenger_pnr -= 1;
+      m_finished_passenger_pnr += passenger->m_count;
+      m_enroute_passenger_pnr -= passenger->m_count;
+    }
+  if (del)
+    {
+      delete passenger;
     }
   IAssert (m_num_passenger >= m_num_passenger_pnr);
   IAssert (m_num_passenger == m_finished_passenger + m_enroute_passenger);
@@ -1896,6 +2017,15 @@ MNM_Veh_Multimodal::~MNM_Veh_Multimodal ()
   m_passenger_pool.clear ();
 }
 
+TInt
+MNM_Veh_Multimodal::get_num_passenger ()
+{
+  TInt _num = 0;
+  for (auto _passenger : m_passenger_pool)
+    _num += _passenger->m_count;
+  return _num;
+}
+
 int
 MNM_Veh_Multimodal::board_and_alight (TInt timestamp, MNM_Busstop *busstop)
 {
@@ -1936,18 +2066,31 @@ MNM_Veh_Multimodal::board_and_alight (TInt timestamp, MNM_Busstop *busstop)
           //     break;
           // }
           // add flow_scalar to passenger
-          if (_alighting_counter >= m_max_alighting_passengers_per_unit_time
-                                      * int (busstop->m_flow_scalar))
+          TInt _room = m_max_alighting_passengers_per_unit_time
+                         * int (busstop->m_flow_scalar)
+                       - _alighting_counter;
+          if (_room <= 0)
             {
               break;
             }
+          if (_passenger->m_count > _room)
+            {
+              // the rest of the cohort alights in the next interval
+              _passenger
+                = busstop->m_passenger_factory->split_passenger (_passenger,
+                                                                 _room);
+              _passenger_it++;
+            }
+          else
+            {
+              _passenger_it = m_passenger_pool.erase (_passenger_it);
+            }
           // // in cc of alighting link has been updated in
           // MNM_Busstop_Virtual::receive_bus()
           _walking_link->m_finished_array.push_back (_passenger);
           _passenger->m_waiting_time = 0;
           _passenger->set_current_link (_walking_link);
-          _passenger_it = m_passenger_pool.erase (_passenger_it);
-          _alighting_counter += 1;
+          _alighting_counter += _passenger->m_count;
 
           // update cc tree for passengers about to alight at this bus stop
           // update cc for passengers about to alight at this bus stop
@@ -1959,7 +2102,8 @@ MNM_Veh_Multimodal::board_and_alight (TInt timestamp, MNM_Busstop *busstop)
               // TFlt(1))); add flow_scalar to passenger
               _busstop_virtual->m_bus_in_link->m_N_out->add_increment (
                 std::pair<TFlt, TFlt> (TFlt (timestamp + 1),
-                                       TFlt (1 / busstop->m_flow_scalar)));
+                                       TFlt (_passenger->m_count
+                                             / busstop->m_flow_scalar)));
             }
           if (_busstop_virtual->m_bus_in_link->m_N_out_tree != nullptr)
             {
@@ -1971,7 +2115,8 @@ MNM_Veh_Multimodal::board_and_alight (TInt timestamp, MNM_Busstop *busstop)
                   // flow_scalar to passenger
                   _busstop_virtual->m_bus_in_link->m_N_out_tree
                     ->add_flow (TFlt (timestamp + 1),
-                                TFlt (1 / busstop->m_flow_scalar),
+                                TFlt (_passenger->m_count
+                                      / busstop->m_flow_scalar),
                                 _passenger->m_pnr_path,
                                 _passenger->m_assign_interval);
                 }
@@ -1983,7 +2128,8 @@ MNM_Veh_Multimodal::board_and_alight (TInt timestamp, MNM_Busstop *busstop)
                   // flow_scalar to passenger
                   _busstop_virtual->m_bus_in_link->m_N_out_tree
                     ->add_flow (TFlt (timestamp + 1),
-                                TFlt (1 / busstop->m_flow_scalar),
+                                TFlt (_passenger->m_count
+                                      / busstop->m_flow_scalar),
                                 _passenger->m_transit_path,
                                 _passenger->m_assign_interval);
                 }
@@ -1995,7 +2141,8 @@ MNM_Veh_Multimodal::board_and_alight (TInt timestamp, MNM_Busstop *busstop)
               // passenger
               _walking_link->m_N_in->add_increment (
                 std::pair<TFlt, TFlt> (TFlt (timestamp + 1),
-                                       TFlt (1 / busstop->m_flow_scalar)));
+                                       TFlt (_passenger->m_count
+                                             / busstop->m_flow_scalar)));
             }
           if (_walking_link->m_N_in_tree != nullptr)
             {
@@ -2006,7 +2153,8 @@ MNM_Veh_Multimodal::board_and_alight (TInt timestamp, MNM_Busstop *busstop)
                   // m_assign_interval); add flow_scalar to passenger
                   _walking_link->m_N_in_tree
                     ->add_flow (TFlt (timestamp + 1),
-                                TFlt (1 / busstop->m_flow_scalar),
+                                TFlt (_passenger->m_count
+                                      / busstop->m_flow_scalar),
                                 _passenger->m_pnr_path,
                                 _passenger->m_assign_interval);
                 }
@@ -2017,7 +2165,8 @@ MNM_Veh_Multimodal::board_and_alight (TInt timestamp, MNM_Busstop *busstop)
                   // m_assign_interval); add flow_scalar to passenger
                   _walking_link->m_N_in_tree
                     ->add_flow (TFlt (timestamp + 1),
-                                TFlt (1 / busstop->m_flow_scalar),
+                                TFlt (_passenger->m_count
+                                      / busstop->m_flow_scalar),
                                 _passenger->m_transit_path,
                                 _passenger->m_assign_interval);
                 }
@@ -2035,7 +2184,7 @@ MNM_Veh_Multimodal::board_and_alight (TInt timestamp, MNM_Busstop *busstop)
   // flow_scalar to passenger
   TInt _remaining_capacity
     = std::min (TInt (int (m_capacity * busstop->m_flow_scalar)
-                      - (int) m_passenger_pool.size ()),
+                      - get_num_passenger ()),
                 int (m_max_boarding_passengers_per_unit_time
                      * busstop->m_flow_scalar));
   if (_remaining_capacity > 0 && _busstop_virtual->m_boarding_link != nullptr)
@@ -2061,10 +2210,24 @@ MNM_Veh_Multimodal::board_and_alight (TInt timestamp, MNM_Busstop *busstop)
                     "Something wrong in passenger routing");
                 }
 
-              if (_boarding_counter >= _remaining_capacity)
+              TInt _room = _remaining_capacity - _boarding_counter;
+              if (_room <= 0)
                 {
                   break;
                 }
+              if (_passenger->m_count > _room)
+                {
+                  // the rest of the cohort waits for the next bus
+                  _passenger
+                    = busstop->m_passenger_factory->split_passenger (_passenger,
+                                                                     _room);
+                  _passenger_it++;
+                }
+              else
+                {
+                  _passenger_it
+                    = _walking_link->m_finished_array.erase (_passenger_it);
+                }
               m_passenger_pool.push_back (_passenger);
               _passenger->set_current_link (_bus_link);
               if (_walking_link->m_N_out != nullptr)
@@ -2074,7 +2237,8 @@ MNM_Veh_Multimodal::board_and_alight (TInt timestamp, MNM_Busstop *busstop)
                   // passenger
                   _walking_link->m_N_out->add_increment (
                     std::pair<TFlt, TFlt> (TFlt (timestamp + 1),
-                                           TFlt (1 / busstop->m_flow_scalar)));
+                                           TFlt (_passenger->m_count
+                                                 / busstop->m_flow_scalar)));
                 }
               if (_bus_link->m_N_in != nullptr)
                 {
@@ -2083,7 +2247,8 @@ MNM_Veh_Multimodal::board_and_alight (TInt timestamp, MNM_Busstop *busstop)
                   // passenger
                   _bus_link->m_N_in->add_increment (
                     std::pair<TFlt, TFlt> (TFlt (timestamp + 1),
-                                           TFlt (1 / busstop->m_flow_scalar)));
+                                           TFlt (_passenger->m_count
+                                                 / busstop->m_flow_scalar)));
                 }
               if (_walking_link->m_N_out_tree != nullptr)
                 {
@@ -2094,7 +2259,8 @@ MNM_Veh_Multimodal::board_and_alight (TInt timestamp, MNM_Busstop *busstop)
                       // m_assign_interval); add flow_scalar to passenger
                       _walking_link->m_N_out_tree
                         ->add_flow (TFlt (timestamp + 1),
-                                    TFlt (1 / busstop->m_flow_scalar),
+                                    TFlt (_passenger->m_count
+                                          / busstop->m_flow_scalar),
                                     _passenger->m_pnr_path,
                                     _passenger->m_assign_interval);
                     }
@@ -2105,7 +2271,8 @@ MNM_Veh_Multimodal::board_and_alight (TInt timestamp, MNM_Busstop *busstop)
                       // -> m_assign_interval); add flow_scalar to passenger
                       _walking_link->m_N_out_tree
                         ->add_flow (TFlt (timestamp + 1),
-                                    TFlt (1 / busstop->m_flow_scalar),
+                                    TFlt (_passenger->m_count
+                                          / busstop->m_flow_scalar),
                                     _passenger->m_transit_path,
                                     _passenger->m_assign_interval);
                     }
@@ -2119,7 +2286,8 @@ MNM_Veh_Multimodal::board_and_alight (TInt timestamp, MNM_Busstop *busstop)
                       // m_assign_interval); add flow_scalar to passenger
                       _bus_link->m_N_in_tree
                         ->add_flow (TFlt (timestamp + 1),
-                                    TFlt (1 / busstop->m_flow_scalar),
+                                    TFlt (_passenger->m_count
+                                          / busstop->m_flow_scalar),
                                     _passenger->m_pnr_path,
                                     _passenger->m_assign_interval);
                     }
@@ -2130,20 +2298,19 @@ MNM_Veh_Multimodal::board_and_alight (TInt timestamp, MNM_Busstop *busstop)
                       // -> m_assign_interval); add flow_scalar to passenger
                       _bus_link->m_N_in_tree
                         ->add_flow (TFlt (timestamp + 1),
-                                    TFlt (1 / busstop->m_flow_scalar),
+                                    TFlt (_passenger->m_count
+                                          / busstop->m_flow_scalar),
                                     _passenger->m_transit_path,
                                     _passenger->m_assign_interval);
                     }
                 }
-              _passenger_it
-                = _walking_link->m_finished_array.erase (_passenger_it);
-              _boarding_counter += 1;
+              _boarding_counter += _passenger->m_count;
             }
         }
     }
 
   // https://stackoverflow.com/questions/6926433/how-to-shuffle-a-stdvector
-  std::random_shuffle (m_passenger_pool.begin (), m_passenger_pool.end ());
+  MNM_Ults::random_shuffle (m_passenger_pool.begin (), m_passenger_pool.end ());
 
   return 0;
 }
@@ -2203,13 +2370,16 @@ MNM_Veh_Factory_Multimodal::make_veh_multimodal (
     {
       _veh->m_waiting_time = pickup_waiting_time;
     }
-  m_veh_map.insert ({ m_num_veh + 1, _veh });
+  add_veh (_veh);
+  return _veh;
+}
 
-  m_num_veh += 1;
-  m_enroute += 1;
-  if (vehicle_cls == 0)
+int
+MNM_Veh_Factory_Multimodal::count_new_veh (MNM_Veh *veh)
+{
+  if (veh->get_class () == 0)
     {
-      if (is_pnr)
+      if (veh->get_ispnr ())
         {
           m_num_car_pnr += 1;
           m_enroute_car_pnr += 1;
@@ -2220,9 +2390,9 @@ MNM_Veh_Factory_Multimodal::make_veh_multimodal (
           m_enroute_car += 1;
         }
     }
-  else if (vehicle_cls == 1)
+  else if (veh->get_class () == 1)
     {
-      if (bus_route_ID != -1)
+      if (veh->get_bus_route_ID () != -1)
         {
           m_num_bus += 1;
           m_enroute_bus += 1;
@@ -2233,7 +2403,7 @@ MNM_Veh_Factory_Multimodal::make_veh_multimodal (
           m_enroute_truck += 1;
         }
     }
-  return _veh;
+  return 0;
 }
 
 int
@@ -2342,7 +2512,8 @@ MNM_Destination_Multimodal::evolve (TInt timestamp)
                   // TFlt(1))); add flow_scalar to passenger
                   _next_walking_link->m_N_in->add_increment (
                     std::pair<TFlt, TFlt> (TFlt (timestamp + 1),
-                                           TFlt (1 / m_flow_scalar)));
+                                           TFlt (_passenger->m_count
+                                                 / m_flow_scalar)));
                 }
             }
           else
@@ -2362,7 +2533,8 @@ MNM_Destination_Multimodal::evolve (TInt timestamp)
               // passenger
               _link->m_N_out->add_increment (
                 std::pair<TFlt, TFlt> (TFlt (timestamp + 1),
-                                       TFlt (1 / m_flow_scalar)));
+                                       TFlt (_passenger->m_count
+                                             / m_flow_scalar)));
             }
         }
       IAssert (_link->m_finished_array.empty ());
@@ -2586,7 +2758,7 @@ MNM_Origin_Multimodal::evolve (TInt timestamp)
           // TFlt>(TFlt(timestamp + 1), TFlt(1))); add flow_scalar to passenger
           _link->m_N_in->add_increment (
             std::pair<TFlt, TFlt> (TFlt (timestamp + 1),
-                                   TFlt (1 / m_flow_scalar)));
+                                   TFlt (_passenger->m_count / m_flow_scalar)));
         }
       if (_link->m_N_in_tree != nullptr)
         {
@@ -2595,7 +2767,8 @@ MNM_Origin_Multimodal::evolve (TInt timestamp)
           // _passenger -> m_transit_path, _passenger -> m_assign_interval); add
           // flow_scalar to passenger
           _link->m_N_in_tree->add_flow (TFlt (timestamp + 1),
-                                        TFlt (1 / m_flow_scalar),
+                                        TFlt (_passenger->m_count
+                                              / m_flow_scalar),
                                         _passenger->m_transit_path,
                                         _passenger->m_assign_interval);
         }
@@ -2859,8 +3032,8 @@ MNM_Origin_Multimodal::release_one_interval (TInt current_interval,
         }
     }
   // https://stackoverflow.com/questions/6926433/how-to-shuffle-a-stdvector
-  std::random_shuffle (m_origin_node->m_in_veh_queue.begin (),
-                       m_origin_node->m_in_veh_queue.end ());
+  MNM_Ults::random_shuffle (m_origin_node->m_in_veh_queue.begin (),
+                            m_origin_node->m_in_veh_queue.end ());
 
   return 0;
 }
@@ -3066,8 +3239,8 @@ MNM_Origin_Multimodal::release_one_interval_biclass (
         }
     }
   // https://stackoverflow.com/questions/6926433/how-to-shuffle-a-stdvector
-  std::random_shuffle (m_origin_node->m_in_veh_queue.begin (),
-                       m_origin_node->m_in_veh_queue.end ());
+  MNM_Ults::random_shuffle (m_origin_node->m_in_veh_queue.begin (),
+                            m_origin_node->m_in_veh_queue.end ());
   return 0;
 }
 
@@ -3096,6 +3269,42 @@ MNM_Origin_Multimodal::release_one_interval_passenger (
       // _passenger_to_release = TInt(floor((_demand_it ->
       // second)[assign_interval] * m_flow_scalar));
 
+      if (passenger_factory->m_cohort)
+        {
+          // one cohort per passenger type, drawn as for single passengers
+          TInt _num_adaptive = 0;
+          if (adaptive_ratio == TFlt (1))
+            {
+              _num_adaptive = _passenger_to_release;
+            }
+          else if (adaptive_ratio != TFlt (0))
+            {
+              for (int i = 0; i < _passenger_to_release; ++i)
+                {
+                  if (MNM_Ults::rand_flt () <= adaptive_ratio)
+                    _num_adaptive += 1;
+                }
+            }
+          TInt _types[2] = { MNM_TYPE_STATIC, MNM_TYPE_ADAPTIVE };
+          TInt _counts[2]
+            = { _passenger_to_release - _num_adaptive, _num_adaptive };
+          for (int j = 0; j < 2; ++j)
+            {
+              if (_counts[j] == 0)
+                continue;
+              _passenger
+                = passenger_factory->make_passenger (current_interval,
+                                                     _types[j], _counts[j]);
+              _passenger->set_destination (_demand_it->first);
+              _passenger->set_origin (this);
+              _passenger->m_pnr = false;
+              _passenger->m_assign_interval
+                = int (current_interval / m_frequency);
+              m_in_passenger_queue.push_back (_passenger);
+            }
+          continue;
+        }
+
       for (int i = 0; i < _passenger_to_release; ++i)
         {
           if (adaptive_ratio == TFlt (0))
@@ -3134,8 +3343,8 @@ MNM_Origin_Multimodal::release_one_interval_passenger (
           m_in_passenger_queue.push_back (_passenger);
         }
     }
-  std::random_shuffle (m_in_passenger_queue.begin (),
-                       m_in_passenger_queue.end ());
+  MNM_Ults::random_shuffle (m_in_passenger_queue.begin (),
+                            m_in_passenger_queue.end ());
   return 0;
 }
 
@@ -3179,20 +3388,20 @@ MNM_OD_Factory_Multimodal::get_random_od_pair ()
   MNM_Destination_Multimodal *_dest;
 
   auto _origin_it = m_origin_map.begin ();
-  int random_index = rand () % m_origin_map.size ();
+  int random_index = MNM_Ults::rand_int (m_origin_map.size ());
   std::advance (_origin_it, random_index);
 
   _origin = dynamic_cast<MNM_Origin_Multimodal *> (_origin_it->second);
   while (_origin->m_demand_car.empty ())
     {
       _origin_it = m_origin_map.begin ();
-      random_index = rand () % m_origin_map.size ();
+      random_index = MNM_Ults::rand_int (m_origin_map.size ());
       std::advance (_origin_it, random_index);
       _origin = dynamic_cast<MNM_Origin_Multimodal *> (_origin_it->second);
     }
 
   auto _dest_it = _origin->m_demand_car.begin ();
-  random_index = rand () % _origin->m_demand_car.size ();
+  random_index = MNM_Ults::rand_int (_origin->m_demand_car.size ());
   std::advance (_dest_it, random_index);
   _dest = dynamic_cast<MNM_Destination_Multimodal *> (_dest_it->first);
 
@@ -3206,20 +3415,20 @@ MNM_OD_Factory_Multimodal::get_random_od_pair_bustransit ()
   MNM_Destination_Multimodal *_dest;
 
   auto _origin_it = m_origin_map.begin ();
-  int random_index = rand () % m_origin_map.size ();
+  int random_index = MNM_Ults::rand_int (m_origin_map.size ());
   std::advance (_origin_it, random_index);
 
   _origin = dynamic_cast<MNM_Origin_Multimodal *> (_origin_it->second);
   while (_origin->m_demand_passenger_bus.empty ())
     {
       _origin_it = m_origin_map.begin ();
-      random_index = rand () % m_origin_map.size ();
+      random_index = MNM_Ults::rand_int (m_origin_map.size ());
       std::advance (_origin_it, random_index);
       _origin = dynamic_cast<MNM_Origin_Multimodal *> (_origin_it->second);
     }
 
   auto _dest_it = _origin->m_demand_passenger_bus.begin ();
-  random_index = rand () % _origin->m_demand_passenger_bus.size ();
+  random_index = MNM_Ults::rand_int (_origin->m_demand_passenger_bus.size ());
   std::advance (_dest_it, random_index);
   _dest = dynamic_cast<MNM_Destination_Multimodal *> (_dest_it->first);
 
@@ -3233,20 +3442,20 @@ MNM_OD_Factory_Multimodal::get_random_od_pair_pnr ()
   MNM_Destination_Multimodal *_dest;
 
   auto _origin_it = m_origin_map.begin ();
-  int random_index = rand () % m_origin_map.size ();
+  int random_index = MNM_Ults::rand_int (m_origin_map.size ());
   std::advance (_origin_it, random_index);
 
   _origin = dynamic_cast<MNM_Origin_Multimodal *> (_origin_it->second);
   while (_origin->m_demand_pnr_car.empty ())
     {
       _origin_it = m_origin_map.begin ();
-      random_index = rand () % m_origin_map.size ();
+      random_index = MNM_Ults::rand_int (m_origin_map.size ());
       std::advance (_origin_it, random_index);
       _origin = dynamic_cast<MNM_Origin_Multimodal *> (_origin_it->second);
     }
 
   auto _dest_it = _origin->m_demand_pnr_car.begin ();
-  random_index = rand () % _origin->m_demand_pnr_car.size ();
+  random_index = MNM_Ults::rand_int (_origin->m_demand_pnr_car.size ());
   std::advance (_dest_it, random_index);
   _dest = dynamic_cast<MNM_Destination_Multimodal *> (_dest_it->first);
 
@@ -3318,7 +3527,7 @@ MNM_Transit_Link::MNM_Transit_Link (TInt link_ID,
   m_fftt = TFlt (-1); // seconds
   m_unit_time = unit_time;
 
-  m_passenger_queue = std::unordered_map<MNM_Passenger *, TInt> ();
+  m_passenger_queue = std::deque<std::pair<MNM_Passenger *, TInt>> ();
   m_finished_array = std::deque<MNM_Passenger *> ();
   m_incoming_array = std::deque<MNM_Passenger *> ();
 
@@ -3350,6 +3559,19 @@ MNM_Transit_Link::~MNM_Transit_Link ()
     delete m_N_out_tree;
 }
 
+int
+MNM_Transit_Link::move_finished_passenger (TInt timestamp, TInt max_stamp)
+{
+  TInt _last_entry = timestamp - std::max (0, max_stamp - 1);
+  while (!m_passenger_queue.empty ()
+         && m_passenger_queue.front ().second <= _last_entry)
+    {
+      m_finished_array.push_back (m_passenger_queue.front ().first);
+      m_passenger_queue.pop_front ();
+    }
+  return 0;
+}
+
 int
 MNM_Transit_Link::install_cumulative_curve ()
 {
@@ -3616,17 +3838,14 @@ MNM_Bus_Link::get_link_tt (bool count_runs)
 int
 MNM_Bus_Link::clear_incoming_array (TInt timestamp)
 {
-  MNM_Passenger *_passenger;
-  auto _passenger_it = m_incoming_array.begin ();
-  while (_passenger_it != m_incoming_array.end ())
+  for (MNM_Passenger *_passenger : m_incoming_array)
     {
-      _passenger = *_passenger_it;
       IAssert (_passenger->get_current_link ()->m_link_ID == m_link_ID);
       _passenger->m_waiting_time = 0;
-      m_passenger_queue.insert (
-        std::pair<MNM_Passenger *, TInt> (_passenger, TInt (0)));
-      _passenger_it = m_incoming_array.erase (_passenger_it);
+      m_passenger_queue.push_back (
+        std::pair<MNM_Passenger *, TInt> (_passenger, timestamp));
     }
+  m_incoming_array.clear ();
   return 0;
 }
 
@@ -3639,21 +3858,7 @@ MNM_Bus_Link::evolve (TInt timestamp)
   // if (_max_stamp > 2 * m_fftt / m_unit_time) {
   //     _max_stamp = int(2 * m_fftt / m_unit_time);
   // }
-  auto _passenger_it = m_passenger_queue.begin ();
-  while (_passenger_it != m_passenger_queue.end ())
-    {
-      if (_passenger_it->second >= std::max (0, _max_stamp - 1))
-        {
-          m_finished_array.push_back (_passenger_it->first);
-          _passenger_it = m_passenger_queue.erase (_passenger_it); // c++ 11
-        }
-      else
-        {
-          _passenger_it->second += 1;
-          _passenger_it++;
-        }
-    }
-  return 0;
+  return move_finished_passenger (timestamp, _max_stamp);
 }
 
 /**************************************************************************
@@ -3682,25 +3887,34 @@ MNM_Walking_Link::~MNM_Walking_Link () { ; }
 int
 MNM_Walking_Link::clear_incoming_array (TInt timestamp)
 {
-  MNM_Passenger *_passenger;
-  auto _passenger_it = m_incoming_array.begin ();
-  while (_passenger_it != m_incoming_array.end ())
+  auto _waiting_it = m_waiting_passenger.begin ();
+  while (_waiting_it != m_waiting_passenger.end ()
+         && _waiting_it->first <= timestamp)
+    {
+      _waiting_it->second->m_waiting_time = 0;
+      m_passenger_queue.push_back (
+        std::pair<MNM_Passenger *, TInt> (_waiting_it->second, timestamp));
+      _waiting_it = m_waiting_passenger.erase (_waiting_it);
+    }
+  for (MNM_Passenger *_passenger : m_incoming_array)
     {
-      _passenger = *_passenger_it;
       IAssert (_passenger->get_current_link ()->m_link_ID == m_link_ID);
       if (_passenger->m_waiting_time <= 0)
         {
           _passenger->m_waiting_time = 0;
-          m_passenger_queue.insert (
-            std::pair<MNM_Passenger *, TInt> (_passenger, TInt (0)));
-          _passenger_it = m_incoming_array.erase (_passenger_it);
+          m_passenger_queue.push_back (
+            std::pair<MNM_Passenger *, TInt> (_passenger, timestamp));
         }
       else
         {
-          _passenger->m_waiting_time -= 1;
-          _passenger_it++;
+          // waits one interval per unit of m_waiting_time, which is reset
+          // when it is done
+          m_waiting_passenger.insert (std::pair<TInt, MNM_Passenger *> (
+            timestamp + TInt (std::ceil (_passenger->m_waiting_time)),
+            _passenger));
         }
     }
+  m_incoming_array.clear ();
   return 0;
 }
 
@@ -3721,21 +3935,7 @@ MNM_Walking_Link::evolve (TInt timestamp)
       // for alighting links
       _max_stamp = TInt (0);
     }
-  auto _passenger_it = m_passenger_queue.begin ();
-  while (_passenger_it != m_passenger_queue.end ())
-    {
-      if (_passenger_it->second >= std::max (0, _max_stamp - 1))
-        {
-          m_finished_array.push_back (_passenger_it->first);
-          _passenger_it = m_passenger_queue.erase (_passenger_it); // c++ 11
-        }
-      else
-        {
-          _passenger_it->second += 1;
-          _passenger_it++;
-        }
-    }
-  return 0;
+  return move_finished_passenger (timestamp, _max_stamp);
 }
 
 TFlt
@@ -4044,7 +4244,7 @@ MNM_Dlink_Pq_Multimodal::evolve (TInt timestamp)
           // m_max_stamp = 0
           if (_que_it->second >= std::max (0, m_max_stamp - 1))
             {
-              m_finished_array.push_back (_veh);
+              add_finished_veh (_veh);
               if (_veh->get_class () == 0)
                 {
                   _num_car += 1;
@@ -4414,7 +4614,7 @@ MNM_Dlink_Ctm_Multimodal::move_veh_queue_in_last_cell (TInt timestamp)
               m_cell_array[m_num_cells - 1]->m_veh_queue_car.pop_front ();
               if (_veh->has_next_link ())
                 {
-                  m_finished_array.push_back (_veh);
+                  add_finished_veh (_veh);
                 }
               else
                 {
@@ -4480,7 +4680,7 @@ MNM_Dlink_Ctm_Multimodal::move_veh_queue_in_last_cell (TInt timestamp)
                       // reset
                       _veh_multimodal->m_stopped_intervals = 0;
                       _held = false;
-                      m_finished_array.push_back (_veh);
+                      add_finished_veh (_veh);
 
                       if ((_veh_multimodal->m_class == 1)
                           && (_veh_multimodal->m_bus_route_ID != TInt (-1)))
@@ -4571,7 +4771,7 @@ MNM_Dlink_Ctm_Multimodal::move_veh_queue_in_last_cell (TInt timestamp)
                       // reset
                       _veh_multimodal->m_stopped_intervals = 0;
                       _held = false;
-                      m_finished_array.push_back (_veh);
+                      add_finished_veh (_veh);
 
                       if ((_veh_multimodal->m_class == 1)
                           && (_veh_multimodal->m_bus_route_ID != TInt (-1)))
@@ -4608,7 +4808,7 @@ MNM_Dlink_Ctm_Multimodal::move_veh_queue_in_last_cell (TInt timestamp)
               m_cell_array[m_num_cells - 1]->m_veh_queue_car.pop_front ();
               if (_veh->has_next_link ())
                 {
-                  m_finished_array.push_back (_veh);
+                  add_finished_veh (_veh);
                 }
               else
                 {
@@ -5327,7 +5527,7 @@ MNM_PnR_Pathset::is_in (MNM_Path *path)
 /**************************************************************************
                           Bus Fixed Routing
 **************************************************************************/
-MNM_Routing_Bus::MNM_Routing_Bus (macposts::Graph &driving_graph,
+MNM_Routing_Bus::MNM_Routing_Bus (const macposts::Graph &driving_graph,
                                   MNM_OD_Factory *od_factory,
                                   MNM_Node_Factory *node_factory,
                                   MNM_Link_Factory *link_factory,
@@ -5348,12 +5548,7 @@ MNM_Routing_Bus::MNM_Routing_Bus (macposts::Graph &driving_graph,
 
 MNM_Routing_Bus::~MNM_Routing_Bus ()
 {
-  for (auto _map_it : m_tracker)
-    {
-      _map_it.second->clear ();
-      delete _map_it.second;
-    }
-  m_tracker.clear ();
+  m_path_links.clear ();
 
   // clear bus_path_table
   if ((m_bus_path_table != nullptr) && (!m_bus_path_table->empty ()))
@@ -5406,16 +5601,7 @@ MNM_Routing_Bus::register_veh (MNM_Veh *veh, bool track)
     }
   if (track)
     {
-      std::deque<TInt> *_link_queue = new std::deque<TInt> ();
-      // copy links in the route to _link_queue
-      // https://www.cplusplus.com/reference/iterator/back_inserter/
-      std::copy (_route_path->m_link_vec.begin (),
-                 _route_path->m_link_vec.end (),
-                 std::back_inserter (*_link_queue));
-      // printf("old link q is %d, New link queue is %d\n", _route_path ->
-      // m_link_vec.size(), _link_queue -> size());
-      m_tracker.insert (
-        std::pair<MNM_Veh *, std::deque<TInt> *> (veh, _link_queue));
+      set_veh_route (veh, _route_path);
     }
   veh->m_path = _route_path; // base vehicle class
   return 0;
@@ -5432,7 +5618,7 @@ MNM_Routing_Bus::update_routing (TInt timestamp)
 {
   MNM_Origin *_origin;
   MNM_DMOND *_origin_node;
-  TInt _node_ID, _next_link_ID;
+  TInt _node_ID;
   MNM_Dlink *_next_link;
   MNM_Veh_Multimodal *_veh_multimodal;
   TInt _cur_ass_int;
@@ -5455,14 +5641,11 @@ MNM_Routing_Bus::update_routing (TInt timestamp)
             {
               // Here is the difference from single-class fixed routing
 
-              if (m_tracker.find (_veh) == m_tracker.end ())
+              if (!_veh->m_route.is_set ())
                 {
                   // printf("Registering!\n");
                   register_veh (_veh, true);
-                  _next_link_ID = m_tracker.find (_veh)->second->front ();
-                  _next_link = m_link_factory->get_link (_next_link_ID);
-                  _veh->set_next_link (_next_link);
-                  m_tracker.find (_veh)->second->pop_front ();
+                  _veh->set_next_link (_veh->m_route.next ());
                 }
             }
         }
@@ -5475,7 +5658,8 @@ MNM_Routing_Bus::update_routing (TInt timestamp)
     {
       _link = _link_it.second;
       _node_ID = _link->m_to_node->m_node_ID;
-      for (auto _veh : _link->m_finished_array)
+      // vehicles queued longer were routed when they reached the link end
+      for (auto _veh : _link->get_new_finished (timestamp))
         {
           // Here is the difference from single-class fixed routing
           if ((_veh->m_type == MNM_TYPE_STATIC)
@@ -5488,7 +5672,7 @@ MNM_Routing_Bus::update_routing (TInt timestamp)
               _veh_dest = _veh->get_destination ();
               if (_veh_dest->m_dest_node->m_node_ID == _node_ID)
                 {
-                  if (!m_tracker.find (_veh)->second->empty ())
+                  if (!_veh->m_route.at_end ())
                     {
                       throw std::runtime_error (
                         "Something wrong in fixed bus routing!");
@@ -5497,15 +5681,15 @@ MNM_Routing_Bus::update_routing (TInt timestamp)
                 }
               else
                 {
-                  if (m_tracker.find (_veh) == m_tracker.end ())
+                  if (!_veh->m_route.is_set ())
                     {
                       throw std::runtime_error (
                         "Vehicle not registered in link, impossible!");
                     }
                   if (_veh->get_current_link () == _veh->get_next_link ())
                     {
-                      _next_link_ID = m_tracker.find (_veh)->second->front ();
-                      if (_next_link_ID == -1)
+                      _next_link = _veh->m_route.next ();
+                      if (_next_link == nullptr)
                         {
                           printf ("The node is %d, the vehicle should head to "
                                   "%d\n",
@@ -5514,9 +5698,7 @@ MNM_Routing_Bus::update_routing (TInt timestamp)
                           throw std::runtime_error (
                             "Something wrong in routing, wrong next link 2\n");
                         }
-                      _next_link = m_link_factory->get_link (_next_link_ID);
                       _veh->set_next_link (_next_link);
-                      m_tracker.find (_veh)->second->pop_front ();
                     }
                 } // end if-else
             }     // end if veh->m_type
@@ -5540,7 +5722,7 @@ MNM_Routing_Bus::remove_finished (MNM_Veh *veh, bool del)
                           PnR Fixed Vehicle Routing
 **************************************************************************/
 MNM_Routing_PnR_Fixed::MNM_Routing_PnR_Fixed (
-  macposts::Graph &driving_graph, MNM_OD_Factory *od_factory,
+  const macposts::Graph &driving_graph, MNM_OD_Factory *od_factory,
   MNM_Node_Factory *node_factory, MNM_Link_Factory *link_factory,
   PnR_Path_Table *pnr_path_table, TInt route_frq, TInt buffer_length,
   TInt veh_class)
@@ -5558,12 +5740,7 @@ MNM_Routing_PnR_Fixed::MNM_Routing_PnR_Fixed (
 
 MNM_Routing_PnR_Fixed::~MNM_Routing_PnR_Fixed ()
 {
-  for (auto _map_it : m_tracker)
-    {
-      _map_it.second->clear ();
-      delete _map_it.second;
-    }
-  m_tracker.clear ();
+  m_path_links.clear ();
 
   // clear pnr_path_table
   if ((m_pnr_path_table != nullptr) && (!m_pnr_path_table->empty ()))
@@ -5587,10 +5764,7 @@ MNM_Routing_PnR_Fixed::~MNM_Routing_PnR_Fixed ()
 int
 MNM_Routing_PnR_Fixed::change_choice_portion (TInt routing_interval)
 {
-  // m_veh_class starts from 0 (car) to 1 (truck)
-  MNM::copy_buffer_to_p (m_pnr_path_table, routing_interval);
-  MNM::normalize_path_table_p (m_pnr_path_table);
-  return 0;
+  return m_sampler.set_column (routing_interval);
 }
 
 // register each vehicle with a route based on the portion of path flow
@@ -5611,41 +5785,16 @@ MNM_Routing_PnR_Fixed::register_veh (MNM_Veh *veh, bool track)
         ->second
         ->find (_veh_multimodal->get_destination ()->m_dest_node->m_node_ID)
         ->second;
-  MNM_PnR_Path *_route_path = nullptr;
-  // printf("1\n");
-  // note m_path_vec is an ordered vector, not unordered
-
-  for (MNM_Path *_path : _pathset->m_path_vec)
-    {
-      // printf("2\n");
-      if (!MNM_Ults::approximate_less_than (_path->m_p, _r))
-        {
-          _route_path = dynamic_cast<MNM_PnR_Path *> (_path);
-          break;
-        }
-      else
-        {
-          _r -= _path->m_p;
-        }
-    }
-
-  // printf("3\n");
+  MNM_PnR_Path *_route_path
+    = dynamic_cast<MNM_PnR_Path *> (m_sampler.sample (_pathset, _r));
   if (_route_path == nullptr)
     {
       throw std::runtime_error ("Wrong probability in register_veh!");
     }
   if (track)
     {
-      auto *_link_queue = new std::deque<TInt> ();
-      // copy links in the route to _link_queue
-      // https://www.cplusplus.com/reference/iterator/back_inserter/
-      std::copy (_route_path->m_driving_path->m_link_vec.begin (),
-                 _route_path->m_driving_path->m_link_vec.end (),
-                 std::back_inserter (*_link_queue));
-      // printf("old link q is %d, New link queue is %d\n", _route_path ->
-      // m_link_vec.size(), _link_queue -> size());
-      m_tracker.insert (
-        std::pair<MNM_Veh *, std::deque<TInt> *> (veh, _link_queue));
+      // only the driving part, up to the parking lot
+      set_veh_route (veh, _route_path->m_driving_path);
     }
   veh->m_path = _route_path; // base vehicle class, base MNM_Path pointer to
                              // derived MNM_PnR_Path
@@ -5666,7 +5815,7 @@ MNM_Routing_PnR_Fixed::update_routing (TInt timestamp)
   // printf("MNM_Routing_Fixed::update_routing\n");
   MNM_Origin *_origin;
   MNM_DMOND *_origin_node;
-  TInt _node_ID, _next_link_ID;
+  TInt _node_ID;
   MNM_Dlink *_next_link;
   MNM_Veh_Multimodal *_veh_multimodal;
   TInt _cur_ass_int;
@@ -5698,16 +5847,13 @@ MNM_Routing_PnR_Fixed::update_routing (TInt timestamp)
               && _veh->get_bus_route_ID () == TInt (-1)
               && _veh_multimodal->get_ispnr ())
             {
-              if (m_tracker.find (_veh) == m_tracker.end ())
-                { // vehicle not in tracker
+              if (!_veh->m_route.is_set ())
+                { // vehicle not routed yet
                   // printf("Registering!\n");
                   register_veh (_veh, true);
                   // printf("1.3\n");
-                  _next_link_ID = m_tracker.find (_veh)->second->front ();
-                  _next_link = m_link_factory->get_link (_next_link_ID);
-                  _veh->set_next_link (_next_link);
-                  m_tracker.find (_veh)
-                    ->second->pop_front (); // adjust remaining links
+                  _veh->set_next_link (
+                    _veh->m_route.next ()); // adjust remaining links
                 }
             }
           // according to Dr. Wei Ma, add a nominal path to adaptive users for
@@ -5737,7 +5883,8 @@ MNM_Routing_PnR_Fixed::update_routing (TInt timestamp)
       // printf("2.02\n");
       _node_ID = _link->m_to_node->m_node_ID;
       // printf("2.1\n");
-      for (auto _veh : _link->m_finished_array)
+      // vehicles queued longer were routed when they reached the link end
+      for (auto _veh : _link->get_new_finished (timestamp))
         {
           _veh_multimodal = dynamic_cast<MNM_Veh_Multimodal *> (_veh);
           if (_veh_multimodal->m_type == MNM_TYPE_STATIC
@@ -5754,28 +5901,27 @@ MNM_Routing_PnR_Fixed::update_routing (TInt timestamp)
               // printf("2.2\n");
               if (_mid_dest_node_ID == _node_ID)
                 { // vehicles reaching mid destination
-                  if (!m_tracker.find (_veh)->second->empty ())
+                  if (!_veh->m_route.at_end ())
                     { // check if any links left in the route
                       throw std::runtime_error (
                         "Something wrong in fixed pnr routing!");
                     }
                   _veh->set_next_link (nullptr);
-                  // m_tracker.erase(m_tracker.find(_veh));
                 }
               else
                 { // vehicles enroute, adjust _next_link_ID, which is changed by
                   // node->evolve() in simulation dta.cpp
                   // printf("2.3\n");
-                  if (m_tracker.find (_veh) == m_tracker.end ())
-                    { // check if vehicle is registered in m_tracker, which
-                      // should be done in releasing from origin
+                  if (!_veh->m_route.is_set ())
+                    { // check if vehicle has a route, which should be set in
+                      // releasing from origin
                       throw std::runtime_error (
                         "Vehicle not registered in link, impossible!");
                     }
                   if (_veh->get_current_link () == _veh->get_next_link ())
                     {
-                      _next_link_ID = m_tracker.find (_veh)->second->front ();
-                      if (_next_link_ID == -1)
+                      _next_link = _veh->m_route.next ();
+                      if (_next_link == nullptr)
                         {
                           printf ("The node is %d, the vehicle should head to "
                                   "mid destination %d\n",
@@ -5784,9 +5930,7 @@ MNM_Routing_PnR_Fixed::update_routing (TInt timestamp)
                             "Something wrong in fixed pnr routing, wrong "
                             "next link 2\n");
                         }
-                      _next_link = m_link_factory->get_link (_next_link_ID);
                       _veh->set_next_link (_next_link);
-                      m_tracker.find (_veh)->second->pop_front ();
                     }
                 } // end if-else
             }     // end if veh->m_type
@@ -5810,7 +5954,7 @@ MNM_Routing_PnR_Fixed::remove_finished (MNM_Veh *veh, bool del)
                   Passenger Bus Transit Routing
 **************************************************************************/
 MNM_Routing_PassengerBusTransit::MNM_Routing_PassengerBusTransit (
-  macposts::Graph &transit_graph, MNM_OD_Factory *od_factory,
+  const macposts::Graph &transit_graph, MNM_OD_Factory *od_factory,
   MNM_Node_Factory *node_factory, MNM_Busstop_Factory *busstop_factory,
   MNM_Parking_Lot_Factory *parkinglot_factory,
   MNM_Transit_Link_Factory *transitlink_factory)
@@ -5821,6 +5965,7 @@ MNM_Routing_PassengerBusTransit::MNM_Routing_PassengerBusTransit (
   m_transitlink_factory = transitlink_factory;
   m_busstop_factory = busstop_factory;
   m_parkinglot_factory = parkinglot_factory;
+  m_passenger_factory = nullptr;
 }
 
 MNM_Routing_PassengerBusTransit::~MNM_Routing_PassengerBusTransit () { ; }
@@ -5829,7 +5974,7 @@ MNM_Routing_PassengerBusTransit::~MNM_Routing_PassengerBusTransit () { ; }
                   Passenger Bus Transit Fixed Routing
 **************************************************************************/
 MNM_Routing_PassengerBusTransit_Fixed::MNM_Routing_PassengerBusTransit_Fixed (
-  macposts::Graph &transit_graph, MNM_OD_Factory *od_factory,
+  const macposts::Graph &transit_graph, MNM_OD_Factory *od_factory,
   MNM_Node_Factory *node_factory, MNM_Busstop_Factory *busstop_factory,
   MNM_Parking_Lot_Factory *parkinglot_factory,
   MNM_Transit_Link_Factory *transitlink_factory,
@@ -5840,7 +5985,6 @@ MNM_Routing_PassengerBusTransit_Fixed::MNM_Routing_PassengerBusTransit_Fixed (
                                          parkinglot_factory,
                                          transitlink_factory)
 {
-  m_tracker = std::unordered_map<MNM_Passenger *, std::deque<TInt> *> ();
   if ((route_frq == -1) || (buffer_length == -1))
     {
       m_buffer_as_p = false;
@@ -5859,12 +6003,7 @@ MNM_Routing_PassengerBusTransit_Fixed::MNM_Routing_PassengerBusTransit_Fixed (
 
 MNM_Routing_PassengerBusTransit_Fixed::~MNM_Routing_PassengerBusTransit_Fixed ()
 {
-  for (auto _map_it : m_tracker)
-    {
-      _map_it.second->clear ();
-      delete _map_it.second;
-    }
-  m_tracker.clear ();
+  m_path_links.clear ();
 
   if ((m_bustransit_path_table != nullptr)
       && (!m_bustransit_path_table->empty ()))
@@ -5890,23 +6029,53 @@ int
 MNM_Routing_PassengerBusTransit_Fixed::change_choice_portion (
   TInt routing_interval)
 {
-  MNM::copy_buffer_to_p (m_bustransit_path_table, routing_interval);
-  MNM::normalize_path_table_p (m_bustransit_path_table);
-  return 0;
+  return m_sampler.set_column (routing_interval);
+}
+
+const std::vector<MNM_Transit_Link *> *
+MNM_Routing_PassengerBusTransit_Fixed::get_path_links (MNM_Path *path)
+{
+  auto _it = m_path_links.find (path);
+  if (_it == m_path_links.end ())
+    {
+      std::vector<MNM_Transit_Link *> _links;
+      _links.reserve (path->m_link_vec.size ());
+      for (TInt _link_ID : path->m_link_vec)
+        {
+          _links.push_back (m_transitlink_factory->get_transit_link (_link_ID));
+        }
+      _it = m_path_links.insert ({ path, std::move (_links) }).first;
+    }
+  return &_it->second;
 }
 
 int
-MNM_Routing_PassengerBusTransit_Fixed::add_passenger_path (
-  MNM_Passenger *passenger, std::deque<TInt> *link_que)
-{
-  std::deque<TInt> *_new_link_que = new std::deque<TInt> ();
-  std::copy (link_que->begin (), link_que->end (),
-             std::back_inserter (*_new_link_que));
-  m_tracker.insert (
-    std::pair<MNM_Passenger *, std::deque<TInt> *> (passenger, _new_link_que));
+MNM_Routing_PassengerBusTransit_Fixed::set_passenger_route (
+  MNM_Passenger *passenger, MNM_Path *path, size_t hop)
+{
+  passenger->m_route.set (get_path_links (path), hop);
   return 0;
 }
 
+MNM_Path *
+MNM_Routing_PassengerBusTransit_Fixed::sample_path (MNM_Passenger *passenger)
+{
+  TFlt _r = MNM_Ults::rand_flt ();
+
+  MNM_Pathset *_pathset
+    = m_bustransit_path_table
+        ->find (passenger->get_origin ()->m_origin_node->m_node_ID)
+        ->second->find (passenger->get_destination ()->m_dest_node->m_node_ID)
+        ->second;
+
+  MNM_Path *_route_path = m_sampler.sample (_pathset, _r);
+  if (_route_path == nullptr)
+    {
+      throw std::runtime_error ("Wrong probability!");
+    }
+  return _route_path;
+}
+
 int
 MNM_Routing_PassengerBusTransit_Fixed::register_passenger (
   MNM_Passenger *passenger, bool track)
@@ -5916,35 +6085,7 @@ MNM_Routing_PassengerBusTransit_Fixed::register_passenger (
   if (!passenger->m_pnr)
     {
       // direct bus transit
-      TFlt _r = MNM_Ults::rand_flt ();
-
-      MNM_Pathset *_pathset
-        = m_bustransit_path_table
-            ->find (passenger->get_origin ()->m_origin_node->m_node_ID)
-            ->second
-            ->find (passenger->get_destination ()->m_dest_node->m_node_ID)
-            ->second;
-
-      // printf("1\n");
-      // note m_path_vec is an ordered vector, not unordered
-      for (MNM_Path *_path : _pathset->m_path_vec)
-        {
-          // printf("2\n");
-          if (!MNM_Ults::approximate_less_than (_path->m_p, _r))
-            {
-              _route_path = _path;
-              break;
-            }
-          else
-            {
-              _r -= _path->m_p;
-            }
-        }
-      // printf("3\n");
-      if (_route_path == nullptr)
-        {
-          throw std::runtime_error ("Wrong probability!");
-        }
+      _route_path = sample_path (passenger);
       passenger->m_transit_path = _route_path;
     }
   else
@@ -5955,17 +6096,54 @@ MNM_Routing_PassengerBusTransit_Fixed::register_passenger (
     }
   if (track)
     {
-      std::deque<TInt> *_link_queue = new std::deque<TInt> ();
-      std::copy (
-        _route_path->m_link_vec.begin (), _route_path->m_link_vec.end (),
-        std::back_inserter (
-          *_link_queue)); // copy links in the route to _link_queue
-                          // https://www.cplusplus.com/reference/iterator/back_inserter/
-      // printf("old link q is %d, New link queue is %d\n", _route_path ->
-      // m_link_vec.size(), _link_queue -> size());
-      m_tracker.insert (
-        std::pair<MNM_Passenger *, std::deque<TInt> *> (passenger,
-                                                        _link_queue));
+      set_passenger_route (passenger, _route_path);
+    }
+  return 0;
+}
+
+int
+MNM_Routing_PassengerBusTransit_Fixed::register_cohort (
+  MNM_Passenger *passenger, bool track, std::deque<MNM_Passenger *> &queue)
+{
+  if (passenger->m_count == 1 || passenger->m_pnr)
+    {
+      return register_passenger (passenger, track);
+    }
+  // <path, travelers>, in the order the paths are first drawn
+  std::vector<std::pair<MNM_Path *, TInt>> _path_count;
+  for (TInt i = 0; i < passenger->m_count; ++i)
+    {
+      MNM_Path *_path = sample_path (passenger);
+      auto _it = std::find_if (_path_count.begin (), _path_count.end (),
+                               [_path] (const std::pair<MNM_Path *, TInt> &p) {
+                                 return p.first == _path;
+                               });
+      if (_it == _path_count.end ())
+        {
+          _path_count.push_back ({ _path, 1 });
+        }
+      else
+        {
+          _it->second += 1;
+        }
+    }
+  for (size_t i = 1; i < _path_count.size (); ++i)
+    {
+      MNM_Passenger *_cohort
+        = m_passenger_factory->split_passenger (passenger,
+                                                _path_count[i].second);
+      _cohort->m_transit_path = _path_count[i].first;
+      if (track)
+        {
+          set_passenger_route (_cohort, _path_count[i].first);
+          _cohort->set_next_link (_cohort->m_route.next ());
+        }
+      queue.push_back (_cohort);
+    }
+  passenger->m_transit_path = _path_count[0].first;
+  if (track)
+    {
+      set_passenger_route (passenger, _path_count[0].first);
     }
   return 0;
 }
@@ -5976,13 +6154,11 @@ MNM_Routing_PassengerBusTransit_Fixed::remove_finished (
 {
   IAssert (passenger->m_finish_time > 0
            && passenger->m_finish_time > passenger->m_start_time);
-  if (m_tracker.find (passenger) != m_tracker.end () && del)
+  if (passenger->m_route.is_set () && del)
     {
       IAssert (passenger->m_passenger_type
-               == MNM_TYPE_STATIC); // adaptive user not in m_tracker
-      m_tracker.find (passenger)->second->clear ();
-      delete m_tracker.find (passenger)->second;
-      m_tracker.erase (passenger);
+               == MNM_TYPE_STATIC); // adaptive user has no route
+      passenger->m_route.reset ();
     }
   return 0;
 }
@@ -5999,8 +6175,7 @@ MNM_Routing_PassengerBusTransit_Fixed::update_routing_origin (TInt timestamp)
   MNM_Origin *_origin;
   MNM_Origin_Multimodal *_origin_multimodal;
   MNM_DMOND *_origin_node;
-  TInt _node_ID, _next_link_ID;
-  MNM_Transit_Link *_next_link;
+  TInt _node_ID;
   TInt _cur_ass_int;
 
   if (m_buffer_as_p)
@@ -6022,22 +6197,22 @@ MNM_Routing_PassengerBusTransit_Fixed::update_routing_origin (TInt timestamp)
       _origin_node = _origin->m_origin_node;
       _node_ID = _origin_node->m_node_ID;
       _origin_multimodal = dynamic_cast<MNM_Origin_Multimodal *> (_origin);
-      for (auto _passenger : _origin_multimodal->m_in_passenger_queue)
+      std::deque<MNM_Passenger *> &_queue
+        = _origin_multimodal->m_in_passenger_queue;
+      // cohorts split by path are appended to the queue already routed
+      for (size_t i = 0; i < _queue.size (); ++i)
         {
+          MNM_Passenger *_passenger = _queue[i];
           // printf("1.2\n");
           if (_passenger->m_passenger_type == MNM_TYPE_STATIC)
             {
-              if (m_tracker.find (_passenger) == m_tracker.end ())
-                { // passenger not in tracker
+              if (!_passenger->m_route.is_set ())
+                { // passenger not routed yet
                   // printf("Registering!\n");
-                  register_passenger (_passenger, true);
+                  register_cohort (_passenger, true, _queue);
                   // printf("1.3\n");
-                  _next_link_ID = m_tracker.find (_passenger)->second->front ();
-                  _next_link
-                    = m_transitlink_factory->get_transit_link (_next_link_ID);
-                  _passenger->set_next_link (_next_link);
-                  m_tracker.find (_passenger)
-                    ->second->pop_front (); // adjust links left
+                  _passenger->set_next_link (
+                    _passenger->m_route.next ()); // adjust links left
                 }
             }
           // according to Dr. Wei Ma, add a nominal path to adaptive users for
@@ -6046,7 +6221,7 @@ MNM_Routing_PassengerBusTransit_Fixed::update_routing_origin (TInt timestamp)
             {
               if (_passenger->m_transit_path == nullptr)
                 {
-                  register_passenger (_passenger, false);
+                  register_cohort (_passenger, false, _queue);
                 }
               IAssert (_passenger->m_transit_path != nullptr);
             }
@@ -6060,8 +6235,6 @@ MNM_Routing_PassengerBusTransit_Fixed::update_routing_parkinglot (
   TInt timestamp)
 {
   MNM_Parking_Lot *_parking_lot;
-  TInt _next_link_ID;
-  MNM_Transit_Link *_next_link;
 
   for (auto _parkinglot_it : m_parkinglot_factory->m_parking_lot_map)
     {
@@ -6070,19 +6243,15 @@ MNM_Routing_PassengerBusTransit_Fixed::update_routing_parkinglot (
         {
           if (_passenger->m_passenger_type == MNM_TYPE_STATIC)
             {
-              if (m_tracker.find (_passenger) == m_tracker.end ())
-                { // passenger not in tracker
+              if (!_passenger->m_route.is_set ())
+                { // passenger not routed yet
                   // printf("Registering!\n");
                   IAssert (_passenger->m_driving_path != nullptr
                            && _passenger->m_pnr);
                   register_passenger (_passenger, true);
                   // printf("1.3\n");
-                  _next_link_ID = m_tracker.find (_passenger)->second->front ();
-                  _next_link
-                    = m_transitlink_factory->get_transit_link (_next_link_ID);
-                  _passenger->set_next_link (_next_link);
-                  m_tracker.find (_passenger)
-                    ->second->pop_front (); // adjust links left
+                  _passenger->set_next_link (
+                    _passenger->m_route.next ()); // adjust links left
                 }
               else
                 {
@@ -6105,7 +6274,7 @@ int
 MNM_Routing_PassengerBusTransit_Fixed::update_routing_one_link (
   TInt timestamp, MNM_Transit_Link *link)
 {
-  TInt _node_ID, _next_link_ID;
+  TInt _node_ID;
   MNM_Transit_Link *_next_link;
   MNM_Destination *_dest;
   MNM_Walking_Link *_walking_link;
@@ -6126,21 +6295,20 @@ MNM_Routing_PassengerBusTransit_Fixed::update_routing_one_link (
               if (_dest->m_dest_node->m_node_ID == _node_ID)
                 { // passengers reaching destination
                   IAssert (link->m_to_node_type == "destination");
-                  if (!(m_tracker.find (_passenger)->second->empty ()))
+                  if (!_passenger->m_route.at_end ())
                     { // check if any links left in the route
                       throw std::runtime_error (
                         "Something wrong in passenger bus transit fixed "
                         "routing!");
                     }
                   _passenger->set_next_link (nullptr);
-                  // m_tracker.erase(m_tracker.find(_passenger));
                 }
               else
                 { // passengers enroute, adjust _next_link_ID,
                   // printf("2.3\n");
-                  if (m_tracker.find (_passenger) == m_tracker.end ())
-                    { // check if passenger is registered in m_tracker, which
-                      // should be done in releasing from origin
+                  if (!_passenger->m_route.is_set ())
+                    { // check if passenger has a route, which should be set
+                      // in releasing from origin
                       throw std::runtime_error (
                         "Passenger not registered in link, impossible!");
                     }
@@ -6155,9 +6323,8 @@ MNM_Routing_PassengerBusTransit_Fixed::update_routing_one_link (
                   if (_passenger->get_current_link ()->m_link_ID
                       == _passenger->get_next_link ()->m_link_ID)
                     {
-                      _next_link_ID
-                        = m_tracker.find (_passenger)->second->front ();
-                      if (_next_link_ID == -1)
+                      _next_link = _passenger->m_route.next ();
+                      if (_next_link == nullptr)
                         {
                           printf ("The node is %d, the passenger should head "
                                   "to %d\n",
@@ -6166,10 +6333,7 @@ MNM_Routing_PassengerBusTransit_Fixed::update_routing_one_link (
                           throw std::runtime_error (
                             "Something wrong in routing, wrong next link 2");
                         }
-                      _next_link = m_transitlink_factory->get_transit_link (
-                        _next_link_ID);
                       _passenger->set_next_link (_next_link);
-                      m_tracker.find (_passenger)->second->pop_front ();
                     }
                 } // end if-else
             }     // end if passenger->m_type
@@ -6194,9 +6358,9 @@ MNM_Routing_PassengerBusTransit_Fixed::update_routing_one_link (
               else
                 { // passengers enroute, adjust _next_link_ID,
                   // printf("2.3\n");
-                  if (m_tracker.find (_passenger) == m_tracker.end ())
-                    { // check if passenger is registered in m_tracker, which
-                      // should be done in releasing from origin
+                  if (!_passenger->m_route.is_set ())
+                    { // check if passenger has a route, which should be set
+                      // in releasing from origin
                       throw std::runtime_error (
                         "Passenger not registered in link, impossible!");
                     }
@@ -6210,9 +6374,8 @@ MNM_Routing_PassengerBusTransit_Fixed::update_routing_one_link (
                   if (_passenger->get_current_link ()->m_link_ID
                       == _passenger->get_next_link ()->m_link_ID)
                     {
-                      _next_link_ID
-                        = m_tracker.find (_passenger)->second->front ();
-                      if (_next_link_ID == -1)
+                      _next_link = _passenger->m_route.next ();
+                      if (_next_link == nullptr)
                         {
                           printf ("The node is %d, the passenger should head "
                                   "to %d\n",
@@ -6221,10 +6384,7 @@ MNM_Routing_PassengerBusTransit_Fixed::update_routing_one_link (
                           throw std::runtime_error (
                             "Something wrong in routing, wrong next link 2");
                         }
-                      _next_link = m_transitlink_factory->get_transit_link (
-                        _next_link_ID);
                       _passenger->set_next_link (_next_link);
-                      m_tracker.find (_passenger)->second->pop_front ();
                     }
                 } // end if-else
             }     // end if passenger->m_type
@@ -6257,8 +6417,6 @@ int
 MNM_Routing_PassengerBusTransit_Fixed::update_routing_one_busstop (
   TInt timestamp, MNM_Busstop *busstop)
 {
-  TInt _next_link_ID;
-  MNM_Transit_Link *_next_link;
   auto *_busstop_virtual = dynamic_cast<MNM_Busstop_Virtual *> (busstop);
   if (_busstop_virtual == nullptr)
     {
@@ -6270,9 +6428,9 @@ MNM_Routing_PassengerBusTransit_Fixed::update_routing_one_busstop (
         {
           if (_passenger->m_passenger_type == MNM_TYPE_STATIC)
             {
-              if (m_tracker.find (_passenger) == m_tracker.end ())
-                { // check if passenger is registered in m_tracker, which should
-                  // be done in releasing from origin
+              if (!_passenger->m_route.is_set ())
+                { // check if passenger has a route, which should be set in
+                  // releasing from origin
                   throw std::runtime_error (
                     "Passenger on bus not registered, impossible!");
                 }
@@ -6284,11 +6442,7 @@ MNM_Routing_PassengerBusTransit_Fixed::update_routing_one_busstop (
                   && _passenger->get_current_link ()->m_link_ID
                        == _busstop_virtual->m_bus_in_link->m_link_ID)
                 {
-                  _next_link_ID = m_tracker.find (_passenger)->second->front ();
-                  _next_link
-                    = m_transitlink_factory->get_transit_link (_next_link_ID);
-                  _passenger->set_next_link (_next_link);
-                  m_tracker.find (_passenger)->second->pop_front ();
+                  _passenger->set_next_link (_passenger->m_route.next ());
                 }
             }
         }
@@ -6320,28 +6474,132 @@ MNM_Routing_PassengerBusTransit_Fixed::update_routing (TInt timestamp)
 }
 
 /**************************************************************************
-                  Passenger and Vehicle Adaptive Routing
+                  Passenger Transit Router
 **************************************************************************/
-MNM_Routing_Multimodal_Adaptive::MNM_Routing_Multimodal_Adaptive (
-  const std::string &file_folder, macposts::Graph &driving_graph,
-  macposts::Graph &transit_graph, MNM_Statistics *statistics,
-  MNM_OD_Factory *od_factory, MNM_Node_Factory *node_factory,
-  MNM_Busstop_Factory *busstop_factory,
-  MNM_Parking_Lot_Factory *parkinglot_factory, MNM_Link_Factory *link_factory,
-  MNM_Transit_Link_Factory *transitlink_factory)
-    : m_driving_graph (driving_graph), m_transit_graph (transit_graph)
+MNM_Transit_Router::MNM_Transit_Router (const macposts::Graph &graph)
 {
-  m_statistics = dynamic_cast<MNM_Statistics_Lrn_Multimodal *> (statistics);
-  IAssert (m_statistics != nullptr);
-  m_self_config = new MNM_ConfReader (file_folder + "/config.conf", "ADAPTIVE");
-  m_routing_freq = m_self_config->get_int ("route_frq");
-
-  // the unit of m_vot here is different from that of m_vot in DUE (money /
-  // interval)
-  try
+  m_node_ID.reserve (graph.size_nodes ());
+  for (const auto &node : graph.nodes ())
     {
-      m_vot = m_self_config->get_float ("vot")
-              / 3600.; // money / hour -> money / second
+      m_node_index.insert ({ graph.get_id (node), int (m_node_ID.size ()) });
+      m_node_ID.push_back (graph.get_id (node));
+    }
+  m_in_ptr.reserve (m_node_ID.size () + 1);
+  m_link_ID.reserve (graph.size_links ());
+  m_link_from.reserve (graph.size_links ());
+  m_in_ptr.push_back (0);
+  for (TInt _node_ID : m_node_ID)
+    {
+      const auto &node = graph.get_node (_node_ID);
+      for (const auto &link : graph.connections (node, Direction::Incoming))
+        {
+          const auto &in_node = graph.get_endpoints (link).first;
+          m_link_ID.push_back (graph.get_id (link));
+          m_link_from.push_back (
+            m_node_index.find (graph.get_id (in_node))->second);
+        }
+      m_in_ptr.push_back (int (m_link_ID.size ()));
+    }
+  m_link_cost.assign (m_link_ID.size (), TFlt (0));
+}
+
+int
+MNM_Transit_Router::set_link_cost (
+  const std::unordered_map<TInt, TFlt> &cost_map)
+{
+  for (size_t i = 0; i < m_link_ID.size (); ++i)
+    {
+      auto _it = cost_map.find (m_link_ID[i]);
+      if (_it == cost_map.end ())
+        {
+          throw std::runtime_error (
+            "MNM_Transit_Router::set_link_cost, no cost for link "
+            + std::to_string (m_link_ID[i]));
+        }
+      m_link_cost[i] = _it->second;
+    }
+  return 0;
+}
+
+int
+MNM_Transit_Router::update_tree (TInt dest_node_ID,
+                                 std::unordered_map<TInt, TInt> &output_map)
+{
+  auto _dest_it = m_node_index.find (dest_node_ID);
+  if (_dest_it == m_node_index.end ())
+    {
+      throw std::runtime_error (
+        "MNM_Transit_Router::update_tree, destination not in graph");
+    }
+  int _dest = _dest_it->second;
+  size_t _num_node = m_node_ID.size ();
+
+  m_cost.assign (_num_node, TFlt (std::numeric_limits<double>::infinity ()));
+  m_cost[_dest] = TFlt (0);
+  m_tree_link.assign (_num_node, -1);
+  m_in_queue.assign (_num_node, 0);
+  m_queue.clear ();
+  m_queue.push_back (_dest);
+  m_in_queue[_dest] = 1;
+
+  int _node, _in_node;
+  TFlt _alt, _node_cost;
+  while (!m_queue.empty ())
+    {
+      _node = m_queue.front ();
+      m_queue.pop_front ();
+      m_in_queue[_node] = 0;
+      _node_cost = m_cost[_node];
+      for (int i = m_in_ptr[_node]; i < m_in_ptr[_node + 1]; ++i)
+        {
+          _in_node = m_link_from[i];
+          _alt = _node_cost + m_link_cost[i];
+          if (_alt < m_cost[_in_node])
+            {
+              m_cost[_in_node] = _alt;
+              m_tree_link[_in_node] = i;
+              if (!m_in_queue[_in_node])
+                {
+                  m_queue.push_back (_in_node);
+                  m_in_queue[_in_node] = 1;
+                }
+            }
+        }
+    }
+
+  for (size_t i = 0; i < _num_node; ++i)
+    {
+      if (int (i) == _dest)
+        continue;
+      output_map[m_node_ID[i]]
+        = m_tree_link[i] < 0 ? TInt (-1) : m_link_ID[m_tree_link[i]];
+    }
+  return 0;
+}
+
+/**************************************************************************
+                  Passenger and Vehicle Adaptive Routing
+**************************************************************************/
+MNM_Routing_Multimodal_Adaptive::MNM_Routing_Multimodal_Adaptive (
+  const std::string &file_folder, const macposts::Graph &driving_graph,
+  const macposts::Graph &transit_graph, MNM_Statistics *statistics,
+  MNM_OD_Factory *od_factory, MNM_Node_Factory *node_factory,
+  MNM_Busstop_Factory *busstop_factory,
+  MNM_Parking_Lot_Factory *parkinglot_factory, MNM_Link_Factory *link_factory,
+  MNM_Transit_Link_Factory *transitlink_factory)
+    : m_driving_graph (driving_graph), m_transit_graph (transit_graph)
+{
+  m_statistics = dynamic_cast<MNM_Statistics_Lrn_Multimodal *> (statistics);
+  IAssert (m_statistics != nullptr);
+  m_self_config = new MNM_ConfReader (file_folder + "/config.conf", "ADAPTIVE");
+  m_routing_freq = m_self_config->get_int ("route_frq");
+
+  // the unit of m_vot here is different from that of m_vot in DUE (money /
+  // interval)
+  try
+    {
+      m_vot = m_self_config->get_float ("vot")
+              / 3600.; // money / hour -> money / second
     }
   catch (const std::invalid_argument &ia)
     {
@@ -6361,6 +6619,7 @@ MNM_Routing_Multimodal_Adaptive::MNM_Routing_Multimodal_Adaptive (
 
   m_driving_link_cost = std::unordered_map<TInt, TFlt> ();
   m_bustransit_link_cost = std::unordered_map<TInt, TFlt> ();
+  m_transit_router = nullptr;
 
   auto *_tmp_config = new MNM_ConfReader (file_folder + "/config.conf", "DTA");
   m_working = _tmp_config->get_float ("adaptive_ratio_passenger") > 0
@@ -6391,6 +6650,7 @@ MNM_Routing_Multimodal_Adaptive::~MNM_Routing_Multimodal_Adaptive ()
   m_transit_table->clear ();
   delete m_driving_table;
   delete m_transit_table;
+  delete m_transit_router;
   m_driving_link_cost.clear ();
   m_bustransit_link_cost.clear ();
 }
@@ -6434,6 +6694,8 @@ MNM_Routing_Multimodal_Adaptive::init_routing ()
       m_bustransit_link_cost.insert (
         std::pair<TInt, TFlt> (_link_it.first, -1));
     }
+  delete m_transit_router;
+  m_transit_router = new MNM_Transit_Router (m_transit_graph);
   return 0;
 }
 
@@ -6469,6 +6731,7 @@ MNM_Routing_Multimodal_Adaptive::update_routing (TInt timestamp)
     {
       // printf("Calculating the shortest path trees!\n");
       update_link_cost ();
+      m_transit_router->set_link_cost (m_bustransit_link_cost);
       for (auto _it : m_od_factory->m_destination_map)
         {
           // #pragma omp task firstprivate(_it)
@@ -6492,10 +6755,8 @@ MNM_Routing_Multimodal_Adaptive::update_routing (TInt timestamp)
           if (is_node (m_transit_graph, _dest_node_ID))
             {
               _shortest_path_tree = m_transit_table->find (_dest)->second;
-              MNM_Shortest_Path::all_to_one_FIFO (_dest_node_ID,
-                                                  m_transit_graph,
-                                                  m_bustransit_link_cost,
-                                                  *_shortest_path_tree);
+              m_transit_router->update_tree (_dest_node_ID,
+                                             *_shortest_path_tree);
               // MNM_Shortest_Path::all_to_one_FIFO(_dest_node_ID,
               // m_transit_graph, m_statistics ->
               // m_record_interval_tt_bus_transit, *_shortest_path_tree);
@@ -6662,7 +6923,7 @@ MNM_Routing_Multimodal_Adaptive::update_routing_passenger_one_link (
                             {
                               printf ("Assign randomly!\n");
                               auto it = outs.begin ();
-                              int idx = MNM_Ults::mod (rand (), deg);
+                              int idx = MNM_Ults::rand_int (deg);
                               while (idx--)
                                 it++;
                               _next_link_ID = m_transit_graph.get_id (*it);
@@ -6756,7 +7017,7 @@ MNM_Routing_Multimodal_Adaptive::update_routing_passenger_one_link (
                         {
                           printf ("Assign randomly!\n");
                           auto it = outs.begin ();
-                          int idx = MNM_Ults::mod (rand (), deg);
+                          int idx = MNM_Ults::rand_int (deg);
                           while (idx--)
                             it++;
                           _next_link_ID = m_transit_graph.get_id (*it);
@@ -6870,7 +7131,7 @@ MNM_Routing_Multimodal_Adaptive::update_routing_passenger_one_busstop (
                     {
                       printf ("Assign randomly!\n");
                       auto it = outs.begin ();
-                      int idx = MNM_Ults::mod (rand (), deg);
+                      int idx = MNM_Ults::rand_int (deg);
                       while (idx--)
                         it++;
                       _next_link_ID = m_transit_graph.get_id (*it);
@@ -6984,8 +7245,9 @@ MNM_Routing_Multimodal_Adaptive::find_mid_destination_for_pnr (
 
   _cur_best_path_tt = std::numeric_limits<double>::infinity ();
   // just use a random middle parking lot
-  std::random_shuffle (_final_dest->m_connected_pnr_parkinglot_vec.begin (),
-                       _final_dest->m_connected_pnr_parkinglot_vec.end ());
+  MNM_Ults::random_shuffle (
+    _final_dest->m_connected_pnr_parkinglot_vec.begin (),
+    _final_dest->m_connected_pnr_parkinglot_vec.end ());
   for (auto _parkinglot : _final_dest->m_connected_pnr_parkinglot_vec)
     {
       // TODO: not every parking lot is suitable, add more conditions, like
@@ -7223,7 +7485,7 @@ MNM_Routing_Multimodal_Adaptive::update_routing_vehicle (TInt timestamp)
                         {
                           printf ("Assign randomly!\n");
                           auto it = outs.begin ();
-                          int idx = MNM_Ults::mod (rand (), deg);
+                          int idx = MNM_Ults::rand_int (deg);
                           while (idx--)
                             it++;
                           _next_link_ID = m_driving_graph.get_id (*it);
@@ -7282,8 +7544,8 @@ MNM_Routing_Multimodal_Adaptive::update_routing_vehicle (TInt timestamp)
                           Multimodal_Hybrid Routing
 **************************************************************************/
 MNM_Routing_Multimodal_Hybrid::MNM_Routing_Multimodal_Hybrid (
-  const std::string &file_folder, macposts::Graph &driving_graph,
-  macposts::Graph &transit_graph, MNM_Statistics *statistics,
+  const std::string &file_folder, const macposts::Graph &driving_graph,
+  const macposts::Graph &transit_graph, MNM_Statistics *statistics,
   MNM_OD_Factory *od_factory, MNM_Node_Factory *node_factory,
   MNM_Link_Factory *link_factory, MNM_Busstop_Factory *busstop_factory,
   MNM_Parking_Lot_Factory *parkinglot_factory,
@@ -9297,7 +9559,7 @@ MNM_IO_Multimodal::load_pnr_path_table (const macposts::Graph &driving_graph,
 
               _path_table->find (_origin_node_ID)
                 ->second->find (_dest_node_ID)
-                ->second->m_path_vec.push_back (_path);
+                ->second->add_path (_path);
             }
         }
       _path_table_file.close ();
@@ -9432,7 +9694,7 @@ MNM_IO_Multimodal::load_bustransit_path_table (
 
               _path_table->find (_origin_node_ID)
                 ->second->find (_dest_node_ID)
-                ->second->m_path_vec.push_back (_path);
+                ->second->add_path (_path);
             }
         }
       _path_table_file.close ();
@@ -9508,10 +9770,20 @@ MNM_Dta_Multimodal::initialize ()
     delete m_config;
 
   m_config = new MNM_ConfReader (m_file_folder + "/config.conf", "DTA");
+  m_settings.load (m_config);
   m_unit_time = m_config->get_int ("unit_time");
   m_flow_scalar = m_config->get_int ("flow_scalar");
 
   m_passenger_factory = new MNM_Passenger_Factory ();
+  try
+    {
+      m_passenger_factory->m_cohort
+        = m_config->get_int ("passenger_cohort") > 0;
+    }
+  catch (const std::invalid_argument &ia)
+    {
+      m_passenger_factory->m_cohort = false;
+    }
   m_veh_factory
     = new MNM_Veh_Factory_Multimodal (TInt (m_config->get_int ("bus_capacity")),
                                       TInt (round (
@@ -9708,7 +9980,11 @@ MNM_Dta_Multimodal::set_routing ()
     {
       _busstop_it.second->m_routing
         = dynamic_cast<MNM_Routing_Multimodal_Hybrid *> (m_routing);
+      _busstop_it.second->m_passenger_factory = m_passenger_factory;
     }
+  dynamic_cast<MNM_Routing_Multimodal_Hybrid *> (m_routing)
+    ->m_routing_passenger_fixed->m_passenger_factory
+    = m_passenger_factory;
   return 0;
 }
 
@@ -9743,7 +10019,7 @@ MNM_Dta_Multimodal::build_from_files ()
                                             m_busstop_factory, m_link_factory,
                                             "bus_link");
 
-  m_graph = MNM_IO_Multimodal::build_graph (m_file_folder, m_config);
+  m_own_graph = MNM_IO_Multimodal::build_graph (m_file_folder, m_config);
   m_bus_transit_graph
     = MNM_IO_Multimodal::build_bus_transit_graph (m_config,
                                                   m_transitlink_factory);
@@ -10419,7 +10695,9 @@ MNM_Dta_Multimodal::record_queue_passengers ()
       if (auto *_walking_link
           = dynamic_cast<MNM_Walking_Link *> (_map_it.second))
         {
-          TInt _queue_size = _walking_link->m_finished_array.size ();
+          TInt _queue_size = 0;
+          for (auto _passenger : _walking_link->m_finished_array)
+            _queue_size += _passenger->m_count;
           _tot_queue_size += _queue_size;
           m_queue_passenger_map[_walking_link->m_link_ID]->push_back (
             _queue_size);
@@ -10432,13 +10710,14 @@ MNM_Dta_Multimodal::record_queue_passengers ()
 int
 MNM_Dta_Multimodal::record_enroute_passengers ()
 {
-  TInt _total_passenger = TInt (m_passenger_factory->m_passenger_map.size ());
+  TInt _total_passenger = 0;
   TInt _finished_passenger = 0;
   TInt _enroute_passenger;
   for (auto _map_it : m_passenger_factory->m_passenger_map)
     {
+      _total_passenger += _map_it.second->m_count;
       if (_map_it.second->m_finish_time > 0)
-        _finished_passenger += 1;
+        _finished_passenger += _map_it.second->m_count;
     }
   _enroute_passenger = _total_passenger - _finished_passenger;
   m_enroute_passenger_num.push_back (_enroute_passenger);
@@ -10484,8 +10763,10 @@ MNM_Dta_Multimodal::load_once (bool verbose, TInt load_int, TInt assign_int)
     printf ("-------------------------------    Interval %d   "
             "------------------------------ \n",
             (int) load_int);
+  MNM_Phase_Timer _timer (m_profiler, load_int);
   if (verbose)
     printf ("Releasing from origins!\n");
+  _timer.start ("release");
   // step 1: origins releasing vehicles and passengers
   // for (auto _origin_it = m_od_factory -> m_origin_map.begin(); _origin_it !=
   // m_od_factory -> m_origin_map.end(); _origin_it++){
@@ -10497,87 +10778,98 @@ MNM_Dta_Multimodal::load_once (bool verbose, TInt load_int, TInt assign_int)
   // m_total_assign_inter = total number of 1 min intervals
   // assign_int = the count of 1 min intervals, the vehicles and passengers
   // record this assign_int
+  // origin is a base origin class pointer to a multimodal origin object
+  auto _release = [&] (MNM_Origin *origin) {
+    auto *_mm_origin = dynamic_cast<MNM_Origin_Multimodal *> (origin);
+    if (assign_int >= m_total_assign_inter)
+      {
+        origin->release_one_interval (load_int, m_veh_factory, -1, TFlt (-1));
+        _mm_origin->release_one_interval_passenger (load_int,
+                                                    m_passenger_factory, -1,
+                                                    TFlt (-1));
+      }
+    else
+      {
+        if (m_settings.is_multimodal ())
+          {
+            // NOTE: in this case the release function is different
+            origin->release_one_interval_biclass (
+              load_int, m_veh_factory, assign_int,
+              m_settings.m_adaptive_ratio_car,
+              m_settings.m_adaptive_ratio_truck);
+            _mm_origin->release_one_interval_passenger (
+              load_int, m_passenger_factory, assign_int,
+              m_settings.m_adaptive_ratio_passenger);
+          }
+        // else if(m_config -> get_string("routing_type") ==
+        // "Multimodal_DUE_FixedPath" ||
+        //         m_config -> get_string("routing_type") ==
+        //         "Multimodal_DUE_ColumnGeneration"){
+        //     _origin -> release_one_interval_biclass(load_int,
+        //     m_veh_factory, assign_int, 0., 0.); _origin_multimodal ->
+        //     release_one_interval_passenger(load_int,
+        //     m_passenger_factory, assign_int, 0.);
+        // }
+        else
+          {
+            throw std::runtime_error ("WARNING:No assignment!");
+          }
+      }
+  };
   if (load_int % m_assign_freq == 0 || load_int == 0)
     {
-      for (auto _origin_it : m_od_factory->m_origin_map)
-        {
-          _origin = _origin_it.second; // base origin class pointer to
-                                       // multimodal origin object
-          _origin_multimodal = dynamic_cast<MNM_Origin_Multimodal *> (_origin);
-          if (assign_int >= m_total_assign_inter)
+      if (m_settings.m_release_threads > 0)
+        {
+          std::vector<MNM_Origin *> _origins;
+          for (auto _origin_it : m_od_factory->m_origin_map)
+            _origins.push_back (_origin_it.second);
+          // the passengers are batched per origin like the vehicles
+          std::vector<std::vector<MNM_Passenger *>> _passenger_batches (
+            _origins.size ());
+          try
+            {
+              MNM::release_origins (
+                _origins.size (), m_settings.m_release_threads, m_veh_factory,
+                [&] (size_t i) {
+                  MNM_Passenger_Factory::set_thread_batch (
+                    &_passenger_batches[i]);
+                  try
+                    {
+                      _release (_origins[i]);
+                    }
+                  catch (...)
+                    {
+                      MNM_Passenger_Factory::set_thread_batch (nullptr);
+                      throw;
+                    }
+                  MNM_Passenger_Factory::set_thread_batch (nullptr);
+                });
+            }
+          catch (...)
             {
-              _origin->release_one_interval (load_int, m_veh_factory, -1,
-                                             TFlt (-1));
-              _origin_multimodal
-                ->release_one_interval_passenger (load_int, m_passenger_factory,
-                                                  -1, TFlt (-1));
+              m_passenger_factory->commit_batches (_passenger_batches);
+              throw;
             }
-          else
+          m_passenger_factory->commit_batches (_passenger_batches);
+        }
+      else
+        {
+          for (auto _origin_it : m_od_factory->m_origin_map)
             {
-              if ((m_config->get_string ("routing_type") == "Multimodal_Hybrid")
-                  || m_config->get_string ("routing_type")
-                       == "Multimodal_Hybrid_ColumnGeneration"
-                  || m_config->get_string ("routing_type")
-                       == "Multimodal_DUE_FixedPath"
-                  || m_config->get_string ("routing_type")
-                       == "Multimodal_DUE_ColumnGeneration")
-                {
-                  TFlt _ad_ratio_car
-                    = m_config->get_float ("adaptive_ratio_car");
-                  if (_ad_ratio_car > 1)
-                    _ad_ratio_car = 1;
-                  if (_ad_ratio_car < 0)
-                    _ad_ratio_car = 0;
-
-                  TFlt _ad_ratio_truck
-                    = m_config->get_float ("adaptive_ratio_truck");
-                  if (_ad_ratio_truck > 1)
-                    _ad_ratio_truck = 1;
-                  if (_ad_ratio_truck < 0)
-                    _ad_ratio_truck = 0;
-                  // NOTE: in this case the release function is different
-                  _origin->release_one_interval_biclass (load_int,
-                                                         m_veh_factory,
-                                                         assign_int,
-                                                         _ad_ratio_car,
-                                                         _ad_ratio_truck);
-
-                  TFlt _ad_ratio_passenger
-                    = m_config->get_float ("adaptive_ratio_passenger");
-                  if (_ad_ratio_passenger > 1)
-                    _ad_ratio_passenger = 1;
-                  if (_ad_ratio_passenger < 0)
-                    _ad_ratio_passenger = 0;
-                  _origin_multimodal
-                    ->release_one_interval_passenger (load_int,
-                                                      m_passenger_factory,
-                                                      assign_int,
-                                                      _ad_ratio_passenger);
-                }
-              // else if(m_config -> get_string("routing_type") ==
-              // "Multimodal_DUE_FixedPath" ||
-              //         m_config -> get_string("routing_type") ==
-              //         "Multimodal_DUE_ColumnGeneration"){
-              //     _origin -> release_one_interval_biclass(load_int,
-              //     m_veh_factory, assign_int, 0., 0.); _origin_multimodal ->
-              //     release_one_interval_passenger(load_int,
-              //     m_passenger_factory, assign_int, 0.);
-              // }
-              else
-                {
-                  throw std::runtime_error ("WARNING:No assignment!");
-                }
+              _release (_origin_it.second);
             }
         }
     }
 
   if (verbose)
     printf ("Routing vehicles and passengers in origins!\n");
+  _timer.start ("routing");
   // step 2: routing the vehicles and passengers
   m_routing->update_routing (load_int);
 
   if (verbose)
     printf ("Moving vehicles through nodes!\n");
+  _timer.start ("node_evolve");
   // step 3: moving vehicles through node
   for (auto _node_it : m_node_factory->m_node_map)
     {
@@ -10591,6 +10883,7 @@ MNM_Dta_Multimodal::load_once (bool verbose, TInt load_int, TInt assign_int)
 
   if (verbose)
     printf ("Moving passengers out of origins!\n");
+  _timer.start ("passenger_evolve");
   // step 4: moving passengers out of origins
   for (auto _origin_it : m_od_factory->m_origin_map)
     {
@@ -10680,6 +10973,7 @@ MNM_Dta_Multimodal::load_once (bool verbose, TInt load_int, TInt assign_int)
 
   if (verbose)
     printf ("Moving vehicles through driving link\n");
+  _timer.start ("link_evolve");
   // step 8: moving vehicles through driving links and boarding and alighting
   // passengers
   for (auto _link_it : m_link_factory->m_link_map)
@@ -10687,10 +10981,10 @@ MNM_Dta_Multimodal::load_once (bool verbose, TInt load_int, TInt assign_int)
       _link = _link_it.second;
 
       if ((m_gridlock_recorder != nullptr)
-          && ((m_config->get_int ("total_interval") <= 0
+          && ((m_settings.m_total_interval <= 0
                && load_int >= 1.5 * m_total_assign_inter * m_assign_freq)
-              || (m_config->get_int ("total_interval") > 0
-                  && load_int >= 0.95 * m_config->get_int ("total_interval"))))
+              || (m_settings.m_total_interval > 0
+                  && load_int >= 0.95 * m_settings.m_total_interval)))
         {
           m_gridlock_recorder->save_one_link (load_int, _link);
         }
@@ -10701,10 +10995,14 @@ MNM_Dta_Multimodal::load_once (bool verbose, TInt load_int, TInt assign_int)
 
   // only use in multiclass vehicle cases
   if (m_emission != nullptr)
-    m_emission->update (m_veh_factory);
+    {
+      _timer.start ("emission");
+      m_emission->update (m_veh_factory);
+    }
 
   if (verbose)
     printf ("Destinations receiving finished vehicles and passengers!\n");
+  _timer.start ("destination_receive");
   // step 9: destinations receiving finished vehicles and passengers
   for (auto _dest_it : m_od_factory->m_destination_map)
     {
@@ -10718,6 +11016,7 @@ MNM_Dta_Multimodal::load_once (bool verbose, TInt load_int, TInt assign_int)
 
   if (verbose)
     printf ("Routing passengers in PnR mode!\n");
+  _timer.start ("routing_pnr");
   // step 10: routing passengers in PnR mode
   _routing_multimodal_hybrid->m_routing_passenger_fixed
     ->update_routing_parkinglot (load_int);
@@ -10729,6 +11028,7 @@ MNM_Dta_Multimodal::load_once (bool verbose, TInt load_int, TInt assign_int)
 
   if (verbose)
     printf ("Moving passengers out of parking lots!\n");
+  _timer.start ("parking_lot_evolve");
   // step 11: moving passengers out of parking lot
   for (auto _parkinglot_it : m_parkinglot_factory->m_parking_lot_map)
     {
@@ -10740,11 +11040,13 @@ MNM_Dta_Multimodal::load_once (bool verbose, TInt load_int, TInt assign_int)
   if (verbose)
     printf ("Update record!\n");
 
+  _timer.start ("statistics");
   // step 12: update record
   m_statistics->update_record (load_int);
 
   record_enroute_vehicles ();
   record_enroute_passengers ();
+  _timer.stop ();
   // if (verbose) {
   //     MNM::print_vehicle_statistics(dynamic_cast<MNM_Veh_Factory_Multimodal*>(m_veh_factory));
   //     MNM::print_passenger_statistics(m_passenger_factory);
@@ -10760,6 +11062,7 @@ MNM_Dta_Multimodal::loading (bool verbose)
 {
   int _current_inter = 0;
   int _assign_inter = m_start_assign_interval;
+  m_memory_log_freq = m_settings.m_memory_log_freq;
 
   while (!finished_loading (_current_inter)
          || _assign_inter < m_total_assign_inter)
@@ -10769,10 +11072,15 @@ MNM_Dta_Multimodal::loading (bool verbose)
           std::cout << std::endl
                     << "Current loading interval: " << _current_inter << ", "
                     << "Current assignment interval: "
-                    << int (_current_inter / m_config->get_int ("assign_frq"))
+                    << int (_current_inter / m_settings.m_assign_frq)
                     << std::endl;
         }
       load_once (verbose, _current_inter, _assign_inter);
+      if (m_memory_log_freq > 0 && _current_inter % m_memory_log_freq == 0)
+        {
+          printf ("Memory after interval %d: %s\n", _current_inter,
+                  MNM::memory_report_to_string (get_memory_usage ()).c_str ());
+        }
       // link cc will be updated with the record at the end of this interval
       // (i.e., _current_inter + 1)
       if (++_current_inter % m_assign_freq == 0)
@@ -10794,11 +11102,26 @@ MNM_Dta_Multimodal::loading (bool verbose)
                          // _current_inter)
 }
 
+int
+MNM_Dta_Multimodal::add_memory_usage (MNM_Memory_Report &report)
+{
+  MNM_Dta::add_memory_usage (report);
+  if (m_passenger_factory != nullptr)
+    {
+      auto &_passenger_map = m_passenger_factory->m_passenger_map;
+      MNM::add_memory (report, "passengers",
+                       MNM::unordered_bytes (_passenger_map)
+                         + _passenger_map.size () * sizeof (MNM_Passenger),
+                       _passenger_map.size ());
+    }
+  return 0;
+}
+
 bool
 MNM_Dta_Multimodal::finished_loading (int cur_int)
 {
   // printf("Entering MNM_Dta::finished_loading\n");
-  TInt _total_int = m_config->get_int ("total_interval");
+  TInt _total_int = m_settings.m_total_interval;
   if (_total_int > 0)
     {
       // printf("Exiting MNM_Dta::finished_loading 1\n");
@@ -10972,6 +11295,44 @@ get_travel_time_walking (MNM_Walking_Link *link, TFlt start_time,
                                   link->m_last_valid_time, fftt);
 }
 
+int
+get_travel_time_walking_batch (MNM_Walking_Link *link,
+                               const std::vector<TFlt> &start_times,
+                               TFlt unit_interval, TInt end_loading_timestamp,
+                               TFlt *tt)
+{
+  if (link == nullptr)
+    {
+      throw std::runtime_error (
+        "Error, get_travel_time_walking_batch link is null");
+    }
+  if (link->m_N_in == nullptr || link->m_N_out == nullptr)
+    {
+      throw std::runtime_error ("Error, get_travel_time_walking_batch link "
+                                "cumulative curve is not installed");
+    }
+
+  TFlt fftt
+    = link->m_fftt / unit_interval + link->m_historical_bus_waiting_time;
+
+  if (link->m_last_valid_time < 0)
+    {
+      link->m_last_valid_time
+        = get_last_valid_time (link->m_N_in, link->m_N_out,
+                               end_loading_timestamp);
+    }
+  IAssert (link->m_last_valid_time >= 0);
+
+  MNM_Cumulative_Curve_Cursor _N_in (link->m_N_in);
+  MNM_Cumulative_Curve_Cursor _N_out (link->m_N_out);
+  for (size_t k = 0; k < start_times.size (); ++k)
+    {
+      tt[k] = get_travel_time_from_cc (start_times[k], &_N_in, &_N_out,
+                                       link->m_last_valid_time, fftt);
+    }
+  return 0;
+}
+
 TFlt
 get_travel_time_walking_robust (MNM_Walking_Link *link, TFlt start_time,
                                 TFlt end_time, TFlt unit_interval,
@@ -10990,10 +11351,16 @@ get_travel_time_walking_robust (MNM_Walking_Link *link, TFlt start_time,
   return _ave_tt / TFlt (num_trials);
 }
 
+namespace
+{
+// get_travel_time_bus, where the ride between the stops is looked up through
+// the cursors on the bus curves of the two stops when they are not null
 TFlt
-get_travel_time_bus (MNM_Bus_Link *link, TFlt start_time, TFlt unit_interval,
-                     TInt end_loading_timestamp, bool explicit_bus,
-                     bool return_inf, bool return_bus_time)
+travel_time_bus (MNM_Bus_Link *link, TFlt start_time, TFlt unit_interval,
+                 TInt end_loading_timestamp, bool explicit_bus,
+                 bool return_inf, bool return_bus_time,
+                 MNM_Cumulative_Curve_Cursor *from_N_in,
+                 MNM_Cumulative_Curve_Cursor *to_N_in)
 {
   if (link == nullptr)
     {
@@ -11067,10 +11434,13 @@ get_travel_time_bus (MNM_Bus_Link *link, TFlt start_time, TFlt unit_interval,
         "Error, get_travel_time_bus no bus, check get_bus_waiting_time");
     }
   TFlt _bus_time
-    = get_travel_time_from_cc (start_time + _wait_time,
-                               link->m_from_busstop->m_N_in_bus,
-                               link->m_to_busstop->m_N_in_bus,
-                               link->m_last_valid_time_bus, fftt, true);
+    = from_N_in != nullptr
+        ? get_travel_time_from_cc (start_time + _wait_time, from_N_in, to_N_in,
+                                   link->m_last_valid_time_bus, fftt, true)
+        : get_travel_time_from_cc (start_time + _wait_time,
+                                   link->m_from_busstop->m_N_in_bus,
+                                   link->m_to_busstop->m_N_in_bus,
+                                   link->m_last_valid_time_bus, fftt, true);
   if (_bus_time < 0)
     {
       std::cout << link->m_from_busstop->m_N_in_bus->to_string () << std::endl;
@@ -11094,6 +11464,60 @@ get_travel_time_bus (MNM_Bus_Link *link, TFlt start_time, TFlt unit_interval,
       return _wait_time + _bus_time;
     }
 }
+}
+
+TFlt
+get_travel_time_bus (MNM_Bus_Link *link, TFlt start_time, TFlt unit_interval,
+                     TInt end_loading_timestamp, bool explicit_bus,
+                     bool return_inf, bool return_bus_time)
+{
+  return travel_time_bus (link, start_time, unit_interval,
+                          end_loading_timestamp, explicit_bus, return_inf,
+                          return_bus_time, nullptr, nullptr);
+}
+
+int
+get_travel_time_bus_batch (MNM_Bus_Link *link,
+                           const std::vector<TFlt> &start_times,
+                           TFlt unit_interval, TInt end_loading_timestamp,
+                           TFlt *tt, bool explicit_bus, bool return_inf,
+                           bool return_bus_time)
+{
+  if (link == nullptr)
+    {
+      throw std::runtime_error (
+        "Error, get_travel_time_bus_batch link is null");
+    }
+  // without explicit buses the time is summed over the overlapped driving
+  // links at times that do not follow the start times, so nothing is swept
+  if (!explicit_bus)
+    {
+      for (size_t k = 0; k < start_times.size (); ++k)
+        {
+          tt[k] = travel_time_bus (link, start_times[k], unit_interval,
+                                   end_loading_timestamp, explicit_bus,
+                                   return_inf, return_bus_time, nullptr,
+                                   nullptr);
+        }
+      return 0;
+    }
+  if (link->m_from_busstop->m_N_in_bus == nullptr
+      || link->m_to_busstop->m_N_in_bus == nullptr)
+    {
+      throw std::runtime_error ("Error, get_travel_time_bus_batch bus stop "
+                                "m_N_in_bus cumulative curve is not installed");
+    }
+
+  MNM_Cumulative_Curve_Cursor _from_N_in (link->m_from_busstop->m_N_in_bus);
+  MNM_Cumulative_Curve_Cursor _to_N_in (link->m_to_busstop->m_N_in_bus);
+  for (size_t k = 0; k < start_times.size (); ++k)
+    {
+      tt[k] = travel_time_bus (link, start_times[k], unit_interval,
+                               end_loading_timestamp, explicit_bus, return_inf,
+                               return_bus_time, &_from_N_in, &_to_N_in);
+    }
+  return 0;
+}
 
 TFlt
 get_travel_time_bus_robust (MNM_Bus_Link *link, TFlt start_time, TFlt end_time,
@@ -11528,6 +11952,13 @@ MNM_Passenger_Path_Base::MNM_Passenger_Path_Base (int mode, TFlt vot,
 
 MNM_Passenger_Path_Base::~MNM_Passenger_Path_Base () { delete m_path; }
 
+size_t
+MNM_Passenger_Path_Base::equal_hash ()
+{
+  // driving, bus and metro paths are equal only if their m_path are
+  return m_path == nullptr ? 0 : m_path->link_vec_hash ();
+}
+
 TFlt
 MNM_Passenger_Path_Base::get_wrongtime_penalty (TFlt arrival_time)
 {
@@ -12266,6 +12697,12 @@ MNM_Passenger_Path_PnR::get_travel_cost (
   return get_travel_cost_with_tt (start_time, tt, mmdta);
 }
 
+size_t
+MNM_Passenger_Path_PnR::equal_hash ()
+{
+  return m_driving_part->equal_hash () * 1000003 ^ m_bus_part->equal_hash ();
+}
+
 bool
 MNM_Passenger_Path_PnR::is_equal (MNM_Passenger_Path_Base *path)
 {
@@ -12404,6 +12841,12 @@ MNM_Passenger_Path_RnD::get_travel_cost_with_tt (TFlt start_time,
          + m_rnd_inconvenience;
 }
 
+size_t
+MNM_Passenger_Path_RnD::equal_hash ()
+{
+  return m_driving_part->equal_hash () * 1000003 ^ m_bus_part->equal_hash ();
+}
+
 bool
 MNM_Passenger_Path_RnD::is_equal (MNM_Passenger_Path_Base *path)
 {
@@ -12476,51 +12919,23 @@ MNM_Passenger_Pathset::is_in (MNM_Passenger_Path_Base *path)
 {
   if (path->m_mode != (int) m_mode)
     return false;
-  // https://stackoverflow.com/questions/92396/why-cant-variables-be-declared-in-a-switch-statement
   switch (m_mode)
     {
     case driving:
       {
-        auto *_path = dynamic_cast<MNM_Passenger_Path_Driving *> (path);
-        IAssert (_path != nullptr);
-        for (auto *_path_it : m_path_vec)
-          {
-            if (_path->is_equal (_path_it))
-              {
-                return true;
-              }
-          }
-        return false;
-        //            break;
+        IAssert (dynamic_cast<MNM_Passenger_Path_Driving *> (path) != nullptr);
+        break;
       }
     case transit:
       {
         // TODO: metro
-        auto *_path = dynamic_cast<MNM_Passenger_Path_Bus *> (path);
-        IAssert (_path != nullptr);
-        for (auto *_path_it : m_path_vec)
-          {
-            if (_path->is_equal (_path_it))
-              {
-                return true;
-              }
-          }
-        return false;
-        //            break;
+        IAssert (dynamic_cast<MNM_Passenger_Path_Bus *> (path) != nullptr);
+        break;
       }
     case pnr:
       {
-        auto *_path = dynamic_cast<MNM_Passenger_Path_PnR *> (path);
-        IAssert (_path != nullptr);
-        for (auto *_path_it : m_path_vec)
-          {
-            if (_path->is_equal (_path_it))
-              {
-                return true;
-              }
-          }
-        return false;
-        //            break;
+        IAssert (dynamic_cast<MNM_Passenger_Path_PnR *> (path) != nullptr);
+        break;
       }
     case rh:
       {
@@ -12532,6 +12947,44 @@ MNM_Passenger_Pathset::is_in (MNM_Passenger_Path_Base *path)
         throw std::runtime_error ("undefined passenger path");
       }
     }
+
+  // a size mismatch means paths were appended to m_path_vec directly
+  if (m_index_stale || m_path_index.size () != m_path_vec.size ())
+    {
+      m_path_index.clear ();
+      for (MNM_Passenger_Path_Base *_path : m_path_vec)
+        {
+          m_path_index.insert (
+            std::pair<size_t, MNM_Passenger_Path_Base *> (_path->equal_hash (),
+                                                          _path));
+        }
+      m_index_stale = false;
+    }
+  auto _range = m_path_index.equal_range (path->equal_hash ());
+  for (auto _it = _range.first; _it != _range.second; ++_it)
+    {
+      if (path->is_equal (_it->second))
+        return true;
+    }
+  return false;
+}
+
+int
+MNM_Passenger_Pathset::add_path (MNM_Passenger_Path_Base *path)
+{
+  m_path_vec.push_back (path);
+  if (!m_index_stale)
+    m_path_index.insert (
+      std::pair<size_t, MNM_Passenger_Path_Base *> (path->equal_hash (), path));
+  return 0;
+}
+
+int
+MNM_Passenger_Pathset::invalidate_index ()
+{
+  m_path_index.clear ();
+  m_index_stale = true;
+  return 0;
 }
 
 namespace MNM
@@ -12673,8 +13126,8 @@ build_shortest_passenger_pathset (
   std::unordered_map<TInt,
                      std::unordered_map<TInt, std::unordered_map<int, bool>>>
     &od_mode_connectivity,
-  MNM_MM_Due *mmdue, macposts::Graph &driving_graph,
-  macposts::Graph &bustransit_graph, MNM_OD_Factory *od_factory,
+  MNM_MM_Due *mmdue, const macposts::Graph &driving_graph,
+  const macposts::Graph &bustransit_graph, MNM_OD_Factory *od_factory,
   MNM_Link_Factory *link_factory, MNM_Transit_Link_Factory *transitlink_factory,
   MNM_Busstop_Factory *busstop_factory)
 {
@@ -13266,12 +13719,12 @@ build_existing_passenger_pathset (
 
 Path_Table *
 build_shortest_driving_pathset (
-  macposts::Graph &graph, MNM_OD_Factory *od_factory,
+  const macposts::Graph &graph, MNM_OD_Factory *od_factory,
   std::unordered_map<TInt,
                      std::unordered_map<TInt, std::unordered_map<int, bool>>>
     &od_mode_connectivity,
   MNM_Link_Factory *link_factory, TFlt min_path_length, size_t MaxIter,
-  TFlt Mid_Scale, TFlt Heavy_Scale, TInt buffer_length)
+  TFlt Mid_Scale, TFlt Heavy_Scale, TInt buffer_length, int num_threads)
 {
   // MaxIter: maximum iteration to find alternative shortest path, when MaxIter
   // = 0, just shortest path Mid_Scale and Heavy_Scale are different penalties
@@ -13319,21 +13772,12 @@ build_shortest_driving_pathset (
         }
     }
 
-  // printf("111\n");
-  std::unordered_map<TInt, TInt> _mid_shortest_path_tree
-    = std::unordered_map<TInt, TInt> ();
-  std::unordered_map<TInt, TFlt> _mid_cost_map
-    = std::unordered_map<TInt, TFlt> ();
-  std::unordered_map<TInt, TInt> _heavy_shortest_path_tree
-    = std::unordered_map<TInt, TInt> ();
-  std::unordered_map<TInt, TFlt> _heavy_cost_map
-    = std::unordered_map<TInt, TFlt> ();
+  // the table only holds the OD pairs connected by this mode
+  std::vector<MNM_Pathset_Dest_Job> _jobs = MNM::get_pathset_dest_jobs (
+    _path_table, od_factory,
+    [] (MNM_Origin *origin, MNM_Destination *dest) { return true; });
 
-  std::unordered_map<TInt, TFlt> _free_cost_map
-    = std::unordered_map<TInt, TFlt> ();
-  std::unordered_map<TInt, TInt> _free_shortest_path_tree
-    = std::unordered_map<TInt, TInt> ();
-  MNM_Path *_path;
+  std::unordered_map<TInt, TFlt> _free_cost_map;
   // TODO: use link cost instead of link travel time
   for (auto _link_it = link_factory->m_link_map.begin ();
        _link_it != link_factory->m_link_map.end (); _link_it++)
@@ -13342,206 +13786,49 @@ build_shortest_driving_pathset (
         std::pair<TInt, TFlt> (_link_it->first,
                                _link_it->second->get_link_tt ()));
     }
-  // printf("1111\n");
-  for (auto _d_it = od_factory->m_destination_map.begin ();
-       _d_it != od_factory->m_destination_map.end (); _d_it++)
+  MNM::build_penalty_pathsets (
+    graph, _jobs, _free_cost_map,
+    [&] (TInt link_ID, TFlt scale) {
+      return link_factory->get_link (link_ID)->get_link_tt () * scale;
+    },
+    MaxIter, Mid_Scale, Heavy_Scale,
+    [&] (MNM_Path *path) {
+      return MNM::get_path_tt_snapshot (path, _free_cost_map)
+             > min_path_length;
+    },
+    false, buffer_length, num_threads);
+
+  printf ("build_shortest_driving_pathset, finish finding driving_pathset with "
+          "number of paths up to %d\n",
+          (int) MaxIter + 1);
+  return _path_table;
+}
+
+Path_Table *
+build_shortest_bustransit_pathset (
+  const macposts::Graph &graph, MNM_OD_Factory *od_factory,
+  std::unordered_map<TInt,
+                     std::unordered_map<TInt, std::unordered_map<int, bool>>>
+    &od_mode_connectivity,
+  MNM_Transit_Link_Factory *link_factory, TFlt min_path_length, size_t MaxIter,
+  TFlt Mid_Scale, TFlt Heavy_Scale, TInt buffer_length, int num_threads)
+{
+  // MaxIter: maximum iteration to find alternative shortest path, when MaxIter
+  // = 0, just shortest path Mid_Scale and Heavy_Scale are different penalties
+  // to the travel cost of links in existing paths
+  printf ("build_shortest_bustransit_pathset, start finding bustransit_pathset "
+          "with number of paths up to %d\n",
+          (int) MaxIter + 1);
+  /* initialize data structure */
+  TInt _dest_node_ID, _origin_node_ID;
+  Path_Table *_path_table = new Path_Table ();
+  std::unordered_map<TInt, MNM_Pathset *> *_new_map = nullptr;
+  for (auto _o_it = od_factory->m_origin_map.begin ();
+       _o_it != od_factory->m_origin_map.end (); _o_it++)
     {
-      _dest_node_ID = _d_it->second->m_dest_node->m_node_ID;
-      MNM_Shortest_Path::all_to_one_FIFO (_dest_node_ID, graph, _free_cost_map,
-                                          _free_shortest_path_tree);
-      for (auto _o_it = od_factory->m_origin_map.begin ();
-           _o_it != od_factory->m_origin_map.end (); _o_it++)
-        {
-          _origin_node_ID = _o_it->second->m_origin_node->m_node_ID;
-          if (od_mode_connectivity.find (_origin_node_ID)
-                != od_mode_connectivity.end ()
-              && od_mode_connectivity.find (_origin_node_ID)
-                     ->second.find (_dest_node_ID)
-                   != od_mode_connectivity.find (_origin_node_ID)->second.end ()
-              && od_mode_connectivity.find (_origin_node_ID)
-                     ->second.find (_dest_node_ID)
-                     ->second.find (driving)
-                   != od_mode_connectivity.find (_origin_node_ID)
-                        ->second.find (_dest_node_ID)
-                        ->second.end ()
-              && od_mode_connectivity.find (_origin_node_ID)
-                   ->second.find (_dest_node_ID)
-                   ->second.find (driving)
-                   ->second)
-            {
-              _path = MNM::extract_path (_origin_node_ID, _dest_node_ID,
-                                         _free_shortest_path_tree, graph);
-              if (_path != nullptr)
-                {
-                  _path->allocate_buffer (buffer_length);
-                  _path_table->find (_origin_node_ID)
-                    ->second->find (_dest_node_ID)
-                    ->second->m_path_vec.push_back (_path);
-                }
-              else
-                {
-                  printf ("No driving path found to connect origin node ID %d "
-                          "and destination node ID %d\n",
-                          _origin_node_ID, _dest_node_ID);
-                  throw std::runtime_error ("No path connecting OD");
-                }
-            }
-        }
-    }
-  // printf("22\n");
-  _mid_cost_map.insert (_free_cost_map.begin (), _free_cost_map.end ());
-  _heavy_cost_map.insert (_free_cost_map.begin (), _free_cost_map.end ());
-
-  MNM_Dlink *_link;
-  MNM_Path *_path_mid, *_path_heavy;
-  TFlt _path_tt;
-  size_t _CurIter = 0;
-  while (_CurIter < MaxIter)
-    {
-      printf ("Current trial %d\n", (int) _CurIter);
-      for (auto _o_it : *_path_table)
-        {
-          for (auto _d_it : *_o_it.second)
-            {
-              for (auto &_path : _d_it.second->m_path_vec)
-                {
-                  for (auto &_link_ID : _path->m_link_vec)
-                    {
-                      _link = link_factory->get_link (_link_ID);
-                      // TODO: use link cost instead of link travel time
-                      _mid_cost_map.find (_link_ID)->second
-                        = _link->get_link_tt () * Mid_Scale;
-                      _heavy_cost_map.find (_link_ID)->second
-                        = _link->get_link_tt () * Heavy_Scale;
-                    }
-                }
-            }
-        }
-
-      for (auto _d_it = od_factory->m_destination_map.begin ();
-           _d_it != od_factory->m_destination_map.end (); _d_it++)
-        {
-          _dest_node_ID = _d_it->second->m_dest_node->m_node_ID;
-          MNM_Shortest_Path::all_to_one_FIFO (_dest_node_ID, graph,
-                                              _mid_cost_map,
-                                              _mid_shortest_path_tree);
-          MNM_Shortest_Path::all_to_one_FIFO (_dest_node_ID, graph,
-                                              _heavy_cost_map,
-                                              _heavy_shortest_path_tree);
-          for (auto _o_it = od_factory->m_origin_map.begin ();
-               _o_it != od_factory->m_origin_map.end (); _o_it++)
-            {
-              _origin_node_ID = _o_it->second->m_origin_node->m_node_ID;
-              if (od_mode_connectivity.find (_origin_node_ID)
-                    != od_mode_connectivity.end ()
-                  && od_mode_connectivity.find (_origin_node_ID)
-                         ->second.find (_dest_node_ID)
-                       != od_mode_connectivity.find (_origin_node_ID)
-                            ->second.end ()
-                  && od_mode_connectivity.find (_origin_node_ID)
-                         ->second.find (_dest_node_ID)
-                         ->second.find (driving)
-                       != od_mode_connectivity.find (_origin_node_ID)
-                            ->second.find (_dest_node_ID)
-                            ->second.end ()
-                  && od_mode_connectivity.find (_origin_node_ID)
-                       ->second.find (_dest_node_ID)
-                       ->second.find (driving)
-                       ->second)
-                {
-                  _path_mid
-                    = MNM::extract_path (_origin_node_ID, _dest_node_ID,
-                                         _mid_shortest_path_tree, graph);
-                  _path_heavy
-                    = MNM::extract_path (_origin_node_ID, _dest_node_ID,
-                                         _heavy_shortest_path_tree, graph);
-                  if (_path_mid != nullptr)
-                    {
-                      if (!_path_table->find (_origin_node_ID)
-                             ->second->find (_dest_node_ID)
-                             ->second->is_in (_path_mid))
-                        {
-                          _path_tt = MNM::get_path_tt_snapshot (_path_mid,
-                                                                _free_cost_map);
-                          if (_path_tt > min_path_length)
-                            {
-                              _path_mid->allocate_buffer (buffer_length);
-                              _path_table->find (_origin_node_ID)
-                                ->second->find (_dest_node_ID)
-                                ->second->m_path_vec.push_back (_path_mid);
-                            }
-                        }
-                      else
-                        {
-                          delete _path_mid;
-                        }
-                    }
-                  if (_path_heavy != nullptr)
-                    {
-                      if (!_path_table->find (_origin_node_ID)
-                             ->second->find (_dest_node_ID)
-                             ->second->is_in (_path_heavy))
-                        {
-                          _path_tt = MNM::get_path_tt_snapshot (_path_heavy,
-                                                                _free_cost_map);
-                          if (_path_tt > min_path_length)
-                            {
-                              _path_heavy->allocate_buffer (buffer_length);
-                              _path_table->find (_origin_node_ID)
-                                ->second->find (_dest_node_ID)
-                                ->second->m_path_vec.push_back (_path_heavy);
-                            }
-                        }
-                      else
-                        {
-                          delete _path_heavy;
-                        }
-                    }
-                }
-            }
-        }
-      _CurIter += 1;
-    }
-
-  _mid_shortest_path_tree.clear ();
-  _mid_cost_map.clear ();
-  _heavy_shortest_path_tree.clear ();
-  _heavy_cost_map.clear ();
-
-  _free_cost_map.clear ();
-  _free_shortest_path_tree.clear ();
-
-  printf ("build_shortest_driving_pathset, finish finding driving_pathset with "
-          "number of paths up to %d\n",
-          (int) MaxIter + 1);
-  return _path_table;
-}
-
-Path_Table *
-build_shortest_bustransit_pathset (
-  macposts::Graph &graph, MNM_OD_Factory *od_factory,
-  std::unordered_map<TInt,
-                     std::unordered_map<TInt, std::unordered_map<int, bool>>>
-    &od_mode_connectivity,
-  MNM_Transit_Link_Factory *link_factory, TFlt min_path_length, size_t MaxIter,
-  TFlt Mid_Scale, TFlt Heavy_Scale, TInt buffer_length)
-{
-  // MaxIter: maximum iteration to find alternative shortest path, when MaxIter
-  // = 0, just shortest path Mid_Scale and Heavy_Scale are different penalties
-  // to the travel cost of links in existing paths
-  printf ("build_shortest_bustransit_pathset, start finding bustransit_pathset "
-          "with number of paths up to %d\n",
-          (int) MaxIter + 1);
-  /* initialize data structure */
-  TInt _dest_node_ID, _origin_node_ID;
-  Path_Table *_path_table = new Path_Table ();
-  std::unordered_map<TInt, MNM_Pathset *> *_new_map = nullptr;
-  for (auto _o_it = od_factory->m_origin_map.begin ();
-       _o_it != od_factory->m_origin_map.end (); _o_it++)
-    {
-      _origin_node_ID = _o_it->second->m_origin_node->m_node_ID;
-      if (is_node (graph, _origin_node_ID)
-          && !graph.connections (_origin_node_ID, Direction::Outgoing).empty ())
+      _origin_node_ID = _o_it->second->m_origin_node->m_node_ID;
+      if (is_node (graph, _origin_node_ID)
+          && !graph.connections (_origin_node_ID, Direction::Outgoing).empty ())
         {
           _new_map = new std::unordered_map<TInt, MNM_Pathset *> ();
           _path_table->insert (
@@ -13588,206 +13875,29 @@ build_shortest_bustransit_pathset (
         }
     }
 
-  // printf("111\n");
-  std::unordered_map<TInt, TInt> _mid_shortest_path_tree
-    = std::unordered_map<TInt, TInt> ();
-  std::unordered_map<TInt, TFlt> _mid_cost_map
-    = std::unordered_map<TInt, TFlt> ();
-  std::unordered_map<TInt, TInt> _heavy_shortest_path_tree
-    = std::unordered_map<TInt, TInt> ();
-  std::unordered_map<TInt, TFlt> _heavy_cost_map
-    = std::unordered_map<TInt, TFlt> ();
+  // the table only holds the OD pairs connected by this mode
+  std::vector<MNM_Pathset_Dest_Job> _jobs = MNM::get_pathset_dest_jobs (
+    _path_table, od_factory,
+    [] (MNM_Origin *origin, MNM_Destination *dest) { return true; });
 
-  std::unordered_map<TInt, TFlt> _free_cost_map
-    = std::unordered_map<TInt, TFlt> ();
-  std::unordered_map<TInt, TInt> _free_shortest_path_tree
-    = std::unordered_map<TInt, TInt> ();
-  MNM_Path *_path;
+  std::unordered_map<TInt, TFlt> _free_cost_map;
   // TODO: use link cost instead of link travel time
   for (auto _link_it : link_factory->m_transit_link_map)
     {
       _free_cost_map.insert (
         std::pair<TInt, TFlt> (_link_it.first, _link_it.second->m_fftt));
     }
-  // printf("1111\n");
-  for (auto _d_it = od_factory->m_destination_map.begin ();
-       _d_it != od_factory->m_destination_map.end (); _d_it++)
-    {
-      _dest_node_ID = _d_it->second->m_dest_node->m_node_ID;
-      if (is_node (graph, _dest_node_ID)
-          && !graph.connections (_dest_node_ID, Direction::Incoming).empty ())
-        {
-          MNM_Shortest_Path::all_to_one_FIFO (_dest_node_ID, graph,
-                                              _free_cost_map,
-                                              _free_shortest_path_tree);
-        }
-      else
-        {
-          continue;
-        }
-      for (auto _o_it = od_factory->m_origin_map.begin ();
-           _o_it != od_factory->m_origin_map.end (); _o_it++)
-        {
-          _origin_node_ID = _o_it->second->m_origin_node->m_node_ID;
-          if (od_mode_connectivity.find (_origin_node_ID)
-                != od_mode_connectivity.end ()
-              && od_mode_connectivity.find (_origin_node_ID)
-                     ->second.find (_dest_node_ID)
-                   != od_mode_connectivity.find (_origin_node_ID)->second.end ()
-              && od_mode_connectivity.find (_origin_node_ID)
-                     ->second.find (_dest_node_ID)
-                     ->second.find (transit)
-                   != od_mode_connectivity.find (_origin_node_ID)
-                        ->second.find (_dest_node_ID)
-                        ->second.end ()
-              && od_mode_connectivity.find (_origin_node_ID)
-                   ->second.find (_dest_node_ID)
-                   ->second.find (transit)
-                   ->second)
-            {
-              _path = MNM::extract_path (_origin_node_ID, _dest_node_ID,
-                                         _free_shortest_path_tree, graph);
-              if (_path != nullptr)
-                {
-                  _path->allocate_buffer (buffer_length);
-                  _path_table->find (_origin_node_ID)
-                    ->second->find (_dest_node_ID)
-                    ->second->m_path_vec.push_back (_path);
-                }
-              else
-                {
-                  printf ("No bus transit path found to connect origin node ID "
-                          "%d and destination node ID %d\n",
-                          _origin_node_ID, _dest_node_ID);
-                  throw std::runtime_error (
-                    "No bus transit path connecting OD");
-                }
-            }
-        }
-    }
-  // printf("22\n");
-  _mid_cost_map.insert (_free_cost_map.begin (), _free_cost_map.end ());
-  _heavy_cost_map.insert (_free_cost_map.begin (), _free_cost_map.end ());
-
-  MNM_Transit_Link *_link;
-  MNM_Path *_path_mid, *_path_heavy;
-  TFlt _path_tt;
-  size_t _CurIter = 0;
-  while (_CurIter < MaxIter)
-    {
-      printf ("Current trial %d\n", (int) _CurIter);
-      for (auto _o_it : *_path_table)
-        {
-          for (auto _d_it : *_o_it.second)
-            {
-              for (auto &_path : _d_it.second->m_path_vec)
-                {
-                  for (auto &_link_ID : _path->m_link_vec)
-                    {
-                      _link = link_factory->get_transit_link (_link_ID);
-                      // TODO: use link cost instead of link travel time
-                      _mid_cost_map.find (_link_ID)->second
-                        = _link->m_fftt * Mid_Scale;
-                      _heavy_cost_map.find (_link_ID)->second
-                        = _link->m_fftt * Heavy_Scale;
-                    }
-                }
-            }
-        }
-
-      for (auto _d_it = od_factory->m_destination_map.begin ();
-           _d_it != od_factory->m_destination_map.end (); _d_it++)
-        {
-          _dest_node_ID = _d_it->second->m_dest_node->m_node_ID;
-          if (is_node (graph, _dest_node_ID)
-              && !graph.connections (_dest_node_ID, Direction::Incoming)
-                    .empty ())
-            {
-              MNM_Shortest_Path::all_to_one_FIFO (_dest_node_ID, graph,
-                                                  _mid_cost_map,
-                                                  _mid_shortest_path_tree);
-              MNM_Shortest_Path::all_to_one_FIFO (_dest_node_ID, graph,
-                                                  _heavy_cost_map,
-                                                  _heavy_shortest_path_tree);
-            }
-          else
-            {
-              continue;
-            }
-          for (auto _o_it = od_factory->m_origin_map.begin ();
-               _o_it != od_factory->m_origin_map.end (); _o_it++)
-            {
-              _origin_node_ID = _o_it->second->m_origin_node->m_node_ID;
-              if (od_mode_connectivity.find (_origin_node_ID)
-                    != od_mode_connectivity.end ()
-                  && od_mode_connectivity.find (_origin_node_ID)
-                         ->second.find (_dest_node_ID)
-                       != od_mode_connectivity.find (_origin_node_ID)
-                            ->second.end ()
-                  && od_mode_connectivity.find (_origin_node_ID)
-                         ->second.find (_dest_node_ID)
-                         ->second.find (transit)
-                       != od_mode_connectivity.find (_origin_node_ID)
-                            ->second.find (_dest_node_ID)
-                            ->second.end ()
-                  && od_mode_connectivity.find (_origin_node_ID)
-                       ->second.find (_dest_node_ID)
-                       ->second.find (transit)
-                       ->second)
-                {
-                  _path_mid
-                    = MNM::extract_path (_origin_node_ID, _dest_node_ID,
-                                         _mid_shortest_path_tree, graph);
-                  _path_heavy
-                    = MNM::extract_path (_origin_node_ID, _dest_node_ID,
-                                         _heavy_shortest_path_tree, graph);
-                  if (_path_mid != nullptr)
-                    {
-                      if (!_path_table->find (_origin_node_ID)
-                             ->second->find (_dest_node_ID)
-                             ->second->is_in (_path_mid))
-                        {
-                          _path_tt = MNM::get_path_tt_snapshot (_path_mid,
-                                                                _free_cost_map);
-                          if (_path_tt > min_path_length)
-                            {
-                              _path_mid->allocate_buffer (buffer_length);
-                              _path_table->find (_origin_node_ID)
-                                ->second->find (_dest_node_ID)
-                                ->second->m_path_vec.push_back (_path_mid);
-                            }
-                        }
-                      else
-                        {
-                          delete _path_mid;
-                        }
-                    }
-                  if (_path_heavy != nullptr)
-                    {
-                      if (!_path_table->find (_origin_node_ID)
-                             ->second->find (_dest_node_ID)
-                             ->second->is_in (_path_heavy))
-                        {
-                          _path_tt = MNM::get_path_tt_snapshot (_path_heavy,
-                                                                _free_cost_map);
-                          if (_path_tt > min_path_length)
-                            {
-                              _path_heavy->allocate_buffer (buffer_length);
-                              _path_table->find (_origin_node_ID)
-                                ->second->find (_dest_node_ID)
-                                ->second->m_path_vec.push_back (_path_heavy);
-                            }
-                        }
-                      else
-                        {
-                          delete _path_heavy;
-                        }
-                    }
-                }
-            }
-        }
-      _CurIter += 1;
-    }
+  MNM::build_penalty_pathsets (
+    graph, _jobs, _free_cost_map,
+    [&] (TInt link_ID, TFlt scale) {
+      return link_factory->get_transit_link (link_ID)->m_fftt * scale;
+    },
+    MaxIter, Mid_Scale, Heavy_Scale,
+    [&] (MNM_Path *path) {
+      return MNM::get_path_tt_snapshot (path, _free_cost_map)
+             > min_path_length;
+    },
+    false, buffer_length, num_threads);
   printf ("build_shortest_bustransit_pathset, finish finding "
           "bustransit_pathset with number of paths up to %d\n",
           (int) MaxIter + 1);
@@ -13796,7 +13906,7 @@ build_shortest_bustransit_pathset (
 
 PnR_Path_Table *
 build_shortest_pnr_pathset (
-  macposts::Graph &driving_graph, macposts::Graph &bustransit_graph,
+  const macposts::Graph &driving_graph, const macposts::Graph &bustransit_graph,
   MNM_OD_Factory *od_factory,
   std::unordered_map<TInt,
                      std::unordered_map<TInt, std::unordered_map<int, bool>>>
@@ -14047,7 +14157,7 @@ build_shortest_pnr_pathset (
                   _pnr_path->allocate_buffer (buffer_length);
                   _path_table->find (_origin_node_ID)
                     ->second->find (_dest_node_ID)
-                    ->second->m_path_vec.push_back (_pnr_path);
+                    ->second->add_path (_pnr_path);
                 }
               else
                 {
@@ -14271,7 +14381,7 @@ build_shortest_pnr_pathset (
                               _pnr_path_mid->allocate_buffer (buffer_length);
                               _path_table->find (_origin_node_ID)
                                 ->second->find (_dest_node_ID)
-                                ->second->m_path_vec.push_back (_pnr_path_mid);
+                                ->second->add_path (_pnr_path_mid);
                             }
                         }
                       else
@@ -14297,8 +14407,7 @@ build_shortest_pnr_pathset (
                               _pnr_path_heavy->allocate_buffer (buffer_length);
                               _path_table->find (_origin_node_ID)
                                 ->second->find (_dest_node_ID)
-                                ->second->m_path_vec.push_back (
-                                  _pnr_path_heavy);
+                                ->second->add_path (_pnr_path_heavy);
                             }
                         }
                       else
@@ -14978,15 +15087,10 @@ MNM_MM_Due::MNM_MM_Due (const std::string &file_folder)
   m_file_folder = file_folder;
 
   m_mmdta_config = new MNM_ConfReader (m_file_folder + "/config.conf", "DTA");
-  IAssert (m_mmdta_config->get_string ("routing_type")
-             == "Multimodal_DUE_FixedPath"
-           || m_mmdta_config->get_string ("routing_type")
-                == "Multimodal_DUE_ColumnGeneration"
-           || m_mmdta_config->get_string ("routing_type") == "Multimodal_Hybrid"
-           || m_mmdta_config->get_string ("routing_type")
-                == "Multimodal_Hybrid_ColumnGeneration");   // Multimodal_Hybrid
-                                                            // only for DODE
-  IAssert (m_mmdta_config->get_int ("total_interval") > 0); // sufficiently long
+  m_mmdta_settings.load (m_mmdta_config);
+  // Multimodal_Hybrid only for DODE
+  IAssert (m_mmdta_settings.is_multimodal ());
+  IAssert (m_mmdta_settings.m_total_interval > 0); // sufficiently long
 
   m_od_mode_connectivity = std::unordered_map<
     TInt, std::unordered_map<TInt, std::unordered_map<int, bool>>> ();
@@ -14995,7 +15099,7 @@ MNM_MM_Due::MNM_MM_Due (const std::string &file_folder)
   m_total_assign_inter = m_mmdta_config->get_int ("max_interval");
   if (m_total_loading_inter <= 0)
     m_total_loading_inter
-      = m_total_assign_inter * m_mmdta_config->get_int ("assign_frq");
+      = m_total_assign_inter * m_mmdta_settings.m_assign_frq;
 
   m_mmdue_config = new MNM_ConfReader (m_file_folder + "/config.conf", "MMDUE");
 
@@ -15065,24 +15169,6 @@ MNM_MM_Due::MNM_MM_Due (const std::string &file_folder)
   // for bus
   m_bus_path_table = nullptr;
 
-  // time-varying link tt
-  m_link_tt_map = std::unordered_map<TInt, TFlt *> ();
-  m_link_tt_map_truck = std::unordered_map<TInt, TFlt *> ();
-  m_transitlink_tt_map = std::unordered_map<TInt, TFlt *> ();
-
-  // time-varying link cost
-  m_link_cost_map = std::unordered_map<TInt, TFlt *> ();
-  m_link_cost_map_truck = std::unordered_map<TInt, TFlt *> ();
-  m_transitlink_cost_map = std::unordered_map<TInt, TFlt *> ();
-
-  m_link_congested_car = std::unordered_map<TInt, bool *> ();
-  m_link_congested_truck = std::unordered_map<TInt, bool *> ();
-  m_transitlink_congested_passenger = std::unordered_map<TInt, bool *> ();
-
-  m_queue_dissipated_time_car = std::unordered_map<TInt, int *> ();
-  m_queue_dissipated_time_truck = std::unordered_map<TInt, int *> ();
-  m_queue_dissipated_time_passenger = std::unordered_map<TInt, int *> ();
-
   m_driving_link_tt_map_snapshot = std::unordered_map<TInt, TFlt> ();
   m_bustransit_link_tt_map_snapshot = std::unordered_map<TInt, TFlt> ();
 
@@ -15095,6 +15181,7 @@ MNM_MM_Due::MNM_MM_Due (const std::string &file_folder)
     = std::unordered_map<TInt, std::unordered_map<TInt, TInt>> ();
 
   m_mmdta = nullptr;
+  m_profiler = nullptr;
 }
 
 MNM_MM_Due::~MNM_MM_Due ()
@@ -15112,77 +15199,6 @@ MNM_MM_Due::~MNM_MM_Due ()
     }
   m_od_mode_connectivity.clear ();
 
-  for (auto _tt_it : m_link_tt_map)
-    {
-      delete _tt_it.second;
-    }
-  m_link_tt_map.clear ();
-
-  for (auto _tt_it : m_link_tt_map_truck)
-    {
-      delete _tt_it.second;
-    }
-  m_link_tt_map_truck.clear ();
-
-  for (auto _tt_it : m_transitlink_tt_map)
-    {
-      delete _tt_it.second;
-    }
-  m_transitlink_tt_map.clear ();
-
-  for (auto _cost_it : m_link_cost_map)
-    {
-      delete _cost_it.second;
-    }
-  m_link_cost_map.clear ();
-
-  for (auto _cost_it : m_link_cost_map_truck)
-    {
-      delete _cost_it.second;
-    }
-  m_link_cost_map_truck.clear ();
-
-  for (auto _cost_it : m_transitlink_cost_map)
-    {
-      delete _cost_it.second;
-    }
-  m_transitlink_cost_map.clear ();
-
-  for (auto _it : m_link_congested_car)
-    {
-      delete _it.second;
-    }
-  m_link_congested_car.clear ();
-
-  for (auto _it : m_link_congested_truck)
-    {
-      delete _it.second;
-    }
-  m_link_congested_truck.clear ();
-
-  for (auto _it : m_transitlink_congested_passenger)
-    {
-      delete _it.second;
-    }
-  m_transitlink_congested_passenger.clear ();
-
-  for (auto _it : m_queue_dissipated_time_car)
-    {
-      delete _it.second;
-    }
-  m_queue_dissipated_time_car.clear ();
-
-  for (auto _it : m_queue_dissipated_time_truck)
-    {
-      delete _it.second;
-    }
-  m_queue_dissipated_time_truck.clear ();
-
-  for (auto _it : m_queue_dissipated_time_passenger)
-    {
-      delete _it.second;
-    }
-  m_queue_dissipated_time_passenger.clear ();
 
   m_driving_link_tt_map_snapshot.clear ();
   m_bustransit_link_tt_map_snapshot.clear ();
@@ -15229,6 +15245,7 @@ MNM_MM_Due::~MNM_MM_Due ()
           for (auto _it_it : *(_it.second))
             {
               _it_it.second->m_path_vec.clear ();
+              _it_it.second->invalidate_index ();
             }
         }
     }
@@ -15239,6 +15256,7 @@ MNM_MM_Due::~MNM_MM_Due ()
           for (auto _it_it : *_it.second)
             {
               _it_it.second->m_path_vec.clear ();
+              _it_it.second->invalidate_index ();
             }
         }
     }
@@ -15249,6 +15267,7 @@ MNM_MM_Due::~MNM_MM_Due ()
           for (auto _it_it : *_it.second)
             {
               _it_it.second->m_path_vec.clear ();
+              _it_it.second->invalidate_index ();
             }
         }
     }
@@ -15625,35 +15644,25 @@ MNM_MM_Due::initialize ()
   // car is zero m_mmdta is used mainly for reading files, an external mmdta
   // will used for actual DNL
   m_mmdta = new MNM_Dta_Multimodal (m_file_folder);
+  m_mmdta->m_profiler = m_profiler;
   m_mmdta->build_from_files ();
   m_mmdta->hook_up_node_and_link ();
   m_mmdta->find_connected_pnr_parkinglot_for_destination ();
   // m_mmdta -> is_ok();  // do this check once if it is time-consuming
 
+  std::vector<TInt> _link_IDs;
   for (auto _link_it : m_mmdta->m_link_factory->m_link_map)
-    {
-      m_link_tt_map[_link_it.first] = new TFlt[m_total_loading_inter];
-      m_link_tt_map_truck[_link_it.first] = new TFlt[m_total_loading_inter];
-      m_link_cost_map[_link_it.first] = new TFlt[m_total_loading_inter];
-      m_link_cost_map_truck[_link_it.first] = new TFlt[m_total_loading_inter];
-      // m_link_congested_car[_link_it.first] = new bool[m_total_loading_inter];
-      // m_link_congested_truck[_link_it.first] = new
-      // bool[m_total_loading_inter];
-      // m_queue_dissipated_time_car[_link_it.first] = new
-      // int[m_total_loading_inter];
-      // m_queue_dissipated_time_truck[_link_it.first] = new
-      // int[m_total_loading_inter];
-    }
+    _link_IDs.push_back (_link_it.first);
+  m_link_tt_map.reset (_link_IDs, m_total_loading_inter);
+  m_link_tt_map_truck.reset (_link_IDs, m_total_loading_inter);
+  m_link_cost_map.reset (_link_IDs, m_total_loading_inter);
+  m_link_cost_map_truck.reset (_link_IDs, m_total_loading_inter);
 
+  std::vector<TInt> _transitlink_IDs;
   for (auto _link_it : m_mmdta->m_transitlink_factory->m_transit_link_map)
-    {
-      m_transitlink_tt_map[_link_it.first] = new TFlt[m_total_loading_inter];
-      m_transitlink_cost_map[_link_it.first] = new TFlt[m_total_loading_inter];
-      // m_transitlink_congested_passenger[_link_it.first] = new
-      // bool[m_total_loading_inter];
-      // m_queue_dissipated_time_passenger[_link_it.first] = new
-      // int[m_total_loading_inter];
-    }
+    _transitlink_IDs.push_back (_link_it.first);
+  m_transitlink_tt_map.reset (_transitlink_IDs, m_total_loading_inter);
+  m_transitlink_cost_map.reset (_transitlink_IDs, m_total_loading_inter);
   // for DODE, initialize as 0 in the input file
   MNM_IO_Multimodal::build_passenger_demand (m_file_folder, m_mmdta_config,
                                              m_mmdta->m_od_factory,
@@ -15679,12 +15688,26 @@ MNM_MM_Due::initialize ()
   return 0;
 }
 
+int
+MNM_MM_Due::add_memory_usage (MNM_Memory_Report &report)
+{
+  for (auto *_matrix :
+       { &m_link_tt_map, &m_link_tt_map_truck, &m_transitlink_tt_map })
+    MNM::add_memory (report, "link_tt_map", _matrix->get_memory_bytes (),
+                     _matrix->get_num_rows ());
+  for (auto *_matrix :
+       { &m_link_cost_map, &m_link_cost_map_truck, &m_transitlink_cost_map })
+    MNM::add_memory (report, "link_cost_map", _matrix->get_memory_bytes (),
+                     _matrix->get_num_rows ());
+  return 0;
+}
+
 int
 MNM_MM_Due::init_passenger_path_table ()
 {
   // init shortest path
-  if (m_mmdta_config->get_string ("routing_type")
-      == "Multimodal_Hybrid_ColumnGeneration")
+  if (m_mmdta_settings.m_routing_type
+      == MNM_Routing_Type::Multimodal_Hybrid_ColumnGeneration)
     {
       // only one path for one OD for each mode
       m_passenger_path_table
@@ -15697,8 +15720,8 @@ MNM_MM_Due::init_passenger_path_table ()
                                                  m_mmdta->m_transitlink_factory,
                                                  m_mmdta->m_busstop_factory);
     }
-  else if (m_mmdta_config->get_string ("routing_type")
-           == "Multimodal_DUE_ColumnGeneration")
+  else if (m_mmdta_settings.m_routing_type
+           == MNM_Routing_Type::Multimodal_DUE_ColumnGeneration)
     {
       auto *_tmp_conf
         = new MNM_ConfReader (m_file_folder + "/config.conf", "FIXED");
@@ -16153,11 +16176,11 @@ MNM_MM_Due::update_origin_demand_logit_model (MNM_Dta_Multimodal *mmdta,
 
           _tot_passenger_demand = _d_it.second[assign_inter];
 
-          _mode_split = get_mode_split_snapshot (mmdta,
-                                                 assign_inter
-                                                   * m_mmdta_config->get_int (
-                                                     "assign_frq"),
-                                                 _o_it.first, _d_it.first);
+          _mode_split
+            = get_mode_split_snapshot (mmdta,
+                                       assign_inter
+                                         * m_mmdta_settings.m_assign_frq,
+                                       _o_it.first, _d_it.first);
 
           // the driving mode impacts the car demand
           if (std::find (m_mode_vec.begin (), m_mode_vec.end (), driving)
@@ -16586,8 +16609,7 @@ MNM_MM_Due::get_mode_split_snapshot (MNM_Dta_Multimodal *mmdta,
            && m_passenger_demand.find (o_node_ID)->second.find (d_node_ID)
                 != m_passenger_demand.find (o_node_ID)->second.end ());
 
-  int _assign_inter
-    = (int) start_interval / m_mmdta_config->get_int ("assign_frq");
+  int _assign_inter = (int) start_interval / m_mmdta_settings.m_assign_frq;
   if (_assign_inter >= m_total_assign_inter)
     _assign_inter = m_total_assign_inter - 1;
 
@@ -17110,8 +17132,7 @@ MNM_MM_Due::get_lowest_cost_path_snapshot (int start_interval, int o_node_ID,
            && m_passenger_demand.find (o_node_ID)->second.find (d_node_ID)
                 != m_passenger_demand.find (o_node_ID)->second.end ());
 
-  int _assign_inter
-    = (int) start_interval / m_mmdta_config->get_int ("assign_frq");
+  int _assign_inter = (int) start_interval / m_mmdta_settings.m_assign_frq;
   if (_assign_inter >= m_total_assign_inter)
     _assign_inter = m_total_assign_inter - 1;
 
@@ -17344,8 +17365,8 @@ MNM_MM_Due::get_lowest_cost_path_snapshot (int start_interval, int o_node_ID,
       _best_mid_parkinglot = nullptr;
       _pnr_path = nullptr;
       // just use a random middle parking lot
-      std::random_shuffle (_dest->m_connected_pnr_parkinglot_vec.begin (),
-                           _dest->m_connected_pnr_parkinglot_vec.end ());
+      MNM_Ults::random_shuffle (_dest->m_connected_pnr_parkinglot_vec.begin (),
+                                _dest->m_connected_pnr_parkinglot_vec.end ());
       for (auto _parkinglot : _dest->m_connected_pnr_parkinglot_vec)
         {
           _mid_dest_node_ID = _parkinglot->m_dest_node->m_node_ID;
@@ -17497,8 +17518,7 @@ MNM_MM_Due::get_lowest_cost_path_snapshot (int start_interval, int o_node_ID,
   IAssert (_p_path != nullptr);
 
   _best_time_col = start_interval;
-  _best_assign_col
-    = (int) _best_time_col / m_mmdta_config->get_int ("assign_frq");
+  _best_assign_col = (int) _best_time_col / m_mmdta_settings.m_assign_frq;
   if (_best_assign_col >= m_total_assign_inter)
     _best_assign_col = m_total_assign_inter - 1;
 
@@ -17643,8 +17663,8 @@ MNM_MM_Due::passenger_path_table_to_multimodal_path_table (
   // some fixed background truck demand MAY exist, which means
   // m_driving_path_table is not nullptr "Multimodal_DUE_ColumnGeneration" is
   // used for one-time loading and will not be used in DODE setting
-  if (m_mmdta_config->get_string ("routing_type")
-      == "Multimodal_Hybrid_ColumnGeneration")
+  if (m_mmdta_settings.m_routing_type
+      == MNM_Routing_Type::Multimodal_Hybrid_ColumnGeneration)
     { // no existing paths
       // m_mmdta == mmdta
       IAssert (dynamic_cast<MNM_Routing_Multimodal_Hybrid *> (mmdta->m_routing)
@@ -17663,8 +17683,8 @@ MNM_MM_Due::passenger_path_table_to_multimodal_path_table (
         = _path_table;
       m_truck_path_table = _path_table;
     }
-  else if (m_mmdta_config->get_string ("routing_type")
-           == "Multimodal_DUE_ColumnGeneration")
+  else if (m_mmdta_settings.m_routing_type
+           == MNM_Routing_Type::Multimodal_DUE_ColumnGeneration)
     {
       // m_mmdta != mmdta
       if (m_truck_path_table != nullptr)
@@ -17710,9 +17730,9 @@ MNM_MM_Due::passenger_path_table_to_multimodal_path_table (
   m_driving_path_table
     = dynamic_cast<MNM_Routing_Multimodal_Hybrid *> (mmdta->m_routing)
         ->m_routing_fixed_car->m_path_table;
-  if (m_mmdta_config->get_string ("routing_type")
-        == "Multimodal_Hybrid_ColumnGeneration"
-      || m_mmdta_config->get_string ("routing_type") == "Multimodal_Hybrid")
+  if (m_mmdta_settings.m_routing_type
+        == MNM_Routing_Type::Multimodal_Hybrid_ColumnGeneration
+      || m_mmdta_settings.m_routing_type == MNM_Routing_Type::Multimodal_Hybrid)
     {
       IAssert (m_mmdta == mmdta && m_truck_path_table == m_driving_path_table);
     }
@@ -17721,8 +17741,8 @@ MNM_MM_Due::passenger_path_table_to_multimodal_path_table (
       IAssert (m_mmdta != mmdta && m_truck_path_table != m_driving_path_table);
     }
 
-  if (m_mmdta_config->get_string ("routing_type")
-      == "Multimodal_Hybrid_ColumnGeneration")
+  if (m_mmdta_settings.m_routing_type
+      == MNM_Routing_Type::Multimodal_Hybrid_ColumnGeneration)
     { // no existing paths
       IAssert (dynamic_cast<MNM_Routing_Multimodal_Hybrid *> (mmdta->m_routing)
                  ->m_routing_car_pnr_fixed->m_pnr_path_table
@@ -17738,8 +17758,8 @@ MNM_MM_Due::passenger_path_table_to_multimodal_path_table (
         ->m_routing_passenger_fixed->m_bustransit_path_table
         = new Path_Table ();
     }
-  else if (m_mmdta_config->get_string ("routing_type")
-           == "Multimodal_DUE_ColumnGeneration")
+  else if (m_mmdta_settings.m_routing_type
+           == MNM_Routing_Type::Multimodal_DUE_ColumnGeneration)
     {
       // may have exisiting paths
       if (dynamic_cast<MNM_Routing_Multimodal_Hybrid *> (mmdta->m_routing)
@@ -17867,7 +17887,7 @@ MNM_MM_Due::passenger_path_table_to_multimodal_path_table (
                                   // 2*m_total_assign_inter
                                   _path->m_buffer[i] = _truck_path->m_buffer[i];
                                 }
-                              _driving_pathset->m_path_vec.push_back (_path);
+                              _driving_pathset->add_path (_path);
                             }
                         }
                     }
@@ -17935,7 +17955,7 @@ MNM_MM_Due::passenger_path_table_to_multimodal_path_table (
                                 = _passenger_path_driving->m_buffer[i]
                                   / _num_people;
                             }
-                          _driving_pathset->m_path_vec.push_back (_path);
+                          _driving_pathset->add_path (_path);
                         }
                     }
                 }
@@ -18048,7 +18068,7 @@ MNM_MM_Due::passenger_path_table_to_multimodal_path_table (
                                 = _passenger_path_pnr->m_buffer[i]
                                   / _num_people;
                             }
-                          _pnr_pathset->m_path_vec.push_back (_path);
+                          _pnr_pathset->add_path (_path);
                         }
                     }
                 }
@@ -18143,7 +18163,7 @@ MNM_MM_Due::passenger_path_table_to_multimodal_path_table (
                               _path->m_buffer[i]
                                 = _passenger_path_bus->m_buffer[i];
                             }
-                          _bustransit_pathset->m_path_vec.push_back (_path);
+                          _bustransit_pathset->add_path (_path);
                         }
                     }
                 }
@@ -18156,144 +18176,128 @@ MNM_MM_Due::passenger_path_table_to_multimodal_path_table (
 
 int
 MNM_MM_Due::build_link_cost_map (MNM_Dta_Multimodal *mmdta,
-                                 bool with_congestion_indicator)
+                                 bool with_congestion_indicator, bool verbose)
 {
-  MNM_Dlink_Multiclass *_link;
-  MNM_Transit_Link *_transitlink;
-  std::cout << "\n********************** Begin build_link_cost_map  "
-               "**********************\n";
+  int _num_threads = int (mmdta->m_settings.m_num_threads);
+  if (with_congestion_indicator && m_link_congested_car.empty ())
+    {
+      m_link_congested_car.reset (m_link_tt_map.get_link_IDs (),
+                                  m_total_loading_inter);
+      m_link_congested_truck.reset (m_link_tt_map.get_link_IDs (),
+                                    m_total_loading_inter);
+      m_transitlink_congested_passenger.reset (m_transitlink_tt_map
+                                                 .get_link_IDs (),
+                                               m_total_loading_inter);
+    }
 
+  std::vector<TFlt> _start_times;
+  for (int i = 0; i < m_total_loading_inter; i++)
+    _start_times.push_back (TFlt (i + 1));
+
+  std::vector<MNM_Dlink_Multiclass *> _links;
   for (auto _link_it : mmdta->m_link_factory->m_link_map)
-    {
-      // #pragma omp task
-      _link = dynamic_cast<MNM_Dlink_Multiclass *> (_link_it.second);
-      std::cout << "********************** build_link_cost_map driving link "
-                << _link_it.first << " **********************\n";
+    _links.push_back (dynamic_cast<MNM_Dlink_Multiclass *> (_link_it.second));
+  // the links are independent, each job only writes the rows of its link
+  MNM::fill_link_rows (
+    _links.size (), _num_threads, verbose, "build_link_cost_map driving",
+    [&] (size_t k) {
+      MNM_Dlink_Multiclass *_link = _links[k];
+      TInt _link_ID = _link->m_link_ID;
+      TFlt *_tt_car = m_link_tt_map[_link_ID];
+      TFlt *_tt_truck = m_link_tt_map_truck[_link_ID];
+      TFlt *_cost_car = m_link_cost_map[_link_ID];
+      TFlt *_cost_truck = m_link_cost_map_truck[_link_ID];
+      MNM_DTA_GRADIENT::get_travel_time_car_batch (_link, _start_times,
+                                                   m_unit_time,
+                                                   m_total_loading_inter,
+                                                   _tt_car); // intervals
+      MNM_DTA_GRADIENT::get_travel_time_truck_batch (_link, _start_times,
+                                                     m_unit_time,
+                                                     m_total_loading_inter,
+                                                     _tt_truck); // intervals
       for (int i = 0; i < m_total_loading_inter; i++)
         {
-          m_link_tt_map[_link_it.first][i] = MNM_DTA_GRADIENT::
-            get_travel_time_car (_link, TFlt (i + 1), m_unit_time,
-                                 m_total_loading_inter); // intervals
-          m_link_tt_map_truck[_link_it.first][i] = MNM_DTA_GRADIENT::
-            get_travel_time_truck (_link, TFlt (i + 1), m_unit_time,
-                                   m_total_loading_inter); // intervals
-          m_link_cost_map[_link_it.first][i]
-            = m_vot * m_link_tt_map[_link_it.first][i] + _link->m_toll_car;
-          m_link_cost_map_truck[_link_it.first][i]
-            = m_vot * m_link_tt_map_truck[_link_it.first][i]
-              + _link->m_toll_truck;
-          // std::cout << "interval: " << i << ", link: " << _link_it.first <<
-          // ", tt: " << m_link_tt_map[_link_it.first][i] << "\n"; std::cout <<
-          // "car in" << "\n"; std::cout << _link -> m_N_in_car -> to_string()
-          // << "\n"; std::cout << "car out" << "\n"; std::cout << _link ->
-          // m_N_out_car -> to_string() << "\n"; std::cout << "truck in" <<
-          // "\n"; std::cout << _link -> m_N_in_truck -> to_string() << "\n";
-          // std::cout << "truck out" << "\n";
-          // std::cout << _link -> m_N_out_truck -> to_string() << "\n";
-          if (with_congestion_indicator)
+          _cost_car[i] = m_vot * _tt_car[i] + _link->m_toll_car;
+          _cost_truck[i] = m_vot * _tt_truck[i] + _link->m_toll_truck;
+        }
+      if (with_congestion_indicator)
+        {
+          bool *_congested_car = m_link_congested_car[_link_ID];
+          bool *_congested_truck = m_link_congested_truck[_link_ID];
+          for (int i = 0; i < m_total_loading_inter; i++)
             {
-              // std::cout << "car, interval: " << i << ", link: " <<
-              // _link_it.first << ", tt: " << m_link_tt_map[_link_it.first][i]
-              // << ", fftt: " << _link -> get_link_freeflow_tt_car() /
-              // m_unit_time << "\n"; std::cout << "truck, interval: " << i <<
-              // ", link: " << _link_it.first << ", tt: " <<
-              // m_link_tt_map_truck[_link_it.first][i] << ", fftt: " << _link
-              // -> get_link_freeflow_tt_truck() / m_unit_time << "\n";
-
-              // std::cout << "car, interval: " << i << ", link: " <<
-              // _link_it.first << ", tt: " << m_link_tt_map[_link_it.first][i]
-              // << ", fftt: " << _link -> get_link_freeflow_tt_loading_car() <<
-              // "\n"; std::cout << "truck, interval: " << i << ", link: " <<
-              // _link_it.first << ", tt: " <<
-              // m_link_tt_map_truck[_link_it.first][i] << ", fftt: " << _link
-              // -> get_link_freeflow_tt_loading_truck() << "\n";
-              if (m_link_congested_car.find (_link_it.first)
-                  == m_link_congested_car.end ())
-                {
-                  m_link_congested_car[_link_it.first]
-                    = new bool[m_total_loading_inter];
-                }
-              m_link_congested_car[_link_it.first][i]
-                = m_link_tt_map[_link_it.first][i]
-                  > _link->get_link_freeflow_tt_loading_car ();
-              if (m_link_congested_truck.find (_link_it.first)
-                  == m_link_congested_truck.end ())
-                {
-                  m_link_congested_truck[_link_it.first]
-                    = new bool[m_total_loading_inter];
-                }
-              m_link_congested_truck[_link_it.first][i]
-                = m_link_tt_map_truck[_link_it.first][i]
-                  > _link->get_link_freeflow_tt_loading_truck ();
-
-              // std::cout << "car, interval: " << i << ", link: " <<
-              // _link_it.first << ", congested?: " <<
-              // m_link_congested_car[_link_it.first][i] << "\n"; std::cout <<
-              // "truck, interval: " << i << ", link: " << _link_it.first << ",
-              // congested?: " << m_link_congested_car[_link_it.first][i] <<
-              // "\n";
+              _congested_car[i]
+                = _tt_car[i] > _link->get_link_freeflow_tt_loading_car ();
+              _congested_truck[i]
+                = _tt_truck[i] > _link->get_link_freeflow_tt_loading_truck ();
             }
         }
-    }
+    });
+
+  // the bus links leaving a bus stop share the last valid time the stop
+  // caches on first use, so they are computed by the same job
+  std::vector<std::vector<MNM_Transit_Link *>> _jobs;
+  std::unordered_map<MNM_Busstop_Virtual *, size_t> _stop_job;
   for (auto _link_it : mmdta->m_transitlink_factory->m_transit_link_map)
     {
-      // #pragma omp task
-      _transitlink = _link_it.second;
-      std::cout
-        << "********************** build_link_cost_map bus transit link "
-        << _link_it.first << " **********************\n";
-      for (int i = 0; i < m_total_loading_inter; i++)
+      MNM_Transit_Link *_transitlink = _link_it.second;
+      auto *_buslink = dynamic_cast<MNM_Bus_Link *> (_transitlink);
+      if (_transitlink->m_link_type == MNM_TYPE_BUS_MULTIMODAL
+          && _buslink != nullptr)
+        {
+          auto _job_it
+            = _stop_job.insert ({ _buslink->m_from_busstop, _jobs.size () })
+                .first;
+          if (_job_it->second == _jobs.size ())
+            _jobs.push_back (std::vector<MNM_Transit_Link *> ());
+          _jobs[_job_it->second].push_back (_transitlink);
+        }
+      else
+        {
+          _jobs.push_back (std::vector<MNM_Transit_Link *> (1, _transitlink));
+        }
+    }
+  MNM::fill_link_rows (
+    _jobs.size (), _num_threads, verbose, "build_link_cost_map transit",
+    [&] (size_t k) {
+      for (MNM_Transit_Link *_transitlink : _jobs[k])
         {
+          TInt _link_ID = _transitlink->m_link_ID;
+          TFlt *_tt = m_transitlink_tt_map[_link_ID];
+          TFlt *_cost = m_transitlink_cost_map[_link_ID];
           if (_transitlink->m_link_type == MNM_TYPE_WALKING_MULTIMODAL)
             {
-              m_transitlink_tt_map[_link_it.first][i] = MNM_DTA_GRADIENT::
-                get_travel_time_walking (dynamic_cast<MNM_Walking_Link *> (
-                                           _transitlink),
-                                         TFlt (i + 1), m_unit_time,
-                                         m_total_loading_inter); // intervals
+              auto *_walkinglink
+                = dynamic_cast<MNM_Walking_Link *> (_transitlink);
+              MNM_DTA_GRADIENT::
+                get_travel_time_walking_batch (_walkinglink, _start_times,
+                                               m_unit_time,
+                                               m_total_loading_inter, _tt);
             }
           else if (_transitlink->m_link_type == MNM_TYPE_BUS_MULTIMODAL)
             {
-              m_transitlink_tt_map[_link_it.first][i] = MNM_DTA_GRADIENT::
-                get_travel_time_bus (dynamic_cast<MNM_Bus_Link *> (
-                                       _transitlink),
-                                     TFlt (i + 1), m_unit_time,
-                                     m_total_loading_inter,
-                                     mmdta->m_explicit_bus, false,
-                                     !mmdta->m_explicit_bus); // intervals
+              auto *_buslink = dynamic_cast<MNM_Bus_Link *> (_transitlink);
+              MNM_DTA_GRADIENT::
+                get_travel_time_bus_batch (_buslink, _start_times, m_unit_time,
+                                           m_total_loading_inter, _tt,
+                                           mmdta->m_explicit_bus, false,
+                                           !mmdta->m_explicit_bus);
             }
           else
             {
               throw std::runtime_error ("Wrong transit link type");
             }
-          // std::cout << "interval: " << i << ", link: " << _link_it.first <<
-          // ", tt: " << m_transitlink_tt_map[_link_it.first][i] << "\n";
-
-          m_transitlink_cost_map[_link_it.first][i]
-            = m_vot * m_transitlink_tt_map[_link_it.first][i];
-
+          for (int i = 0; i < m_total_loading_inter; i++)
+            _cost[i] = m_vot * _tt[i]; // intervals
           if (with_congestion_indicator)
             {
-              if (m_transitlink_congested_passenger.find (_link_it.first)
-                  == m_transitlink_congested_passenger.end ())
-                {
-                  m_transitlink_congested_passenger[_link_it.first]
-                    = new bool[m_total_loading_inter];
-                }
               // TODO: walking link will not be congested, bus link may has
               // infinity values
-              m_transitlink_congested_passenger[_link_it.first][i] = false;
-              // m_transitlink_congested_passenger[_link_it.first][i] =
-              // m_transitlink_cost_map[_link_it.first][i] > _transitlink ->
-              // m_fftt / m_unit_time; std::cout << "passenger, interval: " << i
-              // << ", link: " << _link_it.first << ", congested?: " <<
-              // m_transitlink_congested_passenger[_link_it.first][i] << "\n";
+              std::fill_n (m_transitlink_congested_passenger[_link_ID],
+                           int (m_total_loading_inter), false);
             }
         }
-    }
-
-  std::cout << "********************** End build_link_cost_map  "
-               "**********************\n";
+    });
   return 0;
 }
 
@@ -18308,6 +18312,16 @@ MNM_MM_Due::get_link_queue_dissipated_time (MNM_Dta_Multimodal *mmdta)
   bool _flg;
   std::cout << "\n********************** Begin get_link_queue_dissipated_time "
                "**********************\n";
+  if (m_queue_dissipated_time_car.empty ())
+    {
+      m_queue_dissipated_time_car.reset (m_link_tt_map.get_link_IDs (),
+                                         m_total_loading_inter);
+      m_queue_dissipated_time_truck.reset (m_link_tt_map.get_link_IDs (),
+                                           m_total_loading_inter);
+      m_queue_dissipated_time_passenger.reset (m_transitlink_tt_map
+                                                 .get_link_IDs (),
+                                               m_total_loading_inter);
+    }
   // TODO: switch t and link order
   for (int i = 0; i < m_total_loading_inter; i++)
     {
@@ -18316,12 +18330,6 @@ MNM_MM_Due::get_link_queue_dissipated_time (MNM_Dta_Multimodal *mmdta)
       for (auto _link_it : mmdta->m_link_factory->m_link_map)
         {
           // ************************** car **************************
-          if (m_queue_dissipated_time_car.find (_link_it.first)
-              == m_queue_dissipated_time_car.end ())
-            {
-              m_queue_dissipated_time_car[_link_it.first]
-                = new int[m_total_loading_inter];
-            }
           if (m_link_congested_car[_link_it.first][i])
             {
               if (i == m_total_loading_inter - 1)
@@ -18456,12 +18464,6 @@ MNM_MM_Due::get_link_queue_dissipated_time (MNM_Dta_Multimodal *mmdta)
             }
 
           // ************************** truck **************************
-          if (m_queue_dissipated_time_truck.find (_link_it.first)
-              == m_queue_dissipated_time_truck.end ())
-            {
-              m_queue_dissipated_time_truck[_link_it.first]
-                = new int[m_total_loading_inter];
-            }
           if (m_link_congested_truck[_link_it.first][i])
             {
               if (i == m_total_loading_inter - 1)
@@ -18603,12 +18605,6 @@ MNM_MM_Due::get_link_queue_dissipated_time (MNM_Dta_Multimodal *mmdta)
       // TODO: bus, waiting, infinity values
       for (auto _link_it : mmdta->m_transitlink_factory->m_transit_link_map)
         {
-          if (m_queue_dissipated_time_passenger.find (_link_it.first)
-              == m_queue_dissipated_time_passenger.end ())
-            {
-              m_queue_dissipated_time_passenger[_link_it.first]
-                = new int[m_total_loading_inter];
-            }
           if (m_transitlink_congested_passenger[_link_it.first][i])
             {
               if (i == m_total_loading_inter - 1)
@@ -18873,7 +18869,7 @@ MNM_MM_Due::get_best_driving_path (TInt o_node_ID, MNM_TDSP_Tree *tdsp_tree,
       _tmp_cost
         = _p_path_driving->get_travel_cost (TFlt (i), mmdta, m_link_tt_map,
                                             m_transitlink_tt_map);
-      _assign_inter = (int) i / m_mmdta_config->get_int ("assign_frq");
+      _assign_inter = (int) i / m_mmdta_settings.m_assign_frq;
       if (_assign_inter >= m_total_assign_inter)
         _assign_inter = m_total_assign_inter - 1;
       _tot_dmd_one_mode
@@ -18942,7 +18938,7 @@ MNM_MM_Due::get_best_bus_path (TInt o_node_ID, MNM_TDSP_Tree *tdsp_tree,
       // _tmp_cost = _p_path_bus ->get_travel_cost(TFlt(i), mmdta);
       _tmp_cost = _p_path_bus->get_travel_cost (TFlt (i), mmdta, m_link_tt_map,
                                                 m_transitlink_tt_map);
-      _assign_inter = (int) i / m_mmdta_config->get_int ("assign_frq");
+      _assign_inter = (int) i / m_mmdta_settings.m_assign_frq;
       if (_assign_inter >= m_total_assign_inter)
         _assign_inter = m_total_assign_inter - 1;
       _tot_dmd_one_mode
@@ -19065,7 +19061,7 @@ MNM_MM_Due::get_best_pnr_path (
           _tmp_cost
             = _p_path_pnr->get_travel_cost (TFlt (i), mmdta, m_link_tt_map,
                                             m_transitlink_tt_map);
-          _assign_inter = (int) i / m_mmdta_config->get_int ("assign_frq");
+          _assign_inter = (int) i / m_mmdta_settings.m_assign_frq;
           if (_assign_inter >= m_total_assign_inter)
             _assign_inter = m_total_assign_inter - 1;
           _tot_dmd_one_mode
@@ -19220,7 +19216,7 @@ MNM_MM_Due::get_best_existing_driving_path (TInt o_node_ID, TInt d_node_ID,
   MNM_Path *_path = nullptr;
   for (int i = 0; i < m_total_loading_inter; i++)
     {
-      _assign_inter = (int) i / m_mmdta_config->get_int ("assign_frq");
+      _assign_inter = (int) i / m_mmdta_settings.m_assign_frq;
       if (_assign_inter >= m_total_assign_inter)
         _assign_inter = m_total_assign_inter - 1;
       _tot_dmd_one_mode
@@ -19299,7 +19295,7 @@ MNM_MM_Due::get_best_existing_bus_path (TInt o_node_ID, TInt d_node_ID,
   MNM_Path *_path = nullptr;
   for (int i = 0; i < m_total_loading_inter; i++)
     {
-      _assign_inter = (int) i / m_mmdta_config->get_int ("assign_frq");
+      _assign_inter = (int) i / m_mmdta_settings.m_assign_frq;
       if (_assign_inter >= m_total_assign_inter)
         _assign_inter = m_total_assign_inter - 1;
       _tot_dmd_one_mode
@@ -19384,7 +19380,7 @@ MNM_MM_Due::get_best_existing_pnr_path (TInt o_node_ID, TInt d_node_ID,
   MNM_PnR_Path *_pnr_path = nullptr;
   for (int i = 0; i < m_total_loading_inter; i++)
     {
-      _assign_inter = (int) i / m_mmdta_config->get_int ("assign_frq");
+      _assign_inter = (int) i / m_mmdta_settings.m_assign_frq;
       if (_assign_inter >= m_total_assign_inter)
         _assign_inter = m_total_assign_inter - 1;
       _tot_dmd_one_mode
@@ -19551,7 +19547,7 @@ MNM_MM_Due::get_best_driving_path_for_single_interval (
   MNM_Dta_Multimodal *mmdta)
 {
   // input interval is the loading interval
-  IAssert (interval + m_mmdta_config->get_int ("assign_frq")
+  IAssert (interval + m_mmdta_settings.m_assign_frq
            <= m_total_loading_inter); // tdsp_tree -> m_max_interval =
                                       // total_loading_interval
 
@@ -19601,7 +19597,7 @@ MNM_MM_Due::get_best_driving_path_for_single_interval (
       _tmp_cost
         = _p_path_driving->get_travel_cost (TFlt (i), mmdta, m_link_tt_map,
                                             m_transitlink_tt_map);
-      _assign_inter = (int) i / m_mmdta_config->get_int ("assign_frq");
+      _assign_inter = (int) i / m_mmdta_settings.m_assign_frq;
       if (_assign_inter >= m_total_assign_inter)
         _assign_inter = m_total_assign_inter - 1;
       _tot_dmd_one_mode
@@ -19637,7 +19633,7 @@ MNM_MM_Due::get_best_bus_path_for_single_interval (TInt interval,
                                                    MNM_Dta_Multimodal *mmdta)
 {
   // input interval is the loading interval
-  IAssert (interval + m_mmdta_config->get_int ("assign_frq")
+  IAssert (interval + m_mmdta_settings.m_assign_frq
            <= m_total_loading_inter); // tdsp_tree -> m_max_interval =
                                       // total_loading_interval
 
@@ -19678,7 +19674,7 @@ MNM_MM_Due::get_best_bus_path_for_single_interval (TInt interval,
       // _tmp_cost = _p_path_bus ->get_travel_cost(TFlt(i), mmdta);
       _tmp_cost = _p_path_bus->get_travel_cost (TFlt (i), mmdta, m_link_tt_map,
                                                 m_transitlink_tt_map);
-      _assign_inter = (int) i / m_mmdta_config->get_int ("assign_frq");
+      _assign_inter = (int) i / m_mmdta_settings.m_assign_frq;
       if (_assign_inter >= m_total_assign_inter)
         _assign_inter = m_total_assign_inter - 1;
       _tot_dmd_one_mode
@@ -19713,7 +19709,7 @@ MNM_MM_Due::get_best_pnr_path_for_single_interval (
   MNM_Dta_Multimodal *mmdta)
 {
   // input interval is the loading interval
-  IAssert (interval + m_mmdta_config->get_int ("assign_frq")
+  IAssert (interval + m_mmdta_settings.m_assign_frq
            <= m_total_loading_inter); // tdsp_tree -> m_max_interval =
                                       // total_loading_interval
 
@@ -19810,7 +19806,7 @@ MNM_MM_Due::get_best_pnr_path_for_single_interval (
           _tmp_cost
             = _p_path_pnr->get_travel_cost (TFlt (i), mmdta, m_link_tt_map,
                                             m_transitlink_tt_map);
-          _assign_inter = (int) i / m_mmdta_config->get_int ("assign_frq");
+          _assign_inter = (int) i / m_mmdta_settings.m_assign_frq;
           if (_assign_inter >= m_total_assign_inter)
             _assign_inter = m_total_assign_inter - 1;
           _tot_dmd_one_mode
@@ -19848,7 +19844,7 @@ MNM_MM_Due::get_best_path_for_single_interval (
   MNM_Dta_Multimodal *mmdta)
 {
   // input interval is the loading interval
-  IAssert (interval + m_mmdta_config->get_int ("assign_frq")
+  IAssert (interval + m_mmdta_settings.m_assign_frq
            <= m_total_loading_inter); // tdsp_tree -> m_max_interval =
                                       // total_loading_interval
 
@@ -19954,7 +19950,7 @@ MNM_MM_Due::get_best_existing_driving_path_for_single_interval (
   TInt interval, TInt o_node_ID, TInt d_node_ID, MNM_Dta_Multimodal *mmdta)
 {
   // input interval is the loading interval
-  IAssert (interval + m_mmdta_config->get_int ("assign_frq")
+  IAssert (interval + m_mmdta_settings.m_assign_frq
            <= m_total_loading_inter); // tdsp_tree -> m_max_interval =
                                       // total_loading_interval
 
@@ -19986,7 +19982,7 @@ MNM_MM_Due::get_best_existing_driving_path_for_single_interval (
   MNM_Path *_path = nullptr;
   for (int i = interval; i < interval + 1; i++)
     {
-      _assign_inter = (int) i / m_mmdta_config->get_int ("assign_frq");
+      _assign_inter = (int) i / m_mmdta_settings.m_assign_frq;
       if (_assign_inter >= m_total_assign_inter)
         _assign_inter = m_total_assign_inter - 1;
       _tot_dmd_one_mode
@@ -20050,7 +20046,7 @@ MNM_MM_Due::get_best_existing_bus_path_for_single_interval (
   TInt interval, TInt o_node_ID, TInt d_node_ID, MNM_Dta_Multimodal *mmdta)
 {
   // input interval is the loading interval
-  IAssert (interval + m_mmdta_config->get_int ("assign_frq")
+  IAssert (interval + m_mmdta_settings.m_assign_frq
            <= m_total_loading_inter); // tdsp_tree -> m_max_interval =
                                       // total_loading_interval
 
@@ -20082,7 +20078,7 @@ MNM_MM_Due::get_best_existing_bus_path_for_single_interval (
   MNM_Path *_path = nullptr;
   for (int i = interval; i < interval + 1; i++)
     {
-      _assign_inter = (int) i / m_mmdta_config->get_int ("assign_frq");
+      _assign_inter = (int) i / m_mmdta_settings.m_assign_frq;
       if (_assign_inter >= m_total_assign_inter)
         _assign_inter = m_total_assign_inter - 1;
       _tot_dmd_one_mode
@@ -20149,7 +20145,7 @@ MNM_MM_Due::get_best_existing_pnr_path_for_single_interval (
   TInt interval, TInt o_node_ID, TInt d_node_ID, MNM_Dta_Multimodal *mmdta)
 {
   // input interval is the loading interval
-  IAssert (interval + m_mmdta_config->get_int ("assign_frq")
+  IAssert (interval + m_mmdta_settings.m_assign_frq
            <= m_total_loading_inter); // tdsp_tree -> m_max_interval =
                                       // total_loading_interval
 
@@ -20183,7 +20179,7 @@ MNM_MM_Due::get_best_existing_pnr_path_for_single_interval (
   MNM_PnR_Path *_pnr_path = nullptr;
   for (int i = interval; i < interval + 1; i++)
     {
-      _assign_inter = (int) i / m_mmdta_config->get_int ("assign_frq");
+      _assign_inter = (int) i / m_mmdta_settings.m_assign_frq;
       if (_assign_inter >= m_total_assign_inter)
         _assign_inter = m_total_assign_inter - 1;
       _tot_dmd_one_mode
@@ -20376,7 +20372,7 @@ MNM_MM_Due::update_one_path_cost (MNM_Passenger_Path_Base *p_path,
   p_path->m_travel_disutility_vec.clear ();
   for (int _col = 0; _col < m_total_assign_inter; _col++)
     {
-      _depart_time = _col * m_mmdta_config->get_int ("assign_frq");
+      _depart_time = _col * m_mmdta_settings.m_assign_frq;
       // _travel_time = p_path->get_travel_time(TFlt(_depart_time), mmdta) *
       // m_unit_time;  // seconds _travel_cost =
       // p_path->get_travel_cost(TFlt(_depart_time), mmdta);
@@ -20457,8 +20453,8 @@ MNM_MM_Due::update_path_table (MNM_Dta_Multimodal *mmdta, int iter)
   std::unordered_map<TInt, MNM_TDSP_Tree *> _tdsp_tree_map_bus
     = std::unordered_map<TInt, MNM_TDSP_Tree *> ();
   // build_link_cost_map(mmdta) is called before this function
-  if (m_mmdta_config->get_string ("routing_type")
-      == "Multimodal_DUE_ColumnGeneration")
+  if (m_mmdta_settings.m_routing_type
+      == MNM_Routing_Type::Multimodal_DUE_ColumnGeneration)
     {
       for (auto _d_it : mmdta->m_od_factory->m_destination_map)
         {
@@ -20519,8 +20515,8 @@ MNM_MM_Due::update_path_table (MNM_Dta_Multimodal *mmdta, int iter)
                                               m_total_assign_inter);
           _tot_change = 0.0;
           _best_path = nullptr;
-          if (m_mmdta_config->get_string ("routing_type")
-              == "Multimodal_DUE_ColumnGeneration")
+          if (m_mmdta_settings.m_routing_type
+              == MNM_Routing_Type::Multimodal_DUE_ColumnGeneration)
             {
               _path_result = get_best_path (_orig_node_ID, _dest_node_ID,
                                             _tdsp_tree_map_driving,
@@ -20537,7 +20533,7 @@ MNM_MM_Due::update_path_table (MNM_Dta_Multimodal *mmdta, int iter)
           _mode = _path_result.second;
           _best_time_col = std::get<1> (_path_result.first);
           _best_assign_col
-            = (int) _best_time_col / m_mmdta_config->get_int ("assign_frq");
+            = (int) _best_time_col / m_mmdta_settings.m_assign_frq;
           if (_best_assign_col >= m_total_assign_inter)
             _best_assign_col = m_total_assign_inter - 1;
           // printf("Best time col %d\n", _best_time_col);
@@ -20601,8 +20597,8 @@ MNM_MM_Due::update_path_table (MNM_Dta_Multimodal *mmdta, int iter)
             }
           _path_set_vec = { _path_set_driving, _path_set_bus, _path_set_pnr };
 
-          if (m_mmdta_config->get_string ("routing_type")
-              == "Multimodal_DUE_ColumnGeneration")
+          if (m_mmdta_settings.m_routing_type
+              == MNM_Routing_Type::Multimodal_DUE_ColumnGeneration)
             {
               _exist = false;
               if (_mode == driving && _path_set_driving != nullptr)
@@ -20707,20 +20703,20 @@ MNM_MM_Due::update_path_table (MNM_Dta_Multimodal *mmdta, int iter)
                 {
                   _path->m_path->m_path_ID
                     = (int) _path_set_driving->m_path_vec.size ();
-                  _path_set_driving->m_path_vec.push_back (_path);
+                  _path_set_driving->add_path (_path);
                 }
               else if (_mode == transit)
                 {
                   _path->m_path->m_path_ID
                     = (int) _path_set_bus->m_path_vec.size ();
-                  _path_set_bus->m_path_vec.push_back (_path);
+                  _path_set_bus->add_path (_path);
                 }
               else if (_mode == pnr)
                 {
                   dynamic_cast<MNM_Passenger_Path_PnR *> (_path)
                     ->m_path->m_path_ID
                     = (int) _path_set_pnr->m_path_vec.size ();
-                  _path_set_pnr->m_path_vec.push_back (_path);
+                  _path_set_pnr->add_path (_path);
                 }
               else
                 {
@@ -20794,8 +20790,8 @@ MNM_MM_Due::update_path_table_fixed_departure_time_choice (
   std::unordered_map<TInt, MNM_TDSP_Tree *> _tdsp_tree_map_bus
     = std::unordered_map<TInt, MNM_TDSP_Tree *> ();
   // build_link_cost_map(mmdta) is called before this function
-  if (m_mmdta_config->get_string ("routing_type")
-      == "Multimodal_DUE_ColumnGeneration")
+  if (m_mmdta_settings.m_routing_type
+      == MNM_Routing_Type::Multimodal_DUE_ColumnGeneration)
     {
       for (auto _d_it : mmdta->m_od_factory->m_destination_map)
         {
@@ -20897,8 +20893,8 @@ MNM_MM_Due::update_path_table_fixed_departure_time_choice (
             {
               _tot_change = 0.0;
               _best_path = nullptr;
-              if (m_mmdta_config->get_string ("routing_type")
-                  == "Multimodal_DUE_ColumnGeneration")
+              if (m_mmdta_settings.m_routing_type
+                  == MNM_Routing_Type::Multimodal_DUE_ColumnGeneration)
                 {
                   _path_result
                     = get_best_path_for_single_interval (_col
@@ -20914,7 +20910,7 @@ MNM_MM_Due::update_path_table_fixed_departure_time_choice (
               else
                 {
                   _path_result = get_best_existing_path_for_single_interval (
-                    _col * m_mmdta_config->get_int ("assign_frq"),
+                    _col * m_mmdta_settings.m_assign_frq,
                     _orig_node_ID, _dest_node_ID, mmdta);
                 }
 
@@ -20923,7 +20919,7 @@ MNM_MM_Due::update_path_table_fixed_departure_time_choice (
               _mode = _path_result.second;
               _best_time_col = std::get<1> (_path_result.first);
               _best_assign_col
-                = (int) _best_time_col / m_mmdta_config->get_int ("assign_frq");
+                = (int) _best_time_col / m_mmdta_settings.m_assign_frq;
               if (_best_assign_col >= m_total_assign_inter)
                 _best_assign_col = m_total_assign_inter - 1;
               // printf("Best time col %d\n", _best_time_col);
@@ -20946,8 +20942,8 @@ MNM_MM_Due::update_path_table_fixed_departure_time_choice (
                   throw std::runtime_error ("Mode not implemented");
                 }
 
-              if (m_mmdta_config->get_string ("routing_type")
-                  == "Multimodal_DUE_ColumnGeneration")
+              if (m_mmdta_settings.m_routing_type
+                  == MNM_Routing_Type::Multimodal_DUE_ColumnGeneration)
                 {
                   _exist = false;
                   if (_mode == driving && _path_set_driving != nullptr)
@@ -20988,20 +20984,20 @@ MNM_MM_Due::update_path_table_fixed_departure_time_choice (
                     {
                       _path->m_path->m_path_ID
                         = (int) _path_set_driving->m_path_vec.size ();
-                      _path_set_driving->m_path_vec.push_back (_path);
+                      _path_set_driving->add_path (_path);
                     }
                   else if (_mode == transit)
                     {
                       _path->m_path->m_path_ID
                         = (int) _path_set_bus->m_path_vec.size ();
-                      _path_set_bus->m_path_vec.push_back (_path);
+                      _path_set_bus->add_path (_path);
                     }
                   else if (_mode == pnr)
                     {
                       dynamic_cast<MNM_Passenger_Path_PnR *> (_path)
                         ->m_path->m_path_ID
                         = (int) _path_set_pnr->m_path_vec.size ();
-                      _path_set_pnr->m_path_vec.push_back (_path);
+                      _path_set_pnr->add_path (_path);
                     }
                   else
                     {
@@ -21101,8 +21097,8 @@ MNM_MM_Due::update_path_table_gp_fixed_departure_time_choice (
   std::unordered_map<TInt, MNM_TDSP_Tree *> _tdsp_tree_map_bus
     = std::unordered_map<TInt, MNM_TDSP_Tree *> ();
   // build_link_cost_map(mmdta);
-  if (m_mmdta_config->get_string ("routing_type")
-      == "Multimodal_DUE_ColumnGeneration")
+  if (m_mmdta_settings.m_routing_type
+      == MNM_Routing_Type::Multimodal_DUE_ColumnGeneration)
     {
       // build_link_cost_map(mmdta);
       for (auto _d_it : mmdta->m_od_factory->m_destination_map)
@@ -21209,8 +21205,8 @@ MNM_MM_Due::update_path_table_gp_fixed_departure_time_choice (
               _tau = TFlt (std::numeric_limits<double>::infinity ());
               _min_flow = TFlt (std::numeric_limits<double>::infinity ());
               _flg = false;
-              if (m_mmdta_config->get_string ("routing_type")
-                  == "Multimodal_DUE_ColumnGeneration")
+              if (m_mmdta_settings.m_routing_type
+                  == MNM_Routing_Type::Multimodal_DUE_ColumnGeneration)
                 {
                   _path_result
                     = get_best_path_for_single_interval (_col
@@ -21226,7 +21222,7 @@ MNM_MM_Due::update_path_table_gp_fixed_departure_time_choice (
               else
                 {
                   _path_result = get_best_existing_path_for_single_interval (
-                    _col * m_mmdta_config->get_int ("assign_frq"),
+                    _col * m_mmdta_settings.m_assign_frq,
                     _orig_node_ID, _dest_node_ID, mmdta);
                 }
 
@@ -21235,7 +21231,7 @@ MNM_MM_Due::update_path_table_gp_fixed_departure_time_choice (
               _mode = _path_result.second;
               _best_time_col = std::get<1> (_path_result.first);
               _best_assign_col
-                = (int) _best_time_col / m_mmdta_config->get_int ("assign_frq");
+                = (int) _best_time_col / m_mmdta_settings.m_assign_frq;
               if (_best_assign_col >= m_total_assign_inter)
                 _best_assign_col = m_total_assign_inter - 1;
               // printf("Best time col %d\n", _best_time_col);
@@ -21258,8 +21254,8 @@ MNM_MM_Due::update_path_table_gp_fixed_departure_time_choice (
                   throw std::runtime_error ("Mode not implemented");
                 }
 
-              if (m_mmdta_config->get_string ("routing_type")
-                  == "Multimodal_DUE_ColumnGeneration")
+              if (m_mmdta_settings.m_routing_type
+                  == MNM_Routing_Type::Multimodal_DUE_ColumnGeneration)
                 {
                   _exist = false;
                   if (_mode == driving && _path_set_driving != nullptr)
@@ -21303,20 +21299,20 @@ MNM_MM_Due::update_path_table_gp_fixed_departure_time_choice (
                     {
                       _path->m_path->m_path_ID
                         = (int) _path_set_driving->m_path_vec.size ();
-                      _path_set_driving->m_path_vec.push_back (_path);
+                      _path_set_driving->add_path (_path);
                     }
                   else if (_mode == transit)
                     {
                       _path->m_path->m_path_ID
                         = (int) _path_set_bus->m_path_vec.size ();
-                      _path_set_bus->m_path_vec.push_back (_path);
+                      _path_set_bus->add_path (_path);
                     }
                   else if (_mode == pnr)
                     {
                       dynamic_cast<MNM_Passenger_Path_PnR *> (_path)
                         ->m_path->m_path_ID
                         = (int) _path_set_pnr->m_path_vec.size ();
-                      _path_set_pnr->m_path_vec.push_back (_path);
+                      _path_set_pnr->add_path (_path);
                     }
                   else
                     {
@@ -21491,6 +21487,7 @@ MNM_Dta_Multimodal *
 MNM_MM_Due::run_mmdta (bool verbose)
 {
   auto *mmdta = new MNM_Dta_Multimodal (m_file_folder);
+  mmdta->m_profiler = m_profiler;
   mmdta->build_from_files (); // set_routing() is done
   mmdta->hook_up_node_and_link ();
   mmdta->find_connected_pnr_parkinglot_for_destination ();
@@ -21546,7 +21543,7 @@ MNM_MM_Due::run_mmdta_adaptive (bool verbose)
   while (!mmdta->finished_loading (_current_inter)
          || _dta_assign_inter < mmdta->m_total_assign_inter)
     {
-      if ((_current_inter % m_mmdta_config->get_int ("assign_frq") == 0)
+      if ((_current_inter % m_mmdta_settings.m_assign_frq == 0)
           && (_due_assign_inter < m_total_assign_inter))
         {
           if (_current_inter == 0)
@@ -21568,7 +21565,7 @@ MNM_MM_Due::run_mmdta_adaptive (bool verbose)
                     << "Current loading interval: " << _current_inter << ", "
                     << "Current assignment interval: "
                     << int (_current_inter
-                            / m_mmdta_config->get_int ("assign_frq"))
+                            / m_mmdta_settings.m_assign_frq)
                     << std::endl;
         }
 
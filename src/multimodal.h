@@ -65,6 +65,8 @@ public:
   TFlt m_flow_scalar;
 
   MNM_Routing_Multimodal_Hybrid *m_routing;
+  // splits passenger cohorts at the boarding and alighting limits
+  MNM_Passenger_Factory *m_passenger_factory;
 };
 
 /**************************************************************************
@@ -262,7 +264,12 @@ public:
   MNM_Path *m_driving_path;
   MNM_Path *m_transit_path;
   MNM_PnR_Path *m_pnr_path;
+  // position on the links of m_transit_path, set by fixed routing only
+  MNM_Route_Cursor<MNM_Transit_Link> m_route;
   TInt m_assign_interval;
+  // number of travelers this record stands for, more than one only for the
+  // cohorts made when MNM_Passenger_Factory::m_cohort is set
+  TInt m_count;
 };
 
 /******************************************************************************************************************
@@ -276,12 +283,27 @@ public:
   MNM_Passenger_Factory ();
   ~MNM_Passenger_Factory ();
 
-  MNM_Passenger *make_passenger (TInt timestamp, TInt passenger_type);
+  MNM_Passenger *make_passenger (TInt timestamp, TInt passenger_type,
+                                TInt count = 1);
+  // same as MNM_Veh_Factory::add_veh, for the passengers of make_passenger
+  int add_passenger (MNM_Passenger *passenger);
+  static void set_thread_batch (std::vector<MNM_Passenger *> *batch);
+  int commit_batches (std::vector<std::vector<MNM_Passenger *>> &batches);
+  // moves count travelers of a cohort to a new record in the same state
+  MNM_Passenger *split_passenger (MNM_Passenger *passenger, TInt count);
   MNM_Passenger *get_passenger (TInt ID);
   int remove_finished_passenger (MNM_Passenger *passenger, bool del = true);
 
   std::unordered_map<TInt, MNM_Passenger *> m_passenger_map;
 
+  // release one record per OD pair and passenger type in each interval
+  // instead of one per traveler, records are split by path at the origin and
+  // at the boarding and alighting limits of bus stops; the counts match the
+  // individual mode at the end of each assignment interval, but a cohort may
+  // board and alight at other ticks within it
+  bool m_cohort;
+  TInt m_last_passenger_ID;
+  // the counters below count travelers, not records
   TInt m_num_passenger;
   TInt m_enroute_passenger;
   TInt m_finished_passenger;
@@ -307,6 +329,8 @@ public:
   virtual ~MNM_Veh_Multimodal () override;
 
   int board_and_alight (TInt timestamp, MNM_Busstop *busstop);
+  // travelers on board
+  TInt get_num_passenger ();
 
   virtual TInt get_class () override { return m_class; }; // virtual getter
   virtual TInt get_bus_route_ID () override
@@ -353,6 +377,7 @@ public:
                        bool is_pnr = false,
                        TInt pickup_waiting_time = TInt (0));
 
+  virtual int count_new_veh (MNM_Veh *veh) override;
   virtual int remove_finished_veh (MNM_Veh *veh, bool del = true) override;
 
   TInt m_bus_capacity;
@@ -513,6 +538,9 @@ public:
   {
     return -1;
   }; // intervals
+  // move the passengers that entered max(0, max_stamp - 1) or more intervals
+  // before timestamp to m_finished_array
+  int move_finished_passenger (TInt timestamp, TInt max_stamp);
 
   TInt m_link_ID;
   DLink_type_multimodal m_link_type;
@@ -526,8 +554,10 @@ public:
   TFlt m_unit_time;
 
   std::deque<MNM_Passenger *> m_incoming_array;
-  // <passenger, time left to be moved to finished queue>
-  std::unordered_map<MNM_Passenger *, TInt> m_passenger_queue;
+  // <passenger, interval it entered the link>, in the order of entering. All
+  // passengers on a link stay for the same number of intervals, so the ones
+  // due to finish are always at the front
+  std::deque<std::pair<MNM_Passenger *, TInt>> m_passenger_queue;
   std::deque<MNM_Passenger *> m_finished_array;
 
   // recording passengers dar
@@ -587,6 +617,9 @@ public:
   TInt m_max_stamp;
   std::string m_walking_type;
   TInt m_historical_bus_waiting_time = 0;
+  // <interval to enter m_passenger_queue, passenger> for the passengers that
+  // arrived with a positive m_waiting_time
+  std::multimap<TInt, MNM_Passenger *> m_waiting_passenger;
 };
 
 /**************************************************************************
@@ -815,7 +848,8 @@ typedef std::unordered_map<TInt, std::unordered_map<TInt, MNM_PnR_Pathset *> *>
 class MNM_Routing_Bus : public MNM_Routing_Biclass_Fixed
 {
 public:
-  MNM_Routing_Bus (macposts::Graph &driving_graph, MNM_OD_Factory *od_factory,
+  MNM_Routing_Bus (const macposts::Graph &driving_graph,
+                   MNM_OD_Factory *od_factory,
                    MNM_Node_Factory *node_factory,
                    MNM_Link_Factory *link_factory,
                    Bus_Path_Table *bus_path_table, TInt route_frq = TInt (-1),
@@ -836,7 +870,7 @@ class MNM_Routing_PnR_Fixed : public MNM_Routing_Biclass_Fixed
 {
 public:
   MNM_Routing_PnR_Fixed (
-    macposts::Graph &driving_graph, MNM_OD_Factory *od_factory,
+    const macposts::Graph &driving_graph, MNM_OD_Factory *od_factory,
     MNM_Node_Factory *node_factory, MNM_Link_Factory *link_factory,
     PnR_Path_Table *pnr_path_table, TInt route_frq = TInt (-1),
     TInt buffer_length = TInt (-1), TInt veh_class = TInt (0));
@@ -857,7 +891,7 @@ class MNM_Routing_PassengerBusTransit
 {
 public:
   MNM_Routing_PassengerBusTransit (
-    macposts::Graph &transit_graph, MNM_OD_Factory *od_factory,
+    const macposts::Graph &transit_graph, MNM_OD_Factory *od_factory,
     MNM_Node_Factory *node_factory, MNM_Busstop_Factory *busstop_factory,
     MNM_Parking_Lot_Factory *parkinglot_factory,
     MNM_Transit_Link_Factory *transitlink_factory);
@@ -869,12 +903,14 @@ public:
     return 0;
   };
 
-  macposts::Graph &m_graph;
+  const macposts::Graph &m_graph;
   MNM_OD_Factory *m_od_factory;
   MNM_Node_Factory *m_node_factory;
   MNM_Busstop_Factory *m_busstop_factory;
   MNM_Parking_Lot_Factory *m_parkinglot_factory;
   MNM_Transit_Link_Factory *m_transitlink_factory;
+  // splits passenger cohorts by path
+  MNM_Passenger_Factory *m_passenger_factory;
 };
 
 /**************************************************************************
@@ -885,17 +921,25 @@ class MNM_Routing_PassengerBusTransit_Fixed
 {
 public:
   MNM_Routing_PassengerBusTransit_Fixed (
-    macposts::Graph &transit_graph, MNM_OD_Factory *od_factory,
+    const macposts::Graph &transit_graph, MNM_OD_Factory *od_factory,
     MNM_Node_Factory *node_factory, MNM_Busstop_Factory *busstop_factory,
     MNM_Parking_Lot_Factory *parkinglot_factory,
     MNM_Transit_Link_Factory *transitlink_factory,
     Path_Table *bustransit_path_table, TInt route_frq = TInt (-1),
     TInt buffer_length = TInt (-1));
   virtual ~MNM_Routing_PassengerBusTransit_Fixed () override;
+  MNM_Path *sample_path (MNM_Passenger *passenger);
   int register_passenger (MNM_Passenger *passenger, bool track = true);
+  // registers a cohort not routed yet: draws the path of each of its travelers
+  // and splits it into one cohort per path, the new cohorts are routed and
+  // appended to queue
+  int register_cohort (MNM_Passenger *passenger, bool track,
+                       std::deque<MNM_Passenger *> &queue);
   virtual int remove_finished (MNM_Passenger *passenger,
                                bool del = true) override;
-  int add_passenger_path (MNM_Passenger *passenger, std::deque<TInt> *link_que);
+  const std::vector<MNM_Transit_Link *> *get_path_links (MNM_Path *path);
+  int set_passenger_route (MNM_Passenger *passenger, MNM_Path *path,
+                           size_t hop = 0);
   virtual int init_routing (Path_Table *path_table = nullptr) override;
   int update_routing_origin (TInt timestamp);
   int update_routing_parkinglot (TInt timestamp);
@@ -910,12 +954,52 @@ public:
   int change_choice_portion (TInt interval);
 
   Path_Table *m_bustransit_path_table;
-  std::unordered_map<MNM_Passenger *, std::deque<TInt> *> m_tracker;
+  // choice among the paths of m_bustransit_path_table, see MNM_Routing_Fixed
+  MNM_Path_Sampler m_sampler;
+  // transit links of each path taken so far, see MNM_Routing_Fixed
+  std::unordered_map<MNM_Path *, std::vector<MNM_Transit_Link *>> m_path_links;
   bool m_buffer_as_p;
   TInt m_routing_freq;
   TInt m_buffer_length;
 };
 
+/**************************************************************************
+                  Passenger Transit Router
+**************************************************************************/
+// The bus transit graph (origins, destinations, bus stops and parking lots
+// joined by bus and walking links) packed into index arrays for the passenger
+// trees of adaptive routing. The links entering node i take the slots
+// m_in_ptr[i] .. m_in_ptr[i + 1] - 1 of the link arrays, in the order of
+// graph.connections, and the label-correcting loop is the one of
+// MNM_Shortest_Path::all_to_one_FIFO, so the trees are the same, only without
+// the hash lookups.
+class MNM_Transit_Router
+{
+public:
+  explicit MNM_Transit_Router (const macposts::Graph &graph);
+
+  // copies the link costs, every link of the graph must be in cost_map
+  int set_link_cost (const std::unordered_map<TInt, TFlt> &cost_map);
+  // the tree toward dest_node_ID under the current link costs, written to
+  // output_map as all_to_one_FIFO does (<node ID, out link ID>, -1 if none)
+  int update_tree (TInt dest_node_ID,
+                   std::unordered_map<TInt, TInt> &output_map);
+
+  std::vector<TInt> m_node_ID;
+  std::unordered_map<TInt, int> m_node_index;
+  std::vector<int> m_in_ptr;
+  std::vector<TInt> m_link_ID;
+  std::vector<int> m_link_from; // index of the upstream node
+  std::vector<TFlt> m_link_cost;
+
+private:
+  // work arrays of update_tree
+  std::vector<TFlt> m_cost;
+  std::vector<int> m_tree_link;
+  std::vector<char> m_in_queue;
+  std::deque<int> m_queue;
+};
+
 /**************************************************************************
                   Passenger and Vehicle Adaptive Routing
 **************************************************************************/
@@ -923,8 +1007,8 @@ class MNM_Routing_Multimodal_Adaptive
 {
 public:
   MNM_Routing_Multimodal_Adaptive (
-    const std::string &file_folder, macposts::Graph &driving_graph,
-    macposts::Graph &transit_graph, MNM_Statistics *statistics,
+    const std::string &file_folder, const macposts::Graph &driving_graph,
+    const macposts::Graph &transit_graph, MNM_Statistics *statistics,
     MNM_OD_Factory *od_factory, MNM_Node_Factory *node_factory,
     MNM_Busstop_Factory *busstop_factory,
     MNM_Parking_Lot_Factory *parkinglot_factory, MNM_Link_Factory *link_factory,
@@ -955,8 +1039,8 @@ public:
 
   Routing_Table *m_driving_table;
   Routing_Table *m_transit_table;
-  macposts::Graph &m_driving_graph;
-  macposts::Graph &m_transit_graph;
+  const macposts::Graph &m_driving_graph;
+  const macposts::Graph &m_transit_graph;
   MNM_OD_Factory *m_od_factory;
   MNM_Node_Factory *m_node_factory;
   MNM_Busstop_Factory *m_busstop_factory;
@@ -966,6 +1050,8 @@ public:
 
   std::unordered_map<TInt, TFlt> m_driving_link_cost;
   std::unordered_map<TInt, TFlt> m_bustransit_link_cost;
+  // builds the trees of m_transit_table, made in init_routing
+  MNM_Transit_Router *m_transit_router;
 
   bool m_working;
 };
@@ -977,8 +1063,8 @@ class MNM_Routing_Multimodal_Hybrid : public MNM_Routing_Biclass_Hybrid
 {
 public:
   MNM_Routing_Multimodal_Hybrid (
-    const std::string &file_folder, macposts::Graph &driving_graph,
-    macposts::Graph &transit_graph, MNM_Statistics *statistics,
+    const std::string &file_folder, const macposts::Graph &driving_graph,
+    const macposts::Graph &transit_graph, MNM_Statistics *statistics,
     MNM_OD_Factory *od_factory, MNM_Node_Factory *node_factory,
     MNM_Link_Factory *link_factory, MNM_Busstop_Factory *busstop_factory,
     MNM_Parking_Lot_Factory *parkinglot_factory,
@@ -1108,6 +1194,8 @@ public:
   virtual int load_once (bool verbose, TInt load_int, TInt assign_int) override;
   virtual int loading (bool verbose) override;
   virtual bool finished_loading (int cur_int) override;
+  // the passengers as well
+  virtual int add_memory_usage (MNM_Memory_Report &report) override;
   int record_queue_passengers ();
   int record_enroute_passengers ();
 
@@ -1142,6 +1230,11 @@ TFlt get_bus_waiting_time (MNM_Busstop_Virtual *busstop, TFlt start_time,
 
 TFlt get_travel_time_walking (MNM_Walking_Link *link, TFlt start_time,
                               TFlt unit_interval, TInt end_loading_timestamp);
+// get_travel_time_walking at each of start_times, see get_travel_time_batch
+int get_travel_time_walking_batch (MNM_Walking_Link *link,
+                                   const std::vector<TFlt> &start_times,
+                                   TFlt unit_interval,
+                                   TInt end_loading_timestamp, TFlt *tt);
 
 TFlt get_travel_time_walking_robust (MNM_Walking_Link *link, TFlt start_time,
                                      TFlt end_time, TFlt unit_interval,
@@ -1152,6 +1245,15 @@ TFlt get_travel_time_bus (MNM_Bus_Link *link, TFlt start_time,
                           TFlt unit_interval, TInt end_loading_timestamp,
                           bool explicit_bus = true, bool return_inf = false,
                           bool return_bus_time = false);
+// get_travel_time_bus at each of start_times; with explicit buses the ride
+// between the stops is looked up with one pass over their curves, the waiting
+// time is still found for each start time
+int get_travel_time_bus_batch (MNM_Bus_Link *link,
+                               const std::vector<TFlt> &start_times,
+                               TFlt unit_interval, TInt end_loading_timestamp,
+                               TFlt *tt, bool explicit_bus = true,
+                               bool return_inf = false,
+                               bool return_bus_time = false);
 
 TFlt get_travel_time_bus_robust (MNM_Bus_Link *link, TFlt start_time,
                                  TFlt end_time, TFlt unit_interval,
@@ -1254,6 +1356,8 @@ public:
   TFlt get_wrongtime_penalty (TFlt arrival_time);
 
   virtual bool is_equal (MNM_Passenger_Path_Base *path) { return false; };
+  // equal for paths that are is_equal
+  virtual size_t equal_hash ();
   virtual std::string info2str ()
   {
     return "Base method should not be called\n#origin_node_ID dest_node_ID "
@@ -1426,6 +1530,7 @@ public:
   virtual TFlt get_travel_cost_with_tt (TFlt start_time, TFlt travel_time,
                                         MNM_Dta_Multimodal *mmdta) override;
   virtual bool is_equal (MNM_Passenger_Path_Base *path) override;
+  virtual size_t equal_hash () override;
   virtual std::string info2str () override;
 };
 
@@ -1465,6 +1570,7 @@ public:
   virtual TFlt get_travel_cost_with_tt (TFlt start_time, TFlt travel_time,
                                         MNM_Dta_Multimodal *mmdta) override;
   virtual bool is_equal (MNM_Passenger_Path_Base *path) override;
+  virtual size_t equal_hash () override;
   virtual std::string info2str () override;
 };
 
@@ -1479,8 +1585,16 @@ public:
   MNM_Passenger_Pathset (MMDue_mode mode);
   ~MNM_Passenger_Pathset ();
   MMDue_mode m_mode; // driving, transit, pnr, rh
+  // add paths through add_path so that is_in sees them; after any other
+  // change to m_path_vec call invalidate_index, as for MNM_Pathset
   std::vector<MNM_Passenger_Path_Base *> m_path_vec;
   bool is_in (MNM_Passenger_Path_Base *path);
+  int add_path (MNM_Passenger_Path_Base *path);
+  int invalidate_index ();
+
+  // <equal_hash, path>, rebuilt by is_in when m_index_stale
+  std::unordered_multimap<size_t, MNM_Passenger_Path_Base *> m_path_index;
+  bool m_index_stale = false;
 };
 
 // <O, <D, <mode, PassengerPathset>>>
@@ -1511,8 +1625,8 @@ Passenger_Path_Table *build_shortest_passenger_pathset (
   std::unordered_map<TInt,
                      std::unordered_map<TInt, std::unordered_map<int, bool>>>
     &od_mode_connectivity,
-  MNM_MM_Due *mmdue, macposts::Graph &driving_graph,
-  macposts::Graph &bustransit_graph, MNM_OD_Factory *od_factory,
+  MNM_MM_Due *mmdue, const macposts::Graph &driving_graph,
+  const macposts::Graph &bustransit_graph, MNM_OD_Factory *od_factory,
   MNM_Link_Factory *link_factory, MNM_Transit_Link_Factory *transitlink_factory,
   MNM_Busstop_Factory *busstop_factory);
 
@@ -1525,25 +1639,25 @@ Passenger_Path_Table *build_existing_passenger_pathset (
   MNM_MM_Due *mmdue);
 
 Path_Table *build_shortest_driving_pathset (
-  macposts::Graph &driving_graph, MNM_OD_Factory *od_factory,
+  const macposts::Graph &driving_graph, MNM_OD_Factory *od_factory,
   std::unordered_map<TInt,
                      std::unordered_map<TInt, std::unordered_map<int, bool>>>
     &od_mode_connectivity,
   MNM_Link_Factory *link_factory, TFlt min_path_length = 0.0,
   size_t MaxIter = 10, TFlt Mid_Scale = 3, TFlt Heavy_Scale = 6,
-  TInt buffer_length = -1);
+  TInt buffer_length = -1, int num_threads = 1);
 
 Path_Table *build_shortest_bustransit_pathset (
-  macposts::Graph &bustransit_graph, MNM_OD_Factory *od_factory,
+  const macposts::Graph &bustransit_graph, MNM_OD_Factory *od_factory,
   std::unordered_map<TInt,
                      std::unordered_map<TInt, std::unordered_map<int, bool>>>
     &od_mode_connectivity,
   MNM_Transit_Link_Factory *bus_transitlink_factory, TFlt min_path_length = 0.0,
   size_t MaxIter = 10, TFlt Mid_Scale = 3, TFlt Heavy_Scale = 6,
-  TInt buffer_length = -1);
+  TInt buffer_length = -1, int num_threads = 1);
 
 PnR_Path_Table *build_shortest_pnr_pathset (
-  macposts::Graph &driving_graph, macposts::Graph &bustransit_graph,
+  const macposts::Graph &driving_graph, const macposts::Graph &bustransit_graph,
   MNM_OD_Factory *od_factory,
   std::unordered_map<TInt,
                      std::unordered_map<TInt, std::unordered_map<int, bool>>>
@@ -1621,6 +1735,9 @@ public:
 
   MNM_Dta_Multimodal *run_mmdta_adaptive (bool verbose);
 
+  // the driving and transit link travel time and cost maps
+  int add_memory_usage (MNM_Memory_Report &report);
+
   int check_od_mode_connectivity ();
 
   int save_od_mode_connectivity (const std::string &connectivity_file_name
@@ -1679,8 +1796,10 @@ public:
   update_path_table_gp_fixed_departure_time_choice (MNM_Dta_Multimodal *mmdta,
                                                     int iter);
 
+  // with verbose, prints how many links are done
   int build_link_cost_map (MNM_Dta_Multimodal *mmdta,
-                           bool with_congestion_indicator = false);
+                           bool with_congestion_indicator = false,
+                           bool verbose = false);
 
   int get_link_queue_dissipated_time (MNM_Dta_Multimodal *mmdta);
 
@@ -1779,6 +1898,8 @@ public:
 
   std::string m_file_folder;
   MNM_ConfReader *m_mmdta_config;
+  // the keys of m_mmdta_config read in the path table updates
+  MNM_Dta_Settings m_mmdta_settings;
   MNM_ConfReader *m_mmdue_config;
   // <origin_node_ID, <dest_node_ID, <mode, true or false>>>
   std::unordered_map<TInt,
@@ -1825,28 +1946,30 @@ public:
   TFlt m_bus_inconvenience;
 
   MNM_Dta_Multimodal *m_mmdta;
+  // not owned, handed to the DTA runs if set
+  MNM_Profiler *m_profiler;
 
   // single_level <mode, <passenger path ID, cost>>
 
   // time-varying link tt
-  std::unordered_map<TInt, TFlt *> m_link_tt_map;
-  std::unordered_map<TInt, TFlt *> m_link_tt_map_truck;
-  std::unordered_map<TInt, TFlt *> m_transitlink_tt_map;
+  MNM_Link_Matrix<TFlt> m_link_tt_map;
+  MNM_Link_Matrix<TFlt> m_link_tt_map_truck;
+  MNM_Link_Matrix<TFlt> m_transitlink_tt_map;
 
   // time-varying link cost
-  std::unordered_map<TInt, TFlt *> m_link_cost_map;
-  std::unordered_map<TInt, TFlt *> m_link_cost_map_truck;
-  std::unordered_map<TInt, TFlt *> m_transitlink_cost_map;
+  MNM_Link_Matrix<TFlt> m_link_cost_map;
+  MNM_Link_Matrix<TFlt> m_link_cost_map_truck;
+  MNM_Link_Matrix<TFlt> m_transitlink_cost_map;
 
   // time-varying indicator
-  std::unordered_map<TInt, bool *> m_link_congested_car;
-  std::unordered_map<TInt, bool *> m_link_congested_truck;
-  std::unordered_map<TInt, bool *> m_transitlink_congested_passenger;
+  MNM_Link_Matrix<bool> m_link_congested_car;
+  MNM_Link_Matrix<bool> m_link_congested_truck;
+  MNM_Link_Matrix<bool> m_transitlink_congested_passenger;
 
   // time-varying queue dissipated time
-  std::unordered_map<TInt, int *> m_queue_dissipated_time_car;
-  std::unordered_map<TInt, int *> m_queue_dissipated_time_truck;
-  std::unordered_map<TInt, int *> m_queue_dissipated_time_passenger;
+  MNM_Link_Matrix<int> m_queue_dissipated_time_car;
+  MNM_Link_Matrix<int> m_queue_dissipated_time_truck;
+  MNM_Link_Matrix<int> m_queue_dissipated_time_passenger;
 
   std::unordered_map<TInt, TFlt> m_driving_link_tt_map_snapshot;
   std::unordered_map<TInt, TFlt> m_bustransit_link_tt_map_snapshot;
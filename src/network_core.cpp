@@ -0,0 +1,52 @@
+#include "network_core.h"
+#include "io.h"
+
+MNM_Network_Core::MNM_Network_Core ()
+{
+  m_flow_scalar = TFlt (1);
+  m_unit_time = TFlt (1);
+  m_node_specs = std::vector<node_spec> ();
+  m_link_specs = std::vector<link_spec> ();
+}
+
+MNM_Network_Core::~MNM_Network_Core ()
+{
+  m_node_specs.clear ();
+  m_link_specs.clear ();
+}
+
+std::shared_ptr<const MNM_Network_Core>
+MNM_Network_Core::build_from_files (const std::string &file_folder)
+{
+  MNM_ConfReader _config (file_folder + "/config.conf", "DTA");
+  auto _core = std::make_shared<MNM_Network_Core> ();
+  _core->m_flow_scalar = _config.get_float ("flow_scalar");
+  _core->m_unit_time = _config.get_float ("unit_time");
+  MNM_IO::read_node_specs (file_folder, &_config, _core->m_node_specs);
+  MNM_IO::read_link_specs (file_folder, &_config, _core->m_link_specs);
+  _core->m_graph = MNM_IO::build_graph (file_folder, &_config);
+  return _core;
+}
+
+int
+MNM_Network_Core::build_node_factory (MNM_Node_Factory *node_factory) const
+{
+  for (const node_spec &_spec : m_node_specs)
+    {
+      node_factory->make_node (_spec.node_ID, _spec.node_type, m_flow_scalar);
+    }
+  return 0;
+}
+
+int
+MNM_Network_Core::build_link_factory (MNM_Link_Factory *link_factory) const
+{
+  for (const link_spec &_spec : m_link_specs)
+    {
+      link_factory->make_link (_spec.link_ID, _spec.link_type,
+                               _spec.lane_hold_cap, _spec.lane_flow_cap,
+                               _spec.number_of_lane, _spec.length, _spec.ffs,
+                               m_unit_time, m_flow_scalar);
+    }
+  return 0;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "common.h"
+#include "factory.h"
+#include "ults.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/**************************************************************************
+                          Network core
+**************************************************************************/
+// The static description of a single class network: the graph and the parsed
+// node/link attributes.  It is built once and shared read-only, through a
+// std::shared_ptr<const MNM_Network_Core>, by any number of MNM_Dta instances
+// (scenario runs, DUE iterations), each of which only builds its own dynamic
+// node and link objects from it instead of re-reading the input files.  Nothing
+// is changed after build_from_files, so the instances may run on different
+// threads.  Only plain MNM_Dta takes a core: the multiclass and multimodal
+// networks have their own node and link types and attribute files and are
+// still built from the files by each instance.
+class MNM_Network_Core
+{
+public:
+  MNM_Network_Core ();
+  ~MNM_Network_Core ();
+
+  static std::shared_ptr<const MNM_Network_Core>
+  build_from_files (const std::string &file_folder);
+
+  int build_node_factory (MNM_Node_Factory *node_factory) const;
+  int build_link_factory (MNM_Link_Factory *link_factory) const;
+
+  TFlt m_flow_scalar;
+  TFlt m_unit_time;
+  std::vector<node_spec> m_node_specs;
+  std::vector<link_spec> m_link_specs;
+  macposts::Graph m_graph;
+};
@@ -178,8 +178,8 @@ MNM_Origin::release_one_interval (TInt current_interval,
           m_origin_node->m_in_veh_queue.push_back (_veh);
         }
     }
-  std::random_shuffle (m_origin_node->m_in_veh_queue.begin (),
-                       m_origin_node->m_in_veh_queue.end ());
+  MNM_Ults::random_shuffle (m_origin_node->m_in_veh_queue.begin (),
+                            m_origin_node->m_in_veh_queue.end ());
   return 0;
 }
 
@@ -235,7 +235,7 @@ MNM_Destination::receive (TInt current_interval, MNM_Routing *routing,
       // m_node_ID(), _veh -> get_destination() -> m_dest_node -> m_node_ID());
       m_dest_node->m_out_veh_queue.pop_front ();
 
-      routing->remove_finished (_veh, del); // remove from m_tracker
+      routing->remove_finished (_veh, del); // reset its route
       veh_factory->remove_finished_veh (_veh, del);
     }
   return 0;
@@ -265,4 +265,43 @@ get_demand_bynode (TInt O_node, TInt D_node, TInt assign_inter,
   throw std::runtime_error ("failed to find origin/destination");
 }
 
+int
+release_origins (size_t num_origins, int num_threads,
+                 MNM_Veh_Factory *veh_factory,
+                 const std::function<void (size_t)> &release)
+{
+  std::vector<unsigned int> _seeds (num_origins);
+  for (size_t i = 0; i < num_origins; ++i)
+    _seeds[i] = MNM_Ults::rng () ();
+  std::vector<std::vector<MNM_Veh *>> _batches (num_origins);
+  try
+    {
+      MNM_Ults::parallel_for (num_origins, num_threads,
+                              [&] (size_t i, int worker) {
+                                MNM_Rng_Scope _rng (_seeds[i]);
+                                MNM_Veh_Factory::set_thread_batch (
+                                  &_batches[i]);
+                                try
+                                  {
+                                    release (i);
+                                  }
+                                catch (...)
+                                  {
+                                    MNM_Veh_Factory::set_thread_batch (
+                                      nullptr);
+                                    throw;
+                                  }
+                                MNM_Veh_Factory::set_thread_batch (nullptr);
+                              });
+    }
+  catch (...)
+    {
+      // the vehicles made so far are still owned by the factory
+      veh_factory->commit_batches (_batches);
+      throw;
+    }
+  veh_factory->commit_batches (_batches);
+  return 0;
+}
+
 }
@@ -4,6 +4,7 @@
 #include "dnode.h"
 #include "factory.h"
 #include "ults.h"
+#include <functional>
 #include <unordered_map>
 #include <vector>
 
@@ -69,4 +70,12 @@ namespace MNM
 {
 TFlt get_demand_bynode (TInt O_node, TInt D_node, TInt assign_inter,
                         MNM_Node_Factory *node_factory);
+// Calls release (i) for the origins i in [0, num_origins) on up to num_threads
+// threads.  Each origin draws from its own engine, seeded in origin order from
+// the engine of the caller, and its vehicles get their IDs in origin order
+// once all origins are done, so the outcome does not depend on num_threads.
+// Besides the vehicle factory, release (i) may only change origin i.
+int release_origins (size_t num_origins, int num_threads,
+                     MNM_Veh_Factory *veh_factory,
+                     const std::function<void (size_t)> &release);
 }
@@ -1,5 +1,7 @@
 #include "path.h"
 
+#include <algorithm>
+
 /**************************************************************************
                               Path
 **************************************************************************/
@@ -191,6 +193,17 @@ MNM_Path::allocate_buffer (TInt length)
   return 0;
 }
 
+size_t
+MNM_Path::link_vec_hash () const
+{
+  size_t _hash = m_link_vec.size ();
+  for (TInt _link_ID : m_link_vec)
+    {
+      _hash = _hash * 1000003 ^ std::hash<int> () (_link_ID);
+    }
+  return _hash;
+}
+
 int
 MNM_Path::eliminate_cycles ()
 {
@@ -290,14 +303,44 @@ MNM_Pathset::~MNM_Pathset ()
 bool
 MNM_Pathset::is_in (MNM_Path *path)
 {
-  for (MNM_Path *tmp_path : m_path_vec)
+  // a size mismatch means paths were appended to m_path_vec directly
+  if (m_index_stale || m_path_index.size () != m_path_vec.size ())
     {
-      if (*tmp_path == *path)
+      m_path_index.clear ();
+      for (MNM_Path *_path : m_path_vec)
+        {
+          m_path_index.insert (
+            std::pair<size_t, MNM_Path *> (_path->link_vec_hash (), _path));
+        }
+      m_index_stale = false;
+    }
+  auto _range = m_path_index.equal_range (path->link_vec_hash ());
+  for (auto _it = _range.first; _it != _range.second; ++_it)
+    {
+      if (*_it->second == *path)
         return true;
     }
   return false;
 }
 
+int
+MNM_Pathset::add_path (MNM_Path *path)
+{
+  m_path_vec.push_back (path);
+  if (!m_index_stale)
+    m_path_index.insert (
+      std::pair<size_t, MNM_Path *> (path->link_vec_hash (), path));
+  return 0;
+}
+
+int
+MNM_Pathset::invalidate_index ()
+{
+  m_path_index.clear ();
+  m_index_stale = true;
+  return 0;
+}
+
 int
 MNM_Pathset::normalize_p ()
 {
@@ -340,12 +383,110 @@ MNM_Pathset::normalize_p ()
   return 0;
 }
 
+/**************************************************************************
+                            Path Sampler
+**************************************************************************/
+static std::vector<TFlt>
+cumulative_buffer_p (MNM_Pathset *pathset)
+{
+  std::vector<TFlt> _cum_p;
+  if (pathset->m_path_vec.empty ())
+    return _cum_p;
+  TInt _num_col = pathset->m_path_vec.front ()->m_buffer_length;
+  for (MNM_Path *_path : pathset->m_path_vec)
+    {
+      if (_path->m_buffer_length < _num_col)
+        _num_col = _path->m_buffer_length;
+    }
+  _cum_p.reserve (_num_col * pathset->m_path_vec.size ());
+  TFlt _tot_p, _sum_p;
+  for (int col = 0; col < _num_col; ++col)
+    {
+      _tot_p = TFlt (0);
+      for (MNM_Path *_path : pathset->m_path_vec)
+        {
+          if (_path->m_buffer[col] < 0)
+            {
+              throw std::runtime_error ("invalid probability");
+            }
+          _tot_p += _path->m_buffer[col];
+        }
+      _sum_p = TFlt (0);
+      for (MNM_Path *_path : pathset->m_path_vec)
+        {
+          _sum_p += _tot_p == TFlt (0)
+                      ? TFlt (1) / TFlt (pathset->m_path_vec.size ())
+                      : _path->m_buffer[col] / _tot_p;
+          _cum_p.push_back (_sum_p);
+        }
+    }
+  return _cum_p;
+}
+
+MNM_Path *
+MNM_Path_Sampler::sample (MNM_Pathset *pathset, TFlt r)
+{
+  if (m_col < 0)
+    {
+      // note m_path_vec is an ordered vector, not unordered
+      for (MNM_Path *_path : pathset->m_path_vec)
+        {
+          // when r = 1, it will come to equality check of two floating
+          // numbers and simply using if (_path->m_p >= r) can be problematic
+          // sometimes, especially on Windows
+          if (!MNM_Ults::approximate_less_than (_path->m_p, r))
+            return _path;
+          r -= _path->m_p;
+        }
+      return nullptr;
+    }
+
+  size_t _num_path = pathset->m_path_vec.size ();
+  if (_num_path == 0)
+    return nullptr;
+  auto _it = m_cum_p.find (pathset);
+  if (_it == m_cum_p.end ())
+    {
+      _it = m_cum_p.insert ({ pathset, cumulative_buffer_p (pathset) }).first;
+    }
+  IAssert (size_t (m_col + 1) * _num_path <= _it->second.size ());
+  auto _begin = _it->second.begin () + m_col * _num_path;
+  auto _end = _begin + _num_path;
+  // the first path whose running sum reaches r, with the tolerance of the walk
+  auto _pos = std::partition_point (_begin, _end, [r] (TFlt p) {
+    return MNM_Ults::approximate_less_than (p, r);
+  });
+  if (_pos == _end)
+    return nullptr;
+  return pathset->m_path_vec[_pos - _begin];
+}
+
+int
+MNM_Path_Sampler::set_column (TInt col)
+{
+  IAssert (col >= 0);
+  m_col = col;
+  return 0;
+}
+
+int
+MNM_Path_Sampler::add_memory_usage (MNM_Memory_Report &report)
+{
+  size_t _bytes = MNM::unordered_bytes (m_cum_p);
+  for (auto &_it : m_cum_p)
+    {
+      _bytes += MNM::vector_bytes (_it.second);
+    }
+  MNM::add_memory (report, "path_choice", _bytes, m_cum_p.size ());
+  return 0;
+}
+
 namespace MNM
 {
 MNM_Path *
 extract_path (TInt origin_node_ID, TInt dest_node_ID,
               std::unordered_map<TInt, TInt> &output_map,
-              macposts::Graph &graph)
+              const macposts::Graph &graph)
 {
   // output_map[node_ID][edge_ID], tdsp tree
   // printf("Entering extract_path\n");
@@ -414,7 +555,8 @@ get_path_tt (TFlt start_time, MNM_Path *path,
 }
 
 Path_Table *
-build_shortest_pathset (macposts::Graph &graph, MNM_OD_Factory *od_factory,
+build_shortest_pathset (const macposts::Graph &graph,
+                        MNM_OD_Factory *od_factory,
                         MNM_Link_Factory *link_factory)
 {
   // this build for each OD pair, no matter this OD pair exists in demand file
@@ -470,7 +612,7 @@ build_shortest_pathset (macposts::Graph &graph, MNM_OD_Factory *od_factory,
               // std::cout << _path -> link_vec_to_string();
               _path_table->find (_origin_node_ID)
                 ->second->find (_dest_node_ID)
-                ->second->m_path_vec.push_back (_path);
+                ->second->add_path (_path);
             }
           else
             {
@@ -483,13 +625,163 @@ build_shortest_pathset (macposts::Graph &graph, MNM_OD_Factory *od_factory,
   return _path_table;
 }
 
+std::vector<MNM_Pathset_Dest_Job>
+get_pathset_dest_jobs (
+  Path_Table *path_table, MNM_OD_Factory *od_factory,
+  const std::function<bool (MNM_Origin *, MNM_Destination *)> &use)
+{
+  std::vector<MNM_Pathset_Dest_Job> _jobs;
+  // destinations sharing a node share the pathsets, so also the job
+  std::unordered_map<TInt, size_t> _job_index;
+  TInt _dest_node_ID, _origin_node_ID;
+  for (auto _d_it : od_factory->m_destination_map)
+    {
+      _dest_node_ID = _d_it.second->m_dest_node->m_node_ID;
+      for (auto _o_it : od_factory->m_origin_map)
+        {
+          if (!use (_o_it.second, _d_it.second))
+            continue;
+          _origin_node_ID = _o_it.second->m_origin_node->m_node_ID;
+          auto _table_it = path_table->find (_origin_node_ID);
+          if (_table_it == path_table->end ())
+            continue;
+          auto _pathset_it = _table_it->second->find (_dest_node_ID);
+          if (_pathset_it == _table_it->second->end ())
+            continue;
+          auto _index_it = _job_index.find (_dest_node_ID);
+          if (_index_it == _job_index.end ())
+            {
+              _index_it = _job_index
+                            .insert (std::pair<TInt, size_t> (_dest_node_ID,
+                                                              _jobs.size ()))
+                            .first;
+              _jobs.push_back (MNM_Pathset_Dest_Job ());
+              _jobs.back ().m_dest_node_ID = _dest_node_ID;
+            }
+          _jobs[_index_it->second].m_pathsets.push_back (
+            std::pair<TInt, MNM_Pathset *> (_origin_node_ID,
+                                            _pathset_it->second));
+        }
+    }
+  return _jobs;
+}
+
+int
+build_penalty_pathsets (
+  const macposts::Graph &graph, std::vector<MNM_Pathset_Dest_Job> &jobs,
+  const std::unordered_map<TInt, TFlt> &free_cost_map,
+  const std::function<TFlt (TInt, TFlt)> &penalty_cost, size_t MaxIter,
+  TFlt Mid_Scale, TFlt Heavy_Scale,
+  const std::function<bool (MNM_Path *)> &keep, bool keep_first,
+  TInt buffer_length, int num_threads)
+{
+  struct Workspace
+  {
+    std::unordered_map<TInt, TFlt> m_dist;
+    std::unordered_map<TInt, TInt> m_tree;
+  };
+  std::vector<Workspace> _workspaces (std::max (num_threads, 1));
+  // paths added by each job in the last phase, their links get the penalty
+  std::vector<std::vector<MNM_Path *>> _new_paths (jobs.size ());
+
+  auto _add_path = [&] (MNM_Pathset *pathset, MNM_Path *path, bool check) {
+    if (check && (pathset->is_in (path) || !keep (path)))
+      {
+        delete path;
+        return false;
+      }
+    if (buffer_length > 0)
+      {
+        path->allocate_buffer (buffer_length);
+      }
+    pathset->add_path (path);
+    return true;
+  };
+
+  MNM_Ults::parallel_for (jobs.size (), num_threads, [&] (size_t i,
+                                                          int worker) {
+    MNM_Pathset_Dest_Job &_job = jobs[i];
+    Workspace &_ws = _workspaces[worker];
+    MNM_Shortest_Path::all_to_one_FIFO (_job.m_dest_node_ID, graph, _ws.m_dist,
+                                        free_cost_map, _ws.m_tree);
+    for (auto &_it : _job.m_pathsets)
+      {
+        MNM_Path *_path
+          = MNM::extract_path (_it.first, _job.m_dest_node_ID, _ws.m_tree,
+                               graph);
+        if (_path == nullptr)
+          {
+            throw std::runtime_error (
+              "no path between origin " + std::to_string (_it.first)
+              + " and destination " + std::to_string (_job.m_dest_node_ID));
+          }
+        if (keep_first && !keep (_path))
+          {
+            delete _path;
+            continue;
+          }
+        _add_path (_it.second, _path, false);
+        _new_paths[i].push_back (_path);
+      }
+  });
+
+  // the penalized costs only ever move from the free cost to the scaled one,
+  // so each round only has to look at the paths of the previous one
+  std::unordered_map<TInt, TFlt> _mid_cost_map = free_cost_map;
+  std::unordered_map<TInt, TFlt> _heavy_cost_map = free_cost_map;
+  for (size_t _CurIter = 0; _CurIter < MaxIter; ++_CurIter)
+    {
+      printf ("Current trial %d\n", (int) _CurIter);
+      for (auto &_paths : _new_paths)
+        {
+          for (MNM_Path *_path : _paths)
+            {
+              for (TInt _link_ID : _path->m_link_vec)
+                {
+                  if (Mid_Scale > 0)
+                    _mid_cost_map.find (_link_ID)->second
+                      = penalty_cost (_link_ID, Mid_Scale);
+                  if (Heavy_Scale > 0)
+                    _heavy_cost_map.find (_link_ID)->second
+                      = penalty_cost (_link_ID, Heavy_Scale);
+                }
+            }
+          _paths.clear ();
+        }
+
+      MNM_Ults::parallel_for (jobs.size (), num_threads, [&] (size_t i,
+                                                              int worker) {
+        MNM_Pathset_Dest_Job &_job = jobs[i];
+        Workspace &_ws = _workspaces[worker];
+        for (int _pass = 0; _pass < 2; ++_pass)
+          {
+            if ((_pass == 0 ? Mid_Scale : Heavy_Scale) <= 0)
+              continue;
+            MNM_Shortest_Path::all_to_one_FIFO (_job.m_dest_node_ID, graph,
+                                                _ws.m_dist,
+                                                _pass == 0 ? _mid_cost_map
+                                                           : _heavy_cost_map,
+                                                _ws.m_tree);
+            for (auto &_it : _job.m_pathsets)
+              {
+                MNM_Path *_path
+                  = MNM::extract_path (_it.first, _job.m_dest_node_ID,
+                                       _ws.m_tree, graph);
+                if (_path != nullptr && _add_path (_it.second, _path, true))
+                  _new_paths[i].push_back (_path);
+              }
+          }
+      });
+    }
+  return 0;
+}
+
 Path_Table *
-build_pathset (macposts::Graph &graph, MNM_OD_Factory *od_factory,
+build_pathset (const macposts::Graph &graph, MNM_OD_Factory *od_factory,
                MNM_Link_Factory *link_factory, TFlt min_path_length,
                size_t MaxIter, TFlt vot, TFlt Mid_Scale, TFlt Heavy_Scale,
-               TInt buffer_length)
+               TInt buffer_length, int num_threads)
 {
-  // printf("11\n");
   // MaxIter: maximum iteration to find alternative shortest path, when MaxIter
   // = 0, just shortest path Mid_Scale and Heavy_Scale are different penalties
   // to the travel cost of links in existing paths
@@ -522,21 +814,14 @@ build_pathset (macposts::Graph &graph, MNM_OD_Factory *od_factory,
         }
     }
 
-  // printf("111\n");
-  std::unordered_map<TInt, TInt> _mid_shortest_path_tree
-    = std::unordered_map<TInt, TInt> ();
-  std::unordered_map<TInt, TFlt> _mid_cost_map
-    = std::unordered_map<TInt, TFlt> ();
-  std::unordered_map<TInt, TInt> _heavy_shortest_path_tree
-    = std::unordered_map<TInt, TInt> ();
-  std::unordered_map<TInt, TFlt> _heavy_cost_map
-    = std::unordered_map<TInt, TFlt> ();
+  std::vector<MNM_Pathset_Dest_Job> _jobs
+    = get_pathset_dest_jobs (_path_table, od_factory,
+                             [] (MNM_Origin *origin, MNM_Destination *dest) {
+                               return origin->m_demand.find (dest)
+                                      != origin->m_demand.end ();
+                             });
 
-  std::unordered_map<TInt, TFlt> _free_cost_map
-    = std::unordered_map<TInt, TFlt> ();
-  std::unordered_map<TInt, TInt> _free_shortest_path_tree
-    = std::unordered_map<TInt, TInt> ();
-  MNM_Path *_path;
+  std::unordered_map<TInt, TFlt> _free_cost_map;
   for (auto _link_it = link_factory->m_link_map.begin ();
        _link_it != link_factory->m_link_map.end (); _link_it++)
     {
@@ -545,157 +830,17 @@ build_pathset (macposts::Graph &graph, MNM_OD_Factory *od_factory,
                                vot * _link_it->second->get_link_tt ()
                                  + _link_it->second->m_toll));
     }
-  // printf("1111\n");
-  for (auto _d_it = od_factory->m_destination_map.begin ();
-       _d_it != od_factory->m_destination_map.end (); _d_it++)
-    {
-      _dest_node_ID = _d_it->second->m_dest_node->m_node_ID;
-      MNM_Shortest_Path::all_to_one_FIFO (_dest_node_ID, graph, _free_cost_map,
-                                          _free_shortest_path_tree);
-      for (auto _o_it = od_factory->m_origin_map.begin ();
-           _o_it != od_factory->m_origin_map.end (); _o_it++)
-        {
-          if (_o_it->second->m_demand.find (_d_it->second)
-              == _o_it->second->m_demand.end ())
-            {
-              continue;
-            }
-          _origin_node_ID = _o_it->second->m_origin_node->m_node_ID;
-          _path = MNM::extract_path (_origin_node_ID, _dest_node_ID,
-                                     _free_shortest_path_tree, graph);
-          if (_path != nullptr)
-            {
-              if (_path->get_path_length (link_factory) > min_path_length)
-                {
-                  if (buffer_length > 0)
-                    {
-                      _path->allocate_buffer (buffer_length);
-                    }
-                  _path_table->find (_origin_node_ID)
-                    ->second->find (_dest_node_ID)
-                    ->second->m_path_vec.push_back (_path);
-                }
-            }
-          else
-            {
-              throw std::runtime_error (
-                "no path between origin " + std::to_string (_origin_node_ID)
-                + " and destination " + std::to_string (_dest_node_ID));
-            }
-        }
-    }
-  // printf("22\n");
-  _mid_cost_map.insert (_free_cost_map.begin (), _free_cost_map.end ());
-  _heavy_cost_map.insert (_free_cost_map.begin (), _free_cost_map.end ());
-
-  MNM_Dlink *_link;
-  MNM_Path *_path_mid, *_path_heavy;
-  size_t _CurIter = 0;
-  while (_CurIter < MaxIter)
-    {
-      printf ("Current trial %d\n", (int) _CurIter);
-      for (auto _o_it : *_path_table)
-        {
-          for (auto _d_it : *_o_it.second)
-            {
-              for (auto &_path : _d_it.second->m_path_vec)
-                {
-                  for (auto &_link_ID : _path->m_link_vec)
-                    {
-                      _link = link_factory->get_link (_link_ID);
-                      _mid_cost_map.find (_link_ID)->second
-                        = vot * _link->get_link_tt () * Mid_Scale
-                          + _link->m_toll;
-                      _heavy_cost_map.find (_link_ID)->second
-                        = vot * _link->get_link_tt () * Heavy_Scale
-                          + _link->m_toll;
-                    }
-                }
-            }
-        }
-
-      for (auto _d_it = od_factory->m_destination_map.begin ();
-           _d_it != od_factory->m_destination_map.end (); _d_it++)
-        {
-          _dest_node_ID = _d_it->second->m_dest_node->m_node_ID;
-          MNM_Shortest_Path::all_to_one_FIFO (_dest_node_ID, graph,
-                                              _mid_cost_map,
-                                              _mid_shortest_path_tree);
-          MNM_Shortest_Path::all_to_one_FIFO (_dest_node_ID, graph,
-                                              _heavy_cost_map,
-                                              _heavy_shortest_path_tree);
-          for (auto _o_it = od_factory->m_origin_map.begin ();
-               _o_it != od_factory->m_origin_map.end (); _o_it++)
-            {
-              if (_o_it->second->m_demand.find (_d_it->second)
-                  == _o_it->second->m_demand.end ())
-                {
-                  continue;
-                }
-              _origin_node_ID = _o_it->second->m_origin_node->m_node_ID;
-              _path_mid = MNM::extract_path (_origin_node_ID, _dest_node_ID,
-                                             _mid_shortest_path_tree, graph);
-              _path_heavy
-                = MNM::extract_path (_origin_node_ID, _dest_node_ID,
-                                     _heavy_shortest_path_tree, graph);
-              if (_path_mid != nullptr)
-                {
-                  if (!_path_table->find (_origin_node_ID)
-                         ->second->find (_dest_node_ID)
-                         ->second->is_in (_path_mid))
-                    {
-                      if (_path_mid->get_path_length (link_factory)
-                          > min_path_length)
-                        {
-                          if (buffer_length > 0)
-                            {
-                              _path_mid->allocate_buffer (buffer_length);
-                            }
-                          _path_table->find (_origin_node_ID)
-                            ->second->find (_dest_node_ID)
-                            ->second->m_path_vec.push_back (_path_mid);
-                        }
-                    }
-                  else
-                    {
-                      delete _path_mid;
-                    }
-                }
-              if (_path_heavy != nullptr)
-                {
-                  if (!_path_table->find (_origin_node_ID)
-                         ->second->find (_dest_node_ID)
-                         ->second->is_in (_path_heavy))
-                    {
-                      if (_path_heavy->get_path_length (link_factory)
-                          > min_path_length)
-                        {
-                          if (buffer_length > 0)
-                            {
-                              _path_heavy->allocate_buffer (buffer_length);
-                            }
-                          _path_table->find (_origin_node_ID)
-                            ->second->find (_dest_node_ID)
-                            ->second->m_path_vec.push_back (_path_heavy);
-                        }
-                    }
-                  else
-                    {
-                      delete _path_heavy;
-                    }
-                }
-            }
-        }
-      _CurIter += 1;
-    }
-
-  _mid_shortest_path_tree.clear ();
-  _mid_cost_map.clear ();
-  _heavy_shortest_path_tree.clear ();
-  _heavy_cost_map.clear ();
-
-  _free_cost_map.clear ();
-  _free_shortest_path_tree.clear ();
+  build_penalty_pathsets (
+    graph, _jobs, _free_cost_map,
+    [&] (TInt link_ID, TFlt scale) {
+      MNM_Dlink *_link = link_factory->get_link (link_ID);
+      return vot * _link->get_link_tt () * scale + _link->m_toll;
+    },
+    MaxIter, Mid_Scale, Heavy_Scale,
+    [&] (MNM_Path *path) {
+      return path->get_path_length (link_factory) > min_path_length;
+    },
+    true, buffer_length, num_threads);
 
   return _path_table;
 }
@@ -933,4 +1078,35 @@ get_pathset (Path_Table *path_table, TInt origin_node_ID, TInt dest_node_ID)
   return iterer->second;
 }
 
+int
+add_path_table_memory_usage (MNM_Memory_Report &report,
+                             Path_Table *path_table)
+{
+  if (path_table == nullptr)
+    return 0;
+  size_t _bytes = sizeof (Path_Table) + MNM::unordered_bytes (*path_table);
+  size_t _count = 0;
+  for (auto _it : *path_table)
+    {
+      _bytes += sizeof (*_it.second) + MNM::unordered_bytes (*_it.second);
+      for (auto _it_it : *(_it.second))
+        {
+          MNM_Pathset *_pathset = _it_it.second;
+          _bytes += sizeof (MNM_Pathset)
+                    + MNM::vector_bytes (_pathset->m_path_vec)
+                    + MNM::unordered_bytes (_pathset->m_path_index);
+          for (MNM_Path *_path : _pathset->m_path_vec)
+            {
+              _bytes += sizeof (MNM_Path) + MNM::deque_bytes (_path->m_link_vec)
+                        + MNM::deque_bytes (_path->m_node_vec)
+                        + MNM::set_bytes (_path->m_link_set)
+                        + size_t (_path->m_buffer_length) * sizeof (TFlt);
+            }
+          _count += _pathset->m_path_vec.size ();
+        }
+    }
+  MNM::add_memory (report, "path_table", _bytes, _count);
+  return 0;
+}
+
 } // end namespace MNM
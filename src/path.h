@@ -2,10 +2,12 @@
 
 #include "common.h"
 #include "factory.h"
+#include "memory_usage.h"
 #include "shortest_path.h"
 
 #include <deque>
 #include <fstream>
+#include <functional>
 #include <set>
 #include <string>
 #include <unordered_map>
@@ -36,6 +38,8 @@ public:
   TFlt get_path_length (MNM_Link_Factory *link_factory);
   int allocate_buffer (TInt length);
   int eliminate_cycles ();
+  // rolling hash of the link sequence, equal for paths that are ==
+  size_t link_vec_hash () const;
 
   inline bool operator== (const MNM_Path &rhs)
   {
@@ -72,20 +76,58 @@ class MNM_Pathset
 public:
   MNM_Pathset ();
   virtual ~MNM_Pathset ();
+  // add paths through add_path so that is_in sees them; after any other
+  // change to m_path_vec (clearing, reordering, replacing paths) call
+  // invalidate_index.  A path must not change its links while it is in a
+  // pathset.
   std::vector<MNM_Path *> m_path_vec;
   int normalize_p ();
   virtual bool is_in (MNM_Path *path);
+  int add_path (MNM_Path *path);
+  int invalidate_index ();
+
+  // private:
+  // <link_vec_hash, path>, rebuilt by is_in when m_index_stale
+  std::unordered_multimap<size_t, MNM_Path *> m_path_index;
+  bool m_index_stale = false;
 };
 
 // <O_node_ID, <D_node_ID, Pathset>>
 typedef std::unordered_map<TInt, std::unordered_map<TInt, MNM_Pathset *> *>
   Path_Table;
 
+// Draws the path of a fixed route traveler.  Once a buffer column is set, the
+// choice probabilities are that column of the path buffers, normalized like
+// MNM_Pathset::normalize_p.  Their running sums are built once per pathset for
+// all columns, so a draw is a binary search and moving to the next routing
+// interval rewrites nothing.  Without a column, m_p is walked instead.  The
+// pathsets and their buffers must not change while a sampler is in use.
+class MNM_Path_Sampler
+{
+public:
+  // nullptr if r is beyond the total probability
+  MNM_Path *sample (MNM_Pathset *pathset, TFlt r);
+  int set_column (TInt col);
+  int add_memory_usage (MNM_Memory_Report &report);
+
+  TInt m_col = -1;
+  // <pathset, cumulative probabilities of column 0, column 1, ...>
+  std::unordered_map<MNM_Pathset *, std::vector<TFlt>> m_cum_p;
+};
+
+// The (origin node, pathset) pairs a k-penalty pathset generator fills for
+// one destination node, in the order they are visited
+struct MNM_Pathset_Dest_Job
+{
+  TInt m_dest_node_ID;
+  std::vector<std::pair<TInt, MNM_Pathset *>> m_pathsets;
+};
+
 namespace MNM
 {
 MNM_Path *extract_path (TInt origin_ID, TInt dest_ID,
                         std::unordered_map<TInt, TInt> &output_map,
-                        macposts::Graph &graph);
+                        const macposts::Graph &graph);
 // one-shot cost
 TFlt get_path_tt_snapshot (MNM_Path *path,
                            const std::unordered_map<TInt, TFlt> &link_cost_map);
@@ -93,17 +135,41 @@ TFlt get_path_tt_snapshot (MNM_Path *path,
 TFlt get_path_tt (TFlt start_time, MNM_Path *path,
                   const std::unordered_map<TInt, TFlt *> &link_cost_map,
                   TInt max_interval);
-Path_Table *build_pathset (macposts::Graph &graph, MNM_OD_Factory *od_factory,
+Path_Table *build_pathset (const macposts::Graph &graph,
+                           MNM_OD_Factory *od_factory,
                            MNM_Link_Factory *link_factory,
                            TFlt min_path_length = 0.0, size_t MaxIter = 10,
                            TFlt vot = 3., TFlt Mid_Scale = 3,
-                           TFlt Heavy_Scale = 6, TInt buffer_length = -1);
+                           TFlt Heavy_Scale = 6, TInt buffer_length = -1,
+                           int num_threads = 1);
+// Group the pathsets of path_table by destination node for
+// build_penalty_pathsets, visiting the destinations and then the origins of
+// od_factory in map order and keeping the OD pairs where use (origin, dest)
+std::vector<MNM_Pathset_Dest_Job> get_pathset_dest_jobs (
+  Path_Table *path_table, MNM_OD_Factory *od_factory,
+  const std::function<bool (MNM_Origin *, MNM_Destination *)> &use);
+// The k-penalty method shared by the pathset builders: every pathset first
+// gets its shortest path under free_cost_map, then in each of MaxIter rounds
+// the links on the paths found so far cost penalty_cost (link ID, scale) and
+// the shortest paths under Mid_Scale and Heavy_Scale are added if new (a
+// scale <= 0 skips its tree).  keep tells whether a path is worth adding, it
+// is not asked about the first path unless keep_first.  Destinations are run
+// on up to num_threads threads with their own trees, and each pathset is only
+// touched by the thread of its destination, so the result does not depend on
+// num_threads.
+int build_penalty_pathsets (
+  const macposts::Graph &graph, std::vector<MNM_Pathset_Dest_Job> &jobs,
+  const std::unordered_map<TInt, TFlt> &free_cost_map,
+  const std::function<TFlt (TInt, TFlt)> &penalty_cost, size_t MaxIter,
+  TFlt Mid_Scale, TFlt Heavy_Scale,
+  const std::function<bool (MNM_Path *)> &keep, bool keep_first,
+  TInt buffer_length, int num_threads = 1);
 int save_path_table (const std::string &file_folder, Path_Table *path_table,
                      MNM_OD_Factory *m_od_factory, bool w_buffer = false,
                      bool w_cost = false);
 int print_path_table (Path_Table *path_table, MNM_OD_Factory *m_od_factory,
                       bool w_buffer = false, bool w_cost = false);
-Path_Table *build_shortest_pathset (macposts::Graph &graph,
+Path_Table *build_shortest_pathset (const macposts::Graph &graph,
                                     MNM_OD_Factory *od_factory,
                                     MNM_Link_Factory *link_factory);
 int allocate_path_table_buffer (Path_Table *path_table, TInt num);
@@ -114,4 +180,8 @@ int get_ID_path_mapping (std::unordered_map<TInt, MNM_Path *> &map,
                          Path_Table *path_table);
 MNM_Pathset *get_pathset (Path_Table *path_table, TInt origin_node_ID,
                           TInt dest_node_ID);
+// adds the paths with their buffers and the pathsets to "path_table",
+// counting the paths
+int add_path_table_memory_usage (MNM_Memory_Report &report,
+                                 Path_Table *path_table);
 }
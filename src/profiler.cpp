@@ -0,0 +1,94 @@
+#include "profiler.h"
+
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+MNM_Profiler::MNM_Profiler ()
+{
+  m_iteration = -1;
+  m_origin = Clock::now ();
+}
+
+void
+MNM_Profiler::record (const char *name, Clock::time_point start,
+                      Clock::time_point end, int interval)
+{
+  std::lock_guard<std::mutex> _lock (m_mutex);
+  auto _it = m_thread_index.find (std::this_thread::get_id ());
+  if (_it == m_thread_index.end ())
+    {
+      _it = m_thread_index
+              .insert ({ std::this_thread::get_id (),
+                         int (m_thread_index.size ()) })
+              .first;
+    }
+  m_events.push_back ({ name, start, end, interval, m_iteration, _it->second });
+}
+
+void
+MNM_Profiler::set_iteration (int iteration)
+{
+  std::lock_guard<std::mutex> _lock (m_mutex);
+  m_iteration = iteration;
+}
+
+void
+MNM_Profiler::clear ()
+{
+  std::lock_guard<std::mutex> _lock (m_mutex);
+  m_events.clear ();
+  m_iteration = -1;
+  m_origin = Clock::now ();
+}
+
+std::map<std::string, MNM_Profiler::Phase_Stat>
+MNM_Profiler::get_summary ()
+{
+  std::lock_guard<std::mutex> _lock (m_mutex);
+  std::map<std::string, Phase_Stat> _summary;
+  for (const Event &_event : m_events)
+    {
+      double _seconds
+        = std::chrono::duration<double> (_event.m_end - _event.m_start)
+            .count ();
+      Phase_Stat &_stat = _summary[_event.m_name];
+      _stat.m_count += 1;
+      _stat.m_total += _seconds;
+      if (_seconds > _stat.m_max)
+        _stat.m_max = _seconds;
+      if (_event.m_interval >= 0)
+        _stat.m_by_interval[_event.m_interval] += _seconds;
+      if (_event.m_iteration >= 0)
+        _stat.m_by_iteration[_event.m_iteration] += _seconds;
+    }
+  return _summary;
+}
+
+int
+MNM_Profiler::save_trace (const std::string &file_name)
+{
+  std::ofstream _file (file_name);
+  if (!_file.is_open ())
+    {
+      throw std::runtime_error ("failed to open file: " + file_name);
+    }
+  std::lock_guard<std::mutex> _lock (m_mutex);
+  // complete events, times in microseconds since the profiler was cleared
+  _file << std::fixed << std::setprecision (3) << "{\"traceEvents\": [";
+  for (size_t i = 0; i < m_events.size (); ++i)
+    {
+      const Event &_event = m_events[i];
+      std::chrono::duration<double, std::micro> _ts
+        = _event.m_start - m_origin;
+      std::chrono::duration<double, std::micro> _dur
+        = _event.m_end - _event.m_start;
+      _file << (i == 0 ? "\n" : ",\n") << "{\"name\": \"" << _event.m_name
+            << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << _event.m_thread
+            << ", \"ts\": " << _ts.count () << ", \"dur\": " << _dur.count ()
+            << ", \"args\": {\"interval\": " << _event.m_interval
+            << ", \"iteration\": " << _event.m_iteration << "}}";
+    }
+  _file << "\n]}\n";
+  return 0;
+}
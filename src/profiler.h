@@ -0,0 +1,106 @@
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Wall clock time of the phases of loading (release, routing, node and link
+// evolve, ...), of DUE iterations and of the DAR/LTG builders.  Simulations
+// hold a non-owning pointer that is nullptr by default, in which case the
+// timers below do nothing but a branch.
+class MNM_Profiler
+{
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Event
+  {
+    // a string literal, the name of the phase
+    const char *m_name;
+    Clock::time_point m_start;
+    Clock::time_point m_end;
+    // loading interval, or -1 outside of loading
+    int m_interval;
+    // the iteration set when the event was recorded, or -1
+    int m_iteration;
+    // small number naming the recording thread, for the trace
+    int m_thread;
+  };
+
+  struct Phase_Stat
+  {
+    int m_count = 0;
+    double m_total = 0.; // seconds
+    double m_max = 0.;   // seconds
+    std::map<int, double> m_by_interval;
+    std::map<int, double> m_by_iteration;
+  };
+
+  MNM_Profiler ();
+
+  // thread safe
+  void record (const char *name, Clock::time_point start,
+               Clock::time_point end, int interval);
+  // tags the events recorded from now on, e.g. with the DUE iteration
+  void set_iteration (int iteration);
+  void clear ();
+
+  std::map<std::string, Phase_Stat> get_summary ();
+  // Chrome trace event format, opens in chrome://tracing or Perfetto
+  int save_trace (const std::string &file_name);
+
+private:
+  std::mutex m_mutex;
+  std::vector<Event> m_events;
+  std::map<std::thread::id, int> m_thread_index;
+  int m_iteration;
+  Clock::time_point m_origin;
+};
+
+// Times consecutive phases: start () ends the running phase, if any, and
+// begins the next one; stop () or the destructor ends the last one.
+class MNM_Phase_Timer
+{
+public:
+  explicit MNM_Phase_Timer (MNM_Profiler *profiler, int interval = -1)
+      : m_profiler (profiler), m_name (nullptr), m_interval (interval)
+  {
+  }
+  MNM_Phase_Timer (MNM_Profiler *profiler, const char *name,
+                   int interval = -1)
+      : MNM_Phase_Timer (profiler, interval)
+  {
+    start (name);
+  }
+  ~MNM_Phase_Timer () { stop (); }
+  MNM_Phase_Timer (const MNM_Phase_Timer &) = delete;
+  MNM_Phase_Timer &operator= (const MNM_Phase_Timer &) = delete;
+
+  void start (const char *name)
+  {
+    if (m_profiler == nullptr)
+      return;
+    MNM_Profiler::Clock::time_point _now = MNM_Profiler::Clock::now ();
+    if (m_name != nullptr)
+      m_profiler->record (m_name, m_start, _now, m_interval);
+    m_name = name;
+    m_start = _now;
+  }
+  void stop ()
+  {
+    if (m_profiler == nullptr || m_name == nullptr)
+      return;
+    m_profiler->record (m_name, m_start, MNM_Profiler::Clock::now (),
+                        m_interval);
+    m_name = nullptr;
+  }
+
+private:
+  MNM_Profiler *m_profiler;
+  const char *m_name;
+  int m_interval;
+  MNM_Profiler::Clock::time_point m_start;
+};
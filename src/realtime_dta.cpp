@@ -1,9 +1,41 @@
 #include "realtime_dta.h"
 #include <cstring>
+#include <thread>
 
 using macposts::graph::Direction;
 
+/**************************************************************************
+                          Rollout executor
+**************************************************************************/
+MNM_Rollout_Executor::MNM_Rollout_Executor (TInt num_threads)
+{
+  m_num_threads = num_threads < 1 ? TInt (1) : num_threads;
+}
+
+MNM_Rollout_Executor::~MNM_Rollout_Executor () {}
+
+int
+MNM_Rollout_Executor::run (TInt num_jobs,
+                           const std::function<void (TInt)> &job)
+{
+  if (num_jobs <= 0)
+    return 0;
+  std::vector<unsigned int> _seeds (num_jobs);
+  for (int i = 0; i < num_jobs; ++i)
+    _seeds[i] = MNM_Ults::rng () ();
+  MNM_Ults::parallel_for (num_jobs, m_num_threads, [&] (size_t i, int worker) {
+    MNM_Rng_Scope _rng (_seeds[i]);
+    job (TInt (i));
+  });
+  return 0;
+}
+
+/**************************************************************************
+                          Realtime DTA
+**************************************************************************/
 MNM_Realtime_Dta::MNM_Realtime_Dta (const std::string &file_folder)
+    : m_core (MNM_Network_Core::build_from_files (file_folder)),
+      m_graph (m_core->m_graph)
 {
   m_file_folder = file_folder;
   m_path_table = NULL;
@@ -26,9 +58,10 @@ MNM_Realtime_Dta::initialize ()
   m_dta_config = new MNM_ConfReader (m_file_folder + "/config.conf", "DTA");
   m_realtime_dta_config
     = new MNM_ConfReader (m_file_folder + "/config.conf", "REALTIME_DTA");
-  m_graph = MNM_IO::build_graph (m_file_folder, m_dta_config);
   MNM_IO::build_od_factory (m_file_folder, m_dta_config, m_od_factory);
   MNM_IO::build_demand (m_file_folder, m_dta_config, m_od_factory);
+  MNM_IO::read_od_node (m_file_folder, m_dta_config, &m_origin_node_ID,
+                        &m_dest_node_ID);
   // m_path_table = MNM_IO::load_path_table(m_file_name, m_graph, TInt
   // num_path); MNM_IO::hook_up_od_node(m_file_folder, m_dta_conf_reader,
   // m_od_factory, m_before_shot -> node_factory);
@@ -50,6 +83,22 @@ MNM_Realtime_Dta::initialize ()
   m_estimation_length = m_realtime_dta_config->get_int ("estimation_length");
   m_sample_points = m_realtime_dta_config->get_int ("sample_point");
   m_total_assign_inter = m_dta_config->get_int ("max_interval");
+  try
+    {
+      m_num_threads = m_realtime_dta_config->get_int ("num_threads");
+    }
+  catch (const std::invalid_argument &ia)
+    {
+      m_num_threads = TInt (std::thread::hardware_concurrency ());
+    }
+  try
+    {
+      m_num_rollouts = m_realtime_dta_config->get_int ("num_rollouts");
+    }
+  catch (const std::invalid_argument &ia)
+    {
+      m_num_rollouts = 1;
+    }
 
   m_estimation_step_size
     = m_realtime_dta_config->get_float ("estimation_step_size");
@@ -66,9 +115,9 @@ MNM_Realtime_Dta::init_running ()
   if (m_after_shot != NULL)
     delete m_after_shot;
   m_before_shot = MNM::make_empty_screenshot (m_file_folder, m_dta_config,
-                                              m_od_factory, m_graph);
+                                              m_od_factory, m_graph, m_core);
   m_after_shot = MNM::make_empty_screenshot (m_file_folder, m_dta_config,
-                                             m_od_factory, m_graph);
+                                             m_od_factory, m_graph, m_core);
 
   m_average_link_tt.clear ();
   m_link_tt_difference.clear ();
@@ -103,9 +152,9 @@ MNM_Realtime_Dta::reset ()
   if (m_after_shot != NULL)
     delete m_after_shot;
   m_before_shot = MNM::make_empty_screenshot (m_file_folder, m_dta_config,
-                                              m_od_factory, m_graph);
+                                              m_od_factory, m_graph, m_core);
   m_after_shot = MNM::make_empty_screenshot (m_file_folder, m_dta_config,
-                                             m_od_factory, m_graph);
+                                             m_od_factory, m_graph, m_core);
   return 0;
 }
 
@@ -119,6 +168,33 @@ MNM_Realtime_Dta::build_path_table ()
   return 0;
 }
 
+namespace
+{
+// A pathset of a path table with the nodes of its OD pair
+struct Od_Pathset
+{
+  TInt m_O_node;
+  TInt m_D_node;
+  MNM_Pathset *m_pathset;
+};
+
+// The pathsets of path_table, the jobs of the loops that treat each of them
+// on its own
+std::vector<Od_Pathset>
+list_pathsets (Path_Table *path_table)
+{
+  std::vector<Od_Pathset> _pathsets;
+  for (auto _it : *path_table)
+    {
+      for (auto _it_it : *(_it.second))
+        {
+          _pathsets.push_back ({ _it.first, _it_it.first, _it_it.second });
+        }
+    }
+  return _pathsets;
+}
+}
+
 int
 MNM_Realtime_Dta::get_estimation_gradient (
   MNM_Dta_Screenshot *screenshot, TInt max_inter, TInt assign_inter,
@@ -126,113 +202,15 @@ MNM_Realtime_Dta::get_estimation_gradient (
 {
   TInt _grad_position = 1;
 
-  TInt _cur_inter = 0;
-  TInt _total_inter = max_inter;
-  TInt _real_inter;
-  MNM_Origin *_origin;
-  MNM_Dnode *_node;
-  MNM_Dlink *_link;
-  MNM_Destination *_dest;
-
   MNM_Node_Factory *_node_factory = screenshot->m_node_factory;
   MNM_Link_Factory *_link_factory = screenshot->m_link_factory;
-  MNM_Veh_Factory *_veh_factory = screenshot->m_veh_factory;
-  MNM_Routing *_routing = screenshot->m_routing;
   TFlt num_link = TFlt (_link_factory->m_link_map.size ());
 
-  MNM_Link_Tt *_link_tt
-    = new MNM_Link_Tt (_link_factory, m_dta_config->get_float ("unit_time"));
-  for (auto _map_it : m_average_link_tt)
-    {
-      _map_it.second = 0;
-    }
-  for (auto _map_it : m_link_tt_difference)
+  for (auto &_map_it : m_link_tt_difference)
     {
       _map_it.second = 0;
     }
-  printf ("MNM: Prepare loading!\n");
-  _routing->init_routing (path_table);
-  MNM_IO::hook_up_od_node (m_file_folder, m_dta_config, m_od_factory,
-                           _node_factory);
-  printf ("Finish prepare routing\n");
-  // m_statistics -> init_record();
-  for (auto _node_it = _node_factory->m_node_map.begin ();
-       _node_it != _node_factory->m_node_map.end (); _node_it++)
-    {
-      _node = _node_it->second;
-      // printf("Node ID: %d\n", _node -> m_node_ID);
-      _node->prepare_loading ();
-    }
-  while (_cur_inter < _total_inter)
-    {
-      _real_inter = _cur_inter;
-      printf ("-------------------------------    Interval %d   "
-              "------------------------------ \n",
-              (int) _real_inter);
-      // step 1: Origin release vehicle
-
-      // printf("Realsing!\n");
-      if (_cur_inter == 0)
-        {
-          for (auto _origin_it = m_od_factory->m_origin_map.begin ();
-               _origin_it != m_od_factory->m_origin_map.end (); _origin_it++)
-            {
-              _origin = _origin_it->second;
-              _origin->release_one_interval (_real_inter, _veh_factory,
-                                             assign_inter, TFlt (0));
-            }
-        }
-
-      // printf("Routing!\n");
-      // step 2: route the vehicle
-      _routing->update_routing (_real_inter);
-
-      // printf("Moving through node!\n");
-      // step 3: move vehicles through node
-      for (auto _node_it = _node_factory->m_node_map.begin ();
-           _node_it != _node_factory->m_node_map.end (); _node_it++)
-        {
-          _node = _node_it->second;
-          // printf("Current node %d\n", _node_it -> first);
-          _node->evolve (_real_inter);
-        }
-
-      _link_tt->update_tt (_real_inter);
-      // printf("Moving through link\n");
-      // step 4: move vehicles through link
-      for (auto _link_it = _link_factory->m_link_map.begin ();
-           _link_it != _link_factory->m_link_map.end (); _link_it++)
-        {
-          _link = _link_it->second;
-          // printf("Current Link %d:, incomming %d, finished %d\n", _link ->
-          // m_link_ID, _link -> m_incoming_array.size(),  _link ->
-          // m_finished_array.size());
-          _link->clear_incoming_array (_real_inter);
-          _link->evolve (_real_inter);
-          // _link -> print_info();
-        }
-
-      // printf("Receiving!\n");
-      // step 5: Destination receive vehicle
-      for (auto _dest_it = m_od_factory->m_destination_map.begin ();
-           _dest_it != m_od_factory->m_destination_map.end (); _dest_it++)
-        {
-          _dest = _dest_it->second;
-          _dest->receive (_real_inter);
-        }
-
-      // step 6: sample link tt
-      if ((_cur_inter + 1) % (max_inter / m_sample_points) == 0)
-        {
-          for (auto _map_it : _link_tt->m_tt_map)
-            {
-              m_average_link_tt.find (_map_it.first->m_link_ID)->second
-                += _map_it.second / TFlt (m_sample_points);
-            }
-        }
-      // _link_tt -> print_info();
-      _cur_inter++;
-    }
+  run_rollouts (screenshot, max_inter, assign_inter, path_table);
 
   for (auto _map_it : *link_spd_map)
     {
@@ -245,51 +223,32 @@ MNM_Realtime_Dta::get_estimation_gradient (
       // (TFlt)m_link_tt_difference.find(_link_ID)->second);
     }
 
-  for (auto _it : *path_table)
-    {
-      for (auto _it_it : *(_it.second))
-        {
-          for (MNM_Path *_path : _it_it.second->m_path_vec)
-            {
-              _path->m_buffer[_grad_position] = 0;
-            }
-        }
-    }
-
-  TFlt _tmp_tt;
-  TFlt _demand;
-  TFlt _tmp_grad;
-  for (auto _it : *path_table)
-    {
-      for (auto _it_it : *(_it.second))
+  // the pathsets only read the travel times and the network, and each
+  // writes the buffers of its own paths
+  std::vector<Od_Pathset> _pathsets = list_pathsets (path_table);
+  MNM_Ults::parallel_for (
+    _pathsets.size (), m_num_threads, [&] (size_t i, int worker) {
+      TFlt _tmp_tt;
+      TFlt _tmp_grad;
+      TFlt _demand
+        = MNM::get_demand_bynode (_pathsets[i].m_O_node, _pathsets[i].m_D_node,
+                                  assign_inter, _node_factory);
+      for (MNM_Path *_path : _pathsets[i].m_pathset->m_path_vec)
         {
-          _demand = MNM::get_demand_bynode (_it.first, _it_it.first,
-                                            assign_inter, _node_factory);
-          // printf("Demand is %.4f\n", _demand);
-          for (MNM_Path *_path : _it_it.second->m_path_vec)
+          _tmp_grad = 0;
+          for (TInt _link_ID : _path->m_link_vec)
             {
-              _tmp_grad = 0;
-              for (TInt _link_ID : _path->m_link_vec)
-                {
-                  _tmp_tt = m_average_link_tt.find (_link_ID)->second;
-                  // printf("Average tt is %.4f, marginal cost is %.4f\n",
-                  // (TFlt)_tmp_tt,
-                  // (TFlt)MNM::calculate_link_mc(_link_factory->get_link(_link_ID),
-                  // _tmp_tt));
-                  _tmp_grad += MNM_Ults::
-                    divide (m_link_tt_difference.find (_link_ID)->second
-                              * MNM::calculate_link_mc (_link_factory
-                                                          ->get_link (_link_ID),
-                                                        _tmp_tt),
-                            _demand * num_link);
-                }
-              _path->m_buffer[_grad_position] = _tmp_grad;
-              // printf("grad is %.4f\n", _tmp_grad);
+              _tmp_tt = m_average_link_tt.find (_link_ID)->second;
+              _tmp_grad += MNM_Ults::
+                divide (m_link_tt_difference.find (_link_ID)->second
+                          * MNM::calculate_link_mc (_link_factory->get_link (
+                                                      _link_ID),
+                                                    _tmp_tt),
+                        _demand * num_link);
             }
+          _path->m_buffer[_grad_position] = _tmp_grad;
         }
-    }
-  // // m_statistics -> post_record();
-  delete _link_tt;
+    });
   return 0;
 }
 
@@ -300,6 +259,54 @@ MNM_Realtime_Dta::get_optimization_gradient (MNM_Dta_Screenshot *screenshot,
 {
   TInt _grad_position = 3;
 
+  MNM_Node_Factory *_node_factory = screenshot->m_node_factory;
+  MNM_Link_Factory *_link_factory = screenshot->m_link_factory;
+
+  TFlt num_link = TFlt (_link_factory->m_link_map.size ());
+
+  run_rollouts (screenshot, max_inter, assign_inter, path_table);
+
+  // the pathsets only read the travel times and the network, and each
+  // writes the buffers of its own paths
+  std::vector<Od_Pathset> _pathsets = list_pathsets (path_table);
+  MNM_Ults::parallel_for (
+    _pathsets.size (), m_num_threads, [&] (size_t i, int worker) {
+      MNM_Dlink *_link;
+      TFlt _tmp_tt;
+      TFlt _tmp_grad;
+      TFlt _demand
+        = MNM::get_demand_bynode (_pathsets[i].m_O_node, _pathsets[i].m_D_node,
+                                  assign_inter, _node_factory);
+      for (MNM_Path *_path : _pathsets[i].m_pathset->m_path_vec)
+        {
+          _tmp_grad = 0;
+          for (TInt _link_ID : _path->m_link_vec)
+            {
+              _link = _link_factory->get_link (_link_ID);
+              _tmp_tt = m_average_link_tt.find (_link_ID)->second;
+              _tmp_grad += MNM_Ults::divide (_tmp_tt, _demand);
+              _tmp_grad
+                += MNM_Ults::divide (MNM::calculate_link_mc (_link, _tmp_tt)
+                                       * _link->get_link_flow (),
+                                     _demand * num_link);
+            }
+          _path->m_buffer[_grad_position] = _tmp_grad;
+        }
+    });
+  return 0;
+}
+
+// Re-simulate max_inter intervals from the screenshot, releasing the demand of
+// od_factory, and average the sampled link travel times into
+// average_link_tt.  Touches nothing but its arguments (the path table is only
+// read) and prints nothing, so rollouts on different screenshots and OD
+// factories can run at the same time.
+int
+MNM_Realtime_Dta::simulate_rollout (
+  MNM_Dta_Screenshot *screenshot, MNM_OD_Factory *od_factory, TInt max_inter,
+  TInt assign_inter, Path_Table *path_table,
+  std::unordered_map<TInt, TFlt> *average_link_tt)
+{
   TInt _cur_inter = 0;
   TInt _total_inter = max_inter;
   TInt _real_inter;
@@ -313,41 +320,32 @@ MNM_Realtime_Dta::get_optimization_gradient (MNM_Dta_Screenshot *screenshot,
   MNM_Veh_Factory *_veh_factory = screenshot->m_veh_factory;
   MNM_Routing *_routing = screenshot->m_routing;
 
-  TFlt num_link = TFlt (_link_factory->m_link_map.size ());
-
   MNM_Link_Tt *_link_tt
     = new MNM_Link_Tt (_link_factory, m_dta_config->get_float ("unit_time"));
-  for (auto _map_it : m_average_link_tt)
+  average_link_tt->clear ();
+  for (auto _link_it : _link_factory->m_link_map)
     {
-      _map_it.second = 0;
+      average_link_tt->insert (std::pair<TInt, TFlt> (_link_it.first, 0));
     }
 
   // printf("MNM: Prepare loading!\n");
   _routing->init_routing (path_table);
-  MNM_IO::hook_up_od_node (m_file_folder, m_dta_config, m_od_factory,
-                           _node_factory);
+  hook_up_od_node (od_factory, _node_factory);
   // printf("Finish prepare routing\n");
-  // m_statistics -> init_record();
   for (auto _node_it = _node_factory->m_node_map.begin ();
        _node_it != _node_factory->m_node_map.end (); _node_it++)
     {
       _node = _node_it->second;
-      // printf("Node ID: %d\n", _node -> m_node_ID);
       _node->prepare_loading ();
     }
   while (_cur_inter < _total_inter)
     {
       _real_inter = _cur_inter;
-      printf ("-------------------------------    Interval %d   "
-              "------------------------------ \n",
-              (int) _real_inter);
       // step 1: Origin release vehicle
-
-      // printf("Realsing!\n");
       if (_cur_inter == 0)
         {
-          for (auto _origin_it = m_od_factory->m_origin_map.begin ();
-               _origin_it != m_od_factory->m_origin_map.end (); _origin_it++)
+          for (auto _origin_it = od_factory->m_origin_map.begin ();
+               _origin_it != od_factory->m_origin_map.end (); _origin_it++)
             {
               _origin = _origin_it->second;
               _origin->release_one_interval (_real_inter, _veh_factory,
@@ -355,11 +353,9 @@ MNM_Realtime_Dta::get_optimization_gradient (MNM_Dta_Screenshot *screenshot,
             }
         }
 
-      // printf("Routing!\n");
       // step 2: route the vehicle
       _routing->update_routing (_real_inter);
 
-      // printf("Moving through node!\n");
       // step 3: move vehicles through node
       for (auto _node_it = _node_factory->m_node_map.begin ();
            _node_it != _node_factory->m_node_map.end (); _node_it++)
@@ -369,24 +365,18 @@ MNM_Realtime_Dta::get_optimization_gradient (MNM_Dta_Screenshot *screenshot,
         }
 
       _link_tt->update_tt (_real_inter);
-      // printf("Moving through link\n");
       // step 4: move vehicles through link
       for (auto _link_it = _link_factory->m_link_map.begin ();
            _link_it != _link_factory->m_link_map.end (); _link_it++)
         {
           _link = _link_it->second;
-          // printf("Current Link %d:, incomming %d, finished %d\n", _link ->
-          // m_link_ID, _link -> m_incoming_array.size(),  _link ->
-          // m_finished_array.size());
           _link->clear_incoming_array (_real_inter);
           _link->evolve (_real_inter);
-          // _link -> print_info();
         }
 
-      // printf("Receiving!\n");
       // step 5: Destination receive vehicle
-      for (auto _dest_it = m_od_factory->m_destination_map.begin ();
-           _dest_it != m_od_factory->m_destination_map.end (); _dest_it++)
+      for (auto _dest_it = od_factory->m_destination_map.begin ();
+           _dest_it != od_factory->m_destination_map.end (); _dest_it++)
         {
           _dest = _dest_it->second;
           _dest->receive (_real_inter);
@@ -397,58 +387,105 @@ MNM_Realtime_Dta::get_optimization_gradient (MNM_Dta_Screenshot *screenshot,
         {
           for (auto _map_it : _link_tt->m_tt_map)
             {
-              m_average_link_tt.find (_map_it.first->m_link_ID)->second
+              average_link_tt->find (_map_it.first->m_link_ID)->second
                 += _map_it.second / TFlt (m_sample_points);
             }
         }
-      // _link_tt -> print_info();
       _cur_inter++;
     }
+  delete _link_tt;
+  return 0;
+}
 
-  for (auto _it : *path_table)
+// Fill m_average_link_tt from m_num_rollouts rollouts of the screenshot.  The
+// first rollout runs on the screenshot itself with the shared OD factory, as a
+// single rollout always did, so the screenshot is left in its simulated state;
+// the others run on forks with their own OD factories and are thrown away.
+// The sampled travel times are averaged in rollout order.
+int
+MNM_Realtime_Dta::run_rollouts (MNM_Dta_Screenshot *screenshot, TInt max_inter,
+                                TInt assign_inter, Path_Table *path_table)
+{
+  if (m_num_rollouts <= 1)
     {
-      for (auto _it_it : *(_it.second))
+      return simulate_rollout (screenshot, m_od_factory, max_inter,
+                               assign_inter, path_table, &m_average_link_tt);
+    }
+
+  std::vector<MNM_Dta_Screenshot *> _shots (m_num_rollouts, nullptr);
+  std::vector<MNM_OD_Factory *> _od_factories (m_num_rollouts, nullptr);
+  std::vector<std::unordered_map<TInt, TFlt>> _link_tts (m_num_rollouts);
+  _shots[0] = screenshot;
+  _od_factories[0] = m_od_factory;
+  for (int i = 1; i < m_num_rollouts; ++i)
+    {
+      _od_factories[i] = MNM::copy_od_factory (m_od_factory);
+      _shots[i]
+        = MNM::make_screenshot (m_file_folder, m_dta_config, _od_factories[i],
+                                screenshot->m_link_factory,
+                                screenshot->m_node_factory, m_graph,
+                                screenshot->m_routing, m_core);
+    }
+
+  MNM_Rollout_Executor _executor (m_num_threads);
+  try
+    {
+      _executor.run (m_num_rollouts, [&] (TInt i) {
+        simulate_rollout (_shots[i], _od_factories[i], max_inter, assign_inter,
+                          path_table, &_link_tts[i]);
+      });
+    }
+  catch (...)
+    {
+      for (int i = 1; i < m_num_rollouts; ++i)
         {
-          for (MNM_Path *_path : _it_it.second->m_path_vec)
-            {
-              _path->m_buffer[_grad_position] = 0;
-            }
+          delete _shots[i];
+          delete _od_factories[i];
         }
+      throw;
     }
 
-  TFlt _tmp_tt;
-  TFlt _demand;
-  for (auto _it : *path_table)
+  m_average_link_tt.clear ();
+  for (auto _map_it : _link_tts[0])
     {
-      for (auto _it_it : *(_it.second))
+      TFlt _tt = 0;
+      for (int i = 0; i < m_num_rollouts; ++i)
         {
-          _demand = MNM::get_demand_bynode (_it.first, _it_it.first,
-                                            assign_inter, _node_factory);
-          // printf("Demand is %.4f\n", _demand);
-          for (MNM_Path *_path : _it_it.second->m_path_vec)
-            {
-              TFlt _tmp_grad = 0;
-              for (TInt _link_ID : _path->m_link_vec)
-                {
-                  _link = _link_factory->get_link (_link_ID);
-                  _tmp_tt = m_average_link_tt.find (_link_ID)->second;
-                  // printf("Average tt is %.4f, marginal cost is %.4f\n",
-                  // (TFlt)_tmp_tt,
-                  // (TFlt)MNM::calculate_link_mc(_link_factory->get_link(_link_ID),
-                  // _tmp_tt));
-                  _tmp_grad += MNM_Ults::divide (_tmp_tt, _demand);
-                  _tmp_grad
-                    += MNM_Ults::divide (MNM::calculate_link_mc (_link, _tmp_tt)
-                                           * _link->get_link_flow (),
-                                         _demand * num_link);
-                }
-              _path->m_buffer[_grad_position] = _tmp_grad;
-              // printf("grad is %.4f\n", _tmp_grad);
-            }
+          _tt += _link_tts[i].find (_map_it.first)->second;
         }
+      m_average_link_tt.insert (
+        std::pair<TInt, TFlt> (_map_it.first, _tt / TFlt (m_num_rollouts)));
+    }
+
+  for (int i = 1; i < m_num_rollouts; ++i)
+    {
+      delete _shots[i];
+      delete _od_factories[i];
+    }
+  return 0;
+}
+
+// Hook the origins and destinations of od_factory up to the nodes of
+// node_factory, with the node IDs read in initialize
+int
+MNM_Realtime_Dta::hook_up_od_node (MNM_OD_Factory *od_factory,
+                                   MNM_Node_Factory *node_factory)
+{
+  MNM_Origin *_origin;
+  MNM_Destination *_dest;
+  for (auto _it : m_origin_node_ID)
+    {
+      _origin = od_factory->get_origin (_it.first);
+      _origin->m_origin_node
+        = (MNM_DMOND *) node_factory->get_node (_it.second);
+      _origin->m_origin_node->hook_up_origin (_origin);
+    }
+  for (auto _it : m_dest_node_ID)
+    {
+      _dest = od_factory->get_destination (_it.first);
+      _dest->m_dest_node = (MNM_DMDND *) node_factory->get_node (_it.second);
+      _dest->m_dest_node->hook_up_destination (_dest);
     }
-  // // m_statistics -> post_record();
-  delete _link_tt;
   return 0;
 }
 
@@ -562,7 +599,8 @@ MNM_Realtime_Dta::estimate_previous (TInt assign_inter)
       // }
       printf ("estimate_previousn::update_path_p\n");
       MNM::update_path_p (m_path_table, 1,
-                          m_estimation_step_size / TFlt (i + 1));
+                          m_estimation_step_size / TFlt (i + 1),
+                          m_num_threads);
       printf ("estimate_previousn::delete shot\n");
       if (i == m_estimation_iters - 1)
         {
@@ -591,7 +629,8 @@ MNM_Realtime_Dta::optimize_next (TInt next_assign_inter)
                                  next_assign_inter, m_path_table);
       printf ("optimize_next::update_path_p\n");
       MNM::update_path_p (m_path_table, 3,
-                          m_optimization_step_size / TFlt (i + 1));
+                          m_optimization_step_size / TFlt (i + 1),
+                          m_num_threads);
       printf ("optimize_next::delete\n");
       // for(auto _it : *m_path_table){
       //   for (auto _it_it : *(_it.second)){
@@ -635,8 +674,7 @@ MNM_Realtime_Dta::predict_next (TInt next_assign_inter)
 
   // printf("MNM: Prepare loading!\n");
   _routing->init_routing (m_path_table);
-  MNM_IO::hook_up_od_node (m_file_folder, m_dta_config, m_od_factory,
-                           _node_factory);
+  hook_up_od_node (m_od_factory, _node_factory);
   // printf("Finish prepare routing\n");
   _statistics->init_record ();
   for (auto _node_it = _node_factory->m_node_map.begin ();
@@ -755,11 +793,11 @@ MNM_Realtime_Dta::get_statistics (MNM_Node_Factory *node_factory,
 /**************************************************************************
                           Screen shot
 **************************************************************************/
-MNM_Dta_Screenshot::MNM_Dta_Screenshot (const std::string &file_folder,
-                                        MNM_ConfReader *config,
-                                        macposts::Graph &graph,
-                                        MNM_OD_Factory *od_factory)
-    : m_graph (graph)
+MNM_Dta_Screenshot::MNM_Dta_Screenshot (
+  const std::string &file_folder, MNM_ConfReader *config,
+  const macposts::Graph &graph, MNM_OD_Factory *od_factory,
+  std::shared_ptr<const MNM_Network_Core> core)
+    : m_graph (graph), m_core (core)
 {
   m_file_folder = file_folder;
   m_config = config;
@@ -776,14 +814,24 @@ MNM_Dta_Screenshot::~MNM_Dta_Screenshot ()
   delete m_veh_factory;
   delete m_node_factory;
   delete m_link_factory;
+  // the path table is the one of the realtime DTA, which outlives the shot
+  m_routing->m_path_table = nullptr;
   delete m_routing;
 }
 
 int
 MNM_Dta_Screenshot::build_static_network ()
 {
-  MNM_IO::build_node_factory (m_file_folder, m_config, m_node_factory);
-  MNM_IO::build_link_factory (m_file_folder, m_config, m_link_factory);
+  if (m_core != nullptr)
+    {
+      m_core->build_node_factory (m_node_factory);
+      m_core->build_link_factory (m_link_factory);
+    }
+  else
+    {
+      MNM_IO::build_node_factory (m_file_folder, m_config, m_node_factory);
+      MNM_IO::build_link_factory (m_file_folder, m_config, m_link_factory);
+    }
   hook_up_node_and_link ();
   return 0;
 }
@@ -925,48 +973,84 @@ run_from_screenshot (MNM_Dta_Screenshot *screenshot, MNM_ConfReader *dta_config,
   return 0;
 }
 
+// Number of vehicles held in the queues of a link.
+static size_t
+count_link_veh (MNM_Dlink *link)
+{
+  size_t _num = link->m_finished_array.size ()
+                + link->m_incoming_array.size ();
+  if (MNM_Dlink_Ctm *_ctm = dynamic_cast<MNM_Dlink_Ctm *> (link))
+    {
+      for (MNM_Dlink_Ctm::Ctm_Cell *_cell : _ctm->m_cell_array)
+        _num += _cell->m_veh_queue.size ();
+    }
+  else if (MNM_Dlink_Pq *_pq = dynamic_cast<MNM_Dlink_Pq *> (link))
+    {
+      _num += _pq->m_veh_queue.size ();
+    }
+  return _num;
+}
+
+// Fork the running state into a new screenshot.  The static part (nodes,
+// links, graph) comes from the shared network core when there is one, so it
+// is rebuilt from memory rather than parsed again.  Every link is still
+// counted, but only the links holding vehicles have their queues copied, and
+// the new vehicle pool is sized up front so the copy does not rehash.  Each
+// vehicle is copied in full; the copies keep the paths of the originals and
+// their positions on them.
 MNM_Dta_Screenshot *
 make_screenshot (const std::string &file_folder, MNM_ConfReader *config,
                  MNM_OD_Factory *od_factory, MNM_Link_Factory *link_factory,
-                 MNM_Node_Factory *node_factory, macposts::Graph &graph,
-                 MNM_Routing_Fixed *old_routing)
+                 MNM_Node_Factory *node_factory, const macposts::Graph &graph,
+                 MNM_Routing_Fixed *old_routing,
+                 std::shared_ptr<const MNM_Network_Core> core)
 {
   MNM_Dta_Screenshot *_shot
-    = new MNM_Dta_Screenshot (file_folder, config, graph, od_factory);
+    = new MNM_Dta_Screenshot (file_folder, config, graph, od_factory, core);
   _shot->build_static_network ();
-  MNM_Dlink *_dlink, *_new_dlink;
-  TInt _link_ID;
-  MNM_Veh_Factory *_new_veh_factory;
-  _new_veh_factory = _shot->m_veh_factory;
-  MNM_Veh *_new_veh;
+
+  std::vector<std::pair<MNM_Dlink *, MNM_Dlink *>> _busy_links;
+  size_t _num_veh = 0;
+  size_t _link_veh;
   for (auto _link_it = link_factory->m_link_map.begin ();
        _link_it != link_factory->m_link_map.end (); _link_it++)
     {
-      _link_ID = _link_it->first;
-      _dlink = _link_it->second;
-      _new_dlink = _shot->m_link_factory->get_link (_link_ID);
+      _link_veh = count_link_veh (_link_it->second);
+      if (_link_veh == 0)
+        continue;
+      _num_veh += _link_veh;
+      _busy_links.push_back (std::pair<MNM_Dlink *, MNM_Dlink *> (
+        _link_it->second, _shot->m_link_factory->get_link (_link_it->first)));
+    }
+
+  MNM_Veh_Factory *_new_veh_factory = _shot->m_veh_factory;
+  _new_veh_factory->m_veh_map.reserve (_num_veh);
+
+  auto _fork_veh = [&] (MNM_Veh *veh) {
+    MNM_Veh *_new_veh
+      = _new_veh_factory->make_veh (veh->m_start_time, veh->m_type);
+    copy_veh (veh, _new_veh, _shot);
+    if (!veh->m_route.is_set () || veh->m_path == nullptr)
+      throw std::runtime_error (
+        "Error, MNM::make_screenshot, vehicle has no fixed route");
+    // same path, same position, links of the new network
+    _new_veh->m_path = veh->m_path;
+    _shot->m_routing->set_veh_route (_new_veh, veh->m_path,
+                                     veh->m_route.m_hop);
+    return _new_veh;
+  };
+
+  MNM_Dlink *_dlink, *_new_dlink;
+  for (auto &_link_pair : _busy_links)
+    {
+      _dlink = _link_pair.first;
+      _new_dlink = _link_pair.second;
 
       for (MNM_Veh *_veh : _dlink->m_finished_array)
-        {
-          _new_veh
-            = _new_veh_factory->make_veh (_veh->m_start_time, _veh->m_type);
-          copy_veh (_veh, _new_veh, _shot);
-          _new_dlink->m_finished_array.push_back (_new_veh);
-          _shot->m_routing
-            ->add_veh_path (_new_veh,
-                            old_routing->m_tracker.find (_veh)->second);
-        }
+        _new_dlink->add_finished_veh (_fork_veh (_veh));
 
       for (MNM_Veh *_veh : _dlink->m_incoming_array)
-        {
-          _new_veh
-            = _new_veh_factory->make_veh (_veh->m_start_time, _veh->m_type);
-          copy_veh (_veh, _new_veh, _shot);
-          _new_dlink->m_incoming_array.push_back (_new_veh);
-          _shot->m_routing
-            ->add_veh_path (_new_veh,
-                            old_routing->m_tracker.find (_veh)->second);
-        }
+        _new_dlink->m_incoming_array.push_back (_fork_veh (_veh));
 
       if (MNM_Dlink_Ctm *_ctm = dynamic_cast<MNM_Dlink_Ctm *> (_dlink))
         {
@@ -977,15 +1061,7 @@ make_screenshot (const std::string &file_folder, MNM_ConfReader *config,
               _cell = _ctm->m_cell_array[i];
               _new_cell = _new_ctm->m_cell_array[i];
               for (MNM_Veh *_veh : _cell->m_veh_queue)
-                {
-                  _new_veh = _new_veh_factory->make_veh (_veh->m_start_time,
-                                                         _veh->m_type);
-                  copy_veh (_veh, _new_veh, _shot);
-                  _new_cell->m_veh_queue.push_back (_new_veh);
-                  _shot->m_routing
-                    ->add_veh_path (_new_veh,
-                                    old_routing->m_tracker.find (_veh)->second);
-                }
+                _new_cell->m_veh_queue.push_back (_fork_veh (_veh));
             }
         }
       else if (MNM_Dlink_Pq *_pq = dynamic_cast<MNM_Dlink_Pq *> (_dlink))
@@ -994,15 +1070,8 @@ make_screenshot (const std::string &file_folder, MNM_ConfReader *config,
           for (auto _veh_it = _pq->m_veh_queue.begin ();
                _veh_it != _pq->m_veh_queue.end (); _veh_it++)
             {
-              MNM_Veh *_veh = _veh_it->first;
-              _new_veh
-                = _new_veh_factory->make_veh (_veh->m_start_time, _veh->m_type);
-              copy_veh (_veh, _new_veh, _shot);
-              _new_pq->m_veh_queue.push_back (
-                std::pair<MNM_Veh *, TInt> (_new_veh, _veh_it->second));
-              _shot->m_routing
-                ->add_veh_path (_new_veh,
-                                old_routing->m_tracker.find (_veh)->second);
+              _new_pq->m_veh_queue.push_back (std::pair<MNM_Veh *, TInt> (
+                _fork_veh (_veh_it->first), _veh_it->second));
             }
         }
     }
@@ -1018,46 +1087,83 @@ make_screenshot (MNM_Dta_Screenshot *screenshot)
                                screenshot->m_od_factory,
                                screenshot->m_link_factory,
                                screenshot->m_node_factory, screenshot->m_graph,
-                               screenshot->m_routing);
+                               screenshot->m_routing, screenshot->m_core);
 }
 
 MNM_Dta_Screenshot *
 make_empty_screenshot (const std::string &file_folder, MNM_ConfReader *config,
-                       MNM_OD_Factory *od_factory, macposts::Graph &graph)
+                       MNM_OD_Factory *od_factory, const macposts::Graph &graph,
+                       std::shared_ptr<const MNM_Network_Core> core)
 {
   MNM_Dta_Screenshot *_shot
-    = new MNM_Dta_Screenshot (file_folder, config, graph, od_factory);
+    = new MNM_Dta_Screenshot (file_folder, config, graph, od_factory, core);
   _shot->build_static_network ();
   return _shot;
 }
 
+MNM_OD_Factory *
+copy_od_factory (MNM_OD_Factory *od_factory)
+{
+  MNM_OD_Factory *_od_factory = new MNM_OD_Factory ();
+  MNM_Destination *_dest;
+  for (auto _it : od_factory->m_destination_map)
+    {
+      _dest = _od_factory->make_destination (_it.first);
+      _dest->m_flow_scalar = _it.second->m_flow_scalar;
+    }
+  MNM_Origin *_old, *_origin;
+  for (auto _it : od_factory->m_origin_map)
+    {
+      _old = _it.second;
+      _origin
+        = _od_factory->make_origin (_it.first, _old->m_max_assign_interval,
+                                    _old->m_flow_scalar, _old->m_frequency);
+      for (auto _demand_it : _old->m_demand)
+        {
+          _dest = _od_factory->get_destination (_demand_it.first->m_Dest_ID);
+          _origin->add_dest_demand (_dest, _demand_it.second);
+        }
+      for (auto _ratio_it : _old->m_adaptive_ratio)
+        {
+          _dest = _od_factory->get_destination (_ratio_it.first->m_Dest_ID);
+          _origin->add_dest_adaptive_ratio (_dest, _ratio_it.second);
+        }
+      _origin->m_vehicle_label_ratio = _old->m_vehicle_label_ratio;
+    }
+  return _od_factory;
+}
+
 int
-update_path_p (Path_Table *path_table, TInt col, TFlt step_size)
+update_path_p (Path_Table *path_table, TInt col, TFlt step_size,
+               int num_threads)
 {
   TFlt Possible_Large = 10000;
+  std::vector<MNM_Pathset *> _pathsets;
   for (auto _it : *path_table)
     {
       for (auto _it_it : *(_it.second))
         {
-          for (MNM_Path *_path : _it_it.second->m_path_vec)
+          _pathsets.push_back (_it_it.second);
+        }
+    }
+  // every pathset is updated and normalized on its own
+  MNM_Ults::parallel_for (
+    _pathsets.size (), num_threads, [&] (size_t i, int worker) {
+      for (MNM_Path *_path : _pathsets[i]->m_path_vec)
+        {
+          if (_path->m_buffer[col] > 0)
             {
-              // printf("Before m_p is %lf\n", _path -> m_p);
-              if (_path->m_buffer[col] > 0)
-                {
-                  _path->m_p /= (1 + step_size);
-                }
-              else
-                {
-                  _path->m_p *= (1 + step_size);
-                }
-              // _path -> m_p -= step_size * _path -> buffer[col];
-              // printf("Now m_p is %lf\n", _path -> m_p);
-              _path->m_p = std::max (_path->m_p, -Possible_Large);
-              _path->m_p = std::min (_path->m_p, Possible_Large);
+              _path->m_p /= (1 + step_size);
+            }
+          else
+            {
+              _path->m_p *= (1 + step_size);
             }
-          _it_it.second->normalize_p ();
+          _path->m_p = std::max (_path->m_p, -Possible_Large);
+          _path->m_p = std::min (_path->m_p, Possible_Large);
         }
-    }
+      _pathsets[i]->normalize_p ();
+    });
   return 0;
 }
 
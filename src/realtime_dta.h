@@ -3,16 +3,38 @@
 #include "common.h"
 #include "io.h"
 #include "marginal_cost.h"
+#include "network_core.h"
 #include "od.h"
 #include "path.h"
 #include "routing.h"
 #include "statistics.h"
 
+#include <functional>
+#include <memory>
 #include <string>
 #include <typeinfo>
 
 class MNM_Dta_Screenshot;
 
+/**************************************************************************
+                          Rollout executor
+**************************************************************************/
+// Runs a batch of independent jobs on up to m_num_threads worker threads.
+// Job i draws from an engine seeded with the i-th of num_jobs seeds taken, in
+// job order, from the engine of the caller, so every batch gets fresh draws.
+// A job must only write to its own result slot, so the caller can reduce the
+// slots in index order and get the same answer whatever the thread count or
+// scheduling.  The first exception (by job index) is rethrown once all jobs
+// are done.
+class MNM_Rollout_Executor
+{
+public:
+  explicit MNM_Rollout_Executor (TInt num_threads);
+  ~MNM_Rollout_Executor ();
+  int run (TInt num_jobs, const std::function<void (TInt)> &job);
+  TInt m_num_threads;
+};
+
 class MNM_Realtime_Dta
 {
 public:
@@ -27,6 +49,14 @@ public:
                                std::unordered_map<TInt, TFlt> *link_spd_map);
   int get_optimization_gradient (MNM_Dta_Screenshot *screenshot, TInt max_inter,
                                  TInt assign_inter, Path_Table *path_table);
+  int simulate_rollout (MNM_Dta_Screenshot *screenshot,
+                        MNM_OD_Factory *od_factory, TInt max_inter,
+                        TInt assign_inter, Path_Table *path_table,
+                        std::unordered_map<TInt, TFlt> *average_link_tt);
+  int run_rollouts (MNM_Dta_Screenshot *screenshot, TInt max_inter,
+                    TInt assign_inter, Path_Table *path_table);
+  int hook_up_od_node (MNM_OD_Factory *od_factory,
+                       MNM_Node_Factory *node_factory);
   int one_iteration (TInt assign_inter);
   int estimate_previous (TInt assign_inter);
   int optimize_next (TInt next_assign_inter);
@@ -41,6 +71,11 @@ public:
   TInt m_prediction_length;
   TInt m_estimation_length;
   TInt m_total_assign_inter;
+  // number of sampled rollouts averaged per gradient evaluation, one unless
+  // set, and the threads they and the loops over the pathsets run on; the
+  // thread count only schedules the work and never changes the results
+  TInt m_num_rollouts;
+  TInt m_num_threads;
 
   TFlt m_estimation_step_size;
   TFlt m_optimization_step_size;
@@ -49,8 +84,15 @@ public:
   std::unordered_map<TInt, TFlt> m_link_tt_difference; // only used in
                                                        // estimation
   std::string m_file_folder;
-  macposts::Graph m_graph;
+  // parsed once on construction and shared by every screenshot, so forking a
+  // rollout never goes back to the node/link files
+  std::shared_ptr<const MNM_Network_Core> m_core;
+  // the graph of m_core
+  const macposts::Graph &m_graph;
   MNM_OD_Factory *m_od_factory;
+  // the node of each origin and destination, read once in initialize
+  std::unordered_map<TInt, TInt> m_origin_node_ID;
+  std::unordered_map<TInt, TInt> m_dest_node_ID;
   MNM_ConfReader *m_dta_config;
   MNM_ConfReader *m_realtime_dta_config;
   MNM_Dta_Screenshot *m_before_shot;
@@ -63,11 +105,13 @@ class MNM_Dta_Screenshot
 {
 public:
   MNM_Dta_Screenshot (const std::string &file_folder, MNM_ConfReader *config,
-                      macposts::Graph &graph, MNM_OD_Factory *od_factory);
+                      const macposts::Graph &graph, MNM_OD_Factory *od_factory,
+                      std::shared_ptr<const MNM_Network_Core> core = nullptr);
   ~MNM_Dta_Screenshot ();
   int build_static_network ();
   int hook_up_node_and_link ();
-  macposts::Graph &m_graph;
+  const macposts::Graph &m_graph;
+  std::shared_ptr<const MNM_Network_Core> m_core;
   std::string m_file_folder;
   MNM_ConfReader *m_config;
   MNM_OD_Factory *m_od_factory;
@@ -87,15 +131,20 @@ int run_from_screenshot (MNM_Dta_Screenshot *screenshot,
 MNM_Dta_Screenshot *
 make_screenshot (const std::string &file_folder, MNM_ConfReader *config,
                  MNM_OD_Factory *od_factory, MNM_Link_Factory *link_factory,
-                 MNM_Node_Factory *node_factory, macposts::Graph &graph,
-                 MNM_Routing_Fixed *old_routing);
+                 MNM_Node_Factory *node_factory, const macposts::Graph &graph,
+                 MNM_Routing_Fixed *old_routing,
+                 std::shared_ptr<const MNM_Network_Core> core = nullptr);
 MNM_Dta_Screenshot *make_screenshot (MNM_Dta_Screenshot *screenshot);
-MNM_Dta_Screenshot *make_empty_screenshot (const std::string &file_folder,
-                                           MNM_ConfReader *config,
-                                           MNM_OD_Factory *od_factory,
-                                           macposts::Graph &graph);
+MNM_Dta_Screenshot *
+make_empty_screenshot (const std::string &file_folder, MNM_ConfReader *config,
+                       MNM_OD_Factory *od_factory, const macposts::Graph &graph,
+                       std::shared_ptr<const MNM_Network_Core> core = nullptr);
 
-int update_path_p (Path_Table *path_table, TInt col, TFlt step_size);
+// A new OD factory with the origins, destinations and demand of od_factory,
+// not hooked up to any node
+MNM_OD_Factory *copy_od_factory (MNM_OD_Factory *od_factory);
+int update_path_p (Path_Table *path_table, TInt col, TFlt step_size,
+                   int num_threads = 1);
 }
 
 void static inline copy_veh (MNM_Veh *_veh, MNM_Veh *_new_veh,
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Position of a fixed route traveler on its path.  The links of a path are
+// resolved once by the routing that owns them; a traveler only points to that
+// array and keeps the index of the next link to take, instead of carrying its
+// own copy of the remaining link IDs.
+template <typename Link> struct MNM_Route_Cursor
+{
+  const std::vector<Link *> *m_links = nullptr;
+  size_t m_hop = 0;
+
+  bool is_set () const { return m_links != nullptr; }
+  // no links left in the route
+  bool at_end () const
+  {
+    return m_links == nullptr || m_hop >= m_links->size ();
+  }
+  void set (const std::vector<Link *> *links, size_t hop = 0)
+  {
+    m_links = links;
+    m_hop = hop;
+  }
+  void reset () { set (nullptr); }
+  // the next link of the route and advance, nullptr once the route is done
+  Link *next () { return at_end () ? nullptr : (*m_links)[m_hop++]; }
+};
@@ -2,7 +2,8 @@
 
 using macposts::graph::Direction;
 
-MNM_Routing::MNM_Routing (macposts::Graph &graph, MNM_OD_Factory *od_factory,
+MNM_Routing::MNM_Routing (const macposts::Graph &graph,
+                          MNM_OD_Factory *od_factory,
                           MNM_Node_Factory *node_factory,
                           MNM_Link_Factory *link_factory)
     : m_graph (graph)
@@ -18,7 +19,7 @@ MNM_Routing::~MNM_Routing () { ; }
                           Random routing
 **************************************************************************/
 /* assign each vehicle a random link ahead of it, only used for testing */
-MNM_Routing_Random::MNM_Routing_Random (macposts::Graph &graph,
+MNM_Routing_Random::MNM_Routing_Random (const macposts::Graph &graph,
                                         MNM_OD_Factory *od_factory,
                                         MNM_Node_Factory *node_factory,
                                         MNM_Link_Factory *link_factory)
@@ -54,8 +55,8 @@ MNM_Routing_Random::update_routing (TInt timestamp)
            _veh_it != _origin_node->m_in_veh_queue.end (); _veh_it++)
         {
           auto &&outs = m_graph.connections (_node_ID, Direction::Outgoing);
-          int idx = MNM_Ults::mod (rand (),
-                                   std::distance (outs.begin (), outs.end ()));
+          int idx = MNM_Ults::rand_int (
+            std::distance (outs.begin (), outs.end ()));
           auto it = outs.begin ();
           while (idx--)
             ++it;
@@ -79,7 +80,7 @@ MNM_Routing_Random::update_routing (TInt timestamp)
           int deg = std::distance (outs.begin (), outs.end ());
           if (deg > 0)
             {
-              int idx = MNM_Ults::mod (rand (), deg);
+              int idx = MNM_Ults::rand_int (deg);
               auto it = outs.begin ();
               while (idx--)
                 it++;
@@ -101,7 +102,7 @@ MNM_Routing_Random::update_routing (TInt timestamp)
                           Adaptive routing
 **************************************************************************/
 MNM_Routing_Adaptive::MNM_Routing_Adaptive (const std::string &file_folder,
-                                            macposts::Graph &graph,
+                                            const macposts::Graph &graph,
                                             MNM_Statistics *statistics,
                                             MNM_OD_Factory *od_factory,
                                             MNM_Node_Factory *node_factory,
@@ -126,6 +127,23 @@ MNM_Routing_Adaptive::MNM_Routing_Adaptive (const std::string &file_folder,
       m_vot = 20. / 3600.; // money / second
     }
 
+  try
+    {
+      m_incremental_sp = m_self_config->get_int ("incremental_sp") > 0;
+    }
+  catch (const std::invalid_argument &ia)
+    {
+      m_incremental_sp = false;
+    }
+  try
+    {
+      m_sp_rebuild_ratio = m_self_config->get_float ("sp_rebuild_ratio");
+    }
+  catch (const std::invalid_argument &ia)
+    {
+      m_sp_rebuild_ratio = 0.2;
+    }
+
   m_table = new Routing_Table ();
   m_link_cost = std::unordered_map<TInt, TFlt> ();
 }
@@ -143,6 +161,7 @@ MNM_Routing_Adaptive::~MNM_Routing_Adaptive ()
     }
   m_table->clear ();
   delete m_table;
+  m_dist_table.clear ();
   m_link_cost.clear ();
   delete m_self_config;
 }
@@ -187,44 +206,106 @@ MNM_Routing_Adaptive::update_link_cost ()
       // for multiclass, m_toll is for car, see
       // MNM_IO_Multiclass::build_link_toll_multiclass
       // in dollars
+      MNM_Dlink *_link = m_link_factory->get_link (_it.first);
+      // a closed link costs as much as a jammed one, see MNM_Workzone
       m_link_cost[_it.first]
-        = _it.second * m_vot + m_link_factory->get_link (_it.first)->m_toll;
+        = _link->m_closed ? MNM_Ults::max_link_cost () * m_vot
+                          : _it.second * m_vot + _link->m_toll;
       // printf("link %d, cost %f\n", _it.first(), m_link_cost[_it.first]());
     }
   return 0;
 }
 
 int
-MNM_Routing_Adaptive::update_routing (TInt timestamp)
+MNM_Routing_Adaptive::update_shortest_path_trees ()
 {
-  // relying on m_statistics -> m_record_interval_tt, which is obtained in
-  // simulation, not after simulation link::get_link_tt(), based on density
+  std::vector<std::pair<TInt, TFlt>> _changed_links;
+  update_link_cost ();
+  // the first update always builds the trees from scratch
+  bool _rebuild = !m_incremental_sp || m_dist_table.empty ();
+  if (!_rebuild)
+    {
+      _changed_links
+        = MNM_Shortest_Path::update_changed_link_cost (m_tree_link_cost,
+                                                       m_link_cost);
+      _rebuild = TFlt (_changed_links.size ())
+                 > m_sp_rebuild_ratio * TFlt (m_link_cost.size ());
+    }
+  if (m_incremental_sp && _rebuild)
+    m_tree_link_cost = m_link_cost;
+  const std::unordered_map<TInt, TFlt> &_tree_link_cost
+    = m_incremental_sp ? m_tree_link_cost : m_link_cost;
+
   MNM_Destination *_dest;
   TInt _dest_node_ID;
   std::unordered_map<TInt, TInt> *_shortest_path_tree;
-  // update m_table
-  if ((timestamp) % m_routing_freq == 0 || timestamp == 0)
+  for (auto _it = m_od_factory->m_destination_map.begin ();
+       _it != m_od_factory->m_destination_map.end (); _it++)
     {
-      // printf("Calculating the shortest path trees!\n");
-      update_link_cost ();
-      for (auto _it = m_od_factory->m_destination_map.begin ();
-           _it != m_od_factory->m_destination_map.end (); _it++)
+      _dest = _it->second;
+      _dest_node_ID = _dest->m_dest_node->m_node_ID;
+      _shortest_path_tree = m_table->find (_dest)->second;
+      if (!m_incremental_sp && !m_keep_dist_table)
         {
-          // #pragma omp task firstprivate(_it)
-          // {
-          _dest = _it->second;
-          _dest_node_ID = _dest->m_dest_node->m_node_ID;
-          // printf("Destination ID: %d\n", (int) _dest_node_ID);
-          _shortest_path_tree = m_table->find (_dest)->second;
           MNM_Shortest_Path::all_to_one_FIFO (_dest_node_ID, m_graph,
                                               m_link_cost,
                                               *_shortest_path_tree);
-          // MNM_Shortest_Path::all_to_one_FIFO(_dest_node_ID, m_graph,
-          // m_statistics -> m_record_interval_tt, *_shortest_path_tree);
-          // MNM_Shortest_Path::all_to_one_Dijkstra(_dest_node_ID, m_graph,
-          // m_statistics -> m_record_interval_tt, *_shortest_path_tree);
-          // }
         }
+      else if (_rebuild)
+        {
+          MNM_Shortest_Path::all_to_one_FIFO (_dest_node_ID, m_graph,
+                                              m_dist_table[_dest],
+                                              _tree_link_cost,
+                                              *_shortest_path_tree);
+        }
+      else if (!_changed_links.empty ())
+        {
+          MNM_Shortest_Path::repair_all_to_one_FIFO (_dest_node_ID, m_graph,
+                                                     m_dist_table[_dest],
+                                                     _tree_link_cost,
+                                                     _changed_links,
+                                                     *_shortest_path_tree);
+        }
+    }
+  return 0;
+}
+
+int
+MNM_Routing_Adaptive::add_memory_usage (MNM_Memory_Report &report)
+{
+  size_t _bytes = MNM::unordered_bytes (m_link_cost)
+                  + MNM::unordered_bytes (m_tree_link_cost)
+                  + MNM::unordered_bytes (m_dist_table);
+  size_t _count = 0;
+  if (m_table != nullptr)
+    {
+      _bytes += sizeof (Routing_Table) + MNM::unordered_bytes (*m_table);
+      for (auto _it : *m_table)
+        {
+          _bytes += sizeof (*_it.second) + MNM::unordered_bytes (*_it.second);
+        }
+      _count = m_table->size ();
+    }
+  for (auto &_it : m_dist_table)
+    {
+      _bytes += MNM::unordered_bytes (_it.second);
+    }
+  MNM::add_memory (report, "routing_table", _bytes, _count);
+  return 0;
+}
+
+int
+MNM_Routing_Adaptive::update_routing (TInt timestamp)
+{
+  // relying on m_statistics -> m_record_interval_tt, which is obtained in
+  // simulation, not after simulation link::get_link_tt(), based on density
+  // update m_table
+  bool _table_updated = false;
+  if ((timestamp) % m_routing_freq == 0 || timestamp == 0)
+    {
+      // printf("Calculating the shortest path trees!\n");
+      update_shortest_path_trees ();
+      _table_updated = true;
     }
 
   /* route the vehicle in Origin nodes */
@@ -271,10 +352,16 @@ MNM_Routing_Adaptive::update_routing (TInt timestamp)
     {
       _link = _link_it->second;
       _node_ID = _link->m_to_node->m_node_ID;
-      for (auto _veh_it = _link->m_finished_array.begin ();
-           _veh_it != _link->m_finished_array.end (); _veh_it++)
+      // queued vehicles only need a new next link when m_table changed, the
+      // others get the one they were given when they reached the link end
+      const std::vector<MNM_Veh *> &_new_finished
+        = _link->get_new_finished (timestamp);
+      std::vector<MNM_Veh *> _queued;
+      if (_table_updated)
+        _queued.assign (_link->m_finished_array.begin (),
+                        _link->m_finished_array.end ());
+      for (MNM_Veh *_veh : _table_updated ? _queued : _new_finished)
         {
-          _veh = *_veh_it;
           if (_veh->m_type == MNM_TYPE_ADAPTIVE)
             {
               if (_link != _veh->get_current_link ())
@@ -305,7 +392,7 @@ MNM_Routing_Adaptive::update_routing (TInt timestamp)
                         {
                           printf ("Assign randomly!\n");
                           auto it = outs.begin ();
-                          int idx = MNM_Ults::mod (rand (), deg);
+                          int idx = MNM_Ults::rand_int (deg);
                           while (idx--)
                             it++;
                           _next_link_ID = m_graph.get_id (*it);
@@ -360,14 +447,13 @@ MNM_Routing_Adaptive::update_routing (TInt timestamp)
 /**************************************************************************
                           fixed routing
 **************************************************************************/
-MNM_Routing_Fixed::MNM_Routing_Fixed (macposts::Graph &graph,
+MNM_Routing_Fixed::MNM_Routing_Fixed (const macposts::Graph &graph,
                                       MNM_OD_Factory *od_factory,
                                       MNM_Node_Factory *node_factory,
                                       MNM_Link_Factory *link_factory,
                                       TInt routing_frq, TInt buffer_len)
     : MNM_Routing::MNM_Routing (graph, od_factory, node_factory, link_factory)
 {
-  m_tracker = std::unordered_map<MNM_Veh *, std::deque<TInt> *> ();
   if ((routing_frq == -1) || (buffer_len == -1))
     {
       m_buffer_as_p = false;
@@ -386,12 +472,7 @@ MNM_Routing_Fixed::MNM_Routing_Fixed (macposts::Graph &graph,
 
 MNM_Routing_Fixed::~MNM_Routing_Fixed ()
 {
-  for (auto _map_it : m_tracker)
-    {
-      _map_it.second->clear ();
-      delete _map_it.second;
-    }
-  m_tracker.clear ();
+  m_path_links.clear ();
 
   if ((m_path_table != nullptr) && (!m_path_table->empty ()))
     {
@@ -432,13 +513,8 @@ MNM_Routing_Fixed::init_routing (Path_Table *path_table)
 int
 MNM_Routing_Fixed::change_choice_portion (TInt routing_interval)
 {
-  // printf("Entering MNM_Routing_Fixed::change_choice_portion\n");
   // printf("Current routing interval %d\n", routing_interval);
-  MNM::copy_buffer_to_p (m_path_table, routing_interval);
-  // printf("Finish copying\n");
-  MNM::normalize_path_table_p (m_path_table);
-  // printf("Exiting MNM_Routing_Fixed::change_choice_portion\n");
-  return 0;
+  return m_sampler.set_column (routing_interval);
 }
 
 int
@@ -447,7 +523,7 @@ MNM_Routing_Fixed::update_routing (TInt timestamp)
   // printf("MNM_Routing_Fixed::update_routing\n");
   MNM_Origin *_origin;
   MNM_DMOND *_origin_node;
-  TInt _node_ID, _next_link_ID;
+  TInt _node_ID;
   MNM_Dlink *_next_link;
   MNM_Veh *_veh;
   TInt _cur_ass_int;
@@ -478,16 +554,13 @@ MNM_Routing_Fixed::update_routing (TInt timestamp)
           // printf("1.2\n");
           if (_veh->m_type == MNM_TYPE_STATIC)
             {
-              if (m_tracker.find (_veh) == m_tracker.end ())
-                { // vehicle not in tracker
+              if (!_veh->m_route.is_set ())
+                { // vehicle not routed yet
                   // printf("Registering!\n");
                   register_veh (_veh, true);
                   // printf("1.3\n");
-                  _next_link_ID = m_tracker.find (_veh)->second->front ();
-                  _next_link = m_link_factory->get_link (_next_link_ID);
-                  _veh->set_next_link (_next_link);
-                  m_tracker.find (_veh)
-                    ->second->pop_front (); // adjust links left
+                  _veh->set_next_link (
+                    _veh->m_route.next ()); // adjust links left
                 }
             }
           // according to Dr. Wei Ma, add a nominal path to adaptive users for
@@ -496,7 +569,7 @@ MNM_Routing_Fixed::update_routing (TInt timestamp)
             {
               if (_veh->m_path == nullptr)
                 {
-                  register_veh (_veh, false); // adpative user not in m_tracker
+                  register_veh (_veh, false); // adpative user has no route
                 }
               IAssert (_veh->m_path != nullptr);
             }
@@ -514,43 +587,39 @@ MNM_Routing_Fixed::update_routing (TInt timestamp)
       // printf("2.02\n");
       _node_ID = _link->m_to_node->m_node_ID;
       // printf("2.1\n");
-      for (auto _veh_it = _link->m_finished_array.begin ();
-           _veh_it != _link->m_finished_array.end (); _veh_it++)
+      // vehicles queued longer were routed when they reached the link end
+      for (MNM_Veh *_veh : _link->get_new_finished (timestamp))
         {
-          _veh = *_veh_it;
           if (_veh->m_type == MNM_TYPE_STATIC)
             {
               _veh_dest = _veh->get_destination ();
               // printf("2.2\n");
               if (_veh_dest->m_dest_node->m_node_ID == _node_ID)
                 { // vehicles reaching destination
-                  if (m_tracker.find (_veh)->second->size () != 0)
+                  if (!_veh->m_route.at_end ())
                     { // check if any links left in the route
                       throw std::runtime_error ("invalid state");
                     }
                   _veh->set_next_link (nullptr);
-                  // m_tracker.erase(m_tracker.find(_veh));
                 }
               else
                 { // vehicles enroute, adjust _next_link_ID, which is changed by
                   // node->evolve() in simulation dta.cpp
                   // printf("2.3\n");
-                  if (m_tracker.find (_veh) == m_tracker.end ())
-                    { // check if vehicle is registered in m_tracker, which
-                      // should be done in releasing from origin
+                  if (!_veh->m_route.is_set ())
+                    { // check if vehicle has a route, which should be set in
+                      // releasing from origin
                       throw std::runtime_error (
                         "invalid state: vehicle unregistered for link");
                     }
                   if (_veh->get_current_link () == _veh->get_next_link ())
                     {
-                      _next_link_ID = m_tracker.find (_veh)->second->front ();
-                      if (_next_link_ID == -1)
+                      _next_link = _veh->m_route.next ();
+                      if (_next_link == nullptr)
                         {
                           throw std::runtime_error ("invalid state");
                         }
-                      _next_link = m_link_factory->get_link (_next_link_ID);
                       _veh->set_next_link (_next_link);
-                      m_tracker.find (_veh)->second->pop_front ();
                     }
                 } // end if-else
             }     // end if veh->m_type
@@ -572,42 +641,16 @@ MNM_Routing_Fixed::register_veh (MNM_Veh *veh, bool track)
     = m_path_table->find (veh->get_origin ()->m_origin_node->m_node_ID)
         ->second->find (veh->get_destination ()->m_dest_node->m_node_ID)
         ->second;
-  MNM_Path *_route_path = nullptr;
-  // printf("1\n");
-  // note m_path_vec is an ordered vector, not unordered
-  for (MNM_Path *_path : _pathset->m_path_vec)
-    {
-      // when _r = 1, it will come to equality check of two floating numbers
-      // and simply using if (_path->m_p >= _r) can be problematic sometimes,
-      // especially on Windows, _route_path can still be nullptr after this,
-      // which can cause vehicle on wrong link or node
-      if (!MNM_Ults::approximate_less_than (_path->m_p, _r))
-        {
-          _route_path = _path;
-          break;
-        }
-      else
-        {
-          _r -= _path->m_p;
-        }
-    }
-  // printf("3\n");
+  // _route_path can be nullptr when the probabilities do not sum to 1, which
+  // can cause vehicle on wrong link or node
+  MNM_Path *_route_path = m_sampler.sample (_pathset, _r);
   if (_route_path == nullptr)
     {
       throw std::runtime_error ("wrong probability");
     }
   if (track)
     {
-      std::deque<TInt> *_link_queue = new std::deque<TInt> ();
-      std::copy (
-        _route_path->m_link_vec.begin (), _route_path->m_link_vec.end (),
-        std::back_inserter (
-          *_link_queue)); // copy links in the route to _link_queue
-                          // https://www.cplusplus.com/reference/iterator/back_inserter/
-      // printf("old link q is %d, New link queue is %d\n", _route_path ->
-      // m_link_vec.size(), _link_queue -> size());
-      m_tracker.insert (
-        std::pair<MNM_Veh *, std::deque<TInt> *> (veh, _link_queue));
+      set_veh_route (veh, _route_path);
     }
   veh->m_path = _route_path;
   return 0;
@@ -617,13 +660,10 @@ int
 MNM_Routing_Fixed::remove_finished (MNM_Veh *veh, bool del)
 {
   IAssert (veh->m_finish_time > 0 && veh->m_finish_time > veh->m_start_time);
-  if (m_tracker.find (veh) != m_tracker.end () && del)
+  if (veh->m_route.is_set () && del)
     {
-      IAssert (veh->m_type
-               == MNM_TYPE_STATIC); // adaptive user not in m_tracker
-      m_tracker.find (veh)->second->clear ();
-      delete m_tracker.find (veh)->second;
-      m_tracker.erase (veh);
+      IAssert (veh->m_type == MNM_TYPE_STATIC); // adaptive user has no route
+      veh->m_route.reset ();
     }
   return 0;
 }
@@ -631,20 +671,62 @@ MNM_Routing_Fixed::remove_finished (MNM_Veh *veh, bool del)
 int
 MNM_Routing_Fixed::set_path_table (Path_Table *path_table)
 {
+  // the sampler caches the buffers of the pathsets, which may have changed
+  // since the last loading even if the table has not
+  m_sampler.m_cum_p.clear ();
+  if (path_table == m_path_table)
+    return 0;
   if (m_path_table != nullptr)
-    delete m_path_table;
+    {
+      delete m_path_table;
+      // keyed by the paths of the old table, whose addresses the new one may
+      // reuse
+      m_path_links.clear ();
+    }
   m_path_table = path_table;
   return 0;
 }
 
 int
-MNM_Routing_Fixed::add_veh_path (MNM_Veh *veh, std::deque<TInt> *link_que)
+MNM_Routing_Fixed::add_memory_usage (MNM_Memory_Report &report)
+{
+  MNM::add_path_table_memory_usage (report, m_path_table);
+  return add_route_memory_usage (report);
+}
+
+int
+MNM_Routing_Fixed::add_route_memory_usage (MNM_Memory_Report &report)
+{
+  size_t _bytes = MNM::unordered_bytes (m_path_links);
+  for (auto &_it : m_path_links)
+    {
+      _bytes += MNM::vector_bytes (_it.second);
+    }
+  MNM::add_memory (report, "route_links", _bytes, m_path_links.size ());
+  return m_sampler.add_memory_usage (report);
+}
+
+const std::vector<MNM_Dlink *> *
+MNM_Routing_Fixed::get_path_links (MNM_Path *path)
 {
-  std::deque<TInt> *_new_link_que = new std::deque<TInt> ();
-  std::copy (link_que->begin (), link_que->end (),
-             std::back_inserter (*_new_link_que));
-  m_tracker.insert (
-    std::pair<MNM_Veh *, std::deque<TInt> *> (veh, _new_link_que));
+  auto _it = m_path_links.find (path);
+  if (_it == m_path_links.end ())
+    {
+      std::vector<MNM_Dlink *> _links;
+      _links.reserve (path->m_link_vec.size ());
+      for (TInt _link_ID : path->m_link_vec)
+        {
+          _links.push_back (m_link_factory->get_link (_link_ID));
+        }
+      _it = m_path_links.insert ({ path, std::move (_links) }).first;
+    }
+  return &_it->second;
+}
+
+int
+MNM_Routing_Fixed::set_veh_route (MNM_Veh *veh, MNM_Path *path, size_t hop)
+{
+  veh->m_route.set (get_path_links (path), hop);
   return 0;
 }
 
@@ -652,7 +734,7 @@ MNM_Routing_Fixed::add_veh_path (MNM_Veh *veh, std::deque<TInt> *link_que)
                           Hybrid (Adaptive+Fixed) routing
 **************************************************************************/
 MNM_Routing_Hybrid::MNM_Routing_Hybrid (const std::string &file_folder,
-                                        macposts::Graph &graph,
+                                        const macposts::Graph &graph,
                                         MNM_Statistics *statistics,
                                         MNM_OD_Factory *od_factory,
                                         MNM_Node_Factory *node_factory,
@@ -703,11 +785,19 @@ MNM_Routing_Hybrid::remove_finished (MNM_Veh *veh, bool del)
   return 0;
 }
 
+int
+MNM_Routing_Hybrid::add_memory_usage (MNM_Memory_Report &report)
+{
+  m_routing_adaptive->add_memory_usage (report);
+  m_routing_fixed->add_memory_usage (report);
+  return 0;
+}
+
 /**************************************************************************
                           Bi-class Hybrid routing
 **************************************************************************/
 MNM_Routing_Biclass_Hybrid::MNM_Routing_Biclass_Hybrid (
-  const std::string &file_folder, macposts::Graph &graph,
+  const std::string &file_folder, const macposts::Graph &graph,
   MNM_Statistics *statistics, MNM_OD_Factory *od_factory,
   MNM_Node_Factory *node_factory, MNM_Link_Factory *link_factory,
   TInt route_frq_fixed, TInt buffer_length)
@@ -783,11 +873,25 @@ MNM_Routing_Biclass_Hybrid::remove_finished (MNM_Veh *veh, bool del)
   return 0;
 }
 
+int
+MNM_Routing_Biclass_Hybrid::add_memory_usage (MNM_Memory_Report &report)
+{
+  m_routing_adaptive->add_memory_usage (report);
+  m_routing_fixed_car->add_memory_usage (report);
+  // the path table is usually shared with the cars
+  if (m_routing_fixed_truck->m_path_table
+      != m_routing_fixed_car->m_path_table)
+    MNM::add_path_table_memory_usage (report,
+                                      m_routing_fixed_truck->m_path_table);
+  m_routing_fixed_truck->add_route_memory_usage (report);
+  return 0;
+}
+
 /**************************************************************************
                           Bi-class fixed routing
 **************************************************************************/
 MNM_Routing_Biclass_Fixed::MNM_Routing_Biclass_Fixed (
-  macposts::Graph &graph, MNM_OD_Factory *od_factory,
+  const macposts::Graph &graph, MNM_OD_Factory *od_factory,
   MNM_Node_Factory *node_factory, MNM_Link_Factory *link_factory,
   TInt routing_frq, TInt buffer_length, TInt veh_class)
     : MNM_Routing_Fixed::MNM_Routing_Fixed (graph, od_factory, node_factory,
@@ -804,11 +908,8 @@ int
 MNM_Routing_Biclass_Fixed::change_choice_portion (TInt routing_interval)
 {
   // m_veh_class starts from 0 (car) to 1 (truck)
-  MNM::copy_buffer_to_p (m_path_table,
-                         routing_interval
-                           + m_veh_class * TInt (m_buffer_length / 2));
-  MNM::normalize_path_table_p (m_path_table);
-  return 0;
+  return m_sampler.set_column (routing_interval
+                               + m_veh_class * TInt (m_buffer_length / 2));
 }
 
 int
@@ -816,7 +917,7 @@ MNM_Routing_Biclass_Fixed::update_routing (TInt timestamp)
 {
   MNM_Origin *_origin;
   MNM_DMOND *_origin_node;
-  TInt _node_ID, _next_link_ID;
+  TInt _node_ID;
   MNM_Dlink *_next_link;
   MNM_Veh *_veh;
   TInt _cur_ass_int;
@@ -859,14 +960,11 @@ MNM_Routing_Biclass_Fixed::update_routing (TInt timestamp)
             {
               // Here is the difference from single-class fixed routing
 
-              if (m_tracker.find (_veh) == m_tracker.end ())
+              if (!_veh->m_route.is_set ())
                 {
                   // printf("Registering!\n");
                   register_veh (_veh, true);
-                  _next_link_ID = m_tracker.find (_veh)->second->front ();
-                  _next_link = m_link_factory->get_link (_next_link_ID);
-                  _veh->set_next_link (_next_link);
-                  m_tracker.find (_veh)->second->pop_front ();
+                  _veh->set_next_link (_veh->m_route.next ());
                 }
             }
           // according to Dr. Wei Ma, add a nominal path to adaptive users for
@@ -893,11 +991,9 @@ MNM_Routing_Biclass_Fixed::update_routing (TInt timestamp)
     {
       _link = _link_it->second;
       _node_ID = _link->m_to_node->m_node_ID;
-      for (auto _veh_it = _link->m_finished_array.begin ();
-           _veh_it != _link->m_finished_array.end (); _veh_it++)
+      // vehicles queued longer were routed when they reached the link end
+      for (MNM_Veh *_veh : _link->get_new_finished (timestamp))
         {
-          _veh = *_veh_it;
-
           // Here is the difference from single-class fixed routing
           if ((_veh->m_type == MNM_TYPE_STATIC)
               && (_veh->get_class () == m_veh_class)
@@ -909,7 +1005,7 @@ MNM_Routing_Biclass_Fixed::update_routing (TInt timestamp)
               _veh_dest = _veh->get_destination ();
               if (_veh_dest->m_dest_node->m_node_ID == _node_ID)
                 {
-                  if (m_tracker.find (_veh)->second->size () != 0)
+                  if (!_veh->m_route.at_end ())
                     {
                       throw std::runtime_error ("invalid state");
                     }
@@ -917,21 +1013,19 @@ MNM_Routing_Biclass_Fixed::update_routing (TInt timestamp)
                 }
               else
                 {
-                  if (m_tracker.find (_veh) == m_tracker.end ())
+                  if (!_veh->m_route.is_set ())
                     {
                       throw std::runtime_error (
                         "invalid state: vehicle unregistered for link");
                     }
                   if (_veh->get_current_link () == _veh->get_next_link ())
                     {
-                      _next_link_ID = m_tracker.find (_veh)->second->front ();
-                      if (_next_link_ID == -1)
+                      _next_link = _veh->m_route.next ();
+                      if (_next_link == nullptr)
                         {
                           throw std::runtime_error ("invalid state");
                         }
-                      _next_link = m_link_factory->get_link (_next_link_ID);
                       _veh->set_next_link (_next_link);
-                      m_tracker.find (_veh)->second->pop_front ();
                     }
                 } // end if-else
             }     // end if veh->m_type
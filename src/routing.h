@@ -16,14 +16,16 @@ typedef std::unordered_map<MNM_Destination *, std::unordered_map<TInt, TInt> *>
 class MNM_Routing
 {
 public:
-  MNM_Routing (macposts::Graph &graph, MNM_OD_Factory *od_factory,
+  MNM_Routing (const macposts::Graph &graph, MNM_OD_Factory *od_factory,
                MNM_Node_Factory *node_factory, MNM_Link_Factory *link_factory);
   virtual ~MNM_Routing ();
   virtual int init_routing (Path_Table *path_table = nullptr) { return 0; };
   virtual int update_routing (TInt timestamp) { return 0; };
   virtual int remove_finished (MNM_Veh *veh, bool del = true) { return 0; };
+  // adds the routing tables, path tables and route trackers to report
+  virtual int add_memory_usage (MNM_Memory_Report &report) { return 0; };
 
-  macposts::Graph &m_graph;
+  const macposts::Graph &m_graph;
   MNM_OD_Factory *m_od_factory;
   MNM_Link_Factory *m_link_factory;
   MNM_Node_Factory *m_node_factory;
@@ -33,7 +35,7 @@ public:
 class MNM_Routing_Random : public MNM_Routing
 {
 public:
-  MNM_Routing_Random (macposts::Graph &graph, MNM_OD_Factory *od_factory,
+  MNM_Routing_Random (const macposts::Graph &graph, MNM_OD_Factory *od_factory,
                       MNM_Node_Factory *node_factory,
                       MNM_Link_Factory *link_factory);
   virtual ~MNM_Routing_Random () override;
@@ -44,7 +46,8 @@ public:
 class MNM_Routing_Adaptive : public MNM_Routing
 {
 public:
-  MNM_Routing_Adaptive (const std::string &file_folder, macposts::Graph &graph,
+  MNM_Routing_Adaptive (const std::string &file_folder,
+                        const macposts::Graph &graph,
                         MNM_Statistics *statistics, MNM_OD_Factory *od_factory,
                         MNM_Node_Factory *node_factory,
                         MNM_Link_Factory *link_factory);
@@ -52,10 +55,27 @@ public:
   virtual int init_routing (Path_Table *path_table = nullptr) override;
   virtual int update_link_cost ();
   virtual int update_routing (TInt timestamp) override;
+  int update_shortest_path_trees ();
+  virtual int add_memory_usage (MNM_Memory_Report &report) override;
   // private:
   MNM_Statistics *m_statistics;
   std::unordered_map<TInt, TFlt> m_link_cost;
   Routing_Table *m_table;
+  // incremental_sp in config.conf/ADAPTIVE: only repair the trees when few
+  // link costs change; rebuild them when more than sp_rebuild_ratio of the
+  // links changed
+  // m_dist_table keeps the distance labels of each tree, i.e., the cost from
+  // every node to the destination under m_tree_link_cost, the link costs the
+  // trees were last repaired with (only kept with incremental_sp, else the
+  // trees follow m_link_cost).  Without incremental_sp the labels are only
+  // kept when m_keep_dist_table is set, e.g., for the POI costs of
+  // MNM_Routing_Adaptive_With_POIs.
+  bool m_incremental_sp;
+  bool m_keep_dist_table = false;
+  TFlt m_sp_rebuild_ratio;
+  std::unordered_map<TInt, TFlt> m_tree_link_cost;
+  std::unordered_map<MNM_Destination *, std::unordered_map<TInt, TFlt>>
+    m_dist_table;
   TInt m_routing_freq;
   TFlt m_vot;
   MNM_ConfReader *m_self_config;
@@ -65,7 +85,7 @@ public:
 class MNM_Routing_Fixed : public MNM_Routing
 {
 public:
-  MNM_Routing_Fixed (macposts::Graph &graph, MNM_OD_Factory *od_factory,
+  MNM_Routing_Fixed (const macposts::Graph &graph, MNM_OD_Factory *od_factory,
                      MNM_Node_Factory *node_factory,
                      MNM_Link_Factory *link_factory, TInt route_frq = TInt (-1),
                      TInt buffer_len = TInt (-1));
@@ -76,10 +96,21 @@ public:
   int set_path_table (Path_Table *path_table);
   virtual int register_veh (MNM_Veh *veh, bool track = true);
   virtual int remove_finished (MNM_Veh *veh, bool del = true) override;
-  int add_veh_path (MNM_Veh *veh, std::deque<TInt> *link_que);
+  // the links of path, resolved with m_link_factory the first time a vehicle
+  // takes it
+  const std::vector<MNM_Dlink *> *get_path_links (MNM_Path *path);
+  // sets the route cursor of veh to the hop-th link of path
+  int set_veh_route (MNM_Veh *veh, MNM_Path *path, size_t hop = 0);
   virtual int change_choice_portion (TInt interval);
+  virtual int add_memory_usage (MNM_Memory_Report &report) override;
+  int add_route_memory_usage (MNM_Memory_Report &report);
   Path_Table *m_path_table;
-  std::unordered_map<MNM_Veh *, std::deque<TInt> *> m_tracker;
+  // choice among the paths of m_path_table, from the buffer column of the
+  // current routing interval when m_buffer_as_p
+  MNM_Path_Sampler m_sampler;
+  // resolved links by path; per routing rather than per path because a path
+  // table outlives the links of each loading in DUE
+  std::unordered_map<MNM_Path *, std::vector<MNM_Dlink *>> m_path_links;
   bool m_buffer_as_p;
   TInt m_routing_freq;
   TInt m_buffer_length;
@@ -90,7 +121,8 @@ public:
 class MNM_Routing_Hybrid : public MNM_Routing
 {
 public:
-  MNM_Routing_Hybrid (const std::string &file_folder, macposts::Graph &graph,
+  MNM_Routing_Hybrid (const std::string &file_folder,
+                      const macposts::Graph &graph,
                       MNM_Statistics *statistics, MNM_OD_Factory *od_factory,
                       MNM_Node_Factory *node_factory,
                       MNM_Link_Factory *link_factory,
@@ -100,6 +132,7 @@ public:
   virtual int init_routing (Path_Table *path_table = nullptr) override;
   virtual int update_routing (TInt timestamp) override;
   virtual int remove_finished (MNM_Veh *veh, bool del = true) override;
+  virtual int add_memory_usage (MNM_Memory_Report &report) override;
 
   MNM_Routing_Adaptive *m_routing_adaptive;
   MNM_Routing_Fixed *m_routing_fixed;
@@ -110,7 +143,8 @@ public:
 class MNM_Routing_Biclass_Fixed : public MNM_Routing_Fixed
 {
 public:
-  MNM_Routing_Biclass_Fixed (macposts::Graph &graph, MNM_OD_Factory *od_factory,
+  MNM_Routing_Biclass_Fixed (const macposts::Graph &graph,
+                             MNM_OD_Factory *od_factory,
                              MNM_Node_Factory *node_factory,
                              MNM_Link_Factory *link_factory,
                              TInt route_frq = TInt (-1),
@@ -132,7 +166,7 @@ class MNM_Routing_Biclass_Hybrid : public MNM_Routing
 {
 public:
   MNM_Routing_Biclass_Hybrid (
-    const std::string &file_folder, macposts::Graph &graph,
+    const std::string &file_folder, const macposts::Graph &graph,
     MNM_Statistics *statistics, MNM_OD_Factory *od_factory,
     MNM_Node_Factory *node_factory, MNM_Link_Factory *link_factory,
     TInt route_frq_fixed = TInt (-1), TInt buffer_length = TInt (-1));
@@ -140,6 +174,7 @@ public:
   virtual int init_routing (Path_Table *path_table = NULL) override;
   virtual int update_routing (TInt timestamp) override;
   virtual int remove_finished (MNM_Veh *veh, bool del = true) override;
+  virtual int add_memory_usage (MNM_Memory_Report &report) override;
 
   MNM_Routing_Adaptive *m_routing_adaptive;
   MNM_Routing_Biclass_Fixed *m_routing_fixed_car;
@@ -152,7 +187,8 @@ public:
 class MNM_Routing_Predetermined : public MNM_Routing
 {
 public:
-  MNM_Routing_Predetermined (macposts::Graph &graph, MNM_OD_Factory *od_factory,
+  MNM_Routing_Predetermined (const macposts::Graph &graph,
+                             MNM_OD_Factory *od_factory,
                              MNM_Node_Factory *node_factory,
                              MNM_Link_Factory *link_factory,
                              Path_Table *p_table, MNM_Pre_Routing *pre_routing,
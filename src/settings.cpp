@@ -0,0 +1,126 @@
+#include "settings.h"
+
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+TFlt
+read_ratio (MNM_ConfReader *config, const std::string &key)
+{
+  TFlt _ratio;
+  try
+    {
+      _ratio = config->get_float (key);
+    }
+  catch (const std::invalid_argument &ia)
+    {
+      throw std::runtime_error ("MNM_Dta_Settings::load, " + key
+                                + " is required in config.conf/DTA");
+    }
+  if (_ratio > 1)
+    _ratio = 1;
+  if (_ratio < 0)
+    _ratio = 0;
+  return _ratio;
+}
+} // namespace
+
+MNM_Routing_Type
+MNM::routing_type_from_string (const std::string &name)
+{
+  static const std::pair<const char *, MNM_Routing_Type> _names[] = {
+    { "Adaptive", MNM_Routing_Type::Adaptive },
+    { "Predetermined", MNM_Routing_Type::Predetermined },
+    { "Fixed", MNM_Routing_Type::Fixed },
+    { "Due", MNM_Routing_Type::Due },
+    { "Hybrid", MNM_Routing_Type::Hybrid },
+    { "Biclass_Hybrid", MNM_Routing_Type::Biclass_Hybrid },
+    { "Biclass_Hybrid_ColumnGeneration",
+      MNM_Routing_Type::Biclass_Hybrid_ColumnGeneration },
+    { "Multimodal_Hybrid", MNM_Routing_Type::Multimodal_Hybrid },
+    { "Multimodal_Hybrid_ColumnGeneration",
+      MNM_Routing_Type::Multimodal_Hybrid_ColumnGeneration },
+    { "Multimodal_DUE_FixedPath", MNM_Routing_Type::Multimodal_DUE_FixedPath },
+    { "Multimodal_DUE_ColumnGeneration",
+      MNM_Routing_Type::Multimodal_DUE_ColumnGeneration },
+  };
+  for (const auto &_name : _names)
+    {
+      if (name == _name.first)
+        return _name.second;
+    }
+  return MNM_Routing_Type::Other;
+}
+
+bool
+MNM_Dta_Settings::is_multimodal () const
+{
+  return m_routing_type == MNM_Routing_Type::Multimodal_Hybrid
+         || m_routing_type
+              == MNM_Routing_Type::Multimodal_Hybrid_ColumnGeneration
+         || m_routing_type == MNM_Routing_Type::Multimodal_DUE_FixedPath
+         || m_routing_type == MNM_Routing_Type::Multimodal_DUE_ColumnGeneration;
+}
+
+int
+MNM_Dta_Settings::load (MNM_ConfReader *config)
+{
+  m_routing_type_name = config->get_string ("routing_type");
+  m_routing_type = MNM::routing_type_from_string (m_routing_type_name);
+  m_assign_frq = config->get_int ("assign_frq");
+  if (m_assign_frq <= 0)
+    {
+      throw std::runtime_error (
+        "MNM_Dta_Settings::load, assign_frq must be positive");
+    }
+  m_max_interval = config->get_int ("max_interval");
+  try
+    {
+      m_total_interval = config->get_int ("total_interval");
+    }
+  catch (const std::invalid_argument &ia)
+    {
+      m_total_interval = 0;
+    }
+  try
+    {
+      m_memory_log_freq = config->get_int ("memory_log_freq");
+    }
+  catch (const std::invalid_argument &ia)
+    {
+      m_memory_log_freq = 0;
+    }
+  try
+    {
+      m_release_threads = config->get_int ("release_threads");
+    }
+  catch (const std::invalid_argument &ia)
+    {
+      m_release_threads = 0;
+    }
+  try
+    {
+      m_num_threads = config->get_int ("num_threads");
+    }
+  catch (const std::invalid_argument &ia)
+    {
+      m_num_threads = TInt (std::thread::hardware_concurrency ());
+    }
+
+  if (m_routing_type == MNM_Routing_Type::Hybrid)
+    {
+      m_adaptive_ratio = read_ratio (config, "adaptive_ratio");
+    }
+  if (m_routing_type == MNM_Routing_Type::Biclass_Hybrid || is_multimodal ())
+    {
+      m_adaptive_ratio_car = read_ratio (config, "adaptive_ratio_car");
+      m_adaptive_ratio_truck = read_ratio (config, "adaptive_ratio_truck");
+    }
+  if (is_multimodal ())
+    {
+      m_adaptive_ratio_passenger
+        = read_ratio (config, "adaptive_ratio_passenger");
+    }
+  return 0;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "ults.h"
+
+#include <string>
+
+enum class MNM_Routing_Type
+{
+  Adaptive,
+  Predetermined,
+  Fixed,
+  Due,
+  Hybrid,
+  Biclass_Hybrid,
+  Biclass_Hybrid_ColumnGeneration,
+  Multimodal_Hybrid,
+  Multimodal_Hybrid_ColumnGeneration,
+  Multimodal_DUE_FixedPath,
+  Multimodal_DUE_ColumnGeneration,
+  // any other name, kept in m_routing_type_name
+  Other
+};
+
+// The [DTA] keys read while loading (routing type, adaptive ratios, loading
+// length), parsed once from config.conf when a simulation is initialized so
+// that the per interval and per origin code does not go through the string
+// keyed MNM_ConfReader.  load () throws if a key needed by the routing type
+// is missing.
+struct MNM_Dta_Settings
+{
+  std::string m_routing_type_name;
+  MNM_Routing_Type m_routing_type = MNM_Routing_Type::Other;
+  // assign_frq as written in config.conf, in loading intervals
+  TInt m_assign_frq = 0;
+  TInt m_max_interval = 0;
+  // <= 0 to load until no vehicle is running
+  TInt m_total_interval = 0;
+  // 0 turns the memory log off
+  TInt m_memory_log_freq = 0;
+  // threads releasing the origins, 0 keeps the serial release that draws
+  // all origins from one random stream; any positive value gives each origin
+  // its own stream, so the loading does not depend on the number of threads
+  TInt m_release_threads = 0;
+  // threads filling the per link travel time and cost matrices after
+  // loading, the hardware concurrency when num_threads is not set
+  TInt m_num_threads = 1;
+
+  // clamped to [0, 1], only read for the routing types releasing adaptive
+  // travelers: adaptive_ratio for Hybrid, the car and truck ratios for
+  // Biclass_Hybrid and the multimodal types, which also read the passenger one
+  TFlt m_adaptive_ratio = 0;
+  TFlt m_adaptive_ratio_car = 0;
+  TFlt m_adaptive_ratio_truck = 0;
+  TFlt m_adaptive_ratio_passenger = 0;
+
+  int load (MNM_ConfReader *config);
+  bool is_multimodal () const;
+};
+
+namespace MNM
+{
+MNM_Routing_Type routing_type_from_string (const std::string &name);
+}
@@ -1,5 +1,7 @@
 #include "shortest_path.h"
 
+#include <unordered_set>
+
 using macposts::graph::Direction;
 
 static_assert (std::numeric_limits<double>::is_iec559,
@@ -153,7 +155,21 @@ MNM_Shortest_Path::all_to_one_FIFO (
   const std::unordered_map<TInt, TFlt> &cost_map,
   std::unordered_map<TInt, TInt> &output_map)
 {
-  std::unordered_map<TInt, TFlt> _dist = std::unordered_map<TInt, TFlt> ();
+  std::unordered_map<TInt, TFlt> dist_to_dest
+    = std::unordered_map<TInt, TFlt> ();
+  return all_to_one_FIFO (dest_node_ID, graph, dist_to_dest, cost_map,
+                          output_map);
+}
+
+int
+MNM_Shortest_Path::all_to_one_FIFO (
+  TInt dest_node_ID, const macposts::Graph &graph,
+  std::unordered_map<TInt, TFlt> &dist_to_dest,
+  const std::unordered_map<TInt, TFlt> &cost_map,
+  std::unordered_map<TInt, TInt> &output_map)
+{
+  std::unordered_map<TInt, TFlt> &_dist = dist_to_dest;
+  _dist.clear ();
   _dist.insert (std::pair<TInt, TFlt> (dest_node_ID, TFlt (0)));
 
   std::deque<TInt> m_Q = std::deque<TInt> ();
@@ -217,7 +233,210 @@ MNM_Shortest_Path::all_to_one_FIFO (
 
   m_Q.clear ();
   m_Q_support.clear ();
+  return 0;
+}
+
+int
+MNM_Shortest_Path::one_to_all_FIFO (
+  TInt src_node_ID, const macposts::Graph &graph,
+  std::unordered_map<TInt, TFlt> &dist_from_src,
+  const std::unordered_map<TInt, TFlt> &cost_map)
+{
+  std::unordered_map<TInt, TFlt> &_dist = dist_from_src;
   _dist.clear ();
+  std::deque<TInt> _Q = std::deque<TInt> ();
+  std::unordered_map<TInt, bool> _Q_support = std::unordered_map<TInt, bool> ();
+
+  for (const auto &node : graph.nodes ())
+    {
+      TInt _node_ID = graph.get_id (node);
+      _dist.insert (std::pair<TInt, TFlt> (
+        _node_ID, TFlt (std::numeric_limits<double>::infinity ())));
+      _Q_support.insert (std::pair<TInt, bool> (_node_ID, false));
+    }
+  _dist.find (src_node_ID)->second = TFlt (0);
+  _Q.push_back (src_node_ID);
+  _Q_support.find (src_node_ID)->second = true;
+
+  TInt _out_node_ID, _tmp_ID;
+  TFlt _alt, _tmp_dist;
+  while (!_Q.empty ())
+    {
+      _tmp_ID = _Q.front ();
+      _Q.pop_front ();
+      _Q_support.find (_tmp_ID)->second = false;
+      const auto &node = graph.get_node (_tmp_ID);
+      _tmp_dist = _dist.find (_tmp_ID)->second;
+      for (const auto &link : graph.connections (node, Direction::Outgoing))
+        {
+          _out_node_ID = graph.get_id (graph.get_endpoints (link).second);
+          _alt = _tmp_dist + cost_map.find (graph.get_id (link))->second;
+          auto _dist_it = _dist.find (_out_node_ID);
+          if (_alt < _dist_it->second)
+            {
+              _dist_it->second = _alt;
+              auto _support_it = _Q_support.find (_out_node_ID);
+              if (!_support_it->second)
+                {
+                  _Q.push_back (_out_node_ID);
+                  _support_it->second = true;
+                }
+            }
+        }
+    }
+  return 0;
+}
+
+std::vector<std::pair<TInt, TFlt>>
+MNM_Shortest_Path::update_changed_link_cost (
+  std::unordered_map<TInt, TFlt> &tree_cost_map,
+  const std::unordered_map<TInt, TFlt> &cost_map)
+{
+  std::vector<std::pair<TInt, TFlt>> _changed_links;
+  for (const auto &_it : cost_map)
+    {
+      auto _tree_it = tree_cost_map.find (_it.first);
+      if (_tree_it == tree_cost_map.end ())
+        {
+          throw std::runtime_error (
+            "Error, MNM_Shortest_Path::update_changed_link_cost, link "
+            + std::to_string (_it.first) + " has no tree cost");
+        }
+      if (_it.second == _tree_it->second
+          || MNM_Ults::approximate_equal (_it.second, _tree_it->second))
+        continue;
+      _changed_links.push_back (
+        std::pair<TInt, TFlt> (_it.first, _tree_it->second));
+      _tree_it->second = _it.second;
+    }
+  return _changed_links;
+}
+
+int
+MNM_Shortest_Path::repair_all_to_one_FIFO (
+  TInt dest_node_ID, const macposts::Graph &graph,
+  std::unordered_map<TInt, TFlt> &dist_to_dest,
+  const std::unordered_map<TInt, TFlt> &cost_map,
+  const std::vector<std::pair<TInt, TFlt>> &changed_links,
+  std::unordered_map<TInt, TInt> &output_map)
+{
+  const TFlt _inf = TFlt (std::numeric_limits<double>::infinity ());
+  std::deque<TInt> _Q = std::deque<TInt> ();
+  std::unordered_set<TInt> _in_Q = std::unordered_set<TInt> ();
+  auto _push = [&] (TInt node_ID) {
+    if (_in_Q.insert (node_ID).second)
+      _Q.push_back (node_ID);
+  };
+
+  // a tree link that got more expensive invalidates every label behind it
+  TInt _link_ID, _from_ID, _to_ID;
+  std::vector<TInt> _roots;
+  for (const auto &_change : changed_links)
+    {
+      _link_ID = _change.first;
+      _from_ID = graph.get_id (graph.get_endpoints (_link_ID).first);
+      auto _tree_it = output_map.find (_from_ID);
+      if (cost_map.find (_link_ID)->second > _change.second
+          && _tree_it != output_map.end () && _tree_it->second == _link_ID)
+        {
+          _roots.push_back (_from_ID);
+        }
+    }
+
+  std::unordered_set<TInt> _affected = std::unordered_set<TInt> ();
+  if (!_roots.empty ())
+    {
+      std::unordered_map<TInt, std::vector<TInt>> _children;
+      for (const auto &_tree_it : output_map)
+        {
+          if (_tree_it.second < 0)
+            continue;
+          _to_ID = graph.get_id (graph.get_endpoints (_tree_it.second).second);
+          _children[_to_ID].push_back (_tree_it.first);
+        }
+      std::vector<TInt> _stack = _roots;
+      while (!_stack.empty ())
+        {
+          _from_ID = _stack.back ();
+          _stack.pop_back ();
+          if (!_affected.insert (_from_ID).second)
+            continue;
+          auto _child_it = _children.find (_from_ID);
+          if (_child_it != _children.end ())
+            _stack.insert (_stack.end (), _child_it->second.begin (),
+                           _child_it->second.end ());
+        }
+      for (TInt _node_ID : _affected)
+        {
+          dist_to_dest.find (_node_ID)->second = _inf;
+          output_map.find (_node_ID)->second = -1;
+        }
+      // reattach the cut-off nodes to the part of the tree still valid
+      TFlt _alt;
+      for (TInt _node_ID : _affected)
+        {
+          TFlt &_dist = dist_to_dest.find (_node_ID)->second;
+          for (const auto &link :
+               graph.connections (_node_ID, Direction::Outgoing))
+            {
+              _to_ID = graph.get_id (graph.get_endpoints (link).second);
+              if (_affected.find (_to_ID) != _affected.end ())
+                continue;
+              _alt = dist_to_dest.find (_to_ID)->second
+                     + cost_map.find (graph.get_id (link))->second;
+              if (_alt < _dist)
+                {
+                  _dist = _alt;
+                  output_map.find (_node_ID)->second = graph.get_id (link);
+                }
+            }
+          if (_dist < _inf)
+            _push (_node_ID);
+        }
+    }
+
+  // a link that got cheaper may offer a shortcut to its tail node
+  TFlt _alt;
+  for (const auto &_change : changed_links)
+    {
+      _link_ID = _change.first;
+      if (!(cost_map.find (_link_ID)->second < _change.second))
+        continue;
+      auto &&_ends = graph.get_endpoints (_link_ID);
+      _from_ID = graph.get_id (_ends.first);
+      _to_ID = graph.get_id (_ends.second);
+      _alt = dist_to_dest.find (_to_ID)->second
+             + cost_map.find (_link_ID)->second;
+      if (_alt < dist_to_dest.find (_from_ID)->second)
+        {
+          dist_to_dest.find (_from_ID)->second = _alt;
+          output_map.find (_from_ID)->second = _link_ID;
+          _push (_from_ID);
+        }
+    }
+
+  // propagate the new labels upstream, same as all_to_one_FIFO
+  TInt _tmp_ID;
+  TFlt _tmp_dist;
+  while (!_Q.empty ())
+    {
+      _tmp_ID = _Q.front ();
+      _Q.pop_front ();
+      _in_Q.erase (_tmp_ID);
+      _tmp_dist = dist_to_dest.find (_tmp_ID)->second;
+      for (const auto &link : graph.connections (_tmp_ID, Direction::Incoming))
+        {
+          _from_ID = graph.get_id (graph.get_endpoints (link).first);
+          _link_ID = graph.get_id (link);
+          _alt = _tmp_dist + cost_map.find (_link_ID)->second;
+          if (_alt < dist_to_dest.find (_from_ID)->second)
+            {
+              dist_to_dest.find (_from_ID)->second = _alt;
+              output_map.find (_from_ID)->second = _link_ID;
+              _push (_from_ID);
+            }
+        }
+    }
   return 0;
 }
 
@@ -557,7 +776,7 @@ MNM_Shortest_Path::is_FIFO (const macposts::Graph &graph,
 /*------------------------------------------------------------
                   TDSP  one destination tree
 -------------------------------------------------------------*/
-MNM_TDSP_Tree::MNM_TDSP_Tree (TInt dest_node_ID, macposts::Graph &graph,
+MNM_TDSP_Tree::MNM_TDSP_Tree (TInt dest_node_ID, const macposts::Graph &graph,
                               TInt max_interval)
     : m_graph (graph)
 {
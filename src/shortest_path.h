@@ -36,6 +36,33 @@ int all_to_one_Dijkstra (TInt dest_node_ID, const macposts::Graph &graph,
 int all_to_one_FIFO (TInt dest_node_ID, const macposts::Graph &graph,
                      const std::unordered_map<TInt, TFlt> &cost_map,
                      std::unordered_map<TInt, TInt> &output_map);
+int all_to_one_FIFO (TInt dest_node_ID, const macposts::Graph &graph,
+                     std::unordered_map<TInt, TFlt> &dist_to_dest,
+                     const std::unordered_map<TInt, TFlt> &cost_map,
+                     std::unordered_map<TInt, TInt> &output_map);
+// The links whose cost in cost_map is not approximately equal (see
+// MNM_Ults::approximate_equal) to the one in tree_cost_map, as (link ID, cost
+// in tree_cost_map) for repair_all_to_one_FIFO.  Only their costs are copied
+// into tree_cost_map, so rounding noise sets off no repair and the trees stay
+// exact for tree_cost_map.
+std::vector<std::pair<TInt, TFlt>>
+update_changed_link_cost (std::unordered_map<TInt, TFlt> &tree_cost_map,
+                          const std::unordered_map<TInt, TFlt> &cost_map);
+// Bring a tree and distance labels from all_to_one_FIFO up to date after the
+// links in changed_links (link ID, old cost) moved to their cost in cost_map.
+// Only the subtrees behind links that got more expensive are relabeled, and
+// only the nodes reached through cheaper links are propagated.
+int repair_all_to_one_FIFO (
+  TInt dest_node_ID, const macposts::Graph &graph,
+  std::unordered_map<TInt, TFlt> &dist_to_dest,
+  const std::unordered_map<TInt, TFlt> &cost_map,
+  const std::vector<std::pair<TInt, TFlt>> &changed_links,
+  std::unordered_map<TInt, TInt> &output_map);
+// distance labels from src_node_ID to every node (infinity if unreachable),
+// the forward counterpart of all_to_one_FIFO without the tree
+int one_to_all_FIFO (TInt src_node_ID, const macposts::Graph &graph,
+                     std::unordered_map<TInt, TFlt> &dist_from_src,
+                     const std::unordered_map<TInt, TFlt> &cost_map);
 // with link cost, for last time step of TDSP
 int all_to_one_FIFO (TInt dest_node_ID, const macposts::Graph &graph,
                      const std::unordered_map<TInt, TFlt *> &cost_map,
@@ -92,7 +119,8 @@ bool is_FIFO (const macposts::Graph &graph,
 class MNM_TDSP_Tree
 {
 public:
-  MNM_TDSP_Tree (TInt dest_node_ID, macposts::Graph &graph, TInt max_interval);
+  MNM_TDSP_Tree (TInt dest_node_ID, const macposts::Graph &graph,
+                 TInt max_interval);
   ~MNM_TDSP_Tree ();
 
   int initialize ();
@@ -122,7 +150,7 @@ public:
   std::unordered_map<TInt, TFlt *> m_dist;
   std::unordered_map<TInt, TInt *> m_tree;
   TInt m_dest_node_ID;
-  macposts::Graph &m_graph;
+  const macposts::Graph &m_graph;
   TInt m_max_interval;
 };
 
@@ -1,18 +1,33 @@
 #include "ults.h"
+#include <atomic>
 #include <cmath>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace MNM_Ults
 {
+static std::atomic<unsigned int> default_seed (std::mt19937::default_seed);
+
 void
 set_random_state (unsigned int s)
 {
-  std::srand (s);
+  default_seed = s;
+  rng ().seed (s);
+}
+
+std::mt19937 &
+rng ()
+{
+  thread_local std::mt19937 _rng (default_seed);
+  return _rng;
 }
 
 TInt
 round (TFlt in)
 {
-  TFlt rdNum = TFlt (std::rand () / (1.0 * RAND_MAX));
+  TFlt rdNum = rand_flt ();
   TFlt floorN = TFlt (TInt (in));
   if ((in - floorN) > rdNum)
     return TInt (floorN + 1);
@@ -41,7 +56,15 @@ mod (TInt a, TInt b)
 TFlt
 rand_flt ()
 {
-  return TFlt ((double) std::rand () / (RAND_MAX));
+  return TFlt ((double) rng () () / std::mt19937::max ());
+}
+
+TInt
+rand_int (TInt n)
+{
+  if (n <= TInt (0))
+    return TInt (0);
+  return std::uniform_int_distribution<TInt> (0, n - 1) (rng ());
 }
 
 TFlt
@@ -145,7 +168,61 @@ reverse_graph (const macposts::Graph &graph)
     }
   return reversed_graph;
 }
+
+int
+parallel_for (size_t num_jobs, int num_threads,
+              const std::function<void (size_t, int)> &job)
+{
+  size_t _num_workers
+    = std::min (size_t (std::max (num_threads, 1)), std::max (num_jobs,
+                                                                size_t (1)));
+  if (_num_workers == 1)
+    {
+      for (size_t i = 0; i < num_jobs; ++i)
+        job (i, 0);
+      return 0;
+    }
+
+  std::atomic<size_t> _next (0);
+  std::mutex _error_mutex;
+  size_t _error_job = num_jobs;
+  std::exception_ptr _error = nullptr;
+  auto _work = [&] (int worker) {
+    for (size_t i = _next++; i < num_jobs; i = _next++)
+      {
+        try
+          {
+            job (i, worker);
+          }
+        catch (...)
+          {
+            std::lock_guard<std::mutex> _lock (_error_mutex);
+            if (i < _error_job)
+              {
+                _error_job = i;
+                _error = std::current_exception ();
+              }
+          }
+      }
+  };
+  std::vector<std::thread> _threads;
+  for (size_t w = 1; w < _num_workers; ++w)
+    _threads.push_back (std::thread (_work, int (w)));
+  _work (0);
+  for (auto &_thread : _threads)
+    _thread.join ();
+  if (_error != nullptr)
+    std::rethrow_exception (_error);
+  return 0;
 }
+}
+
+MNM_Rng_Scope::MNM_Rng_Scope (unsigned int seed) : m_saved (MNM_Ults::rng ())
+{
+  MNM_Ults::rng ().seed (seed);
+}
+
+MNM_Rng_Scope::~MNM_Rng_Scope () { MNM_Ults::rng () = m_saved; }
 
 Chameleon::Chameleon (std::string const &value) { value_ = value; }
 
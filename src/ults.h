@@ -1,8 +1,11 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdlib>
 #include <fstream>
+#include <functional>
 #include <map>
+#include <random>
 #include <sstream>
 #include <string>
 
@@ -10,11 +13,23 @@
 
 namespace MNM_Ults
 {
+// Every thread draws from its own engine, so independent simulations can run
+// in different threads.  An engine is seeded on first use with the seed last
+// passed to set_random_state, which also reseeds the engine of the caller.
 void set_random_state (unsigned int s);
+std::mt19937 &rng ();
 TInt round (TFlt in);
 TFlt divide (TFlt a, TFlt b);
 TInt mod (TInt a, TInt b);
 TFlt rand_flt ();
+// uniform in [0, n), 0 if n <= 0
+TInt rand_int (TInt n);
+template <typename RandomIt>
+inline void
+random_shuffle (RandomIt first, RandomIt last)
+{
+  std::shuffle (first, last, rng ());
+}
 TFlt max_link_cost ();
 int copy_file (const char *srce_file, const char *dest_file);
 int copy_file (std::string srce_file, std::string dest_file);
@@ -27,8 +42,30 @@ int round_up_time (TFlt time, TFlt p = 1e-4);
 int round_down_time (TFlt time);
 
 macposts::Graph reverse_graph (const macposts::Graph &graph);
+
+// Call job (i, worker) for every i in [0, num_jobs) on up to num_threads
+// threads, worker < max (num_threads, 1) names the calling thread so that
+// jobs can reuse per-thread workspaces.  All jobs are run even if some throw,
+// and then the exception of the lowest failed job is rethrown.
+int parallel_for (size_t num_jobs, int num_threads,
+                  const std::function<void (size_t, int)> &job);
 }
 
+// Until the scope ends, the draws of the calling thread come from an engine
+// seeded with seed, then its previous engine is restored.  A job run in such
+// a scope gets the same numbers on whichever thread runs it.
+class MNM_Rng_Scope
+{
+public:
+  explicit MNM_Rng_Scope (unsigned int seed);
+  ~MNM_Rng_Scope ();
+  MNM_Rng_Scope (const MNM_Rng_Scope &) = delete;
+  MNM_Rng_Scope &operator= (const MNM_Rng_Scope &) = delete;
+
+private:
+  std::mt19937 m_saved;
+};
+
 class Chameleon
 {
 public:
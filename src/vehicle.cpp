@@ -1,4 +1,5 @@
 #include "vehicle.h"
+#include "emission.h"
 
 MNM_Veh::MNM_Veh (TInt ID, TInt start_time)
 {
@@ -29,6 +30,8 @@ int
 MNM_Veh::set_current_link (MNM_Dlink *link)
 {
   m_current_link = link;
+  if (link != nullptr && link->m_emission != nullptr)
+    link->m_emission->register_trip (this);
   return 0;
 }
 
@@ -4,6 +4,7 @@
 #include "dlink.h"
 #include "enum.h"
 #include "od.h"
+#include "route_cursor.h"
 
 #include <deque>
 
@@ -60,6 +61,8 @@ public:
   // encode) m_path for adaptive routing is just nominal, not exactly the actual
   // path
   MNM_Path *m_path;
+  // position on the links of m_path, set by Fixed routing only
+  MNM_Route_Cursor<MNM_Dlink> m_route;
   TInt m_assign_interval;
 
   bool m_tracked;                 // tracked to output route info
@@ -2,64 +2,93 @@
 
 MNM_Workzone::MNM_Workzone (MNM_Node_Factory *node_factory,
                             MNM_Link_Factory *link_factory,
-                            macposts::Graph &graph)
+                            const macposts::Graph &graph)
     : m_graph (graph)
 {
   m_node_factory = node_factory;
   m_link_factory = link_factory;
-  m_disabled_link = std::vector<MNM_Dlink *> ();
   m_workzone_list = std::vector<Link_Workzone> ();
 }
 
-MNM_Workzone::~MNM_Workzone ()
-{
-  m_disabled_link.clear ();
-  m_workzone_list.clear ();
-}
+MNM_Workzone::~MNM_Workzone () { m_workzone_list.clear (); }
 
 int
 MNM_Workzone::init_workzone ()
 {
-  for (Link_Workzone _workzone : m_workzone_list)
+  for (const Link_Workzone &_workzone : m_workzone_list)
     {
-      add_workzone_link (_workzone.m_link_ID);
+      if (m_link_factory->m_link_map.find (_workzone.m_link_ID)
+          == m_link_factory->m_link_map.end ())
+        {
+          throw std::runtime_error (
+            "Error, MNM_Workzone::init_workzone, unknown link "
+            + std::to_string (_workzone.m_link_ID));
+        }
     }
-  return 0;
+  return update_workzone (0);
 }
 
 int
 MNM_Workzone::update_workzone (TInt timestamp)
 {
+  for (const Link_Workzone &_workzone : m_workzone_list)
+    {
+      m_link_factory->get_link (_workzone.m_link_ID)->m_closed = false;
+    }
+  for (const Link_Workzone &_workzone : m_workzone_list)
+    {
+      if (_workzone.m_start_timestamp <= timestamp
+          && (_workzone.m_end_timestamp < 0
+              || timestamp < _workzone.m_end_timestamp))
+        {
+          m_link_factory->get_link (_workzone.m_link_ID)->m_closed = true;
+        }
+    }
   return 0;
 }
 
 int
 MNM_Workzone::add_workzone_link (TInt link_ID)
 {
-  MNM_Dlink *_link = m_link_factory->get_link (link_ID);
-  if (_link == NULL)
+  if (m_link_factory->get_link (link_ID) == nullptr)
     {
       throw std::runtime_error ("failed to get link");
     }
-  MNM_Dnode *_from_node, *_to_node;
-  auto &&sd = m_graph.get_endpoints (link_ID);
-  _from_node = m_node_factory->get_node (m_graph.get_id (sd.first));
-  _to_node = m_node_factory->get_node (m_graph.get_id (sd.second));
-  _from_node->m_out_link_array.erase (
-    std::remove (_from_node->m_out_link_array.begin (),
-                 _from_node->m_out_link_array.end (), _link));
-  _to_node->m_in_link_array.erase (
-    std::remove (_to_node->m_in_link_array.begin (),
-                 _to_node->m_in_link_array.end (), _link));
-  // m_graph->DelEdge (link_ID);
-  assert (false && "deleting a link not implemented");
-  m_link_factory->delete_link (link_ID);
-  m_disabled_link.push_back (_link);
+  Link_Workzone _w = { link_ID, 0, -1 };
+  m_workzone_list.push_back (_w);
   return 0;
 }
 
 int
 MNM_Workzone::delete_workzone_link (TInt link_ID)
 {
+  m_workzone_list.erase (std::remove_if (m_workzone_list.begin (),
+                                         m_workzone_list.end (),
+                                         [link_ID] (const Link_Workzone &w) {
+                                           return w.m_link_ID == link_ID;
+                                         }),
+                         m_workzone_list.end ());
+  m_link_factory->get_link (link_ID)->m_closed = false;
+  return 0;
+}
+
+int
+MNM_Workzone::mask_link_cost (const std::unordered_map<TInt, TFlt *> &link_map,
+                              TInt num_interval, TFlt penalty) const
+{
+  for (const Link_Workzone &_workzone : m_workzone_list)
+    {
+      auto _row_it = link_map.find (_workzone.m_link_ID);
+      if (_row_it == link_map.end ())
+        continue;
+      TInt _end = _workzone.m_end_timestamp < 0
+                    ? num_interval
+                    : std::min (_workzone.m_end_timestamp, num_interval);
+      for (int i = std::max (0, int (_workzone.m_start_timestamp)); i < _end;
+           ++i)
+        {
+          _row_it->second[i] = penalty;
+        }
+    }
   return 0;
 }
@@ -4,28 +4,42 @@
 #include "dlink.h"
 #include "factory.h"
 #include <algorithm>
+#include <unordered_map>
 
+// A link closed for loading intervals [m_start_timestamp, m_end_timestamp),
+// m_end_timestamp < 0 meaning until the end of the simulation
 struct Link_Workzone
 {
   TInt m_link_ID;
-  // TInt m_start_timestamp;
-  // TInt m_end_timestamp;
+  TInt m_start_timestamp;
+  TInt m_end_timestamp;
 };
 
+// Work zones and incidents as a time-dependent availability mask over the
+// links.  The graph and the node/link arrays are never changed: a closed link
+// has MNM_Dlink::m_closed set, so it offers no supply to its upstream node, and
+// is as expensive as a jammed link (MNM_Ults::max_link_cost) in the link cost
+// and travel time maps passed through mask_link_cost.  The penalty is finite,
+// so paths that must cross a closure still get comparable costs.  Many closure
+// scenarios can therefore share one network.
 class MNM_Workzone
 {
 public:
   MNM_Workzone (MNM_Node_Factory *node_factory, MNM_Link_Factory *link_factory,
-                macposts::Graph &graph);
+                const macposts::Graph &graph);
   ~MNM_Workzone ();
 
   MNM_Link_Factory *m_link_factory;
   MNM_Node_Factory *m_node_factory;
-  macposts::Graph &m_graph;
+  const macposts::Graph &m_graph;
   int init_workzone ();
   int update_workzone (TInt timestamp);
+  // close/reopen a link for the whole simulation
   int add_workzone_link (TInt link_ID);
   int delete_workzone_link (TInt link_ID);
-  std::vector<MNM_Dlink *> m_disabled_link;
+  // write penalty into the rows of link_map for the closed intervals, the map
+  // itself is not changed
+  int mask_link_cost (const std::unordered_map<TInt, TFlt *> &link_map,
+                      TInt num_interval, TFlt penalty) const;
   std::vector<Link_Workzone> m_workzone_list;
 };
@@ -215,3 +215,114 @@ route_frq = 180
         with (base_dir / name).open("w") as f:
             f.write(contents)
     return base_dir
+
+
+@pytest.fixture(scope="session")
+def network_7link_realtime(tmp_path_factory):
+    # Demand is kept below what the origin link takes in one tick, as the
+    # link travel time tracker of the rollouts expects.
+    config = """\
+[DTA]
+network_name = Snap_graph
+unit_time = 5
+total_interval = -1
+assign_frq = 180
+start_assign_interval = 0
+max_interval = 10
+flow_scalar = 1
+num_of_link = 7
+num_of_node = 6
+num_of_O = 1
+num_of_D = 1
+OD_pair = 1
+
+routing_type = Fixed
+
+init_demand_split = 0
+
+[STAT]
+rec_mode = LRn
+rec_mode_para = 12
+rec_folder = record
+rec_volume = 1
+volume_load_automatic_rec = 0
+volume_record_automatic_rec = 0
+rec_tt = 1
+tt_load_automatic_rec = 0
+tt_record_automatic_rec = 0
+
+[REALTIME_DTA]
+path_file_name = path_table
+num_path = 3
+num_vms = 0
+estimation_iters = 2
+optimization_iters = 2
+prediction_length = 20
+estimation_length = 20
+sample_point = 5
+estimation_step_size = 0.1
+optimization_step_size = 0.1
+"""
+    graph = """\
+1 1 2
+2 2 3
+3 2 4
+4 3 5
+5 4 5
+6 3 4
+7 5 6
+"""
+    links = """\
+1 PQ 1 99999 99999 99999 1
+2 CTM 1.55 35 600 40 2
+3 CTM 1.55 35 600 40 2
+4 CTM 1.55 35 600 40 1
+5 CTM 1.55 35 600 40 1
+6 CTM 1.55 35 600 40 1
+7 PQ 1 99999 99999 99999 1
+"""
+    nodes = """\
+1 DMOND
+2 FWJ
+3 FWJ
+4 FWJ
+5 FWJ
+6 DMDND
+"""
+    ods = """\
+# origins
+1 1
+# destination
+1 6
+"""
+    demands = """\
+1 1 50 50 50 50 50 50 50 50 50 50
+"""
+    path_table = """\
+1 2 3 5 6
+1 2 4 5 6
+1 2 3 4 5 6
+"""
+    speeds = """\
+5
+2 30
+3 25
+4 30
+5 20
+6 30
+"""
+    base_dir = tmp_path_factory.mktemp("network_7link_realtime")
+    (base_dir / "record").mkdir()
+    for name, contents in [
+        ("config.conf", config),
+        ("Snap_graph", graph),
+        ("path_table", path_table),
+        ("MNM_input_demand", demands),
+        ("MNM_input_link", links),
+        ("MNM_input_node", nodes),
+        ("MNM_input_od", ods),
+        ("MNM_input_spd", speeds),
+    ]:
+        with (base_dir / name).open("w") as f:
+            f.write(contents)
+    return base_dir
@@ -0,0 +1,134 @@
+"""A 3x3 grid with three origins on the top row and three destinations on
+the bottom row."""
+
+import pytest
+
+SIZE = 3
+NUM_INTERVALS = 10
+
+
+def grid_node(row, col):
+    return row * SIZE + col + 1
+
+
+@pytest.fixture(scope="session")
+def network_grid(tmp_path_factory):
+    origins = [SIZE * SIZE + col + 1 for col in range(SIZE)]
+    dests = [SIZE * SIZE + SIZE + col + 1 for col in range(SIZE)]
+
+    edges = []
+    for row in range(SIZE):
+        for col in range(SIZE):
+            if col + 1 < SIZE:
+                edges.append((grid_node(row, col), grid_node(row, col + 1)))
+                edges.append((grid_node(row, col + 1), grid_node(row, col)))
+            if row + 1 < SIZE:
+                edges.append((grid_node(row, col), grid_node(row + 1, col)))
+                edges.append((grid_node(row + 1, col), grid_node(row, col)))
+    num_roads = len(edges)
+    for col in range(SIZE):
+        edges.append((origins[col], grid_node(0, col)))
+        edges.append((grid_node(SIZE - 1, col), dests[col]))
+
+    graph = "".join(
+        f"{i + 1} {from_} {to}\n" for i, (from_, to) in enumerate(edges)
+    )
+    links = "".join(
+        f"{i + 1} CTM 0.5 35 1000 200 1\n"
+        if i < num_roads
+        else f"{i + 1} PQ 1 99999 99999 99999 1\n"
+        for i in range(len(edges))
+    )
+    nodes = "".join(f"{n} FWJ\n" for n in range(1, SIZE * SIZE + 1))
+    nodes += "".join(f"{n} DMOND\n" for n in origins)
+    nodes += "".join(f"{n} DMDND\n" for n in dests)
+    ods = "# origins\n"
+    ods += "".join(f"{i + 1} {n}\n" for i, n in enumerate(origins))
+    ods += "# destination\n"
+    ods += "".join(f"{i + 1} {n}\n" for i, n in enumerate(dests))
+    demands = ""
+    for o in range(SIZE):
+        for d in range(SIZE):
+            flows = [
+                str(20 + 10 * ((o + d + t) % 3)) for t in range(NUM_INTERVALS)
+            ]
+            demands += f"{o + 1} {d + 1} " + " ".join(flows) + "\n"
+
+    # Across the top row and down, and down and across the bottom row.
+    paths = []
+    for o in range(SIZE):
+        for d in range(SIZE):
+            step = 1 if d >= o else -1
+            top = [grid_node(0, c) for c in range(o, d + step, step)]
+            down = [grid_node(r, d) for r in range(1, SIZE)]
+            paths.append([origins[o]] + top + down + [dests[d]])
+            if o != d:
+                down = [grid_node(r, o) for r in range(SIZE)]
+                bottom = [
+                    grid_node(SIZE - 1, c)
+                    for c in range(o + step, d + step, step)
+                ]
+                paths.append([origins[o]] + down + bottom + [dests[d]])
+    path_table = "".join(" ".join(map(str, p)) + "\n" for p in paths)
+    path_table_buffer = "".join(
+        " ".join(["1"] * NUM_INTERVALS) + "\n" for _ in paths
+    )
+
+    config = f"""\
+[DTA]
+network_name = Snap_graph
+unit_time = 5
+total_interval = -1
+assign_frq = 180
+start_assign_interval = 0
+max_interval = {NUM_INTERVALS}
+flow_scalar = 2
+num_of_link = {len(edges)}
+num_of_node = {SIZE * SIZE + 2 * SIZE}
+num_of_O = {SIZE}
+num_of_D = {SIZE}
+OD_pair = {SIZE * SIZE}
+
+adaptive_ratio = 0.5
+routing_type = Hybrid
+
+init_demand_split = 0
+
+[STAT]
+rec_mode = LRn
+rec_mode_para = 12
+rec_folder = record
+rec_volume = 1
+volume_load_automatic_rec = 0
+volume_record_automatic_rec = 0
+rec_tt = 1
+tt_load_automatic_rec = 0
+tt_record_automatic_rec = 0
+
+[HYBRID]
+route_frq = 180
+
+[FIXED]
+path_file_name = path_table
+num_path = {len(paths)}
+choice_portion = Buffer
+buffer_length = {NUM_INTERVALS}
+route_frq = 180
+
+[ADAPTIVE]
+route_frq = 180
+"""
+    base_dir = tmp_path_factory.mktemp("network_grid")
+    for name, contents in [
+        ("config.conf", config),
+        ("Snap_graph", graph),
+        ("path_table", path_table),
+        ("path_table_buffer", path_table_buffer),
+        ("MNM_input_demand", demands),
+        ("MNM_input_link", links),
+        ("MNM_input_node", nodes),
+        ("MNM_input_od", ods),
+    ]:
+        with (base_dir / name).open("w") as f:
+            f.write(contents)
+    return base_dir
@@ -0,0 +1,172 @@
+"""A single corridor with a car path and a bus route, for multimodal loading.
+
+Origin 1 and destination 4 are joined by driving links 1 -> 2 -> 3 -> 4. The
+bus route stops at physical stops 201 and 202 on link 2. Travelers either walk
+to stop 201, ride the bus to stop 202 and walk on to the destination, or walk
+all the way."""
+
+import pytest
+
+NUM_INTERVALS = 6
+
+
+@pytest.fixture(scope="session")
+def network_multimodal(tmp_path_factory):
+    transit_flows = " ".join(
+        str(30 + 10 * (t % 3)) for t in range(NUM_INTERVALS)
+    )
+    # Travelers take the bus in even intervals and walk in odd ones.
+    bus_choice = [1 - t % 2 for t in range(NUM_INTERVALS)]
+    bustransit_buffer = "".join(
+        " ".join(map(str, row)) + "\n"
+        for row in [bus_choice, [1 - c for c in bus_choice]]
+    )
+    config = f"""\
+[DTA]
+network_name = Snap_graph
+unit_time = 5
+total_interval = {NUM_INTERVALS * 180 * 2}
+assign_frq = 180
+start_assign_interval = 0
+max_interval = {NUM_INTERVALS}
+flow_scalar = 2
+num_of_link = 3
+num_of_node = 4
+num_of_O = 1
+num_of_D = 1
+OD_pair_passenger = 1
+OD_pair_driving = 1
+OD_pair_pnr = 0
+OD_pair_bustransit = 1
+num_of_bus_stop_physical = 2
+num_of_bus_stop_virtual = 2
+num_of_parking_lot = 0
+num_of_walking_link = 5
+num_of_bus_link = 1
+num_bus_routes = 1
+
+bus_capacity = 20
+fixed_dwell_time = 5
+boarding_lost_time = 0
+boarding_time_per_passenger = 2
+alighting_time_per_passenger = 2
+explicit_bus = 1
+historical_bus_waiting_time = 0
+
+adaptive_ratio_passenger = 0
+adaptive_ratio_car = 0
+adaptive_ratio_truck = 0
+routing_type = Multimodal_Hybrid
+
+init_demand_split = 0
+passenger_cohort = 0
+
+[STAT]
+rec_mode = LRn
+rec_mode_para = 12
+rec_folder = record
+rec_volume = 1
+volume_load_automatic_rec = 0
+volume_record_automatic_rec = 0
+rec_tt = 1
+tt_load_automatic_rec = 0
+tt_record_automatic_rec = 0
+
+[ADAPTIVE]
+route_frq = 180
+vot = 20
+bus_fare = 1
+metro_fare = 1
+pnr_inconvenience = 0
+bus_inconvenience = 0
+parking_lot_to_destination_walking_time = 0
+carpool_cost_multiplier = 1
+
+[FIXED]
+choice_portion = Buffer
+buffer_length = {2 * NUM_INTERVALS}
+route_frq = 180
+driving_path_file_name = driving_path_table
+num_driving_path = 1
+bustransit_path_file_name = bustransit_path_table
+num_bustransit_path = 2
+pnr_path_file_name = pnr_path_table
+num_pnr_path = 0
+bus_path_file_name = bus_path_table
+bus_route_file_name = bus_route
+num_bus_routes = 1
+
+[MMDUE]
+driving = 1
+transit = 1
+pnr = 1
+alpha1_driving = 0
+alpha1_transit = 0
+alpha1_pnr = 0
+beta1 = 0
+vot = 20
+early_penalty = 0
+late_penalty = 0
+target_time = 0
+parking_lot_to_destination_walking_time = 0
+carpool_cost_multiplier = 1
+bus_fare = 1
+metro_fare = 1
+pnr_inconvenience = 0
+bus_inconvenience = 0
+max_iter = 1
+step_size = 0.1
+"""
+    files = {
+        "config.conf": config,
+        "Snap_graph": "# EdgeId FromNodeId ToNodeId\n1 1 2\n2 2 3\n3 3 4\n",
+        "driving_node": (
+            "# ID type convert_factor\n"
+            "1 DMOND 1\n2 FWJ 1\n3 FWJ 1\n4 DMDND 1\n"
+        ),
+        "driving_link": (
+            "# ID type length ffs_car cap_car rhoj_car lanes ffs_truck "
+            "cap_truck rhoj_truck convert_factor\n"
+            "1 PQ 1 99999 99999 99999 1 99999 99999 99999 1\n"
+            "2 CTM 0.5 30 1800 200 1 25 1600 200 2\n"
+            "3 PQ 1 99999 99999 99999 1 99999 99999 99999 1\n"
+        ),
+        "od": "# origin\n1 1 0\n# destination\n1 4\n",
+        "bus_stop_physical": "# ID link loc route\n201 2 0.1 1\n202 2 0.4 1\n",
+        "bus_stop_virtual": "# ID physical route\n211 201 1\n212 202 1\n",
+        "parking_lot": "# ID node price surge avg_time capacity\n",
+        "walking_link": (
+            "# ID from to from_type to_type walking_type time\n"
+            "1 1 201 origin bus_stop_physical normal 60\n"
+            "2 201 211 bus_stop_physical bus_stop_virtual boarding 0\n"
+            "3 212 202 bus_stop_virtual bus_stop_physical alighting 0\n"
+            "4 202 4 bus_stop_physical destination normal 60\n"
+            "5 1 4 origin destination normal 900\n"
+        ),
+        "bus_link": "# ID from to length fftt route links\n"
+        "101 211 212 0.3 0.01 1 2\n",
+        "driving_demand": (
+            "# O D car truck\n"
+            f"1 1 {' '.join(['40'] * NUM_INTERVALS)} "
+            f"{' '.join(['4'] * NUM_INTERVALS)}\n"
+        ),
+        "bus_demand": (
+            f"# O D route bus\n1 1 1 {' '.join(['1'] * NUM_INTERVALS)}\n"
+        ),
+        "bustransit_demand": f"# O D passenger\n1 1 {transit_flows}\n",
+        "passenger_demand": f"# O D passenger\n1 1 {transit_flows}\n",
+        "driving_path_table": "1 2 3 4\n",
+        "driving_path_table_buffer": " ".join(["1"] * 2 * NUM_INTERVALS)
+        + "\n",
+        "bustransit_path_table": "# O D links\n1 4 1 2 101 3 4\n1 4 5\n",
+        "bustransit_path_table_buffer": bustransit_buffer,
+        "pnr_path_table": "",
+        "bus_path_table": "# O D route nodes\n1 4 1 1 2 3 4\n",
+        "bus_route": "# O D route stops\n1 4 1 211 212\n",
+    }
+    base_dir = tmp_path_factory.mktemp("network_multimodal")
+    for name, contents in files.items():
+        with (base_dir / name).open("w") as f:
+            f.write(contents)
+    (base_dir / "record").mkdir()
+    return base_dir
@@ -1,7 +1,10 @@
+import json
 import macposts
 import numpy as np
 import platform
 import pytest
+import shutil
+import threading
 from .conftest import SEED, NUM_REPRO_RUNS
 
 
@@ -27,6 +30,50 @@ def test_reproducibility(network, request):
         in_ccs, out_ccs = in_ccs_, out_ccs_
 
 
+@pytest.mark.parametrize("network", ["network_3link", "network_7link"])
+def test_threaded_runs(network, request):
+    network = request.getfixturevalue(network)
+
+    def run(results, idx):
+        dta = macposts.Dta.from_files(network)
+        dta.register_links()
+        dta.install_cc()
+        dta.run_whole()
+        results[idx] = (dta.get_in_ccs(), dta.get_out_ccs())
+
+    # Each thread seeds its own generator from the last seed set.
+    macposts.set_random_state(SEED)
+    results = [None] * 4
+    threads = [
+        threading.Thread(target=run, args=(results, i))
+        for i in range(len(results))
+    ]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    for in_ccs, out_ccs in results[1:]:
+        assert np.allclose(in_ccs, results[0][0], equal_nan=True)
+        assert np.allclose(out_ccs, results[0][1], equal_nan=True)
+
+
+def test_shared_network(network_7link):
+    macposts.set_random_state(SEED)
+    dta = macposts.Dta.from_files(network_7link)
+    dta.register_links()
+    dta.install_cc()
+    dta.run_whole()
+
+    macposts.set_random_state(SEED)
+    dta_ = macposts.Dta.from_files(network_7link, shared=dta)
+    assert list(dta_.links) == list(dta.links)
+    dta_.register_links()
+    dta_.install_cc()
+    dta_.run_whole()
+    assert np.allclose(dta_.get_in_ccs(), dta.get_in_ccs(), equal_nan=True)
+    assert np.allclose(dta_.get_out_ccs(), dta.get_out_ccs(), equal_nan=True)
+
+
 def test_3link(network_3link):
     macposts.set_random_state(SEED)
     links = [2, 3, 4]
@@ -53,6 +100,10 @@ def test_3link(network_3link):
     assert np.isclose(out_ccs[0, 0], 0)
     assert np.allclose(out_ccs[:, :-1], in_ccs[:, 1:])
 
+    in_cc_view = dta.get_link_in_cc_view(links[0])
+    assert not in_cc_view.flags.writeable
+    assert np.array_equal(in_cc_view, dta.get_link_in_cc(links[0]))
+
 
 def test_7link(network_7link):
     macposts.set_random_state(SEED)
@@ -78,3 +129,176 @@ def test_7link(network_7link):
     assert in_ccs.shape[1] == 7
     assert out_ccs.shape == in_ccs.shape
     assert np.isclose(out_ccs[0, 0], 0)
+
+
+def test_profile(network_7link, tmp_path):
+    macposts.set_random_state(SEED)
+    dta = macposts.Dta.from_files(network_7link)
+    dta.register_links()
+    dta.install_cc()
+    dta.enable_profile()
+    dta.run_whole()
+
+    profile = dta.get_profile()
+    for phase in ["release", "routing", "node_evolve", "link_evolve"]:
+        stat = profile[phase]
+        assert stat["count"] > 0
+        assert 0 <= stat["max"] <= stat["total"]
+        assert stat["intervals"].shape == (stat["count"], 2)
+        assert np.isclose(stat["intervals"][:, 1].sum(), stat["total"])
+
+    trace = tmp_path / "trace.json"
+    dta.save_profile_trace(str(trace))
+    events = json.loads(trace.read_text())["traceEvents"]
+    assert len(events) == sum(stat["count"] for stat in profile.values())
+
+    dta.enable_profile(False)
+    assert dta.get_profile() == {}
+
+
+def test_memory_usage(network_7link):
+    macposts.set_random_state(SEED)
+    dta = macposts.Dta.from_files(network_7link)
+    dta.register_links()
+    dta.install_cc()
+    dta.install_cc_tree()
+
+    before = dta.get_memory_usage()
+    assert before["cumulative_curves"]["count"] == 2 * 7
+    dta.run_whole()
+    after = dta.get_memory_usage()
+
+    for category in ["vehicles", "cumulative_curves", "path_table"]:
+        assert after[category]["bytes"] > 0
+    assert after["path_table"]["count"] == before["path_table"]["count"]
+    assert after["cumulative_curves"]["count"] > 2 * 7
+    assert after["tree_cumulative_curves"]["count"] > 0
+
+
+def test_generate_shortest_pathsets_threads(network_grid, tmp_path):
+    tables = []
+    for num_threads in [1, 4]:
+        folder = tmp_path / f"threads_{num_threads}"
+        shutil.copytree(network_grid, folder)
+        dta = macposts.Dta()
+        dta.generate_shortest_pathsets(
+            str(folder), 3, 20.0, 1.1, 1.5, num_threads=num_threads
+        )
+        tables.append(
+            [
+                (folder / name).read_text()
+                for name in ["path_table", "path_table_buffer"]
+            ]
+        )
+    assert tables[0][0]
+    assert tables[1] == tables[0]
+
+
+def test_release_threads(network_grid, tmp_path):
+    ccs = []
+    for num_threads in [1, 4]:
+        folder = tmp_path / f"threads_{num_threads}"
+        shutil.copytree(network_grid, folder)
+        config = folder / "config.conf"
+        config.write_text(
+            config.read_text().replace(
+                "routing_type = Hybrid",
+                f"routing_type = Hybrid\nrelease_threads = {num_threads}",
+            )
+        )
+        macposts.set_random_state(SEED)
+        dta = macposts.Dta.from_files(folder)
+        dta.register_links()
+        dta.install_cc()
+        dta.run_whole()
+        ccs.append((dta.get_in_ccs(), dta.get_out_ccs()))
+    assert np.nanmax(ccs[0][0]) > 0
+    for i in range(2):
+        assert np.array_equal(ccs[1][i], ccs[0][i], equal_nan=True)
+
+
+def test_link_tt(network_7link):
+    macposts.set_random_state(SEED)
+    dta = macposts.Dta.from_files(network_7link)
+    dta.register_links()
+    dta.install_cc()
+    dta.run_whole()
+
+    # A single trial over one interval is the per-interval link travel time.
+    starts = np.arange(dta.get_cur_loading_interval())
+    tt = dta.get_link_tt(starts, True)
+    tt_ = dta.get_link_tt_robust(starts.astype(float), starts + 1.0, 1, True)
+    assert tt.shape == (7, len(starts))
+    assert np.array_equal(tt, tt_)
+
+
+def test_registered_path_tt(network_7link):
+    macposts.set_random_state(SEED)
+    dta = macposts.Dta.from_files(network_7link)
+    dta.register_links()
+    dta.register_paths(np.arange(3, dtype=np.int32))
+    dta.install_cc()
+    dta.run_whole()
+    dta.build_link_cost_map()
+
+    # The registered paths are evaluated in one batch, which must agree with
+    # evaluating each path on its own.
+    starts = np.arange(dta.get_cur_loading_interval(), dtype=np.int32)
+    tt = dta.get_registered_path_tt(starts)
+    cost = dta.get_registered_path_cost(starts)
+    paths = [[1, 2, 4, 7], [1, 3, 5, 7], [1, 2, 6, 5, 7]]
+    assert tt.shape == (len(paths), len(starts))
+    assert cost.shape == tt.shape
+    for i, links in enumerate(paths):
+        tt_cost = dta.get_path_tt(np.array(links, dtype=np.int32), starts)
+        assert np.array_equal(tt[i], tt_cost[0])
+        assert np.array_equal(cost[i], tt_cost[1])
+
+def test_cc_view(network_3link):
+    macposts.set_random_state(SEED)
+    dta = macposts.Dta.from_files(network_3link)
+    dta.register_links()
+    dta.install_cc()
+    # The records still move while loading.
+    with pytest.raises(RuntimeError):
+        dta.get_link_in_cc_view(2)
+    dta.run_whole()
+
+    in_cc_view = dta.get_link_in_cc_view(2)
+    out_cc_view = dta.get_link_out_cc_view(2)
+    in_cc, out_cc = in_cc_view.copy(), out_cc_view.copy()
+    # Loading more would grow the curves under the views.
+    with pytest.raises(RuntimeError):
+        dta.run_whole()
+    with pytest.raises(RuntimeError):
+        dta.install_cc()
+    assert np.array_equal(in_cc_view, in_cc)
+    assert np.array_equal(out_cc_view, out_cc)
+    assert np.array_equal(in_cc_view, dta.get_link_in_cc(2))
+    assert np.array_equal(out_cc_view, dta.get_link_out_cc(2))
+
+
+@pytest.mark.parametrize("num_rollouts", [1, 3])
+def test_realtime_threads(network_7link_realtime, tmp_path, num_rollouts):
+    links = np.arange(1, 8, dtype=np.int32)
+    results = []
+    # The default thread count is the number of cores, which must not change
+    # the results either.
+    for num_threads in [None, 1, 4]:
+        folder = tmp_path / f"threads_{num_threads}"
+        shutil.copytree(network_7link_realtime, folder)
+        settings = f"num_rollouts = {num_rollouts}\n"
+        if num_threads is not None:
+            settings += f"num_threads = {num_threads}\n"
+        with (folder / "config.conf").open("a") as f:
+            f.write(settings)
+        macposts.set_random_state(SEED)
+        dta = macposts.RealtimeDta.from_files(folder)
+        for assign_inter in range(3):
+            dta.run_iteration(assign_inter)
+        results.append((dta.get_path_p(), dta.get_link_tt(links)))
+    assert np.isclose(np.sum(results[0][0]), 1)
+    assert np.max(results[0][1]) > 0
+    for path_p, link_tt in results[1:]:
+        assert np.array_equal(path_p, results[0][0])
+        assert np.array_equal(link_tt, results[0][1])
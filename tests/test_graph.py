@@ -1,6 +1,8 @@
 import pytest
+import random
 import macposts
 from macposts.graph import Direction
+from .conftest import SEED
 
 
 def test_basics():
@@ -106,3 +108,108 @@ def test_cycles():
     assert g.connections(0, Direction.Outgoing) == [0]
     assert g.connections(1, Direction.Incoming) == [0]
     assert g.connections(1, Direction.Outgoing) == [1]
+
+
+def grid_graph(size):
+    g = macposts.Graph()
+    for idx in range(size * size):
+        g.add_node(idx)
+    link = 0
+    for row in range(size):
+        for col in range(size):
+            node = row * size + col
+            neighbors = []
+            if col + 1 < size:
+                neighbors.append(node + 1)
+            if row + 1 < size:
+                neighbors.append(node + size)
+            for other in neighbors:
+                g.add_link(node, other, link)
+                g.add_link(other, node, link + 1)
+                link += 2
+    return g
+
+
+def test_repair_shortest_path_tree():
+    rng = random.Random(SEED)
+    g = grid_graph(6)
+    links = g.links()
+    dest = 0
+    costs = {link: rng.uniform(1, 10) for link in links}
+    tree, dist = g.shortest_path_tree(dest, costs)
+    tree_costs = dict(costs)
+
+    for _ in range(50):
+        # rounding noise on every link, real changes on a few
+        new_costs = {
+            link: cost * (1 + rng.uniform(-1e-9, 1e-9))
+            for link, cost in costs.items()
+        }
+        changed = rng.sample(links, 5)
+        for link in changed:
+            new_costs[link] = rng.uniform(1, 10)
+        old_tree_costs = tree_costs
+        tree, dist, tree_costs = g.repair_shortest_path_tree(
+            dest, tree_costs, new_costs, tree, dist
+        )
+        _, rebuilt = g.shortest_path_tree(dest, new_costs)
+
+        # only the real changes are taken over
+        for link in links:
+            if tree_costs[link] != old_tree_costs[link]:
+                assert link in changed
+            assert tree_costs[link] == pytest.approx(new_costs[link], rel=1e-4)
+        for node in g.nodes():
+            assert dist[node] == pytest.approx(rebuilt[node], rel=1e-4)
+            if node != dest:
+                link = tree[node]
+                head = g.get_endpoints(link)[1]
+                assert dist[node] == pytest.approx(
+                    dist[head] + tree_costs[link]
+                )
+        costs = new_costs
+
+    # noise alone changes nothing
+    noisy = {link: cost * (1 + 1e-9) for link, cost in costs.items()}
+    tree_, dist_, tree_costs_ = g.repair_shortest_path_tree(
+        dest, tree_costs, noisy, tree, dist
+    )
+    assert tree_ == tree
+    assert dist_ == dist
+    assert tree_costs_ == tree_costs
+
+
+def test_transit_shortest_path_tree():
+    # the bus transit graph of a corridor: origin 1 walks to stop 201 or
+    # straight to destination 4, boards route 1 at 211, alights at 212 and
+    # walks on from stop 202
+    g = macposts.Graph()
+    for node in [1, 201, 211, 212, 202, 4]:
+        g.add_node(node)
+    for link, from_, to in [
+        (1, 1, 201),
+        (2, 201, 211),
+        (101, 211, 212),
+        (3, 212, 202),
+        (4, 202, 4),
+        (5, 1, 4),
+        (6, 202, 201),
+    ]:
+        g.add_link(from_, to, link)
+    for costs in [
+        {1: 60, 2: 0, 101: 300, 3: 0, 4: 60, 5: 900, 6: 120},
+        {1: 60, 2: 0, 101: 900, 3: 0, 4: 60, 5: 900, 6: 120},
+        {1: 60, 2: 0, 101: 300, 3: 0, 4: 60, 5: 420, 6: 120},
+    ]:
+        for dest in g.nodes():
+            tree, _ = g.shortest_path_tree(dest, costs)
+            assert g.transit_shortest_path_tree(dest, costs) == tree
+
+    # ties are broken the same way
+    rng = random.Random(SEED)
+    g = grid_graph(6)
+    for _ in range(5):
+        costs = {link: rng.randint(1, 3) for link in g.links()}
+        for dest in g.nodes():
+            tree, _ = g.shortest_path_tree(dest, costs)
+            assert g.transit_shortest_path_tree(dest, costs) == tree
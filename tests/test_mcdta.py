@@ -103,3 +103,21 @@ def test_7link_mc(network_7link_mc):
     assert truck_in_ccs.shape == car_in_ccs.shape
     assert truck_out_ccs.shape == truck_out_ccs.shape
     assert np.isclose(car_in_ccs[0, 0], 0)
+
+
+def test_link_tt_mc(network_7link_mc):
+    macposts.set_random_state(SEED)
+    mcdta = macposts.Mcdta.from_files(network_7link_mc)
+    mcdta.register_links()
+    mcdta.install_cc()
+    mcdta.run_whole()
+
+    # A single trial over one interval is the per-interval link travel time.
+    starts = np.arange(mcdta.get_cur_loading_interval(), dtype=float)
+    for get_tt, get_tt_robust in [
+        (mcdta.get_car_link_tt, mcdta.get_car_link_tt_robust),
+        (mcdta.get_truck_link_tt, mcdta.get_truck_link_tt_robust),
+    ]:
+        tt = get_tt(starts, True)
+        assert tt.shape == (7, len(starts))
+        assert np.array_equal(tt, get_tt_robust(starts, starts + 1, 1, True))
@@ -0,0 +1,79 @@
+import macposts
+import numpy as np
+import pytest
+import shutil
+from .conftest import SEED
+
+WALKING_LINKS = [1, 2, 3, 4, 5]
+BUS_LINKS = [101]
+DRIVING_LINKS = [1, 2, 3]
+
+
+def counts_at(cc, ticks):
+    """Read a cumulative curve record array at the given ticks."""
+    return cc[np.searchsorted(cc[:, 0], ticks, side="right") - 1, 1]
+
+
+def load(network, folder, cohort):
+    shutil.copytree(network, folder)
+    config = folder / "config.conf"
+    config.write_text(
+        config.read_text().replace(
+            "passenger_cohort = 0", f"passenger_cohort = {cohort}"
+        )
+    )
+    macposts.set_random_state(SEED)
+    mmdta = macposts.Mmdta.from_files(folder)
+    mmdta.install_cc()
+    mmdta.run_whole()
+    return mmdta
+
+
+def test_passenger_cohort(network_multimodal, tmp_path):
+    # Cohorts are not equivalent to individual travelers tick by tick: a
+    # cohort is released at once and may board and alight at other ticks
+    # within an assignment interval. Path choices are deterministic in the
+    # fixture, so what stays invariant is the number of travelers that have
+    # entered and left each link by the end of every interval and of loading.
+    flows = []
+    for cohort in [0, 1]:
+        mmdta = load(network_multimodal, tmp_path / f"cohort_{cohort}", cohort)
+        end = mmdta.get_cur_loading_interval()
+        ticks = np.append(np.arange(180, end + 1, 180), end)
+        ccs = []
+        for link in WALKING_LINKS:
+            ccs.append(mmdta.get_walking_link_in_cc(link))
+            ccs.append(mmdta.get_walking_link_out_cc(link))
+        for link in BUS_LINKS:
+            ccs.append(mmdta.get_bus_link_in_passenger_cc(link))
+            ccs.append(mmdta.get_bus_link_out_passenger_cc(link))
+        for link in DRIVING_LINKS:
+            ccs.append(mmdta.get_car_link_in_cc(link))
+            ccs.append(mmdta.get_car_link_out_cc(link))
+        flows.append(np.array([counts_at(cc, ticks) for cc in ccs]))
+    # Both paths and the bus carry travelers.
+    assert np.all(flows[0][: 2 * len(WALKING_LINKS) + 2, -1] > 0)
+    assert np.array_equal(flows[0], flows[1])
+
+
+@pytest.mark.parametrize("cohort", [0, 1])
+def test_transit_link_exit(network_multimodal, tmp_path, cohort):
+    # Every traveler leaves a normal walking link the fixed number of
+    # intervals after entering it, and an alighting link in the next one.
+    # Bus links hand their passengers straight to the alighting link.
+    mmdta = load(network_multimodal, tmp_path / "network", cohort)
+    delays = {1: 12, 3: 1, 4: 12, 5: 180}
+    for link, delay in delays.items():
+        in_cc = mmdta.get_walking_link_in_cc(link)[1:]
+        out_cc = mmdta.get_walking_link_out_cc(link)[1:]
+        assert len(in_cc) > 0
+        assert np.array_equal(out_cc[:, 0], in_cc[:, 0] + delay)
+        assert np.array_equal(out_cc[:, 1], in_cc[:, 1])
+    assert np.array_equal(
+        mmdta.get_bus_link_out_passenger_cc(101),
+        mmdta.get_walking_link_in_cc(3),
+    )
+    assert np.array_equal(
+        mmdta.get_walking_link_out_cc(2),
+        mmdta.get_bus_link_in_passenger_cc(101),
+    )